@@ -0,0 +1,265 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file ChunkRing.cpp
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief a ring of pre-allocated chunk buffers shared between one producer thread and one consumer thread.
+ *
+ */
+#include "ChunkRing.h"
+
+ChunkRing::ChunkRing() {
+	m_chunks = nullptr;
+	m_chunkBytes = nullptr;
+	m_numChunks = 0;
+	m_chunkSize = 0;
+	m_mappedSize = 0;
+	m_fillSeq = 0;
+	m_drainSeq = 0;
+	m_releaseSeq = 0;
+	m_drainHoldBack = 0;
+	m_finished = false;
+	m_aborted = false;
+	pthread_mutex_init(&m_mutex, nullptr);
+	pthread_cond_init(&m_filledCond, nullptr);
+	pthread_cond_init(&m_freeCond, nullptr);
+}
+
+/**
+ * Allocate chunk buffers. Each buffer is mapped on its own pages, so its memory never gets touched
+ * by the heap allocator and can be handed over to the kernel by reference. Buffers are pre-faulted
+ * so the first fill doesn't pay for page faults.
+ *
+ * @param numChunks how many chunk buffers to allocate
+ * @param chunkSize size of each chunk buffer in bytes
+ *
+ * @return true when all chunk buffers allocated successfully
+ */
+bool ChunkRing::allocate(uint32_t numChunks, uint32_t chunkSize) {
+	release();
+	if (numChunks == 0 || chunkSize == 0) {
+		return false;
+	}
+	m_chunks = (uint8_t**) calloc(numChunks, sizeof(uint8_t*));
+	m_chunkBytes = (uint32_t*) calloc(numChunks, sizeof(uint32_t));
+	if (m_chunks == nullptr || m_chunkBytes == nullptr) {
+		release();
+		return false;
+	}
+	long pageSize = sysconf(_SC_PAGESIZE);
+	if (pageSize < CHUNK_RING_BUFF_ALIGNMENT) {
+		pageSize = CHUNK_RING_BUFF_ALIGNMENT;
+	}
+	m_numChunks = numChunks;
+	m_chunkSize = chunkSize;
+	m_mappedSize = ((size_t) chunkSize + pageSize - 1) / pageSize * pageSize;
+	for (uint32_t i = 0; i < numChunks; i++) {
+		void *chunk = mmap(nullptr, m_mappedSize, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (chunk == MAP_FAILED) {
+			release();
+			return false;
+		}
+		memset(chunk, 0, m_mappedSize);
+		m_chunks[i] = (uint8_t*) chunk;
+	}
+	m_fillSeq = 0;
+	m_drainSeq = 0;
+	m_releaseSeq = 0;
+	m_finished = false;
+	m_aborted = false;
+	return true;
+}
+
+/**
+ * Wait for the next free chunk buffer. Called by the producer thread.
+ *
+ * @return pointer to the chunk buffer to fill or nullptr when the ring was aborted
+ */
+uint8_t* ChunkRing::beginFill() {
+	uint8_t *chunk = nullptr;
+	pthread_mutex_lock(&m_mutex);
+	while (!m_aborted && m_fillSeq - m_releaseSeq >= m_numChunks) {
+		pthread_cond_wait(&m_freeCond, &m_mutex);
+	}
+	if (!m_aborted) {
+		chunk = m_chunks[m_fillSeq % m_numChunks];
+	}
+	pthread_mutex_unlock(&m_mutex);
+	return chunk;
+}
+
+/**
+ * Hand the chunk buffer returned by beginFill() over to the consumer thread.
+ *
+ * @param numBytes how many bytes have been stored in the chunk buffer
+ */
+void ChunkRing::commitFill(uint32_t numBytes) {
+	pthread_mutex_lock(&m_mutex);
+	m_chunkBytes[m_fillSeq % m_numChunks] = numBytes;
+	m_fillSeq++;
+	pthread_cond_signal(&m_filledCond);
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/**
+ * Wait for the next filled chunk buffer. Called by the consumer thread.
+ *
+ * @param numBytes pointer to receiving amount of bytes stored in the chunk buffer
+ *
+ * @return pointer to the filled chunk buffer or nullptr when there are no more chunks
+ */
+uint8_t* ChunkRing::beginDrain(uint32_t *numBytes) {
+	uint8_t *chunk = nullptr;
+	pthread_mutex_lock(&m_mutex);
+	while (!m_aborted && !m_finished && m_drainSeq == m_fillSeq) {
+		pthread_cond_wait(&m_filledCond, &m_mutex);
+	}
+	if (!m_aborted && m_drainSeq != m_fillSeq) {
+		chunk = m_chunks[m_drainSeq % m_numChunks];
+		*numBytes = m_chunkBytes[m_drainSeq % m_numChunks];
+	}
+	pthread_mutex_unlock(&m_mutex);
+	return chunk;
+}
+
+/**
+ * Return the chunk buffer returned by beginDrain() back to the producer thread.
+ * When a drain hold back is configured, the chunk buffer is only returned after
+ * that many more chunks have been drained.
+ */
+void ChunkRing::commitDrain() {
+	pthread_mutex_lock(&m_mutex);
+	m_drainSeq++;
+	if (m_drainSeq - m_releaseSeq > m_drainHoldBack) {
+		m_releaseSeq = m_drainSeq - m_drainHoldBack;
+		pthread_cond_signal(&m_freeCond);
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/**
+ * Keep drained chunk buffers away from the producer thread until more chunks have been drained.
+ * Used when the consumer hands chunk memory over to the kernel by reference and the memory
+ * must not be refilled until the kernel is done with it.
+ * The ring needs more chunk buffers than the hold back to make progress.
+ *
+ * @param numChunks how many drained chunk buffers to hold back
+ */
+void ChunkRing::setDrainHoldBack(uint32_t numChunks) {
+	pthread_mutex_lock(&m_mutex);
+	m_drainHoldBack = numChunks;
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/**
+ * Signal that the producer thread will not fill any more chunks.
+ * The consumer thread still drains all chunks filled so far.
+ */
+void ChunkRing::finish() {
+	pthread_mutex_lock(&m_mutex);
+	m_finished = true;
+	pthread_cond_broadcast(&m_filledCond);
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/**
+ * Stop both producer and consumer threads, chunks not drained yet are discarded.
+ */
+void ChunkRing::abort() {
+	pthread_mutex_lock(&m_mutex);
+	m_aborted = true;
+	pthread_cond_broadcast(&m_filledCond);
+	pthread_cond_broadcast(&m_freeCond);
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/**
+ * Check if the ring was aborted
+ *
+ * @return true if abort() was called
+ */
+bool ChunkRing::isAborted() {
+	pthread_mutex_lock(&m_mutex);
+	bool aborted = m_aborted;
+	pthread_mutex_unlock(&m_mutex);
+	return aborted;
+}
+
+/**
+ * @return number of allocated chunk buffers
+ */
+uint32_t ChunkRing::getNumChunks() const {
+	return m_numChunks;
+}
+
+/**
+ * @return size of each chunk buffer in bytes
+ */
+uint32_t ChunkRing::getChunkSize() const {
+	return m_chunkSize;
+}
+
+/**
+ * Retrieve a chunk buffer by its position in the ring
+ *
+ * @param idx chunk buffer position
+ *
+ * @return pointer to the chunk buffer
+ */
+uint8_t* ChunkRing::getChunk(uint32_t idx) const {
+	return m_chunks[idx];
+}
+
+/**
+ * De-allocate chunk buffers
+ */
+void ChunkRing::release() {
+	if (m_chunks != nullptr) {
+		for (uint32_t i = 0; i < m_numChunks; i++) {
+			if (m_chunks[i] != nullptr) {
+				munmap(m_chunks[i], m_mappedSize);
+			}
+		}
+		free(m_chunks);
+		m_chunks = nullptr;
+	}
+	free(m_chunkBytes);
+	m_chunkBytes = nullptr;
+	m_numChunks = 0;
+	m_chunkSize = 0;
+	m_mappedSize = 0;
+}
+
+/**
+ * De-allocate resources
+ */
+ChunkRing::~ChunkRing() {
+	release();
+	pthread_cond_destroy(&m_freeCond);
+	pthread_cond_destroy(&m_filledCond);
+	pthread_mutex_destroy(&m_mutex);
+}
@@ -0,0 +1,88 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file ChunkRing.h
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief a ring of pre-allocated chunk buffers shared between one producer thread and one consumer thread.
+ *
+ */
+#ifndef CHUNKRING_H
+#define CHUNKRING_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+/**
+ * Minimal alignment of each chunk buffer, suitable for unbuffered and direct I/O
+ */
+#define CHUNK_RING_BUFF_ALIGNMENT (4096)
+
+class ChunkRing {
+public:
+	ChunkRing();
+	ChunkRing(ChunkRing const&) = delete;
+	ChunkRing(ChunkRing&&) = delete;
+	ChunkRing& operator=(ChunkRing const&) = delete;
+	ChunkRing& operator=(ChunkRing&&) = delete;
+	virtual ~ChunkRing();
+
+	bool allocate(uint32_t numChunks, uint32_t chunkSize);
+	uint8_t* beginFill();
+	void commitFill(uint32_t numBytes);
+	uint8_t* beginDrain(uint32_t *numBytes);
+	void commitDrain();
+	void setDrainHoldBack(uint32_t numChunks);
+	void finish();
+	void abort();
+	bool isAborted();
+	uint32_t getNumChunks() const;
+	uint32_t getChunkSize() const;
+	uint8_t* getChunk(uint32_t idx) const;
+
+private:
+	void release();
+
+	uint8_t **m_chunks;
+	uint32_t *m_chunkBytes;
+	uint32_t m_numChunks;
+	uint32_t m_chunkSize;
+	size_t m_mappedSize;
+	uint64_t m_fillSeq;
+	uint64_t m_drainSeq;
+	uint64_t m_releaseSeq;
+	uint32_t m_drainHoldBack;
+	bool m_finished;
+	bool m_aborted;
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_filledCond;
+	pthread_cond_t m_freeCond;
+};
+
+#endif // CHUNKRING_H
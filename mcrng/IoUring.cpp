@@ -0,0 +1,322 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file IoUring.cpp
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief submits writes through a Linux io_uring instance using raw system calls, without liburing.
+ *
+ */
+#include "IoUring.h"
+
+IoUring::IoUring() {
+	m_fd = -1;
+	m_sqRing = MAP_FAILED;
+	m_sqRingSize = 0;
+	m_cqRing = MAP_FAILED;
+	m_cqRingSize = 0;
+	m_sqes = (struct io_uring_sqe*) MAP_FAILED;
+	m_sqesSize = 0;
+	m_sqHead = nullptr;
+	m_sqTail = nullptr;
+	m_sqMask = nullptr;
+	m_sqArray = nullptr;
+	m_sqEntries = 0;
+	m_cqHead = nullptr;
+	m_cqTail = nullptr;
+	m_cqMask = nullptr;
+	m_cqes = nullptr;
+	m_numPending = 0;
+	m_isBuffersRegistered = false;
+	m_statSubmissions = 0;
+	m_statCompletions = 0;
+	m_statEnterCalls = 0;
+	m_statRegisteredBuffers = 0;
+	m_lastError[0] = '\0';
+}
+
+/**
+ * Set the ring up and map its submission and completion queues
+ *
+ * @param uint32_t numEntries - submission queue size, rounded up to a power of two by the kernel
+ * @return true when the ring is ready for submissions
+ */
+bool IoUring::setup(uint32_t numEntries) {
+	release();
+	if (numEntries == 0 || numEntries > IO_URING_MAX_ENTRIES) {
+		setErrMsg("Invalid number of io_uring entries");
+		return false;
+	}
+
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	m_fd = (int) syscall(__NR_io_uring_setup, numEntries, &params);
+	if (m_fd == -1) {
+		snprintf(m_lastError, sizeof(m_lastError), "io_uring_setup failed, error: %s", strerror(errno));
+		return false;
+	}
+
+	m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+	m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		// Both queues share one mapping since kernel 5.4
+		if (m_cqRingSize > m_sqRingSize) {
+			m_sqRingSize = m_cqRingSize;
+		}
+		m_cqRingSize = 0;
+	}
+	m_sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+			IORING_OFF_SQ_RING);
+	if (m_sqRing == MAP_FAILED) {
+		snprintf(m_lastError, sizeof(m_lastError), "Cannot map io_uring submission queue, error: %s", strerror(errno));
+		release();
+		return false;
+	}
+	if (m_cqRingSize == 0) {
+		m_cqRing = m_sqRing;
+	} else {
+		m_cqRing = mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+				IORING_OFF_CQ_RING);
+		if (m_cqRing == MAP_FAILED) {
+			snprintf(m_lastError, sizeof(m_lastError), "Cannot map io_uring completion queue, error: %s", strerror(errno));
+			release();
+			return false;
+		}
+	}
+	m_sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+	m_sqes = (struct io_uring_sqe*) mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			m_fd, IORING_OFF_SQES);
+	if (m_sqes == MAP_FAILED) {
+		snprintf(m_lastError, sizeof(m_lastError), "Cannot map io_uring submission entries, error: %s", strerror(errno));
+		release();
+		return false;
+	}
+
+	uint8_t *sqRing = (uint8_t*) m_sqRing;
+	m_sqHead = (uint32_t*) (sqRing + params.sq_off.head);
+	m_sqTail = (uint32_t*) (sqRing + params.sq_off.tail);
+	m_sqMask = (uint32_t*) (sqRing + params.sq_off.ring_mask);
+	m_sqArray = (uint32_t*) (sqRing + params.sq_off.array);
+	m_sqEntries = params.sq_entries;
+	uint8_t *cqRing = (uint8_t*) m_cqRing;
+	m_cqHead = (uint32_t*) (cqRing + params.cq_off.head);
+	m_cqTail = (uint32_t*) (cqRing + params.cq_off.tail);
+	m_cqMask = (uint32_t*) (cqRing + params.cq_off.ring_mask);
+	m_cqes = (struct io_uring_cqe*) (cqRing + params.cq_off.cqes);
+	return true;
+}
+
+/**
+ * Register buffers with the ring, so the kernel maps their pages once instead of with every write
+ *
+ * @param const struct iovec* buffers - buffers to register
+ * @param uint32_t numBuffers - number of buffers
+ * @return true when the buffers are registered
+ */
+bool IoUring::registerBuffers(const struct iovec *buffers, uint32_t numBuffers) {
+	if (m_fd == -1) {
+		setErrMsg("io_uring is not set up");
+		return false;
+	}
+	if (syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_BUFFERS, buffers, numBuffers) == -1) {
+		snprintf(m_lastError, sizeof(m_lastError), "Cannot register io_uring buffers, error: %s", strerror(errno));
+		return false;
+	}
+	m_isBuffersRegistered = true;
+	m_statRegisteredBuffers = numBuffers;
+	return true;
+}
+
+/**
+ * @return true when buffers are registered with the ring
+ */
+bool IoUring::isBuffersRegistered() const {
+	return m_isBuffersRegistered;
+}
+
+/**
+ * Queue a write, it is handed over to the kernel by the next submit() or waitCompletion()
+ *
+ * @param int fd - file descriptor to write to
+ * @param const void* buf - bytes to write
+ * @param uint32_t len - number of bytes to write
+ * @param int64_t offset - file offset to write at, -1 for the current file position
+ * @param int bufIndex - index of the registered buffer containing the bytes, -1 when not registered
+ * @param uint64_t userData - value returned with the completion
+ * @return true when queued, false when the submission queue is full
+ */
+bool IoUring::prepareWrite(int fd, const void *buf, uint32_t len, int64_t offset, int bufIndex, uint64_t userData) {
+	uint32_t tail = *m_sqTail;
+	if (tail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries) {
+		setErrMsg("io_uring submission queue is full");
+		return false;
+	}
+	uint32_t idx = tail & *m_sqMask;
+	struct io_uring_sqe *sqe = &m_sqes[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	if (bufIndex >= 0 && m_isBuffersRegistered) {
+		sqe->opcode = IORING_OP_WRITE_FIXED;
+		sqe->buf_index = (uint16_t) bufIndex;
+	} else {
+		sqe->opcode = IORING_OP_WRITE;
+	}
+	sqe->fd = fd;
+	sqe->addr = (uint64_t) (uintptr_t) buf;
+	sqe->len = len;
+	sqe->off = (uint64_t) offset;
+	sqe->user_data = userData;
+	m_sqArray[idx] = idx;
+	__atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+	m_numPending++;
+	return true;
+}
+
+/**
+ * Hand the queued writes over to the kernel without waiting for completions
+ *
+ * @return true when run successfully
+ */
+bool IoUring::submit() {
+	if (m_numPending == 0) {
+		return true;
+	}
+	return enter(m_numPending, 0, 0);
+}
+
+/**
+ * Reap a completion without blocking
+ *
+ * @param uint64_t* userData - pointer to receiving the user data of the completed write
+ * @param int32_t* result - pointer to receiving the number of bytes written or a negative error number
+ * @return true when a completion was reaped
+ */
+bool IoUring::reapCompletion(uint64_t *userData, int32_t *result) {
+	if (m_fd == -1) {
+		return false;
+	}
+	uint32_t head = *m_cqHead;
+	if (head == __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE)) {
+		return false;
+	}
+	struct io_uring_cqe *cqe = &m_cqes[head & *m_cqMask];
+	*userData = cqe->user_data;
+	*result = cqe->res;
+	__atomic_store_n(m_cqHead, head + 1, __ATOMIC_RELEASE);
+	m_statCompletions++;
+	return true;
+}
+
+/**
+ * Submit the queued writes and wait for a completion, both with one system call
+ *
+ * @param uint64_t* userData - pointer to receiving the user data of the completed write
+ * @param int32_t* result - pointer to receiving the number of bytes written or a negative error number
+ * @return true when a completion was reaped
+ */
+bool IoUring::waitCompletion(uint64_t *userData, int32_t *result) {
+	while (!reapCompletion(userData, result)) {
+		if (!enter(m_numPending, 1, IORING_ENTER_GETEVENTS)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Tear the ring down, outstanding writes are completed by the kernel
+ */
+void IoUring::release() {
+	if (m_sqes != MAP_FAILED) {
+		munmap(m_sqes, m_sqesSize);
+		m_sqes = (struct io_uring_sqe*) MAP_FAILED;
+	}
+	if (m_cqRing != MAP_FAILED && m_cqRing != m_sqRing) {
+		munmap(m_cqRing, m_cqRingSize);
+	}
+	m_cqRing = MAP_FAILED;
+	if (m_sqRing != MAP_FAILED) {
+		munmap(m_sqRing, m_sqRingSize);
+		m_sqRing = MAP_FAILED;
+	}
+	if (m_fd != -1) {
+		close(m_fd);
+		m_fd = -1;
+	}
+	m_numPending = 0;
+	m_isBuffersRegistered = false;
+}
+
+/**
+ * Retrieve io_uring counters
+ *
+ * @param IoUringStats* stats - pointer to receiving the counters
+ */
+void IoUring::getStats(IoUringStats *stats) const {
+	stats->submissions = m_statSubmissions;
+	stats->completions = m_statCompletions;
+	stats->enterCalls = m_statEnterCalls;
+	stats->registeredBuffers = m_statRegisteredBuffers;
+}
+
+/**
+ * Call io_uring_enter(2), retrying when interrupted by a signal
+ *
+ * @param uint32_t numSubmit - number of queued entries to submit
+ * @param uint32_t minComplete - number of completions to wait for
+ * @param uint32_t flags - io_uring_enter flags
+ * @return true when run successfully
+ */
+bool IoUring::enter(uint32_t numSubmit, uint32_t minComplete, uint32_t flags) {
+	while (true) {
+		m_statEnterCalls++;
+		long submitted = syscall(__NR_io_uring_enter, m_fd, numSubmit, minComplete, flags, nullptr, 0);
+		if (submitted >= 0) {
+			m_numPending -= (uint32_t) submitted;
+			m_statSubmissions += (uint64_t) submitted;
+			return true;
+		}
+		if (errno != EINTR) {
+			snprintf(m_lastError, sizeof(m_lastError), "io_uring_enter failed, error: %s", strerror(errno));
+			return false;
+		}
+	}
+}
+
+void IoUring::setErrMsg(const char *errMessage) {
+	snprintf(m_lastError, sizeof(m_lastError), "%s", errMessage);
+}
+
+/**
+ * Retrieve the last error message.
+ *
+ * @return const char* - pointer to the last error message
+ */
+const char* IoUring::getLastErrMsg() const {
+	return m_lastError;
+}
+
+IoUring::~IoUring() {
+	release();
+}
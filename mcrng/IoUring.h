@@ -0,0 +1,109 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file IoUring.h
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief submits writes through a Linux io_uring instance using raw system calls, without liburing.
+ *
+ */
+#ifndef IOURING_H
+#define IOURING_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+/**
+ * Max amount of submission queue entries requested when setting the ring up
+ */
+#define IO_URING_MAX_ENTRIES (4096)
+
+/**
+ * Snapshot of io_uring counters, accumulated since the ring was set up
+ */
+struct IoUringStats {
+	uint64_t submissions;		// submission queue entries handed over to the kernel
+	uint64_t completions;		// completion queue entries reaped
+	uint64_t enterCalls;		// io_uring_enter system calls
+	uint32_t registeredBuffers;	// buffers registered with the ring, kept after the ring is released
+};
+
+class IoUring {
+public:
+	IoUring();
+	IoUring(IoUring const&) = delete;
+	IoUring(IoUring&&) = delete;
+	IoUring& operator=(IoUring const&) = delete;
+	IoUring& operator=(IoUring&&) = delete;
+	virtual ~IoUring();
+
+	bool setup(uint32_t numEntries);
+	bool registerBuffers(const struct iovec *buffers, uint32_t numBuffers);
+	bool isBuffersRegistered() const;
+	bool prepareWrite(int fd, const void *buf, uint32_t len, int64_t offset, int bufIndex, uint64_t userData);
+	bool submit();
+	bool reapCompletion(uint64_t *userData, int32_t *result);
+	bool waitCompletion(uint64_t *userData, int32_t *result);
+	void release();
+	void getStats(IoUringStats *stats) const;
+	const char* getLastErrMsg() const;
+
+private:
+	void setErrMsg(const char *errMessage);
+	bool enter(uint32_t numSubmit, uint32_t minComplete, uint32_t flags);
+
+	int m_fd;
+	void *m_sqRing;
+	size_t m_sqRingSize;
+	void *m_cqRing;
+	size_t m_cqRingSize;
+	struct io_uring_sqe *m_sqes;
+	size_t m_sqesSize;
+	uint32_t *m_sqHead;
+	uint32_t *m_sqTail;
+	uint32_t *m_sqMask;
+	uint32_t *m_sqArray;
+	uint32_t m_sqEntries;
+	uint32_t *m_cqHead;
+	uint32_t *m_cqTail;
+	uint32_t *m_cqMask;
+	struct io_uring_cqe *m_cqes;
+	uint32_t m_numPending;
+	bool m_isBuffersRegistered;
+	uint64_t m_statSubmissions;
+	uint64_t m_statCompletions;
+	uint64_t m_statEnterCalls;
+	uint32_t m_statRegisteredBuffers;
+	char m_lastError[256];
+};
+
+#endif // IOURING_H
@@ -0,0 +1,356 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngAsync.cpp
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief non-blocking front end for MicroRNG requests, executed by a worker thread that owns the device.
+ *
+ */
+#include "MicroRngAsync.h"
+#include <errno.h>
+#include <new>
+
+MicroRngAsync::MicroRngAsync(MicroRngSPI &device) :
+		m_scheduler(device) {
+	m_worker = pthread_t();
+	m_isRunning = false;
+	m_stopRequested = false;
+	m_eventFd = -1;
+	m_pendingHead = nullptr;
+	m_pendingTail = nullptr;
+	m_numPending = 0;
+	m_completedHead = nullptr;
+	m_completedTail = nullptr;
+	strcpy(m_lastError, "Not started");
+	pthread_mutex_init(&m_mutex, nullptr);
+	pthread_cond_init(&m_pendingCond, nullptr);
+}
+
+/**
+ * Create the completion event descriptor and start the worker thread
+ *
+ * @return true if started successfully
+ */
+bool MicroRngAsync::start() {
+	if (m_isRunning) {
+		return true;
+	}
+	if (m_eventFd == -1) {
+		m_eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (m_eventFd == -1) {
+			sprintf(m_lastError, "Could not create completion event descriptor, error: %d", errno);
+			return false;
+		}
+	}
+	m_stopRequested = false;
+	if (pthread_create(&m_worker, nullptr, runWorker, this) != 0) {
+		sprintf(m_lastError, "Could not start worker thread");
+		return false;
+	}
+	m_isRunning = true;
+	return true;
+}
+
+/**
+ * Stop the worker thread after it executed all pending requests. Completions of requests
+ * submitted with a callback are still delivered by processCompletions().
+ */
+void MicroRngAsync::stop() {
+	if (!m_isRunning) {
+		return;
+	}
+	pthread_mutex_lock(&m_mutex);
+	m_stopRequested = true;
+	pthread_cond_signal(&m_pendingCond);
+	pthread_mutex_unlock(&m_mutex);
+	pthread_join(m_worker, nullptr);
+	m_isRunning = false;
+}
+
+/**
+ * @return true if the worker thread is running
+ */
+bool MicroRngAsync::isRunning() const {
+	return m_isRunning;
+}
+
+/**
+ * @return event descriptor that becomes readable when completions are ready for processCompletions(), -1 before start()
+ */
+int MicroRngAsync::getEventFd() const {
+	return m_eventFd;
+}
+
+/**
+ * Submit a random bytes request, completed through the callback
+ *
+ * @param len how many random bytes to retrieve
+ * @param buffer pointer to receiving random bytes, must stay valid until the callback is invoked
+ * @param callback function invoked by processCompletions() when the request completes
+ * @param context value passed to the callback
+ *
+ * @return true if the request is queued
+ */
+bool MicroRngAsync::submitRead(uint32_t len, uint8_t *buffer, McrAsyncCallback callback, void *context) {
+	return submitRead(MCR_REQUEST_RANDOM, len, buffer, callback, context);
+}
+
+/**
+ * Submit a typed request, completed through the callback
+ *
+ * @param type request type
+ * @param len how many bytes to retrieve
+ * @param buffer pointer to receiving bytes, must stay valid until the callback is invoked
+ * @param callback function invoked by processCompletions() when the request completes
+ * @param context value passed to the callback
+ *
+ * @return true if the request is queued
+ */
+bool MicroRngAsync::submitRead(McrRequestType type, uint32_t len, uint8_t *buffer, McrAsyncCallback callback,
+		void *context) {
+	if (callback == nullptr) {
+		sprintf(m_lastError, "Missing completion callback");
+		return false;
+	}
+	AsyncRequest *request = new (std::nothrow) AsyncRequest();
+	if (request == nullptr) {
+		sprintf(m_lastError, "Could not allocate memory for request");
+		return false;
+	}
+	request->request = { type, len, buffer, false, false, nullptr };
+	request->callback = callback;
+	request->context = context;
+	request->hasPromise = false;
+	if (!enqueue(request)) {
+		delete request;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Submit a random bytes request, completed through the returned future
+ *
+ * @param len how many random bytes to retrieve
+ * @param buffer pointer to receiving random bytes, must stay valid until the future is ready
+ *
+ * @return future holding true if all bytes retrieved, an invalid future if the request could not be queued
+ */
+std::future<bool> MicroRngAsync::submitRead(uint32_t len, uint8_t *buffer) {
+	AsyncRequest *request = new (std::nothrow) AsyncRequest();
+	if (request == nullptr) {
+		sprintf(m_lastError, "Could not allocate memory for request");
+		return std::future<bool>();
+	}
+	request->request = { MCR_REQUEST_RANDOM, len, buffer, false, false, nullptr };
+	request->callback = nullptr;
+	request->context = nullptr;
+	request->hasPromise = true;
+	std::future<bool> future = request->promise.get_future();
+	if (!enqueue(request)) {
+		delete request;
+		return std::future<bool>();
+	}
+	return future;
+}
+
+/**
+ * Invoke the callbacks of completed requests in the calling thread and reset the completion event descriptor
+ *
+ * @return number of callbacks invoked
+ */
+uint32_t MicroRngAsync::processCompletions() {
+	uint64_t numEvents;
+	if (m_eventFd != -1 && read(m_eventFd, &numEvents, sizeof(numEvents)) < 0 && errno != EAGAIN) {
+		sprintf(m_lastError, "Could not read completion event descriptor, error: %d", errno);
+	}
+
+	pthread_mutex_lock(&m_mutex);
+	AsyncRequest *completed = m_completedHead;
+	m_completedHead = nullptr;
+	m_completedTail = nullptr;
+	pthread_mutex_unlock(&m_mutex);
+
+	uint32_t numCompleted = 0;
+	while (completed != nullptr) {
+		AsyncRequest *next = completed->next;
+		completed->callback(completed->request.isSuccess, completed->request.rx, completed->request.len,
+				completed->context);
+		delete completed;
+		completed = next;
+		numCompleted++;
+	}
+	return numCompleted;
+}
+
+/**
+ * @return number of submitted requests not completed by the worker yet
+ */
+uint32_t MicroRngAsync::getPendingCount() {
+	pthread_mutex_lock(&m_mutex);
+	uint32_t numPending = m_numPending;
+	pthread_mutex_unlock(&m_mutex);
+	return numPending;
+}
+
+/**
+ * Retrieve the last error message.
+ *
+ * @return last error message
+ */
+const char* MicroRngAsync::getLastErrMsg() const {
+	return m_lastError;
+}
+
+/**
+ * Queue a request for the worker thread
+ *
+ * @param request pointer to the request
+ *
+ * @return true if queued
+ */
+bool MicroRngAsync::enqueue(AsyncRequest *request) {
+	if (request->request.len == 0 || request->request.rx == nullptr) {
+		sprintf(m_lastError, "Invalid request");
+		return false;
+	}
+	request->next = nullptr;
+	pthread_mutex_lock(&m_mutex);
+	if (!m_isRunning || m_stopRequested) {
+		pthread_mutex_unlock(&m_mutex);
+		sprintf(m_lastError, "Not started");
+		return false;
+	}
+	if (m_numPending >= MCR_ASYNC_MAX_PENDING_REQUESTS) {
+		pthread_mutex_unlock(&m_mutex);
+		sprintf(m_lastError, "Too many pending requests");
+		return false;
+	}
+	if (m_pendingTail == nullptr) {
+		m_pendingHead = request;
+	} else {
+		m_pendingTail->next = request;
+	}
+	m_pendingTail = request;
+	m_numPending++;
+	pthread_cond_signal(&m_pendingCond);
+	pthread_mutex_unlock(&m_mutex);
+	return true;
+}
+
+/**
+ * Worker thread, executes pending requests until stopped
+ *
+ * @param arg pointer to the MicroRngAsync instance
+ */
+void* MicroRngAsync::runWorker(void *arg) {
+	MicroRngAsync *async = (MicroRngAsync*) arg;
+	pthread_mutex_lock(&async->m_mutex);
+	while (true) {
+		while (async->m_pendingHead == nullptr && !async->m_stopRequested) {
+			pthread_cond_wait(&async->m_pendingCond, &async->m_mutex);
+		}
+		if (async->m_pendingHead == nullptr) {
+			break;
+		}
+		AsyncRequest *requests = async->m_pendingHead;
+		async->m_pendingHead = nullptr;
+		async->m_pendingTail = nullptr;
+		pthread_mutex_unlock(&async->m_mutex);
+		async->executeRequests(requests);
+		pthread_mutex_lock(&async->m_mutex);
+	}
+	pthread_mutex_unlock(&async->m_mutex);
+	return nullptr;
+}
+
+/**
+ * Exchange a burst of pending requests with one scheduler batch
+ *
+ * @param requests pointer to the first pending request
+ */
+void MicroRngAsync::executeRequests(AsyncRequest *requests) {
+	for (AsyncRequest *request = requests; request != nullptr; request = request->next) {
+		m_scheduler.submit(&request->request);
+	}
+	if (!m_scheduler.perform()) {
+		sprintf(m_lastError, "%s", m_scheduler.getLastErrMsg());
+	}
+	completeRequests(requests);
+}
+
+/**
+ * Complete executed requests: fulfill futures right away, queue callbacks for processCompletions()
+ *
+ * @param requests pointer to the first executed request
+ */
+void MicroRngAsync::completeRequests(AsyncRequest *requests) {
+	uint64_t numCallbacks = 0;
+	uint32_t numCompleted = 0;
+	while (requests != nullptr) {
+		AsyncRequest *next = requests->next;
+		numCompleted++;
+		if (requests->hasPromise) {
+			requests->promise.set_value(requests->request.isSuccess);
+			delete requests;
+		} else {
+			requests->next = nullptr;
+			pthread_mutex_lock(&m_mutex);
+			if (m_completedTail == nullptr) {
+				m_completedHead = requests;
+			} else {
+				m_completedTail->next = requests;
+			}
+			m_completedTail = requests;
+			pthread_mutex_unlock(&m_mutex);
+			numCallbacks++;
+		}
+		requests = next;
+	}
+
+	pthread_mutex_lock(&m_mutex);
+	m_numPending -= numCompleted;
+	pthread_mutex_unlock(&m_mutex);
+
+	if (numCallbacks > 0 && write(m_eventFd, &numCallbacks, sizeof(numCallbacks)) < 0) {
+		sprintf(m_lastError, "Could not signal completion event descriptor, error: %d", errno);
+	}
+}
+
+MicroRngAsync::~MicroRngAsync() {
+	stop();
+	// Drop completions nobody processed, without invoking callbacks of a caller going away
+	while (m_completedHead != nullptr) {
+		AsyncRequest *next = m_completedHead->next;
+		delete m_completedHead;
+		m_completedHead = next;
+	}
+	if (m_eventFd != -1) {
+		close(m_eventFd);
+	}
+	pthread_cond_destroy(&m_pendingCond);
+	pthread_mutex_destroy(&m_mutex);
+}
@@ -0,0 +1,119 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngAsync.h
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief non-blocking front end for MicroRNG requests, executed by a worker thread that owns the device.
+ *
+ *    Requests submitted with a callback are completed in the caller's thread: the worker signals
+ *    the completion event descriptor (an eventfd) and the caller runs processCompletions() when the
+ *    descriptor becomes readable, typically from an epoll or io_uring event loop. Requests submitted
+ *    without a callback return a std::future completed by the worker.
+ *
+ *    The worker hands every burst of pending requests to a MicroRngScheduler, so many small reads
+ *    share one SPI exchange. Don't use the device directly while the worker is running.
+ *
+ *    Usage:
+ *        MicroRngAsync async(spi);
+ *        async.start();
+ *        async.submitRead(32, key, onKeyReady, context);
+ *        // when async.getEventFd() is readable
+ *        async.processCompletions();
+ */
+#ifndef MICRORNGASYNC_H
+#define MICRORNGASYNC_H
+
+#include "MicroRngScheduler.h"
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <future>
+
+/**
+ * Max number of requests waiting for the worker thread
+ */
+#define MCR_ASYNC_MAX_PENDING_REQUESTS (4096)
+
+/**
+ * Completion callback, invoked by processCompletions()
+ *
+ * @param isSuccess true if all requested bytes were retrieved into the buffer
+ * @param buffer the buffer passed to submitRead()
+ * @param len amount of bytes requested
+ * @param context the context passed to submitRead()
+ */
+typedef void (*McrAsyncCallback)(bool isSuccess, uint8_t *buffer, uint32_t len, void *context);
+
+class MicroRngAsync {
+public:
+	explicit MicroRngAsync(MicroRngSPI &device);
+	MicroRngAsync(MicroRngAsync const&) = delete;
+	MicroRngAsync(MicroRngAsync&&) = delete;
+	MicroRngAsync& operator=(MicroRngAsync const&) = delete;
+	MicroRngAsync& operator=(MicroRngAsync&&) = delete;
+	virtual ~MicroRngAsync();
+
+	bool start();
+	void stop();
+	bool isRunning() const;
+	int getEventFd() const;
+	bool submitRead(uint32_t len, uint8_t *buffer, McrAsyncCallback callback, void *context);
+	bool submitRead(McrRequestType type, uint32_t len, uint8_t *buffer, McrAsyncCallback callback, void *context);
+	std::future<bool> submitRead(uint32_t len, uint8_t *buffer);
+	uint32_t processCompletions();
+	uint32_t getPendingCount();
+	const char* getLastErrMsg() const;
+
+private:
+	struct AsyncRequest {
+		MicroRngRequest request;
+		McrAsyncCallback callback;
+		void *context;
+		std::promise<bool> promise;
+		bool hasPromise;
+		AsyncRequest *next;
+	};
+
+	static void* runWorker(void *arg);
+	bool enqueue(AsyncRequest *request);
+	void executeRequests(AsyncRequest *requests);
+	void completeRequests(AsyncRequest *requests);
+
+	MicroRngScheduler m_scheduler;
+	pthread_t m_worker;
+	bool m_isRunning;
+	bool m_stopRequested;
+	int m_eventFd;
+	AsyncRequest *m_pendingHead;
+	AsyncRequest *m_pendingTail;
+	uint32_t m_numPending;
+	AsyncRequest *m_completedHead;
+	AsyncRequest *m_completedTail;
+	char m_lastError[512];
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_pendingCond;
+};
+
+#endif // MICRORNGASYNC_H
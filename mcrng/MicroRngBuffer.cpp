@@ -0,0 +1,686 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngBuffer.cpp
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief thread-safe access to random bytes of a MicroRNG device, kept ready by a background filler thread.
+ *
+ */
+#include "MicroRngBuffer.h"
+#include <atomic>
+#include <time.h>
+
+/**
+ * Random bytes taken from the central buffer by one thread
+ */
+struct MicroRngThreadCache {
+	uint64_t instanceId;
+	uint64_t forkGeneration;
+	uint32_t offset;
+	uint32_t numBytes;
+	uint64_t pendingRequests;	// requests not added to the buffer counters yet
+	uint64_t pendingHits;
+	uint64_t pendingBytes;
+	uint8_t bytes[MCR_BUFFER_THREAD_CACHE_BYTES];
+};
+
+static thread_local MicroRngThreadCache threadCache;
+static std::atomic<uint64_t> nextInstanceId(1);
+static std::atomic<uint64_t> forkGeneration(0);
+static pthread_once_t forkHandlerOnce = PTHREAD_ONCE_INIT;
+
+MicroRngBuffer::MicroRngBuffer(MicroRngSPI &device) :
+		m_device(device) {
+	pthread_once(&forkHandlerOnce, registerForkHandler);
+	m_instanceId = nextInstanceId.fetch_add(1);
+	m_forkGeneration = forkGeneration.load();
+	m_ring = nullptr;
+	m_capacity = 0;
+	m_requestedLowWatermark = 0;
+	m_requestedHighWatermark = 0;
+	m_lowWatermark = 0;
+	m_highWatermark = 0;
+	m_isRefilling = false;
+	m_refillStartNanos = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_readPos = 0;
+	m_writePos = 0;
+	m_filler = pthread_t();
+	m_isRunning = false;
+	m_stopRequested = false;
+	m_isFillFailing = false;
+	m_idleTimeoutMs = 0;
+	m_isSleeping = false;
+	m_lastActivityNanos = 0;
+	m_sleepStartNanos = 0;
+	m_rateSampleNanos = 0;
+	m_rateSampleReadPos = 0;
+	m_drainBytesPerNano = 0;
+	m_warmupNanos = 0;
+	strcpy(m_lastError, "Not started");
+	pthread_mutex_init(&m_mutex, nullptr);
+	pthread_cond_init(&m_dataCond, nullptr);
+	pthread_condattr_t condAttr;
+	pthread_condattr_init(&condAttr);
+	pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+	pthread_cond_init(&m_spaceCond, &condAttr);
+	pthread_condattr_destroy(&condAttr);
+}
+
+/**
+ * Allocate the central buffer and start the filler thread. The device must be connected and configured,
+ * it is used by the filler thread only until stop() is called.
+ *
+ * @param capacityBytes size of the central buffer in bytes
+ *
+ * @return true if started successfully
+ */
+bool MicroRngBuffer::start(uint32_t capacityBytes) {
+	if (m_isRunning) {
+		return true;
+	}
+	if (!m_device.isConnected()) {
+		sprintf(m_lastError, "Device not connected");
+		return false;
+	}
+	if (capacityBytes < MCR_BUFFER_MIN_CAPACITY_BYTES || capacityBytes > MCR_BUFFER_MAX_CAPACITY_BYTES) {
+		sprintf(m_lastError, "Buffer capacity must be between %d and %d bytes",
+				MCR_BUFFER_MIN_CAPACITY_BYTES, MCR_BUFFER_MAX_CAPACITY_BYTES);
+		return false;
+	}
+	free(m_ring);
+	m_ring = (uint8_t*) malloc(capacityBytes);
+	if (m_ring == nullptr) {
+		sprintf(m_lastError, "Could not allocate memory for buffer");
+		return false;
+	}
+	m_capacity = capacityBytes;
+	applyWatermarks();
+	m_isRefilling = false;
+	m_readPos = 0;
+	m_writePos = 0;
+	m_isFillFailing = false;
+	m_stopRequested = false;
+	m_forkGeneration = forkGeneration.load();
+	if (pthread_create(&m_filler, nullptr, runFiller, this) != 0) {
+		sprintf(m_lastError, "Could not start filler thread");
+		return false;
+	}
+	m_isRunning = true;
+	return true;
+}
+
+/**
+ * Set the refill watermarks. The filler thread starts refilling when the central buffer holds
+ * no more than the low watermark and stops when it holds the high watermark.
+ * A high watermark above the capacity is lowered to the capacity by start().
+ *
+ * @param lowBytes low watermark in bytes, 0 for MCR_BUFFER_DEFAULT_LOW_WATERMARK_PERCENT of the capacity
+ * @param highBytes high watermark in bytes, 0 for MCR_BUFFER_DEFAULT_HIGH_WATERMARK_PERCENT of the capacity
+ *
+ * @return true if the watermarks are valid
+ */
+bool MicroRngBuffer::setWatermarks(uint32_t lowBytes, uint32_t highBytes) {
+	if (highBytes != 0 && lowBytes >= highBytes) {
+		sprintf(m_lastError, "Low watermark must be below the high watermark");
+		return false;
+	}
+	pthread_mutex_lock(&m_mutex);
+	m_requestedLowWatermark = lowBytes;
+	m_requestedHighWatermark = highBytes;
+	if (m_isRunning) {
+		applyWatermarks();
+		pthread_cond_signal(&m_spaceCond);
+	}
+	pthread_mutex_unlock(&m_mutex);
+	return true;
+}
+
+/**
+ * Shut the noise sources down when the buffer is full and no bytes have been taken from it for a while.
+ * The filler thread starts them up again when the buffer is predicted to reach the low watermark,
+ * or when it reaches it, and always before it stops.
+ *
+ * @param idleTimeoutMs idle time in milliseconds before shutting down, 0 to keep the noise sources on
+ */
+void MicroRngBuffer::setIdleShutdown(uint32_t idleTimeoutMs) {
+	pthread_mutex_lock(&m_mutex);
+	m_idleTimeoutMs = idleTimeoutMs;
+	pthread_cond_signal(&m_spaceCond);
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/**
+ * Stop the filler thread. Bytes left in the buffer can still be retrieved.
+ */
+void MicroRngBuffer::stop() {
+	if (!m_isRunning || isForkedChild()) {
+		return;
+	}
+	pthread_mutex_lock(&m_mutex);
+	m_stopRequested = true;
+	pthread_cond_broadcast(&m_spaceCond);
+	pthread_cond_broadcast(&m_dataCond);
+	pthread_mutex_unlock(&m_mutex);
+	pthread_join(m_filler, nullptr);
+	m_isRunning = false;
+}
+
+/**
+ * @return true if the filler thread is running
+ */
+bool MicroRngBuffer::isRunning() const {
+	return m_isRunning;
+}
+
+/**
+ * Retrieve random bytes, waiting for the filler thread when the buffer doesn't hold enough bytes.
+ * Safe to call from any number of threads.
+ *
+ * @param buffer pointer to receiving random bytes
+ * @param len how many random bytes to retrieve
+ *
+ * @return true if all bytes retrieved
+ */
+bool MicroRngBuffer::getRandom(uint8_t *buffer, uint32_t len) {
+	if (isForkedChild()) {
+		sprintf(m_lastError, "Buffer was started by the parent process");
+		return false;
+	}
+	if (len > MCR_BUFFER_THREAD_CACHE_MAX_REQUEST) {
+		return fetch(buffer, len, nullptr);
+	}
+
+	MicroRngThreadCache &cache = threadCache;
+	if (cache.instanceId != m_instanceId || cache.forkGeneration != m_forkGeneration) {
+		cache.instanceId = m_instanceId;
+		cache.forkGeneration = m_forkGeneration;
+		cache.numBytes = 0;
+		cache.pendingRequests = 0;
+		cache.pendingHits = 0;
+		cache.pendingBytes = 0;
+	}
+	cache.pendingRequests++;
+	cache.pendingBytes += len;
+	if (cache.numBytes >= len) {
+		memcpy(buffer, cache.bytes + cache.offset, len);
+		cache.offset += len;
+		cache.numBytes -= len;
+		cache.pendingHits++;
+		return true;
+	}
+
+	// Use up the cached bytes first, then take the rest from a new batch
+	uint32_t numCached = cache.numBytes;
+	memcpy(buffer, cache.bytes + cache.offset, numCached);
+	cache.numBytes = 0;
+	if (!fetch(cache.bytes, MCR_BUFFER_THREAD_CACHE_BYTES, &cache)) {
+		return false;
+	}
+	memcpy(buffer + numCached, cache.bytes, len - numCached);
+	cache.offset = len - numCached;
+	cache.numBytes = MCR_BUFFER_THREAD_CACHE_BYTES - cache.offset;
+	return true;
+}
+
+/**
+ * Retrieve random bytes held by the central buffer without waiting for the filler thread.
+ * Checking the available bytes and taking them is one step, so bytes taken by other threads
+ * in between can't make the call wait. Safe to call from any number of threads.
+ *
+ * @param buffer pointer to receiving random bytes
+ * @param minLen least amount of random bytes to retrieve, nothing is retrieved when fewer are held
+ * @param maxLen most amount of random bytes to retrieve
+ *
+ * @return amount of random bytes retrieved, 0 when the buffer held fewer than minLen bytes
+ */
+uint32_t MicroRngBuffer::tryGetRandom(uint8_t *buffer, uint32_t minLen, uint32_t maxLen) {
+	if (isForkedChild()) {
+		sprintf(m_lastError, "Buffer was started by the parent process");
+		return 0;
+	}
+	pthread_mutex_lock(&m_mutex);
+	m_lastActivityNanos = getMonotonicNanos();
+	uint32_t numAvailable = (uint32_t) (m_writePos - m_readPos);
+	uint32_t numBytes = numAvailable < maxLen ? numAvailable : maxLen;
+	if (numBytes == 0 || numBytes < minLen) {
+		// Wake up the filler, it may be sleeping or waiting for the low watermark
+		pthread_cond_signal(&m_spaceCond);
+		pthread_mutex_unlock(&m_mutex);
+		return 0;
+	}
+	copyOut(buffer, numBytes);
+	m_stats.requests++;
+	m_stats.bytesServed += numBytes;
+	m_stats.hits++;
+	if (!m_isRefilling && m_writePos - m_readPos <= m_lowWatermark) {
+		pthread_cond_signal(&m_spaceCond);
+	}
+	pthread_mutex_unlock(&m_mutex);
+	return numBytes;
+}
+
+/**
+ * @return amount of random bytes currently held by the central buffer
+ */
+uint32_t MicroRngBuffer::getAvailableBytes() {
+	if (isForkedChild()) {
+		return 0;
+	}
+	pthread_mutex_lock(&m_mutex);
+	uint32_t numAvailable = (uint32_t) (m_writePos - m_readPos);
+	pthread_mutex_unlock(&m_mutex);
+	return numAvailable;
+}
+
+/**
+ * Retrieve the buffer counters
+ *
+ * @param stats pointer to receiving counters
+ */
+void MicroRngBuffer::getStats(MicroRngBufferStats *stats) {
+	pthread_mutex_lock(&m_mutex);
+	*stats = m_stats;
+	stats->availableBytes = (uint32_t) (m_writePos - m_readPos);
+	stats->lowWatermark = m_lowWatermark;
+	stats->highWatermark = m_highWatermark;
+	stats->isSleeping = m_isSleeping;
+	stats->warmupNanos = m_warmupNanos;
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/**
+ * Reset the buffer counters
+ */
+void MicroRngBuffer::resetStats() {
+	pthread_mutex_lock(&m_mutex);
+	memset(&m_stats, 0, sizeof(m_stats));
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/**
+ * Retrieve the last error message.
+ *
+ * @return last error message
+ */
+const char* MicroRngBuffer::getLastErrMsg() const {
+	return m_lastError;
+}
+
+/**
+ * Register the fork handler once per process
+ */
+void MicroRngBuffer::registerForkHandler() {
+	pthread_atfork(nullptr, nullptr, handleForkChild);
+}
+
+/**
+ * Invalidate all buffers in a forked child, their filler threads don't exist in the child
+ * and their bytes have been handed out by the parent already.
+ */
+void MicroRngBuffer::handleForkChild() {
+	forkGeneration.fetch_add(1);
+}
+
+/**
+ * @return true when called in a child process forked after the buffer was started
+ */
+bool MicroRngBuffer::isForkedChild() const {
+	return m_forkGeneration != forkGeneration.load(std::memory_order_relaxed);
+}
+
+/**
+ * Compute the watermarks in effect from the requested ones and the capacity
+ */
+void MicroRngBuffer::applyWatermarks() {
+	m_highWatermark = m_requestedHighWatermark;
+	if (m_highWatermark == 0) {
+		m_highWatermark = (uint32_t) ((uint64_t) m_capacity * MCR_BUFFER_DEFAULT_HIGH_WATERMARK_PERCENT / 100);
+	}
+	if (m_highWatermark > m_capacity) {
+		m_highWatermark = m_capacity;
+	}
+	m_lowWatermark = m_requestedLowWatermark;
+	if (m_lowWatermark == 0) {
+		m_lowWatermark = (uint32_t) ((uint64_t) m_capacity * MCR_BUFFER_DEFAULT_LOW_WATERMARK_PERCENT / 100);
+	}
+	if (m_lowWatermark >= m_highWatermark) {
+		m_lowWatermark = m_highWatermark / 2;
+	}
+}
+
+/**
+ * @return current CLOCK_MONOTONIC time in nanoseconds
+ */
+uint64_t MicroRngBuffer::getMonotonicNanos() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * Copy random bytes out of the central buffer
+ *
+ * @param buffer pointer to receiving random bytes
+ * @param len how many random bytes to copy
+ * @param cache pointer to the per-thread cache being refilled, nullptr when copying for a request
+ *
+ * @return true if all bytes copied
+ */
+bool MicroRngBuffer::fetch(uint8_t *buffer, uint32_t len, MicroRngThreadCache *cache) {
+	bool isWaiting = false;
+	uint64_t waitStartNanos = 0;
+
+	pthread_mutex_lock(&m_mutex);
+	if (cache != nullptr) {
+		m_stats.requests += cache->pendingRequests;
+		m_stats.threadCacheHits += cache->pendingHits;
+		m_stats.bytesServed += cache->pendingBytes;
+		cache->pendingRequests = 0;
+		cache->pendingHits = 0;
+		cache->pendingBytes = 0;
+	} else {
+		m_stats.requests++;
+		m_stats.bytesServed += len;
+	}
+	m_lastActivityNanos = getMonotonicNanos();
+	while (len > 0) {
+		uint32_t numAvailable = (uint32_t) (m_writePos - m_readPos);
+		if (numAvailable == 0) {
+			if (!m_isRunning || m_stopRequested) {
+				sprintf(m_lastError, "Buffer is not running");
+				pthread_mutex_unlock(&m_mutex);
+				return false;
+			}
+			if (m_isFillFailing) {
+				pthread_mutex_unlock(&m_mutex);
+				return false;
+			}
+			if (!isWaiting) {
+				isWaiting = true;
+				waitStartNanos = getMonotonicNanos();
+				pthread_cond_signal(&m_spaceCond);
+			}
+			pthread_cond_wait(&m_dataCond, &m_mutex);
+			continue;
+		}
+		uint32_t numBytes = numAvailable < len ? numAvailable : len;
+		copyOut(buffer, numBytes);
+		buffer += numBytes;
+		len -= numBytes;
+	}
+	if (isWaiting) {
+		uint64_t waitNanos = getMonotonicNanos() - waitStartNanos;
+		m_stats.misses++;
+		m_stats.missWaitNanos += waitNanos;
+		if (waitNanos > m_stats.maxMissWaitNanos) {
+			m_stats.maxMissWaitNanos = waitNanos;
+		}
+	} else {
+		m_stats.hits++;
+	}
+	if (!m_isRefilling && m_writePos - m_readPos <= m_lowWatermark) {
+		pthread_cond_signal(&m_spaceCond);
+	}
+	pthread_mutex_unlock(&m_mutex);
+	return true;
+}
+
+/**
+ * Copy random bytes out of the ring and advance the read position, the caller holds the mutex
+ *
+ * @param buffer pointer to receiving random bytes
+ * @param len how many random bytes to copy, no more than the ring holds
+ */
+void MicroRngBuffer::copyOut(uint8_t *buffer, uint32_t len) {
+	uint32_t offset = (uint32_t) (m_readPos % m_capacity);
+	uint32_t firstPart = m_capacity - offset;
+	if (firstPart >= len) {
+		memcpy(buffer, m_ring + offset, len);
+	} else {
+		memcpy(buffer, m_ring + offset, firstPart);
+		memcpy(buffer + firstPart, m_ring, len - firstPart);
+	}
+	m_readPos += len;
+}
+
+/**
+ * Filler thread
+ *
+ * @param arg pointer to the MicroRngBuffer instance
+ */
+void* MicroRngBuffer::runFiller(void *arg) {
+	((MicroRngBuffer*) arg)->fill();
+	return nullptr;
+}
+
+/**
+ * Refill the central buffer between the watermarks until stopped. Random bytes are retrieved straight
+ * into the free part of the buffer, consumers only read the part already published.
+ */
+void MicroRngBuffer::fill() {
+	uint64_t warmupNanos = measureWarmup();
+	pthread_mutex_lock(&m_mutex);
+	m_warmupNanos = warmupNanos;
+	m_lastActivityNanos = getMonotonicNanos();
+	while (!m_stopRequested) {
+		uint32_t numAvailable = (uint32_t) (m_writePos - m_readPos);
+		if (!m_isRefilling) {
+			if (numAvailable > m_lowWatermark) {
+				uint64_t nowNanos = getMonotonicNanos();
+				if (m_isSleeping) {
+					if (isWakeupDue(numAvailable, nowNanos)) {
+						startUpNoiseSources(true);
+					} else {
+						waitForSpace(nowNanos + (uint64_t) MCR_BUFFER_POWER_CHECK_MSECS * 1000000);
+					}
+				} else if (m_idleTimeoutMs > 0) {
+					uint64_t idleDeadlineNanos = m_lastActivityNanos + (uint64_t) m_idleTimeoutMs * 1000000;
+					if (nowNanos >= idleDeadlineNanos) {
+						shutDownNoiseSources();
+					} else {
+						waitForSpace(idleDeadlineNanos);
+					}
+				} else {
+					pthread_cond_wait(&m_spaceCond, &m_mutex);
+				}
+				continue;
+			}
+			if (m_isSleeping) {
+				startUpNoiseSources(false);
+				continue;
+			}
+			m_isRefilling = true;
+			m_refillStartNanos = getMonotonicNanos();
+		}
+		if (numAvailable >= m_highWatermark) {
+			uint64_t nowNanos = getMonotonicNanos();
+			uint64_t refillNanos = nowNanos - m_refillStartNanos;
+			m_isRefilling = false;
+			m_lastActivityNanos = nowNanos;
+			m_stats.refills++;
+			m_stats.refillNanos += refillNanos;
+			if (refillNanos > m_stats.maxRefillNanos) {
+				m_stats.maxRefillNanos = refillNanos;
+			}
+			continue;
+		}
+		uint32_t numFree = m_highWatermark - numAvailable;
+		uint32_t offset = (uint32_t) (m_writePos % m_capacity);
+		uint32_t numBytes = m_capacity - offset;
+		if (numBytes > numFree) {
+			numBytes = numFree;
+		}
+		if (numBytes > MCR_BUFFER_MAX_REFILL_BYTES) {
+			numBytes = MCR_BUFFER_MAX_REFILL_BYTES;
+		}
+		pthread_mutex_unlock(&m_mutex);
+
+		bool isSuccess = m_device.retrieveRandomBytes(numBytes, m_ring + offset);
+
+		pthread_mutex_lock(&m_mutex);
+		if (isSuccess) {
+			m_writePos += numBytes;
+			m_isFillFailing = false;
+		} else {
+			sprintf(m_lastError, "%s", m_device.getLastErrMsg());
+			m_isFillFailing = true;
+			m_stats.refillFailures++;
+		}
+		pthread_cond_broadcast(&m_dataCond);
+		if (!isSuccess) {
+			pthread_mutex_unlock(&m_mutex);
+			usleep(MCR_BUFFER_RETRY_PAUSE_USECS);
+			pthread_mutex_lock(&m_mutex);
+		}
+	}
+	if (m_isSleeping) {
+		startUpNoiseSources(false);
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/**
+ * Wait for consumers to take bytes from the buffer, at most until a deadline. Called with the mutex locked.
+ *
+ * @param deadlineNanos CLOCK_MONOTONIC deadline in nanoseconds
+ */
+void MicroRngBuffer::waitForSpace(uint64_t deadlineNanos) {
+	struct timespec deadline;
+	deadline.tv_sec = (time_t) (deadlineNanos / 1000000000);
+	deadline.tv_nsec = (long) (deadlineNanos % 1000000000);
+	pthread_cond_timedwait(&m_spaceCond, &m_mutex, &deadline);
+}
+
+/**
+ * Check whether the noise sources need starting up so the device is warmed up before the buffer
+ * reaches the low watermark, at the rate the buffer has recently been drained at.
+ * Called with the mutex locked.
+ *
+ * @param numAvailable bytes held by the central buffer
+ * @param nowNanos current CLOCK_MONOTONIC time in nanoseconds
+ *
+ * @return true when the noise sources should be started up now
+ */
+bool MicroRngBuffer::isWakeupDue(uint32_t numAvailable, uint64_t nowNanos) {
+	uint64_t sampleNanos = nowNanos - m_rateSampleNanos;
+	if (sampleNanos == 0) {
+		return false;
+	}
+	// Average the drain rate over the recent demand checks, half of the weight on the last one
+	double sampleRate = (double) (m_readPos - m_rateSampleReadPos) / sampleNanos;
+	m_drainBytesPerNano = (m_drainBytesPerNano + sampleRate) / 2;
+	m_rateSampleNanos = nowNanos;
+	m_rateSampleReadPos = m_readPos;
+	if (m_drainBytesPerNano <= 0) {
+		return false;
+	}
+	double nanosToLowWatermark = (double) (numAvailable - m_lowWatermark) / m_drainBytesPerNano;
+
+	// Allow for the next two demand checks and some warm-up variation
+	double leadNanos = (double) m_warmupNanos * 3 / 2 + (double) MCR_BUFFER_POWER_CHECK_MSECS * 2000000;
+	return nanosToLowWatermark <= leadNanos;
+}
+
+/**
+ * Shut the noise sources down. Called with the mutex locked, released during the device command.
+ */
+void MicroRngBuffer::shutDownNoiseSources() {
+	uint8_t status;
+	pthread_mutex_unlock(&m_mutex);
+	bool isSuccess = m_device.shutDownNoiseSources(&status);
+	pthread_mutex_lock(&m_mutex);
+	uint64_t nowNanos = getMonotonicNanos();
+	if (!isSuccess) {
+		sprintf(m_lastError, "Could not shut down noise sources: %s", m_device.getLastErrMsg());
+		// Try again after another idle timeout
+		m_lastActivityNanos = nowNanos;
+		return;
+	}
+	m_isSleeping = true;
+	m_sleepStartNanos = nowNanos;
+	m_rateSampleNanos = nowNanos;
+	m_rateSampleReadPos = m_readPos;
+	m_drainBytesPerNano = 0;
+	m_stats.shutdowns++;
+}
+
+/**
+ * Start the noise sources up and wait for the device to warm up. Called with the mutex locked,
+ * released while the device warms up.
+ *
+ * @param isPredicted true when started up ahead of the predicted demand
+ */
+void MicroRngBuffer::startUpNoiseSources(bool isPredicted) {
+	pthread_mutex_unlock(&m_mutex);
+	uint64_t warmupNanos = measureWarmup();
+	pthread_mutex_lock(&m_mutex);
+	uint64_t nowNanos = getMonotonicNanos();
+	m_isSleeping = false;
+	m_stats.sleepNanos += nowNanos - m_sleepStartNanos;
+	if (isPredicted) {
+		m_stats.predictiveWakeups++;
+	} else {
+		m_stats.demandWakeups++;
+	}
+	if (warmupNanos > 0) {
+		m_warmupNanos = warmupNanos;
+	}
+	m_lastActivityNanos = nowNanos;
+}
+
+/**
+ * Start the noise sources up and poll the device status until it is healthy
+ *
+ * @return time in nanoseconds it took the device to report healthy status, 0 on failure
+ */
+uint64_t MicroRngBuffer::measureWarmup() {
+	uint8_t status;
+	uint64_t startNanos = getMonotonicNanos();
+	uint64_t deadlineNanos = startNanos + (uint64_t) MCR_BUFFER_MAX_WARMUP_MSECS * 1000000;
+	if (!m_device.startUpNoiseSources(&status)) {
+		return 0;
+	}
+	while (m_device.retrieveDeviceStatusByte(&status)) {
+		uint64_t nowNanos = getMonotonicNanos();
+		if (status == 0) {
+			return nowNanos - startNanos;
+		}
+		if (nowNanos >= deadlineNanos) {
+			break;
+		}
+		usleep(MCR_BUFFER_WARMUP_POLL_USECS);
+	}
+	return 0;
+}
+
+MicroRngBuffer::~MicroRngBuffer() {
+	stop();
+	free(m_ring);
+	pthread_cond_destroy(&m_spaceCond);
+	pthread_cond_destroy(&m_dataCond);
+	pthread_mutex_destroy(&m_mutex);
+}
@@ -0,0 +1,191 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngBuffer.h
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief thread-safe access to random bytes of a MicroRNG device, kept ready by a background filler thread.
+ *
+ *    The filler thread is the only user of the device once started. It starts refilling the central buffer
+ *    when the buffer holds no more than the low watermark and stops at the high watermark, so the device
+ *    is only used for bursts of large transfers while consumers are served by memcpy(). Optionally the filler
+ *    thread shuts the noise sources down once the buffer is full and hasn't been used for a while, and starts
+ *    them up again ahead of the time the buffer is expected to reach the low watermark, judging by the recent rate
+ *    the buffer is drained at and the measured warm-up latency of the device. Any number of threads may call getRandom() concurrently. Small requests are served from a per-thread
+ *    cache of pre-fetched bytes without locking or touching the bus, the cache takes MCR_BUFFER_THREAD_CACHE_BYTES
+ *    from the central buffer at a time. Larger requests are copied from the central buffer directly.
+ *    getStats() reports cache and central buffer hits and misses, and the duration of the refills.
+ *    Each random byte is handed out once. A forked child process can't use a buffer started by its parent,
+ *    the child neither inherits the parent's per-thread caches nor the central buffer.
+ *
+ *    Usage:
+ *        MicroRngBuffer buffer(spi);
+ *        if (buffer.start(MCR_BUFFER_DEFAULT_CAPACITY_BYTES)) {
+ *            uint64_t nonce;
+ *            bool success = buffer.getRandom((uint8_t*) &nonce, sizeof(nonce));
+ *        }
+ */
+#ifndef MICRORNGBUFFER_H
+#define MICRORNGBUFFER_H
+
+#include "MicroRngSPI.h"
+#include <pthread.h>
+
+#define MCR_BUFFER_DEFAULT_CAPACITY_BYTES (65536)
+#define MCR_BUFFER_MIN_CAPACITY_BYTES (1024)
+#define MCR_BUFFER_MAX_CAPACITY_BYTES (268435456)
+
+/**
+ * Max amount of random bytes retrieved from the device by one transfer of a refill
+ */
+#define MCR_BUFFER_MAX_REFILL_BYTES (16384)
+
+/**
+ * Default watermarks, in percent of the capacity
+ */
+#define MCR_BUFFER_DEFAULT_LOW_WATERMARK_PERCENT (50)
+#define MCR_BUFFER_DEFAULT_HIGH_WATERMARK_PERCENT (100)
+
+/**
+ * Size of the per-thread cache, requests up to MCR_BUFFER_THREAD_CACHE_MAX_REQUEST bytes are served from it
+ */
+#define MCR_BUFFER_THREAD_CACHE_BYTES (256)
+#define MCR_BUFFER_THREAD_CACHE_MAX_REQUEST (64)
+
+/**
+ * How often the filler thread checks the predicted demand while the noise sources are shut down
+ */
+#define MCR_BUFFER_POWER_CHECK_MSECS (10)
+
+/**
+ * Max time to wait for the device to report healthy status after starting up the noise sources
+ */
+#define MCR_BUFFER_MAX_WARMUP_MSECS (200)
+#define MCR_BUFFER_WARMUP_POLL_USECS (500)
+
+/**
+ * Pause of the filler thread after a failed refill
+ */
+#define MCR_BUFFER_RETRY_PAUSE_USECS (10000)
+
+/**
+ * Counters of a MicroRngBuffer. Requests served by a per-thread cache are added
+ * when that thread takes its next batch from the central buffer.
+ */
+struct MicroRngBufferStats {
+	uint64_t requests;		// getRandom() calls
+	uint64_t bytesServed;		// random bytes handed out
+	uint64_t threadCacheHits;	// requests served by the per-thread cache
+	uint64_t hits;			// copies from the central buffer that didn't wait
+	uint64_t misses;		// copies from the central buffer that waited for the filler thread
+	uint64_t missWaitNanos;		// total time spent waiting by misses
+	uint64_t maxMissWaitNanos;	// longest wait of a miss
+	uint64_t refills;		// completed refills from the low to the high watermark
+	uint64_t refillNanos;		// total duration of completed refills
+	uint64_t maxRefillNanos;	// longest completed refill
+	uint64_t refillFailures;	// failed device transfers
+	uint64_t shutdowns;		// noise sources shut down after the idle timeout
+	uint64_t predictiveWakeups;	// noise sources started up ahead of the predicted demand
+	uint64_t demandWakeups;		// noise sources started up because the buffer reached the low watermark
+	uint64_t sleepNanos;		// total time the noise sources were shut down
+	uint64_t warmupNanos;		// last measured time from starting up the noise sources to healthy status
+	bool isSleeping;		// noise sources are currently shut down
+	uint32_t availableBytes;	// bytes held by the central buffer
+	uint32_t lowWatermark;
+	uint32_t highWatermark;
+};
+
+struct MicroRngThreadCache;
+
+class MicroRngBuffer {
+public:
+	explicit MicroRngBuffer(MicroRngSPI &device);
+	MicroRngBuffer(MicroRngBuffer const&) = delete;
+	MicroRngBuffer(MicroRngBuffer&&) = delete;
+	MicroRngBuffer& operator=(MicroRngBuffer const&) = delete;
+	MicroRngBuffer& operator=(MicroRngBuffer&&) = delete;
+	virtual ~MicroRngBuffer();
+
+	bool start(uint32_t capacityBytes);
+	bool setWatermarks(uint32_t lowBytes, uint32_t highBytes);
+	void setIdleShutdown(uint32_t idleTimeoutMs);
+	void stop();
+	bool isRunning() const;
+	bool getRandom(uint8_t *buffer, uint32_t len);
+	uint32_t tryGetRandom(uint8_t *buffer, uint32_t minLen, uint32_t maxLen);
+	uint32_t getAvailableBytes();
+	void getStats(MicroRngBufferStats *stats);
+	void resetStats();
+	const char* getLastErrMsg() const;
+
+private:
+	static void* runFiller(void *arg);
+	static void registerForkHandler();
+	static void handleForkChild();
+	void fill();
+	void waitForSpace(uint64_t deadlineNanos);
+	bool isWakeupDue(uint32_t numAvailable, uint64_t nowNanos);
+	void shutDownNoiseSources();
+	void startUpNoiseSources(bool isPredicted);
+	uint64_t measureWarmup();
+	bool fetch(uint8_t *buffer, uint32_t len, MicroRngThreadCache *cache);
+	void copyOut(uint8_t *buffer, uint32_t len);
+	void applyWatermarks();
+	static uint64_t getMonotonicNanos();
+	bool isForkedChild() const;
+
+	MicroRngSPI &m_device;
+	uint64_t m_instanceId;
+	uint64_t m_forkGeneration;
+	uint8_t *m_ring;
+	uint32_t m_capacity;
+	uint32_t m_requestedLowWatermark;
+	uint32_t m_requestedHighWatermark;
+	uint32_t m_lowWatermark;
+	uint32_t m_highWatermark;
+	bool m_isRefilling;
+	uint64_t m_refillStartNanos;
+	MicroRngBufferStats m_stats;
+	uint64_t m_readPos;
+	uint64_t m_writePos;
+	pthread_t m_filler;
+	bool m_isRunning;
+	bool m_stopRequested;
+	bool m_isFillFailing;
+	uint32_t m_idleTimeoutMs;
+	bool m_isSleeping;
+	uint64_t m_lastActivityNanos;
+	uint64_t m_sleepStartNanos;
+	uint64_t m_rateSampleNanos;
+	uint64_t m_rateSampleReadPos;
+	double m_drainBytesPerNano;
+	uint64_t m_warmupNanos;
+	char m_lastError[512];
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_dataCond;
+	pthread_cond_t m_spaceCond;
+};
+
+#endif // MICRORNGBUFFER_H
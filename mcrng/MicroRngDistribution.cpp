@@ -0,0 +1,457 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngDistribution.cpp
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief typed random values drawn from a MicroRngBuffer without wasting random bits.
+ *
+ */
+#include "MicroRngDistribution.h"
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/**
+ * Bit pattern of the exponent of doubles and floats in [1, 2)
+ */
+#define MCR_DIST_DOUBLE_ONE_BITS (0x3FF0000000000000ULL)
+#define MCR_DIST_FLOAT_ONE_BITS (0x3F800000U)
+
+/**
+ * Multiply two 64-bit numbers into a 128-bit product
+ *
+ * @param a first factor
+ * @param b second factor
+ * @param high pointer to receiving upper 64 bits of the product
+ * @param low pointer to receiving lower 64 bits of the product
+ */
+static void multiply64(uint64_t a, uint64_t b, uint64_t *high, uint64_t *low) {
+#if defined(__SIZEOF_INT128__)
+	unsigned __int128 product = (unsigned __int128) a * b;
+	*high = (uint64_t) (product >> 64);
+	*low = (uint64_t) product;
+#else
+	// 32-bit targets have no 128-bit integers
+	uint64_t aLow = (uint32_t) a;
+	uint64_t aHigh = a >> 32;
+	uint64_t bLow = (uint32_t) b;
+	uint64_t bHigh = b >> 32;
+	uint64_t lowLow = aLow * bLow;
+	uint64_t highLow = aHigh * bLow;
+	uint64_t lowHigh = aLow * bHigh;
+	uint64_t middle = (lowLow >> 32) + (uint32_t) highLow + (uint32_t) lowHigh;
+	*high = aHigh * bHigh + (highLow >> 32) + (lowHigh >> 32) + (middle >> 32);
+	*low = (middle << 32) | (uint32_t) lowLow;
+#endif
+}
+
+/**
+ * Construct a distribution drawing random bytes from a buffer, the buffer has to be started
+ * before values are requested
+ *
+ * @param buffer source of random bytes
+ */
+MicroRngDistribution::MicroRngDistribution(MicroRngBuffer &buffer) :
+		m_buffer(buffer) {
+	m_poolOffset = MCR_DIST_POOL_BYTES;
+	m_reservoir = 0;
+	m_reservoirBits = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_lastError[0] = '\0';
+}
+
+/**
+ * Retrieve random bits
+ *
+ * @param numBits how many bits to retrieve, between 1 and 64
+ * @param value pointer to receiving bits in the least significant positions
+ *
+ * @return true when retrieved successfully
+ */
+bool MicroRngDistribution::getBits(uint32_t numBits, uint64_t *value) {
+	if (numBits == 0 || numBits > 64) {
+		sprintf(m_lastError, "Invalid amount of random bits requested: %u", numBits);
+		return false;
+	}
+	if (!takeBits(numBits, value)) {
+		return false;
+	}
+	m_stats.values++;
+	return true;
+}
+
+/**
+ * Retrieve a uniform random integer in [0, bound)
+ *
+ * @param bound exclusive upper limit, at least 1
+ * @param value pointer to receiving integer
+ *
+ * @return true when retrieved successfully
+ */
+bool MicroRngDistribution::getUniform32(uint32_t bound, uint32_t *value) {
+	uint64_t wideValue;
+	if (!getUniform64(bound, &wideValue)) {
+		return false;
+	}
+	*value = (uint32_t) wideValue;
+	return true;
+}
+
+/**
+ * Retrieve a uniform random integer in [0, bound)
+ *
+ * @param bound exclusive upper limit, at least 1
+ * @param value pointer to receiving integer
+ *
+ * @return true when retrieved successfully
+ */
+bool MicroRngDistribution::getUniform64(uint64_t bound, uint64_t *value) {
+	if (bound == 0) {
+		sprintf(m_lastError, "Bound of uniform random integers must be at least 1");
+		return false;
+	}
+	if (bound == 1) {
+		*value = 0;
+		m_stats.values++;
+		return true;
+	}
+	uint32_t numBits;
+	uint64_t threshold;
+	selectSampleBits(bound, 64, &numBits, &threshold);
+	uint64_t sample;
+	if (!takeBits(numBits, &sample)) {
+		return false;
+	}
+	while (!isAccepted(sample, bound, numBits, threshold, value)) {
+		m_stats.rejections++;
+		if (!takeBits(numBits, &sample)) {
+			return false;
+		}
+	}
+	m_stats.values++;
+	return true;
+}
+
+/**
+ * Retrieve a uniform random integer in [min, max]
+ *
+ * @param min inclusive lower limit
+ * @param max inclusive upper limit, not less than min
+ * @param value pointer to receiving integer
+ *
+ * @return true when retrieved successfully
+ */
+bool MicroRngDistribution::getRange32(int32_t min, int32_t max, int32_t *value) {
+	if (min > max) {
+		sprintf(m_lastError, "Invalid range of random integers: %d to %d", min, max);
+		return false;
+	}
+	uint64_t offset;
+	if (!getUniform64((uint64_t) ((int64_t) max - min) + 1, &offset)) {
+		return false;
+	}
+	*value = (int32_t) ((int64_t) min + (int64_t) offset);
+	return true;
+}
+
+/**
+ * Retrieve a uniform random double in [0, 1) with MCR_DIST_DOUBLE_BITS bit resolution
+ *
+ * @param value pointer to receiving double
+ *
+ * @return true when retrieved successfully
+ */
+bool MicroRngDistribution::getDouble(double *value) {
+	uint64_t bits;
+	if (!takeBits(MCR_DIST_DOUBLE_BITS, &bits)) {
+		return false;
+	}
+	memcpy(value, &bits, sizeof(bits));
+	convertDoubles(value, 1);
+	m_stats.values++;
+	return true;
+}
+
+/**
+ * Retrieve a uniform random float in [0, 1) with MCR_DIST_FLOAT_BITS bit resolution
+ *
+ * @param value pointer to receiving float
+ *
+ * @return true when retrieved successfully
+ */
+bool MicroRngDistribution::getFloat(float *value) {
+	uint64_t bits;
+	if (!takeBits(MCR_DIST_FLOAT_BITS, &bits)) {
+		return false;
+	}
+	uint32_t floatBits = (uint32_t) bits | MCR_DIST_FLOAT_ONE_BITS;
+	float one;
+	memcpy(&one, &floatBits, sizeof(floatBits));
+	*value = one - 1.0f;
+	m_stats.values++;
+	return true;
+}
+
+/**
+ * Fill an array with uniform random integers in [0, bound)
+ *
+ * @param values pointer to receiving integers
+ * @param numValues how many integers to retrieve
+ * @param bound exclusive upper limit, at least 1
+ *
+ * @return true when retrieved successfully
+ */
+bool MicroRngDistribution::fillUniform(uint32_t *values, size_t numValues, uint32_t bound) {
+	if (bound == 0) {
+		sprintf(m_lastError, "Bound of uniform random integers must be at least 1");
+		return false;
+	}
+	if (bound == 1) {
+		memset(values, 0, numValues * sizeof(uint32_t));
+		m_stats.values += numValues;
+		return true;
+	}
+	// The sample width only depends on the bound
+	uint32_t numBits;
+	uint64_t threshold;
+	selectSampleBits(bound, 64, &numBits, &threshold);
+	for (size_t i = 0; i < numValues; i++) {
+		uint64_t sample;
+		uint64_t value;
+		if (!takeBits(numBits, &sample)) {
+			return false;
+		}
+		while (!isAccepted(sample, bound, numBits, threshold, &value)) {
+			m_stats.rejections++;
+			if (!takeBits(numBits, &sample)) {
+				return false;
+			}
+		}
+		values[i] = (uint32_t) value;
+	}
+	m_stats.values += numValues;
+	return true;
+}
+
+/**
+ * Fill an array with uniform random doubles in [0, 1) with MCR_DIST_DOUBLE_BITS bit resolution
+ *
+ * @param values pointer to receiving doubles
+ * @param numValues how many doubles to retrieve
+ *
+ * @return true when retrieved successfully
+ */
+bool MicroRngDistribution::fillDouble(double *values, size_t numValues) {
+	// Gather the mantissa bits in place, then convert all of them at once
+	for (size_t i = 0; i < numValues; i++) {
+		uint64_t bits;
+		if (!takeBits(MCR_DIST_DOUBLE_BITS, &bits)) {
+			return false;
+		}
+		memcpy(values + i, &bits, sizeof(bits));
+	}
+	convertDoubles(values, numValues);
+	m_stats.values += numValues;
+	return true;
+}
+
+/**
+ * Drop the random bits kept in the reservoir, for example before handing the object to another thread
+ */
+void MicroRngDistribution::discardBits() {
+	memset(m_pool, 0, sizeof(m_pool));
+	m_poolOffset = MCR_DIST_POOL_BYTES;
+	m_reservoir = 0;
+	m_reservoirBits = 0;
+}
+
+/**
+ * Retrieve the counters
+ *
+ * @param stats pointer to receiving counters
+ */
+void MicroRngDistribution::getStats(MicroRngDistributionStats *stats) const {
+	*stats = m_stats;
+}
+
+/**
+ * Retrieves a pointer to the internally saved error message
+ */
+const char* MicroRngDistribution::getLastErrMsg() const {
+	return m_lastError;
+}
+
+/**
+ * Take random bits from the reservoir, refilling it from the pool of random bytes as needed.
+ * Taken bits are removed, so each random bit is used once.
+ *
+ * @param numBits how many bits to take, between 1 and 64
+ * @param value pointer to receiving bits in the least significant positions
+ *
+ * @return true when taken successfully
+ */
+bool MicroRngDistribution::takeBits(uint32_t numBits, uint64_t *value) {
+	uint64_t bits = 0;
+	uint32_t numTaken = 0;
+	while (numTaken < numBits) {
+		if (m_reservoirBits == 0) {
+			if (m_poolOffset == MCR_DIST_POOL_BYTES && !refillPool()) {
+				return false;
+			}
+			memcpy(&m_reservoir, m_pool + m_poolOffset, sizeof(m_reservoir));
+			memset(m_pool + m_poolOffset, 0, sizeof(m_reservoir));
+			m_poolOffset += sizeof(m_reservoir);
+			m_reservoirBits = 64;
+		}
+		uint32_t numPartBits = numBits - numTaken < m_reservoirBits ? numBits - numTaken : m_reservoirBits;
+		if (numPartBits == 64) {
+			bits = m_reservoir;
+			m_reservoir = 0;
+		} else {
+			bits |= (m_reservoir & ((1ULL << numPartBits) - 1)) << numTaken;
+			m_reservoir >>= numPartBits;
+		}
+		m_reservoirBits -= numPartBits;
+		numTaken += numPartBits;
+	}
+	m_stats.bitsConsumed += numBits;
+	*value = bits;
+	return true;
+}
+
+/**
+ * Refill the pool of random bytes from the buffer
+ *
+ * @return true when refilled successfully
+ */
+bool MicroRngDistribution::refillPool() {
+	if (!m_buffer.getRandom(m_pool, MCR_DIST_POOL_BYTES)) {
+		sprintf(m_lastError, "Could not retrieve random bytes: %.200s", m_buffer.getLastErrMsg());
+		return false;
+	}
+	m_poolOffset = 0;
+	m_stats.bytesRetrieved += MCR_DIST_POOL_BYTES;
+	return true;
+}
+
+/**
+ * Choose the width of rejection samples for a bound. A sample of n bits is rejected with
+ * probability (2^n mod bound) / 2^n, the width with the fewest expected bits per accepted
+ * sample is chosen among the narrowest one and up to MCR_DIST_MAX_EXTRA_BITS wider ones.
+ *
+ * @param bound exclusive upper limit, at least 2
+ * @param maxBits max sample width, up to 64
+ * @param numBits pointer to receiving sample width
+ * @param threshold pointer to receiving 2^numBits mod bound, lower parts of products below it are rejected
+ */
+void MicroRngDistribution::selectSampleBits(uint64_t bound, uint32_t maxBits, uint32_t *numBits, uint64_t *threshold) {
+	uint32_t minBits = 64 - (uint32_t) __builtin_clzll(bound - 1);
+	double bestCost = 0;
+	for (uint32_t width = minBits; width <= minBits + MCR_DIST_MAX_EXTRA_BITS && width <= maxBits; width++) {
+		uint64_t widthThreshold = width == 64 ? (0 - bound) % bound : (1ULL << width) % bound;
+		double cost = width / (1.0 - (double) widthThreshold / ldexp(1.0, (int) width));
+		if (width == minBits || cost < bestCost) {
+			bestCost = cost;
+			*numBits = width;
+			*threshold = widthThreshold;
+		}
+		if (widthThreshold == 0) {
+			// Nothing is rejected, wider samples can only cost more
+			break;
+		}
+	}
+}
+
+/**
+ * Map a sample to [0, bound) with Lemire's multiply-and-shift method
+ *
+ * @param sample random sample of numBits bits
+ * @param bound exclusive upper limit
+ * @param numBits sample width
+ * @param threshold 2^numBits mod bound
+ * @param value pointer to receiving integer of an accepted sample
+ *
+ * @return true when the sample is accepted, false when it has to be rejected for uniformity
+ */
+bool MicroRngDistribution::isAccepted(uint64_t sample, uint64_t bound, uint32_t numBits, uint64_t threshold, uint64_t *value) {
+	uint64_t high;
+	uint64_t low;
+	multiply64(sample, bound, &high, &low);
+	// The product is split at bit numBits into the integer and the fraction part
+	uint64_t fraction = numBits == 64 ? low : low & ((1ULL << numBits) - 1);
+	if (fraction < threshold) {
+		return false;
+	}
+	*value = numBits == 64 ? high : (low >> numBits) | (numBits == 0 ? 0 : high << (64 - numBits));
+	return true;
+}
+
+/**
+ * Convert mantissa bits to doubles in [0, 1) in place: setting the exponent of 1.0 gives
+ * a double in [1, 2), subtracting 1.0 from it is exact
+ *
+ * @param values pointer to the doubles holding mantissa bits in their least significant positions
+ * @param numValues how many doubles to convert
+ */
+void MicroRngDistribution::convertDoubles(double *values, size_t numValues) {
+	size_t i = 0;
+#if defined(__SSE2__)
+	const __m128i exponent = _mm_set1_epi64x((long long) MCR_DIST_DOUBLE_ONE_BITS);
+	const __m128d one = _mm_set1_pd(1.0);
+	for (; i + 2 <= numValues; i += 2) {
+		__m128i bits = _mm_loadu_si128((const __m128i*) (values + i));
+		__m128d shifted = _mm_castsi128_pd(_mm_or_si128(bits, exponent));
+		_mm_storeu_pd(values + i, _mm_sub_pd(shifted, one));
+	}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+	const uint64x2_t exponent = vdupq_n_u64(MCR_DIST_DOUBLE_ONE_BITS);
+	const float64x2_t one = vdupq_n_f64(1.0);
+	for (; i + 2 <= numValues; i += 2) {
+		uint64x2_t bits = vld1q_u64((const uint64_t*) (values + i));
+		float64x2_t shifted = vreinterpretq_f64_u64(vorrq_u64(bits, exponent));
+		vst1q_f64(values + i, vsubq_f64(shifted, one));
+	}
+#endif
+	for (; i < numValues; i++) {
+		uint64_t bits;
+		double shifted;
+		memcpy(&bits, values + i, sizeof(bits));
+		bits |= MCR_DIST_DOUBLE_ONE_BITS;
+		memcpy(&shifted, &bits, sizeof(bits));
+		values[i] = shifted - 1.0;
+	}
+}
+
+/**
+ * Wipe the random bits kept for later values
+ */
+MicroRngDistribution::~MicroRngDistribution() {
+	discardBits();
+}
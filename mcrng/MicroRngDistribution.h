@@ -0,0 +1,114 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngDistribution.h
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief typed random values drawn from a MicroRngBuffer without wasting random bits.
+ *
+ *    Random bytes are taken from the buffer into a bit reservoir and each value consumes only the bits it needs.
+ *    A uniform integer below a bound is computed with the multiply-and-shift method of D. Lemire, rejecting the
+ *    few samples that would introduce a bias instead of reducing modulo the bound. Each sample is only as wide as
+ *    the bound requires plus at most MCR_DIST_MAX_EXTRA_BITS, the width giving the fewest expected bits per value
+ *    is chosen. Doubles and floats are uniform in [0, 1) with 52 and 23 bit resolution; the bulk conversion of
+ *    doubles uses SSE2 or NEON instructions when the target supports them.
+ *    An object is not thread-safe, use one object per thread; the objects may share the same buffer.
+ *
+ *    Usage:
+ *        MicroRngDistribution distribution(buffer);
+ *        uint32_t dieRoll;
+ *        if (distribution.getUniform32(6, &dieRoll)) {
+ *            dieRoll++;
+ *        }
+ */
+#ifndef MICRORNGDISTRIBUTION_H
+#define MICRORNGDISTRIBUTION_H
+
+#include "MicroRngBuffer.h"
+
+/**
+ * Amount of random bytes taken from the buffer at a time for refilling the bit reservoir
+ */
+#define MCR_DIST_POOL_BYTES (256)
+
+/**
+ * Max amount of bits a rejection sample may be wider than the bound
+ */
+#define MCR_DIST_MAX_EXTRA_BITS (4)
+
+/**
+ * Resolution in bits of doubles and floats
+ */
+#define MCR_DIST_DOUBLE_BITS (52)
+#define MCR_DIST_FLOAT_BITS (23)
+
+/**
+ * Counters of a MicroRngDistribution
+ */
+struct MicroRngDistributionStats {
+	uint64_t bytesRetrieved;		// random bytes taken from the buffer
+	uint64_t bitsConsumed;		// random bits used by values, including rejected samples
+	uint64_t values;		// values produced
+	uint64_t rejections;		// samples rejected for uniformity
+};
+
+class MicroRngDistribution {
+public:
+	explicit MicroRngDistribution(MicroRngBuffer &buffer);
+	MicroRngDistribution(MicroRngDistribution const&) = delete;
+	MicroRngDistribution(MicroRngDistribution&&) = delete;
+	MicroRngDistribution& operator=(MicroRngDistribution const&) = delete;
+	MicroRngDistribution& operator=(MicroRngDistribution&&) = delete;
+	virtual ~MicroRngDistribution();
+
+	bool getBits(uint32_t numBits, uint64_t *value);
+	bool getUniform32(uint32_t bound, uint32_t *value);
+	bool getUniform64(uint64_t bound, uint64_t *value);
+	bool getRange32(int32_t min, int32_t max, int32_t *value);
+	bool getDouble(double *value);
+	bool getFloat(float *value);
+	bool fillUniform(uint32_t *values, size_t numValues, uint32_t bound);
+	bool fillDouble(double *values, size_t numValues);
+	void discardBits();
+	void getStats(MicroRngDistributionStats *stats) const;
+	const char* getLastErrMsg() const;
+
+private:
+	bool takeBits(uint32_t numBits, uint64_t *value);
+	bool refillPool();
+	static void selectSampleBits(uint64_t bound, uint32_t maxBits, uint32_t *numBits, uint64_t *threshold);
+	static bool isAccepted(uint64_t sample, uint64_t bound, uint32_t numBits, uint64_t threshold, uint64_t *value);
+	static void convertDoubles(double *values, size_t numValues);
+
+	MicroRngBuffer &m_buffer;
+	uint8_t m_pool[MCR_DIST_POOL_BYTES];
+	uint32_t m_poolOffset;
+	uint64_t m_reservoir;
+	uint32_t m_reservoirBits;
+	MicroRngDistributionStats m_stats;
+	char m_lastError[256];
+};
+
+#endif // MICRORNGDISTRIBUTION_H
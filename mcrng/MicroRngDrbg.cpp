@@ -0,0 +1,305 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngDrbg.cpp
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief deterministic random bit generator based on the ChaCha20 stream cipher, seeded with MicroRNG random bytes.
+ *
+ */
+#include "MicroRngDrbg.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define MCR_DRBG_VECTOR_BLOCKS
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MCR_DRBG_VECTOR_BLOCKS
+#endif
+
+static inline uint32_t rotateLeft(uint32_t value, int bits) {
+	return (value << bits) | (value >> (32 - bits));
+}
+
+#define CHACHA_QUARTER_ROUND(a, b, c, d) \
+	a += b; d = rotateLeft(d ^ a, 16); \
+	c += d; b = rotateLeft(b ^ c, 12); \
+	a += b; d = rotateLeft(d ^ a, 8); \
+	c += d; b = rotateLeft(b ^ c, 7);
+
+/**
+ * Compute one ChaCha20 key stream block with a 64 bit block counter and a zero nonce
+ *
+ * @param key 256 bit key
+ * @param counter block counter
+ * @param block pointer to receiving MCR_DRBG_BLOCK_BYTES bytes
+ */
+static void computeChaChaBlock(const uint32_t *key, uint64_t counter, uint8_t *block) {
+	uint32_t input[16] = { 0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+			key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7],
+			(uint32_t) counter, (uint32_t) (counter >> 32), 0, 0 };
+	uint32_t x[16];
+	memcpy(x, input, sizeof(x));
+	for (int i = 0; i < 10; i++) {
+		CHACHA_QUARTER_ROUND(x[0], x[4], x[8], x[12])
+		CHACHA_QUARTER_ROUND(x[1], x[5], x[9], x[13])
+		CHACHA_QUARTER_ROUND(x[2], x[6], x[10], x[14])
+		CHACHA_QUARTER_ROUND(x[3], x[7], x[11], x[15])
+		CHACHA_QUARTER_ROUND(x[0], x[5], x[10], x[15])
+		CHACHA_QUARTER_ROUND(x[1], x[6], x[11], x[12])
+		CHACHA_QUARTER_ROUND(x[2], x[7], x[8], x[13])
+		CHACHA_QUARTER_ROUND(x[3], x[4], x[9], x[14])
+	}
+	for (int i = 0; i < 16; i++) {
+		uint32_t word = x[i] + input[i];
+		block[i * 4] = (uint8_t) word;
+		block[i * 4 + 1] = (uint8_t) (word >> 8);
+		block[i * 4 + 2] = (uint8_t) (word >> 16);
+		block[i * 4 + 3] = (uint8_t) (word >> 24);
+	}
+}
+
+#if defined(MCR_DRBG_VECTOR_BLOCKS)
+
+#if defined(__SSE2__)
+typedef __m128i ChaChaVector;
+#define CHACHA_VECTOR_ADD(a, b) _mm_add_epi32(a, b)
+#define CHACHA_VECTOR_XOR(a, b) _mm_xor_si128(a, b)
+#define CHACHA_VECTOR_ROTATE(x, bits) _mm_or_si128(_mm_slli_epi32(x, bits), _mm_srli_epi32(x, 32 - bits))
+#define CHACHA_VECTOR_SET(value) _mm_set1_epi32((int) (value))
+#else
+typedef uint32x4_t ChaChaVector;
+#define CHACHA_VECTOR_ADD(a, b) vaddq_u32(a, b)
+#define CHACHA_VECTOR_XOR(a, b) veorq_u32(a, b)
+#define CHACHA_VECTOR_ROTATE(x, bits) vsriq_n_u32(vshlq_n_u32(x, bits), x, 32 - bits)
+#define CHACHA_VECTOR_SET(value) vdupq_n_u32(value)
+#endif
+
+#define CHACHA_VECTOR_QUARTER_ROUND(a, b, c, d) \
+	a = CHACHA_VECTOR_ADD(a, b); d = CHACHA_VECTOR_ROTATE(CHACHA_VECTOR_XOR(d, a), 16); \
+	c = CHACHA_VECTOR_ADD(c, d); b = CHACHA_VECTOR_ROTATE(CHACHA_VECTOR_XOR(b, c), 12); \
+	a = CHACHA_VECTOR_ADD(a, b); d = CHACHA_VECTOR_ROTATE(CHACHA_VECTOR_XOR(d, a), 8); \
+	c = CHACHA_VECTOR_ADD(c, d); b = CHACHA_VECTOR_ROTATE(CHACHA_VECTOR_XOR(b, c), 7);
+
+/**
+ * Store four state words of four blocks, the vectors hold the same word of each block
+ *
+ * @param a vector of the first word
+ * @param b vector of the second word
+ * @param c vector of the third word
+ * @param d vector of the fourth word
+ * @param blocks pointer to the first of four consecutive blocks, at the offset of the first word
+ */
+static inline void storeChaChaWords(ChaChaVector a, ChaChaVector b, ChaChaVector c, ChaChaVector d, uint8_t *blocks) {
+#if defined(__SSE2__)
+	__m128i ab01 = _mm_unpacklo_epi32(a, b);
+	__m128i cd01 = _mm_unpacklo_epi32(c, d);
+	__m128i ab23 = _mm_unpackhi_epi32(a, b);
+	__m128i cd23 = _mm_unpackhi_epi32(c, d);
+	_mm_storeu_si128((__m128i*) blocks, _mm_unpacklo_epi64(ab01, cd01));
+	_mm_storeu_si128((__m128i*) (blocks + MCR_DRBG_BLOCK_BYTES), _mm_unpackhi_epi64(ab01, cd01));
+	_mm_storeu_si128((__m128i*) (blocks + MCR_DRBG_BLOCK_BYTES * 2), _mm_unpacklo_epi64(ab23, cd23));
+	_mm_storeu_si128((__m128i*) (blocks + MCR_DRBG_BLOCK_BYTES * 3), _mm_unpackhi_epi64(ab23, cd23));
+#else
+	uint32x4x2_t ab = vtrnq_u32(a, b);
+	uint32x4x2_t cd = vtrnq_u32(c, d);
+	vst1q_u8(blocks, vreinterpretq_u8_u32(vcombine_u32(vget_low_u32(ab.val[0]), vget_low_u32(cd.val[0]))));
+	vst1q_u8(blocks + MCR_DRBG_BLOCK_BYTES,
+			vreinterpretq_u8_u32(vcombine_u32(vget_low_u32(ab.val[1]), vget_low_u32(cd.val[1]))));
+	vst1q_u8(blocks + MCR_DRBG_BLOCK_BYTES * 2,
+			vreinterpretq_u8_u32(vcombine_u32(vget_high_u32(ab.val[0]), vget_high_u32(cd.val[0]))));
+	vst1q_u8(blocks + MCR_DRBG_BLOCK_BYTES * 3,
+			vreinterpretq_u8_u32(vcombine_u32(vget_high_u32(ab.val[1]), vget_high_u32(cd.val[1]))));
+#endif
+}
+
+/**
+ * Compute four consecutive ChaCha20 key stream blocks at once, one block per vector lane
+ *
+ * @param key 256 bit key
+ * @param counter block counter of the first block
+ * @param blocks pointer to receiving 4 * MCR_DRBG_BLOCK_BYTES bytes
+ */
+static void computeChaChaBlocks4(const uint32_t *key, uint64_t counter, uint8_t *blocks) {
+	uint32_t counterLow[4];
+	uint32_t counterHigh[4];
+	for (int i = 0; i < 4; i++) {
+		counterLow[i] = (uint32_t) (counter + i);
+		counterHigh[i] = (uint32_t) ((counter + i) >> 32);
+	}
+	ChaChaVector input[16];
+	input[0] = CHACHA_VECTOR_SET(0x61707865);
+	input[1] = CHACHA_VECTOR_SET(0x3320646e);
+	input[2] = CHACHA_VECTOR_SET(0x79622d32);
+	input[3] = CHACHA_VECTOR_SET(0x6b206574);
+	for (int i = 0; i < 8; i++) {
+		input[4 + i] = CHACHA_VECTOR_SET(key[i]);
+	}
+#if defined(__SSE2__)
+	input[12] = _mm_loadu_si128((const __m128i*) counterLow);
+	input[13] = _mm_loadu_si128((const __m128i*) counterHigh);
+#else
+	input[12] = vld1q_u32(counterLow);
+	input[13] = vld1q_u32(counterHigh);
+#endif
+	input[14] = CHACHA_VECTOR_SET(0);
+	input[15] = CHACHA_VECTOR_SET(0);
+
+	ChaChaVector x[16];
+	for (int i = 0; i < 16; i++) {
+		x[i] = input[i];
+	}
+	for (int i = 0; i < 10; i++) {
+		CHACHA_VECTOR_QUARTER_ROUND(x[0], x[4], x[8], x[12])
+		CHACHA_VECTOR_QUARTER_ROUND(x[1], x[5], x[9], x[13])
+		CHACHA_VECTOR_QUARTER_ROUND(x[2], x[6], x[10], x[14])
+		CHACHA_VECTOR_QUARTER_ROUND(x[3], x[7], x[11], x[15])
+		CHACHA_VECTOR_QUARTER_ROUND(x[0], x[5], x[10], x[15])
+		CHACHA_VECTOR_QUARTER_ROUND(x[1], x[6], x[11], x[12])
+		CHACHA_VECTOR_QUARTER_ROUND(x[2], x[7], x[8], x[13])
+		CHACHA_VECTOR_QUARTER_ROUND(x[3], x[4], x[9], x[14])
+	}
+	for (int i = 0; i < 16; i++) {
+		x[i] = CHACHA_VECTOR_ADD(x[i], input[i]);
+	}
+	for (int i = 0; i < 16; i += 4) {
+		storeChaChaWords(x[i], x[i + 1], x[i + 2], x[i + 3], blocks + i * 4);
+	}
+}
+
+#endif
+
+MicroRngDrbg::MicroRngDrbg() {
+	memset(m_key, 0, sizeof(m_key));
+	m_isSeeded = false;
+	m_bytesSinceReseed = 0;
+}
+
+/**
+ * Mix seed bytes into the generator key, key = SHA-256(key || seed)
+ *
+ * @param seed pointer to the seed bytes, random bytes retrieved from MicroRNG device
+ * @param len number of seed bytes, at least MCR_DRBG_MIN_SEED_BYTES
+ *
+ * @return true if reseeded
+ */
+bool MicroRngDrbg::reseed(const uint8_t *seed, size_t len) {
+	if (len < MCR_DRBG_MIN_SEED_BYTES) {
+		return false;
+	}
+	uint8_t keyBytes[MCR_DRBG_KEY_BYTES];
+	Sha256 sha;
+	sha.update((const uint8_t*) m_key, sizeof(m_key));
+	sha.update(seed, len);
+	sha.final(keyBytes);
+	memcpy(m_key, keyBytes, sizeof(m_key));
+	memset(keyBytes, 0, sizeof(keyBytes));
+	m_isSeeded = true;
+	m_bytesSinceReseed = 0;
+	return true;
+}
+
+/**
+ * @return true once the generator has been seeded
+ */
+bool MicroRngDrbg::isSeeded() const {
+	return m_isSeeded;
+}
+
+/**
+ * Generate pseudo random bytes
+ *
+ * @param buffer pointer to receiving bytes
+ * @param len number of bytes to generate
+ *
+ * @return true if generated, false when the generator hasn't been seeded
+ */
+bool MicroRngDrbg::generate(uint8_t *buffer, size_t len) {
+	if (!m_isSeeded) {
+		return false;
+	}
+	while (len > 0) {
+		size_t numBytes = len < MCR_DRBG_MAX_REQUEST_BYTES ? len : MCR_DRBG_MAX_REQUEST_BYTES;
+		generateRequest(buffer, numBytes);
+		buffer += numBytes;
+		len -= numBytes;
+	}
+	return true;
+}
+
+/**
+ * @return number of bytes generated since the last reseed
+ */
+uint64_t MicroRngDrbg::getBytesSinceReseed() const {
+	return m_bytesSinceReseed;
+}
+
+/**
+ * Generate up to MCR_DRBG_MAX_REQUEST_BYTES bytes and replace the key
+ *
+ * @param buffer pointer to receiving bytes
+ * @param len number of bytes to generate
+ */
+void MicroRngDrbg::generateRequest(uint8_t *buffer, size_t len) {
+	uint8_t block[MCR_DRBG_BLOCK_BYTES];
+	uint32_t nextKey[MCR_DRBG_KEY_BYTES / 4];
+
+	// The first half of block 0 becomes the next key, the rest of the stream is handed out
+	computeChaChaBlock(m_key, 0, block);
+	memcpy(nextKey, block, sizeof(nextKey));
+	size_t numBytes = MCR_DRBG_BLOCK_BYTES - MCR_DRBG_KEY_BYTES;
+	if (numBytes > len) {
+		numBytes = len;
+	}
+	memcpy(buffer, block + MCR_DRBG_KEY_BYTES, numBytes);
+	size_t offset = numBytes;
+
+	uint64_t counter = 1;
+#if defined(MCR_DRBG_VECTOR_BLOCKS)
+	for (; len - offset >= MCR_DRBG_BLOCK_BYTES * 4; counter += 4) {
+		computeChaChaBlocks4(m_key, counter, buffer + offset);
+		offset += MCR_DRBG_BLOCK_BYTES * 4;
+	}
+#endif
+	for (; offset < len; counter++) {
+		if (len - offset >= MCR_DRBG_BLOCK_BYTES) {
+			computeChaChaBlock(m_key, counter, buffer + offset);
+			offset += MCR_DRBG_BLOCK_BYTES;
+		} else {
+			computeChaChaBlock(m_key, counter, block);
+			memcpy(buffer + offset, block, len - offset);
+			offset = len;
+		}
+	}
+
+	memcpy(m_key, nextKey, sizeof(m_key));
+	memset(nextKey, 0, sizeof(nextKey));
+	memset(block, 0, sizeof(block));
+	m_bytesSinceReseed += len;
+}
+
+MicroRngDrbg::~MicroRngDrbg() {
+	memset(m_key, 0, sizeof(m_key));
+}
@@ -0,0 +1,78 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngDrbg.h
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief deterministic random bit generator based on the ChaCha20 stream cipher, seeded with MicroRNG random bytes.
+ *
+ *    Seed bytes are mixed into the key with SHA-256. Each request is generated from a ChaCha20 key stream,
+ *    the first MCR_DRBG_KEY_BYTES of that stream replace the key right away (fast key erasure),
+ *    so bytes handed out earlier can't be recovered from the generator state.
+ *
+ *    Usage:
+ *        MicroRngDrbg drbg;
+ *        drbg.reseed(seed, sizeof(seed));
+ *        bool success = drbg.generate(buffer, len);
+ */
+#ifndef MICRORNGDRBG_H
+#define MICRORNGDRBG_H
+
+#include "Sha256.h"
+
+#define MCR_DRBG_KEY_BYTES (32)
+#define MCR_DRBG_BLOCK_BYTES (64)
+
+/**
+ * Min amount of seed bytes accepted by reseed()
+ */
+#define MCR_DRBG_MIN_SEED_BYTES (32)
+
+/**
+ * Max amount of bytes generated with the same key, larger requests are split
+ */
+#define MCR_DRBG_MAX_REQUEST_BYTES (65536)
+
+class MicroRngDrbg {
+public:
+	MicroRngDrbg();
+	MicroRngDrbg(MicroRngDrbg const&) = delete;
+	MicroRngDrbg& operator=(MicroRngDrbg const&) = delete;
+	virtual ~MicroRngDrbg();
+
+	bool reseed(const uint8_t *seed, size_t len);
+	bool isSeeded() const;
+	bool generate(uint8_t *buffer, size_t len);
+	uint64_t getBytesSinceReseed() const;
+
+private:
+	void generateRequest(uint8_t *buffer, size_t len);
+
+	uint32_t m_key[MCR_DRBG_KEY_BYTES / 4];
+	bool m_isSeeded;
+	uint64_t m_bytesSinceReseed;
+};
+
+#endif // MICRORNGDRBG_H
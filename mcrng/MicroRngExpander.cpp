@@ -0,0 +1,360 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngExpander.cpp
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief expands MicroRNG random bytes at memory speed with a ChaCha20 DRBG reseeded on a schedule.
+ *
+ */
+#include "MicroRngExpander.h"
+
+/**
+ * Construct an expander seeded with random bytes of a MicroRNG device
+ *
+ * @param device connected and configured device, used by the reseeder thread only while started
+ */
+MicroRngExpander::MicroRngExpander(MicroRngSPI &device) : MicroRngExpander(retrieveDeviceSeed, &device) {
+	m_device = &device;
+}
+
+/**
+ * Construct an expander seeded by a callback
+ *
+ * @param source callback retrieving seed bytes, called by start() and by the reseeder thread
+ * @param context passed to the callback
+ */
+MicroRngExpander::MicroRngExpander(McrSeedSource source, void *context) {
+	m_source = source;
+	m_context = context;
+	m_device = nullptr;
+	m_reseedBytes = MCR_EXPANDER_DEFAULT_RESEED_BYTES;
+	m_reseedIntervalMs = MCR_EXPANDER_DEFAULT_RESEED_MSECS;
+	m_lastReseedNanos = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_reseeder = pthread_t();
+	m_isRunning = false;
+	m_stopRequested = false;
+	m_isSeedFailing = false;
+	strcpy(m_lastError, "Not started");
+	strcpy(m_seedError, "");
+	pthread_mutex_init(&m_mutex, nullptr);
+	pthread_cond_init(&m_seedCond, nullptr);
+	pthread_condattr_t condAttr;
+	pthread_condattr_init(&condAttr);
+	pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+	pthread_cond_init(&m_reseedCond, &condAttr);
+	pthread_condattr_destroy(&condAttr);
+}
+
+/**
+ * Seed the DRBG and start the reseeder thread
+ *
+ * @param reseedBytes byte budget, reseed after generating that many bytes
+ * @param reseedIntervalMs reseed interval in milliseconds, reseed at least that often while bytes are generated
+ *
+ * @return true if started successfully
+ */
+bool MicroRngExpander::start(uint32_t reseedBytes, uint32_t reseedIntervalMs) {
+	if (m_isRunning) {
+		return true;
+	}
+	if (m_device != nullptr && !m_device->isConnected()) {
+		sprintf(m_lastError, "Device not connected");
+		return false;
+	}
+	if (reseedBytes < MCR_EXPANDER_MIN_RESEED_BYTES || reseedBytes > MCR_EXPANDER_MAX_RESEED_BYTES) {
+		sprintf(m_lastError, "Reseed byte budget must be between %d and %d bytes",
+				MCR_EXPANDER_MIN_RESEED_BYTES, MCR_EXPANDER_MAX_RESEED_BYTES);
+		return false;
+	}
+	if (reseedIntervalMs == 0) {
+		sprintf(m_lastError, "Reseed interval must be at least 1 millisecond");
+		return false;
+	}
+
+	uint8_t seed[MCR_EXPANDER_SEED_BYTES];
+	char seedError[256];
+	if (!retrieveSeed(seed, seedError)) {
+		sprintf(m_lastError, "Could not retrieve seed: %s", seedError);
+		return false;
+	}
+	m_reseedBytes = reseedBytes;
+	m_reseedIntervalMs = reseedIntervalMs;
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_isSeedFailing = false;
+	m_stopRequested = false;
+	applySeed(seed);
+	memset(seed, 0, sizeof(seed));
+
+	if (pthread_create(&m_reseeder, nullptr, runReseeder, this) != 0) {
+		sprintf(m_lastError, "Could not start reseeder thread");
+		return false;
+	}
+	m_isRunning = true;
+	return true;
+}
+
+/**
+ * Stop the reseeder thread, generate() fails until started again
+ */
+void MicroRngExpander::stop() {
+	if (!m_isRunning) {
+		return;
+	}
+	pthread_mutex_lock(&m_mutex);
+	m_stopRequested = true;
+	pthread_cond_broadcast(&m_reseedCond);
+	pthread_cond_broadcast(&m_seedCond);
+	pthread_mutex_unlock(&m_mutex);
+	pthread_join(m_reseeder, nullptr);
+	pthread_mutex_lock(&m_mutex);
+	m_isRunning = false;
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/**
+ * @return true if the reseeder thread is running
+ */
+bool MicroRngExpander::isRunning() const {
+	return m_isRunning;
+}
+
+/**
+ * Generate random bytes, may be called from any thread
+ *
+ * @param buffer pointer to receiving bytes
+ * @param len number of bytes to generate
+ *
+ * @return true if generated successfully
+ */
+bool MicroRngExpander::generate(uint8_t *buffer, size_t len) {
+	pthread_mutex_lock(&m_mutex);
+	if (!m_isRunning || m_stopRequested) {
+		sprintf(m_lastError, "Expander is not running");
+		pthread_mutex_unlock(&m_mutex);
+		return false;
+	}
+	uint64_t maxBytesPerSeed = (uint64_t) m_reseedBytes * MCR_EXPANDER_MAX_BUDGET_OVERRUN;
+	uint64_t waitStartNanos = 0;
+	size_t offset = 0;
+	while (offset < len) {
+		if (m_isSeedFailing) {
+			sprintf(m_lastError, "Could not reseed: %s", m_seedError);
+			pthread_mutex_unlock(&m_mutex);
+			return false;
+		}
+		uint64_t bytesSinceReseed = m_drbg.getBytesSinceReseed();
+		if (bytesSinceReseed >= maxBytesPerSeed) {
+			if (m_stopRequested) {
+				sprintf(m_lastError, "Expander is not running");
+				pthread_mutex_unlock(&m_mutex);
+				return false;
+			}
+			if (waitStartNanos == 0) {
+				waitStartNanos = getMonotonicNanos();
+				m_stats.stalls++;
+			}
+			pthread_cond_wait(&m_seedCond, &m_mutex);
+			continue;
+		}
+		size_t numBytes = len - offset;
+		if (numBytes > maxBytesPerSeed - bytesSinceReseed) {
+			numBytes = (size_t) (maxBytesPerSeed - bytesSinceReseed);
+		}
+		if (bytesSinceReseed < m_reseedBytes && bytesSinceReseed + numBytes >= m_reseedBytes) {
+			pthread_cond_signal(&m_reseedCond);
+		}
+		m_drbg.generate(buffer + offset, numBytes);
+		m_stats.bytesGenerated += numBytes;
+		offset += numBytes;
+	}
+	if (waitStartNanos != 0) {
+		m_stats.stallNanos += getMonotonicNanos() - waitStartNanos;
+	}
+	pthread_mutex_unlock(&m_mutex);
+	return true;
+}
+
+/**
+ * Retrieve a copy of the counters
+ *
+ * @param stats pointer to receiving counters
+ */
+void MicroRngExpander::getStats(MicroRngExpanderStats *stats) {
+	pthread_mutex_lock(&m_mutex);
+	*stats = m_stats;
+	if (m_drbg.getBytesSinceReseed() > stats->maxBytesPerSeed) {
+		stats->maxBytesPerSeed = m_drbg.getBytesSinceReseed();
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/**
+ * Seed source of a MicroRNG device
+ *
+ * @param seed pointer to receiving len random bytes
+ * @param len number of random bytes to retrieve
+ * @param context the MicroRngSPI device
+ * @return true when retrieved successfully
+ */
+bool MicroRngExpander::retrieveDeviceSeed(uint8_t *seed, uint32_t len, void *context) {
+	return ((MicroRngSPI*) context)->retrieveRandomBytes(len, seed);
+}
+
+/**
+ * Reseeder thread entry
+ *
+ * @param arg the MicroRngExpander instance
+ * @return nullptr
+ */
+void* MicroRngExpander::runReseeder(void *arg) {
+	((MicroRngExpander*) arg)->reseedPeriodically();
+	return nullptr;
+}
+
+/**
+ * Retrieve the next seed ahead of time, then mix it into the DRBG when the byte budget
+ * is spent or the reseed interval elapsed
+ */
+void MicroRngExpander::reseedPeriodically() {
+	uint8_t seed[MCR_EXPANDER_SEED_BYTES];
+	char seedError[256];
+	bool isSeedReady = false;
+
+	pthread_mutex_lock(&m_mutex);
+	while (!m_stopRequested) {
+		if (!isSeedReady) {
+			// Don't hold the mutex while the seed is retrieved, generate() keeps going with the current seed
+			pthread_mutex_unlock(&m_mutex);
+			bool isSuccess = retrieveSeed(seed, seedError);
+			pthread_mutex_lock(&m_mutex);
+			if (!isSuccess) {
+				strcpy(m_seedError, seedError);
+				m_isSeedFailing = true;
+				m_stats.seedFailures++;
+				pthread_cond_broadcast(&m_seedCond);
+				waitUntil(&m_reseedCond, getMonotonicNanos() + (uint64_t) MCR_EXPANDER_RETRY_PAUSE_MSECS * 1000000);
+				continue;
+			}
+			isSeedReady = true;
+		}
+		uint64_t deadlineNanos = m_lastReseedNanos + (uint64_t) m_reseedIntervalMs * 1000000;
+		bool isBudgetSpent = m_drbg.getBytesSinceReseed() >= m_reseedBytes;
+		if (m_isSeedFailing) {
+			// Reseed right away after recovering from failures, generate() fails meanwhile
+		} else if (isBudgetSpent) {
+			m_stats.byteBudgetReseeds++;
+		} else if (getMonotonicNanos() >= deadlineNanos) {
+			if (m_drbg.getBytesSinceReseed() == 0) {
+				// Nothing generated with the current seed
+				m_lastReseedNanos = getMonotonicNanos();
+				continue;
+			}
+			m_stats.intervalReseeds++;
+		} else {
+			waitUntil(&m_reseedCond, deadlineNanos);
+			continue;
+		}
+		applySeed(seed);
+		isSeedReady = false;
+		m_isSeedFailing = false;
+		pthread_cond_broadcast(&m_seedCond);
+	}
+	pthread_mutex_unlock(&m_mutex);
+	memset(seed, 0, sizeof(seed));
+}
+
+/**
+ * Retrieve seed bytes from the seed source
+ *
+ * @param seed pointer to receiving MCR_EXPANDER_SEED_BYTES random bytes
+ * @param error pointer to receiving the error message on failure, 256 bytes
+ * @return true when retrieved successfully
+ */
+bool MicroRngExpander::retrieveSeed(uint8_t *seed, char *error) {
+	if (m_source(seed, MCR_EXPANDER_SEED_BYTES, m_context)) {
+		return true;
+	}
+	if (m_device != nullptr) {
+		snprintf(error, 256, "%s", m_device->getLastErrMsg());
+	} else {
+		strcpy(error, "Seed source failed");
+	}
+	return false;
+}
+
+/**
+ * Mix a seed into the DRBG. Called with the mutex locked or before the reseeder thread starts.
+ *
+ * @param seed MCR_EXPANDER_SEED_BYTES random bytes
+ */
+void MicroRngExpander::applySeed(const uint8_t *seed) {
+	if (m_drbg.getBytesSinceReseed() > m_stats.maxBytesPerSeed) {
+		m_stats.maxBytesPerSeed = m_drbg.getBytesSinceReseed();
+	}
+	m_drbg.reseed(seed, MCR_EXPANDER_SEED_BYTES);
+	m_lastReseedNanos = getMonotonicNanos();
+	m_stats.reseeds++;
+}
+
+/**
+ * Wait on a condition variable using CLOCK_MONOTONIC until signalled or the deadline passes.
+ * Called with the mutex locked.
+ *
+ * @param cond condition variable to wait on
+ * @param deadlineNanos CLOCK_MONOTONIC deadline in nanoseconds
+ */
+void MicroRngExpander::waitUntil(pthread_cond_t *cond, uint64_t deadlineNanos) {
+	struct timespec deadline;
+	deadline.tv_sec = (time_t) (deadlineNanos / 1000000000);
+	deadline.tv_nsec = (long) (deadlineNanos % 1000000000);
+	pthread_cond_timedwait(cond, &m_mutex, &deadline);
+}
+
+/**
+ * @return uint64_t - CLOCK_MONOTONIC time in nanoseconds
+ */
+uint64_t MicroRngExpander::getMonotonicNanos() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * Retrieve the last error message.
+ *
+ * @return const char* - pointer to the last error message
+ */
+const char* MicroRngExpander::getLastErrMsg() const {
+	return m_lastError;
+}
+
+MicroRngExpander::~MicroRngExpander() {
+	stop();
+	pthread_cond_destroy(&m_seedCond);
+	pthread_cond_destroy(&m_reseedCond);
+	pthread_mutex_destroy(&m_mutex);
+}
@@ -0,0 +1,144 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngExpander.h
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief expands MicroRNG random bytes at memory speed with a ChaCha20 DRBG reseeded on a schedule.
+ *
+ *    A background reseeder thread retrieves the next seed from the seed source ahead of time and mixes it
+ *    into the DRBG once the bytes generated since the last reseed reach the byte budget or the reseed interval
+ *    elapses, whichever comes first, so generate() never waits for the device in the normal case. When a seed
+ *    isn't ready by the time MCR_EXPANDER_MAX_BUDGET_OVERRUN byte budgets were generated with the same seed,
+ *    generate() waits for it. While the seed source keeps failing generate() fails too, the reseeder thread
+ *    keeps retrying and generate() succeeds again after the next successful reseed.
+ *
+ *    The ChaCha20 key stream is computed four blocks at a time with SSE2 or NEON when available.
+ *
+ *    The seed source is either a MicroRngSPI device, used by the reseeder thread only while started, or a callback.
+ *
+ *    Usage:
+ *        MicroRngExpander expander(spi);
+ *        if (expander.start(MCR_EXPANDER_DEFAULT_RESEED_BYTES, MCR_EXPANDER_DEFAULT_RESEED_MSECS)) {
+ *            bool success = expander.generate(buffer, len);
+ *        }
+ */
+#ifndef MICRORNGEXPANDER_H
+#define MICRORNGEXPANDER_H
+
+#include "MicroRngSPI.h"
+#include "MicroRngDrbg.h"
+#include <pthread.h>
+
+/**
+ * Amount of random bytes retrieved from the seed source for each reseed
+ */
+#define MCR_EXPANDER_SEED_BYTES (64)
+
+#define MCR_EXPANDER_DEFAULT_RESEED_BYTES (1048576)
+#define MCR_EXPANDER_MIN_RESEED_BYTES (4096)
+#define MCR_EXPANDER_MAX_RESEED_BYTES (1073741824)
+#define MCR_EXPANDER_DEFAULT_RESEED_MSECS (1000)
+
+/**
+ * Number of byte budgets generated with the same seed before generate() waits for the next seed
+ */
+#define MCR_EXPANDER_MAX_BUDGET_OVERRUN (4)
+
+/**
+ * Pause of the reseeder thread after a failed seed retrieval
+ */
+#define MCR_EXPANDER_RETRY_PAUSE_MSECS (10)
+
+/**
+ * Callback retrieving seed bytes
+ *
+ * @param seed pointer to receiving len random bytes
+ * @param len number of random bytes to retrieve
+ * @param context context given to the MicroRngExpander constructor
+ * @return true when retrieved successfully
+ */
+typedef bool (*McrSeedSource)(uint8_t *seed, uint32_t len, void *context);
+
+/**
+ * Counters of a MicroRngExpander
+ */
+struct MicroRngExpanderStats {
+	uint64_t bytesGenerated;	// bytes handed out by generate()
+	uint64_t reseeds;		// seeds mixed into the DRBG, including the initial seed
+	uint64_t byteBudgetReseeds;	// reseeds triggered by the byte budget
+	uint64_t intervalReseeds;	// reseeds triggered by the reseed interval
+	uint64_t seedFailures;		// failed seed retrievals
+	uint64_t maxBytesPerSeed;	// most bytes generated with the same seed
+	uint64_t stalls;		// generate() calls that waited for a seed
+	uint64_t stallNanos;		// total time generate() waited for seeds
+};
+
+class MicroRngExpander {
+public:
+	explicit MicroRngExpander(MicroRngSPI &device);
+	MicroRngExpander(McrSeedSource source, void *context);
+	MicroRngExpander(MicroRngExpander const&) = delete;
+	MicroRngExpander(MicroRngExpander&&) = delete;
+	MicroRngExpander& operator=(MicroRngExpander const&) = delete;
+	MicroRngExpander& operator=(MicroRngExpander&&) = delete;
+	virtual ~MicroRngExpander();
+
+	bool start(uint32_t reseedBytes, uint32_t reseedIntervalMs);
+	void stop();
+	bool isRunning() const;
+	bool generate(uint8_t *buffer, size_t len);
+	void getStats(MicroRngExpanderStats *stats);
+	const char* getLastErrMsg() const;
+
+private:
+	static bool retrieveDeviceSeed(uint8_t *seed, uint32_t len, void *context);
+	static void* runReseeder(void *arg);
+	void reseedPeriodically();
+	bool retrieveSeed(uint8_t *seed, char *error);
+	void applySeed(const uint8_t *seed);
+	void waitUntil(pthread_cond_t *cond, uint64_t deadlineNanos);
+	static uint64_t getMonotonicNanos();
+
+	McrSeedSource m_source;
+	void *m_context;
+	MicroRngSPI *m_device;
+	MicroRngDrbg m_drbg;
+	uint32_t m_reseedBytes;
+	uint32_t m_reseedIntervalMs;
+	uint64_t m_lastReseedNanos;
+	MicroRngExpanderStats m_stats;
+	pthread_t m_reseeder;
+	bool m_isRunning;
+	bool m_stopRequested;
+	bool m_isSeedFailing;
+	char m_lastError[512];
+	char m_seedError[256];
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_reseedCond;
+	pthread_cond_t m_seedCond;
+};
+
+#endif // MICRORNGEXPANDER_H
@@ -0,0 +1,439 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngHealth.cpp
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief continuous health tests of MicroRNG random bytes, following NIST SP 800-90B section 4.4.
+ *
+ */
+#include "MicroRngHealth.h"
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/**
+ * Count the bytes matching a value
+ *
+ * @param bytes pointer to the bytes
+ * @param len number of bytes
+ * @param value byte value to count
+ *
+ * @return number of bytes equal to the value
+ */
+static uint32_t countMatchingBytes(const uint8_t *bytes, uint32_t len, uint8_t value) {
+	uint32_t count = 0;
+	uint32_t i = 0;
+#if defined(__SSE2__)
+	const __m128i target = _mm_set1_epi8((char) value);
+	const __m128i zero = _mm_setzero_si128();
+	while (i + 16 <= len) {
+		// Byte lane counters overflow after 255 blocks
+		uint32_t numBlocks = (len - i) / 16;
+		if (numBlocks > 255) {
+			numBlocks = 255;
+		}
+		__m128i counters = zero;
+		for (uint32_t b = 0; b < numBlocks; b++, i += 16) {
+			__m128i block = _mm_loadu_si128((const __m128i*) (bytes + i));
+			counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(block, target));
+		}
+		__m128i sums = _mm_sad_epu8(counters, zero);
+		count += (uint32_t) (_mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4));
+	}
+#elif defined(__ARM_NEON)
+	const uint8x16_t target = vdupq_n_u8(value);
+	while (i + 16 <= len) {
+		// Byte lane counters overflow after 255 blocks
+		uint32_t numBlocks = (len - i) / 16;
+		if (numBlocks > 255) {
+			numBlocks = 255;
+		}
+		uint8x16_t counters = vdupq_n_u8(0);
+		for (uint32_t b = 0; b < numBlocks; b++, i += 16) {
+			counters = vsubq_u8(counters, vceqq_u8(vld1q_u8(bytes + i), target));
+		}
+		uint64x2_t sums = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(counters)));
+		count += (uint32_t) (vgetq_lane_u64(sums, 0) + vgetq_lane_u64(sums, 1));
+	}
+#endif
+	for (; i < len; i++) {
+		count += bytes[i] == value;
+	}
+	return count;
+}
+
+/**
+ * Find the first byte equal to the byte following it
+ *
+ * @param bytes pointer to the bytes
+ * @param len number of bytes
+ *
+ * @return index of the first byte equal to its successor, or a lower bound of it when the
+ *         remaining bytes are too few for a vector comparison; the bytes before the index all differ from their successors
+ */
+static uint32_t skipDistinctBytes(const uint8_t *bytes, uint32_t len) {
+	uint32_t i = 0;
+#if defined(__SSE2__)
+	while (i + 17 <= len) {
+		__m128i block = _mm_loadu_si128((const __m128i*) (bytes + i));
+		__m128i nextBlock = _mm_loadu_si128((const __m128i*) (bytes + i + 1));
+		int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, nextBlock));
+		if (mask != 0) {
+			return i + (uint32_t) __builtin_ctz((unsigned int) mask);
+		}
+		i += 16;
+	}
+#elif defined(__ARM_NEON)
+	while (i + 17 <= len) {
+		uint8x16_t block = vld1q_u8(bytes + i);
+		uint8x16_t nextBlock = vld1q_u8(bytes + i + 1);
+		uint64x2_t matches = vreinterpretq_u64_u8(vceqq_u8(block, nextBlock));
+		uint64_t lowMatches = vgetq_lane_u64(matches, 0);
+		uint64_t highMatches = vgetq_lane_u64(matches, 1);
+		if (lowMatches != 0) {
+			return i + (uint32_t) __builtin_ctzll(lowMatches) / 8;
+		}
+		if (highMatches != 0) {
+			return i + 8 + (uint32_t) __builtin_ctzll(highMatches) / 8;
+		}
+		i += 16;
+	}
+#else
+	(void) bytes;
+	(void) len;
+#endif
+	return i;
+}
+
+MicroRngHealth::MicroRngHealth() {
+	m_isChiSquareEnabled = false;
+	configure(MCR_HEALTH_DEFAULT_MIN_ENTROPY_BITS, MCR_HEALTH_DEFAULT_ALPHA_LOG2);
+}
+
+/**
+ * Compute the test cutoffs and reset the test state
+ *
+ * @param minEntropyBits assessed min-entropy per byte in bits, between 0.5 and 8
+ * @param alphaLog2 false positive probability of each test as a negative power of two, 2^-alphaLog2
+ *
+ * @return true if the parameters are valid
+ */
+bool MicroRngHealth::configure(double minEntropyBits, uint32_t alphaLog2) {
+	if (minEntropyBits < 0.5 || minEntropyBits > 8) {
+		sprintf(m_lastError, "Min-entropy must be between 0.5 and 8 bits per byte");
+		return false;
+	}
+	if (alphaLog2 < MCR_HEALTH_MIN_ALPHA_LOG2 || alphaLog2 > MCR_HEALTH_MAX_ALPHA_LOG2) {
+		sprintf(m_lastError, "False positive probability must be between 2^-%d and 2^-%d",
+				MCR_HEALTH_MIN_ALPHA_LOG2, MCR_HEALTH_MAX_ALPHA_LOG2);
+		return false;
+	}
+	double alpha = ldexp(1.0, -(int) alphaLog2);
+	m_repetitionCutoff = 1 + (uint32_t) ceil(alphaLog2 / minEntropyBits);
+	m_proportionCutoff = computeProportionCutoff(minEntropyBits, alpha);
+	m_chiSquareCutoff = computeChiSquareCutoff(alpha);
+	reset();
+	return true;
+}
+
+/**
+ * Enable or disable the byte frequency chi-square test, disabled by default
+ *
+ * @param enabled true to enable the test
+ */
+void MicroRngHealth::setChiSquareEnabled(bool enabled) {
+	m_isChiSquareEnabled = enabled;
+	m_blockPos = 0;
+	memset(m_histogram, 0, sizeof(m_histogram));
+}
+
+/**
+ * @return number of identical consecutive bytes that fails the repetition count test
+ */
+uint32_t MicroRngHealth::getRepetitionCutoff() const {
+	return m_repetitionCutoff;
+}
+
+/**
+ * @return number of occurrences of the first byte of a window that fails the adaptive proportion test
+ */
+uint32_t MicroRngHealth::getProportionCutoff() const {
+	return m_proportionCutoff;
+}
+
+/**
+ * @return chi-square statistic of a block that fails the byte frequency test
+ */
+double MicroRngHealth::getChiSquareCutoff() const {
+	return m_chiSquareCutoff;
+}
+
+/**
+ * Run the health tests over the next bytes of the stream
+ *
+ * @param bytes pointer to the bytes
+ * @param len number of bytes
+ *
+ * @return MCR_HEALTH_PASSED or a combination of McrHealthResult failure flags, see getLastErrMsg() for details
+ */
+uint32_t MicroRngHealth::test(const uint8_t *bytes, uint32_t len) {
+	uint32_t result = testRepetitionCount(bytes, len) | testAdaptiveProportion(bytes, len);
+	if (m_isChiSquareEnabled) {
+		result |= testChiSquare(bytes, len);
+	}
+	m_stats.bytesTested += len;
+	return result;
+}
+
+/**
+ * Reset the test state and the counters
+ */
+void MicroRngHealth::reset() {
+	m_hasPreviousByte = false;
+	m_previousByte = 0;
+	m_repetitionCount = 0;
+	m_proportionValue = 0;
+	m_proportionCount = 0;
+	m_windowPos = 0;
+	m_blockPos = 0;
+	memset(m_histogram, 0, sizeof(m_histogram));
+	memset(&m_stats, 0, sizeof(m_stats));
+	strcpy(m_lastError, "");
+}
+
+/**
+ * Retrieve the test counters
+ *
+ * @param stats pointer to receiving counters
+ */
+void MicroRngHealth::getStats(MicroRngHealthStats *stats) const {
+	*stats = m_stats;
+}
+
+/**
+ * Retrieve the description of the last test failure.
+ *
+ * @return last error message
+ */
+const char* MicroRngHealth::getLastErrMsg() const {
+	return m_lastError;
+}
+
+/**
+ * Repetition count test, SP 800-90B section 4.4.1
+ *
+ * @param bytes pointer to the bytes
+ * @param len number of bytes
+ *
+ * @return MCR_HEALTH_PASSED or MCR_HEALTH_RCT_FAILED
+ */
+uint32_t MicroRngHealth::testRepetitionCount(const uint8_t *bytes, uint32_t len) {
+	uint32_t result = MCR_HEALTH_PASSED;
+	uint32_t i = 0;
+	if (len > 0 && !m_hasPreviousByte) {
+		m_previousByte = bytes[0];
+		m_repetitionCount = 1;
+		m_hasPreviousByte = true;
+		i = 1;
+	}
+	while (i < len) {
+		if (bytes[i] == m_previousByte) {
+			if (++m_repetitionCount > m_stats.maxRepetitionCount) {
+				m_stats.maxRepetitionCount = m_repetitionCount;
+			}
+			if (m_repetitionCount >= m_repetitionCutoff) {
+				sprintf(m_lastError, "Repetition count test failed: %u identical bytes 0x%02x at offset %llu",
+						m_repetitionCount, m_previousByte, (unsigned long long) (m_stats.bytesTested + i));
+				m_stats.rctFailures++;
+				m_repetitionCount = 1;
+				result = MCR_HEALTH_RCT_FAILED;
+			}
+			i++;
+			continue;
+		}
+		// A new run starts, skip ahead to the next pair of identical bytes
+		uint32_t numDistinct = skipDistinctBytes(bytes + i, len - i);
+		i += numDistinct;
+		m_previousByte = bytes[i];
+		m_repetitionCount = 1;
+		i++;
+	}
+	return result;
+}
+
+/**
+ * Adaptive proportion test, SP 800-90B section 4.4.2
+ *
+ * @param bytes pointer to the bytes
+ * @param len number of bytes
+ *
+ * @return MCR_HEALTH_PASSED or MCR_HEALTH_APT_FAILED
+ */
+uint32_t MicroRngHealth::testAdaptiveProportion(const uint8_t *bytes, uint32_t len) {
+	uint32_t result = MCR_HEALTH_PASSED;
+	uint32_t i = 0;
+	while (i < len) {
+		if (m_windowPos == 0) {
+			m_proportionValue = bytes[i++];
+			m_proportionCount = 1;
+			m_windowPos = 1;
+			continue;
+		}
+		uint32_t numBytes = MCR_HEALTH_APT_WINDOW_SIZE - m_windowPos;
+		if (numBytes > len - i) {
+			numBytes = len - i;
+		}
+		m_proportionCount += countMatchingBytes(bytes + i, numBytes, m_proportionValue);
+		m_windowPos += numBytes;
+		i += numBytes;
+		if (m_windowPos < MCR_HEALTH_APT_WINDOW_SIZE) {
+			break;
+		}
+		if (m_proportionCount > m_stats.maxProportionCount) {
+			m_stats.maxProportionCount = m_proportionCount;
+		}
+		if (m_proportionCount >= m_proportionCutoff) {
+			sprintf(m_lastError, "Adaptive proportion test failed: %u bytes 0x%02x in a window of %d ending at offset %llu",
+					m_proportionCount, m_proportionValue, MCR_HEALTH_APT_WINDOW_SIZE,
+					(unsigned long long) (m_stats.bytesTested + i));
+			m_stats.aptFailures++;
+			result = MCR_HEALTH_APT_FAILED;
+		}
+		m_stats.aptWindows++;
+		m_windowPos = 0;
+	}
+	return result;
+}
+
+/**
+ * Byte frequency chi-square test with 255 degrees of freedom
+ *
+ * @param bytes pointer to the bytes
+ * @param len number of bytes
+ *
+ * @return MCR_HEALTH_PASSED or MCR_HEALTH_CHI_SQUARE_FAILED
+ */
+uint32_t MicroRngHealth::testChiSquare(const uint8_t *bytes, uint32_t len) {
+	uint32_t result = MCR_HEALTH_PASSED;
+	uint32_t i = 0;
+	while (i < len) {
+		uint32_t numBytes = MCR_HEALTH_CHI_SQUARE_BLOCK_BYTES - m_blockPos;
+		if (numBytes > len - i) {
+			numBytes = len - i;
+		}
+		// Four histograms avoid stalls on consecutive increments of the same counter
+		uint32_t j = 0;
+		for (; j + 4 <= numBytes; j += 4) {
+			m_histogram[0][bytes[i + j]]++;
+			m_histogram[1][bytes[i + j + 1]]++;
+			m_histogram[2][bytes[i + j + 2]]++;
+			m_histogram[3][bytes[i + j + 3]]++;
+		}
+		for (; j < numBytes; j++) {
+			m_histogram[0][bytes[i + j]]++;
+		}
+		m_blockPos += numBytes;
+		i += numBytes;
+		if (m_blockPos < MCR_HEALTH_CHI_SQUARE_BLOCK_BYTES) {
+			break;
+		}
+
+		const double expected = (double) MCR_HEALTH_CHI_SQUARE_BLOCK_BYTES / 256;
+		double chiSquare = 0;
+		for (uint32_t v = 0; v < 256; v++) {
+			double observed = (double) m_histogram[0][v] + m_histogram[1][v] + m_histogram[2][v] + m_histogram[3][v];
+			chiSquare += (observed - expected) * (observed - expected) / expected;
+		}
+		m_stats.lastChiSquare = chiSquare;
+		m_stats.chiSquareBlocks++;
+		if (chiSquare >= m_chiSquareCutoff) {
+			sprintf(m_lastError, "Chi-square test failed: statistic %.1f exceeds %.1f for the block ending at offset %llu",
+					chiSquare, m_chiSquareCutoff, (unsigned long long) (m_stats.bytesTested + i));
+			m_stats.chiSquareFailures++;
+			result = MCR_HEALTH_CHI_SQUARE_FAILED;
+		}
+		memset(m_histogram, 0, sizeof(m_histogram));
+		m_blockPos = 0;
+	}
+	return result;
+}
+
+/**
+ * Compute the adaptive proportion test cutoff, 1 + CRITBINOM(W, 2^-H, 1 - alpha) as defined by SP 800-90B
+ *
+ * @param minEntropyBits assessed min-entropy per byte in bits
+ * @param alpha false positive probability
+ *
+ * @return cutoff value
+ */
+uint32_t MicroRngHealth::computeProportionCutoff(double minEntropyBits, double alpha) {
+	const uint32_t windowSize = MCR_HEALTH_APT_WINDOW_SIZE;
+	double p = pow(2.0, -minEntropyBits);
+	double tailProbability = 0;
+	for (uint32_t k = windowSize; k > 0; k--) {
+		double logProbability = lgamma(windowSize + 1.0) - lgamma(k + 1.0) - lgamma(windowSize - k + 1.0)
+				+ k * log(p) + (windowSize - k) * log1p(-p);
+		double probability = exp(logProbability);
+		if (tailProbability + probability > alpha) {
+			// P(X > k) <= alpha and P(X > k - 1) > alpha
+			return k + 1;
+		}
+		tailProbability += probability;
+	}
+	return 1;
+}
+
+/**
+ * Compute the chi-square cutoff for 255 degrees of freedom with the Wilson-Hilferty approximation
+ *
+ * @param alpha false positive probability
+ *
+ * @return cutoff value
+ */
+double MicroRngHealth::computeChiSquareCutoff(double alpha) {
+	// Upper standard normal quantile of alpha by bisection
+	double low = 0;
+	double high = 40;
+	for (int i = 0; i < 100; i++) {
+		double z = (low + high) / 2;
+		if (0.5 * erfc(z / sqrt(2.0)) > alpha) {
+			low = z;
+		} else {
+			high = z;
+		}
+	}
+	const double degreesOfFreedom = 255;
+	double scale = 2 / (9 * degreesOfFreedom);
+	double cube = 1 - scale + low * sqrt(scale);
+	return degreesOfFreedom * cube * cube * cube;
+}
+
+MicroRngHealth::~MicroRngHealth() {
+}
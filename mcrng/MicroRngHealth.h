@@ -0,0 +1,136 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngHealth.h
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief continuous health tests of MicroRNG random bytes, following NIST SP 800-90B section 4.4.
+ *
+ *    The repetition count test detects runs of identical bytes and the adaptive proportion test detects
+ *    a byte value occurring too often within a window of MCR_HEALTH_APT_WINDOW_SIZE bytes. The cutoffs are
+ *    computed from the assessed min-entropy per byte and the acceptable false positive probability.
+ *    An optional chi-square test checks byte frequencies of each block of MCR_HEALTH_CHI_SQUARE_BLOCK_BYTES.
+ *    The test state carries over between calls, so a stream can be tested in chunks of any size.
+ *    Byte comparisons use SSE2 or NEON instructions when the target supports them.
+ *
+ *    Usage:
+ *        MicroRngHealth health;
+ *        if (health.test(chunk, chunkSize) != MCR_HEALTH_PASSED) {
+ *            fprintf(stderr, "%s\n", health.getLastErrMsg());
+ *        }
+ */
+#ifndef MICRORNGHEALTH_H
+#define MICRORNGHEALTH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Default assessed min-entropy in bits per byte and false positive probability as a negative power of two
+ */
+#define MCR_HEALTH_DEFAULT_MIN_ENTROPY_BITS (7.0)
+#define MCR_HEALTH_DEFAULT_ALPHA_LOG2 (40)
+#define MCR_HEALTH_MIN_ALPHA_LOG2 (20)
+#define MCR_HEALTH_MAX_ALPHA_LOG2 (60)
+
+/**
+ * Adaptive proportion test window size for non-binary samples
+ */
+#define MCR_HEALTH_APT_WINDOW_SIZE (512)
+
+/**
+ * Amount of bytes counted for each chi-square test
+ */
+#define MCR_HEALTH_CHI_SQUARE_BLOCK_BYTES (65536)
+
+/**
+ * Health test results, a combination of failure flags
+ */
+enum McrHealthResult {
+	MCR_HEALTH_PASSED = 0,
+	MCR_HEALTH_RCT_FAILED = 1,		// repetition count test
+	MCR_HEALTH_APT_FAILED = 2,		// adaptive proportion test
+	MCR_HEALTH_CHI_SQUARE_FAILED = 4	// byte frequency chi-square test
+};
+
+/**
+ * Counters of tested bytes and test failures
+ */
+struct MicroRngHealthStats {
+	uint64_t bytesTested;
+	uint64_t rctFailures;
+	uint64_t aptFailures;
+	uint64_t aptWindows;
+	uint64_t chiSquareFailures;
+	uint64_t chiSquareBlocks;
+	uint32_t maxRepetitionCount;	// longest run of identical bytes seen
+	uint32_t maxProportionCount;	// highest adaptive proportion count seen
+	double lastChiSquare;		// statistic of the last completed chi-square block
+};
+
+class MicroRngHealth {
+public:
+	MicroRngHealth();
+	MicroRngHealth(MicroRngHealth const&) = delete;
+	MicroRngHealth(MicroRngHealth&&) = delete;
+	MicroRngHealth& operator=(MicroRngHealth const&) = delete;
+	MicroRngHealth& operator=(MicroRngHealth&&) = delete;
+	virtual ~MicroRngHealth();
+
+	bool configure(double minEntropyBits, uint32_t alphaLog2);
+	void setChiSquareEnabled(bool enabled);
+	uint32_t getRepetitionCutoff() const;
+	uint32_t getProportionCutoff() const;
+	double getChiSquareCutoff() const;
+	uint32_t test(const uint8_t *bytes, uint32_t len);
+	void reset();
+	void getStats(MicroRngHealthStats *stats) const;
+	const char* getLastErrMsg() const;
+
+private:
+	uint32_t testRepetitionCount(const uint8_t *bytes, uint32_t len);
+	uint32_t testAdaptiveProportion(const uint8_t *bytes, uint32_t len);
+	uint32_t testChiSquare(const uint8_t *bytes, uint32_t len);
+	static uint32_t computeProportionCutoff(double minEntropyBits, double alpha);
+	static double computeChiSquareCutoff(double alpha);
+
+	uint32_t m_repetitionCutoff;
+	uint32_t m_proportionCutoff;
+	double m_chiSquareCutoff;
+	bool m_isChiSquareEnabled;
+	bool m_hasPreviousByte;
+	uint8_t m_previousByte;
+	uint32_t m_repetitionCount;
+	uint8_t m_proportionValue;
+	uint32_t m_proportionCount;
+	uint32_t m_windowPos;
+	uint32_t m_blockPos;
+	uint32_t m_histogram[4][256];
+	MicroRngHealthStats m_stats;
+	char m_lastError[512];
+};
+
+#endif // MICRORNGHEALTH_H
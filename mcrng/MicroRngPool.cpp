@@ -0,0 +1,462 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngPool.cpp
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief aggregates random bytes from several MicroRNG devices, each retrieved by its own thread.
+ *
+ */
+#include "MicroRngPool.h"
+#include <new>
+
+MicroRngPool::MicroRngPool() {
+	for (uint32_t i = 0; i < MCR_POOL_MAX_DEVICES; i++) {
+		m_workers[i] = nullptr;
+	}
+	m_numWorkers = 0;
+	m_pendingJobs = 0;
+	m_combineMode = MCR_POOL_INTERLEAVE;
+	m_stopRequested = false;
+	strcpy(m_lastError, "No devices");
+	pthread_mutex_init(&m_mutex, nullptr);
+	pthread_cond_init(&m_jobCond, nullptr);
+	pthread_cond_init(&m_doneCond, nullptr);
+}
+
+/**
+ * Connect to a MicroRNG device and start its retrieval thread.
+ * The device is added with the default clock frequency, use getDevice() to configure it.
+ *
+ * @param devicePath complete path to the SPI device
+ *
+ * @return true if the device is connected and added to the pool
+ */
+bool MicroRngPool::addDevice(const char *devicePath) {
+	if (m_numWorkers >= MCR_POOL_MAX_DEVICES) {
+		sprintf(m_lastError, "Cannot add more than %d devices", MCR_POOL_MAX_DEVICES);
+		return false;
+	}
+	Worker *worker = (Worker*) calloc(1, sizeof(Worker));
+	if (worker == nullptr) {
+		sprintf(m_lastError, "Could not allocate memory for device %s", devicePath);
+		return false;
+	}
+	worker->pool = this;
+	worker->device = new (std::nothrow) MicroRngSPI();
+	if (worker->device == nullptr) {
+		free(worker);
+		sprintf(m_lastError, "Could not allocate memory for device %s", devicePath);
+		return false;
+	}
+	if (!worker->device->connect(devicePath)) {
+		sprintf(m_lastError, "%s", worker->device->getLastErrMsg());
+		delete worker->device;
+		free(worker);
+		return false;
+	}
+	worker->stats.isHealthy = true;
+	if (pthread_create(&worker->thread, nullptr, runWorker, worker) != 0) {
+		sprintf(m_lastError, "Could not start retrieval thread for device %s", devicePath);
+		delete worker->device;
+		free(worker);
+		return false;
+	}
+	m_workers[m_numWorkers++] = worker;
+	return true;
+}
+
+/**
+ * @return number of devices in the pool
+ */
+uint32_t MicroRngPool::getNumDevices() const {
+	return m_numWorkers;
+}
+
+/**
+ * Access a pool device for configuring it. Don't retrieve bytes from it directly while
+ * a pool retrieval is in progress.
+ *
+ * @param idx device index, in the order the devices were added
+ *
+ * @return pointer to the device or nullptr if the index is out of range
+ */
+MicroRngSPI* MicroRngPool::getDevice(uint32_t idx) const {
+	if (idx >= m_numWorkers) {
+		return nullptr;
+	}
+	return m_workers[idx]->device;
+}
+
+/**
+ * Set the way random bytes from the pool devices are combined
+ *
+ * @param combineMode MCR_POOL_INTERLEAVE for the highest throughput, MCR_POOL_XOR for combining all devices into each byte
+ */
+void MicroRngPool::setCombineMode(McrPoolCombineMode combineMode) {
+	m_combineMode = combineMode;
+}
+
+/**
+ * @return current combine mode
+ */
+McrPoolCombineMode MicroRngPool::getCombineMode() const {
+	return m_combineMode;
+}
+
+/**
+ * Retrieve random bytes from the pool devices
+ *
+ * @param len how many random bytes to retrieve
+ * @param rx pointer to receiving random bytes
+ *
+ * @return true if successful
+ */
+bool MicroRngPool::retrieveRandomBytes(int len, uint8_t *rx) {
+	return retrieve(false, len, rx, m_numWorkers + 1);
+}
+
+/**
+ * Retrieve RAW (unprocessed) random bytes from the pool devices
+ *
+ * @param len how many raw random bytes to retrieve
+ * @param rx pointer to receiving raw random bytes
+ *
+ * @return true if successful
+ */
+bool MicroRngPool::retrieveRawRandomBytes(int len, uint8_t *rx) {
+	return retrieve(true, len, rx, m_numWorkers + 1);
+}
+
+/**
+ * Validate the communication with each unhealthy device and put it back in use when successful
+ *
+ * @return number of healthy devices
+ */
+uint32_t MicroRngPool::revalidateDevices() {
+	uint32_t numHealthy = 0;
+	for (uint32_t i = 0; i < m_numWorkers; i++) {
+		Worker *worker = m_workers[i];
+		if (!worker->stats.isHealthy && worker->device->validateCommunication()) {
+			pthread_mutex_lock(&m_mutex);
+			worker->stats.isHealthy = true;
+			pthread_mutex_unlock(&m_mutex);
+		}
+		if (worker->stats.isHealthy) {
+			numHealthy++;
+		}
+	}
+	return numHealthy;
+}
+
+/**
+ * Retrieve health and throughput counters of a pool device
+ *
+ * @param idx device index, in the order the devices were added
+ * @param stats pointer to receiving counters
+ *
+ * @return false if the index is out of range
+ */
+bool MicroRngPool::getDeviceStats(uint32_t idx, MicroRngPoolDeviceStats *stats) {
+	if (idx >= m_numWorkers) {
+		return false;
+	}
+	pthread_mutex_lock(&m_mutex);
+	*stats = m_workers[idx]->stats;
+	pthread_mutex_unlock(&m_mutex);
+	return true;
+}
+
+/**
+ * Reset throughput counters of all pool devices, health status is kept
+ */
+void MicroRngPool::resetStats() {
+	pthread_mutex_lock(&m_mutex);
+	for (uint32_t i = 0; i < m_numWorkers; i++) {
+		bool isHealthy = m_workers[i]->stats.isHealthy;
+		memset(&m_workers[i]->stats, 0, sizeof(MicroRngPoolDeviceStats));
+		m_workers[i]->stats.isHealthy = isHealthy;
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/**
+ * Retrieve the last error message.
+ *
+ * @return last error message
+ */
+const char* MicroRngPool::getLastErrMsg() const {
+	return m_lastError;
+}
+
+/**
+ * Retrieval thread of a pool device, runs jobs posted by dispatchJobs()
+ *
+ * @param arg pointer to the device worker
+ */
+void* MicroRngPool::runWorker(void *arg) {
+	Worker *worker = (Worker*) arg;
+	MicroRngPool *pool = worker->pool;
+	pthread_mutex_lock(&pool->m_mutex);
+	while (true) {
+		while (!worker->hasJob && !pool->m_stopRequested) {
+			pthread_cond_wait(&pool->m_jobCond, &pool->m_mutex);
+		}
+		if (pool->m_stopRequested) {
+			break;
+		}
+		pthread_mutex_unlock(&pool->m_mutex);
+		pool->processJob(worker);
+		pthread_mutex_lock(&pool->m_mutex);
+		worker->hasJob = false;
+		if (--pool->m_pendingJobs == 0) {
+			pthread_cond_signal(&pool->m_doneCond);
+		}
+	}
+	pthread_mutex_unlock(&pool->m_mutex);
+	return nullptr;
+}
+
+/**
+ * Retrieve the bytes of the job assigned to a device and update its counters
+ *
+ * @param worker pointer to the device worker
+ */
+void MicroRngPool::processJob(Worker *worker) {
+	struct timespec start;
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	bool isSuccess;
+	if (worker->isRawJob) {
+		isSuccess = worker->device->retrieveRawRandomBytes((int) worker->jobBytes, worker->jobBuffer);
+	} else {
+		isSuccess = worker->device->retrieveRandomBytes((int) worker->jobBytes, worker->jobBuffer);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	pthread_mutex_lock(&m_mutex);
+	worker->jobSucceeded = isSuccess;
+	worker->stats.busyNanos += (uint64_t) (end.tv_sec - start.tv_sec) * 1000000000ULL
+			+ end.tv_nsec - start.tv_nsec;
+	if (isSuccess) {
+		worker->stats.bytesRetrieved += worker->jobBytes;
+		worker->stats.retrievals++;
+	} else {
+		worker->stats.failures++;
+		worker->stats.isHealthy = false;
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/**
+ * Make sure the scratch buffer of a device can hold the requested amount of bytes
+ *
+ * @param worker pointer to the device worker
+ * @param numBytes required scratch buffer size
+ *
+ * @return true if successful
+ */
+bool MicroRngPool::ensureScratch(Worker *worker, uint32_t numBytes) {
+	if (worker->scratchSize >= numBytes) {
+		return true;
+	}
+	uint8_t *scratch = (uint8_t*) realloc(worker->scratch, numBytes);
+	if (scratch == nullptr) {
+		sprintf(m_lastError, "Could not allocate %u bytes of scratch memory", numBytes);
+		return false;
+	}
+	worker->scratch = scratch;
+	worker->scratchSize = numBytes;
+	return true;
+}
+
+/**
+ * Retrieve bytes from a single device in the calling thread
+ *
+ * @param worker pointer to the device worker
+ * @param isRaw true for raw random bytes
+ * @param rx pointer to receiving bytes
+ * @param numBytes how many bytes to retrieve
+ *
+ * @return true if successful
+ */
+bool MicroRngPool::retrieveDirect(Worker *worker, bool isRaw, uint8_t *rx, uint32_t numBytes) {
+	worker->isRawJob = isRaw;
+	worker->jobBuffer = rx;
+	worker->jobBytes = numBytes;
+	processJob(worker);
+	if (!worker->jobSucceeded) {
+		sprintf(m_lastError, "%s", worker->device->getLastErrMsg());
+	}
+	return worker->jobSucceeded;
+}
+
+/**
+ * Hand the assigned jobs over to the device threads and wait until all of them completed
+ */
+void MicroRngPool::dispatchJobs() {
+	pthread_mutex_lock(&m_mutex);
+	m_pendingJobs = 0;
+	for (uint32_t i = 0; i < m_numWorkers; i++) {
+		if (m_workers[i]->hasJob) {
+			m_pendingJobs++;
+		}
+	}
+	pthread_cond_broadcast(&m_jobCond);
+	while (m_pendingJobs > 0) {
+		pthread_cond_wait(&m_doneCond, &m_mutex);
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/**
+ * Split a request among the healthy devices, retrieve all parts in parallel and combine them
+ *
+ * @param isRaw true for raw random bytes
+ * @param len how many bytes to retrieve
+ * @param rx pointer to receiving bytes
+ * @param attemptsLeft how many more times the request may be retried after device failures
+ *
+ * @return true if successful
+ */
+bool MicroRngPool::retrieve(bool isRaw, int len, uint8_t *rx, uint32_t attemptsLeft) {
+	if (len <= 0) {
+		sprintf(m_lastError, "Invalid amount of random bytes requested");
+		return false;
+	}
+	if (attemptsLeft == 0) {
+		return false;
+	}
+
+	Worker *healthy[MCR_POOL_MAX_DEVICES];
+	uint32_t numHealthy = 0;
+	for (uint32_t i = 0; i < m_numWorkers; i++) {
+		if (m_workers[i]->stats.isHealthy) {
+			healthy[numHealthy++] = m_workers[i];
+		}
+	}
+	if (numHealthy == 0 && revalidateDevices() > 0) {
+		return retrieve(isRaw, len, rx, attemptsLeft - 1);
+	}
+	if (numHealthy == 0) {
+		sprintf(m_lastError, "No healthy MicroRNG device available");
+		return false;
+	}
+	if (numHealthy == 1) {
+		// Nothing to run in parallel
+		return retrieveDirect(healthy[0], isRaw, rx, (uint32_t) len)
+				|| retrieve(isRaw, len, rx, attemptsLeft - 1);
+	}
+
+	uint32_t numBytes = (uint32_t) len;
+	if (m_combineMode == MCR_POOL_INTERLEAVE) {
+		uint32_t stripeBytes = numBytes / numHealthy;
+		uint32_t offset = 0;
+		for (uint32_t i = 0; i < numHealthy; i++) {
+			uint32_t jobBytes = stripeBytes + (i < numBytes % numHealthy ? 1 : 0);
+			healthy[i]->isRawJob = isRaw;
+			healthy[i]->jobBuffer = rx + offset;
+			healthy[i]->jobBytes = jobBytes;
+			healthy[i]->hasJob = jobBytes > 0;
+			offset += jobBytes;
+		}
+		dispatchJobs();
+
+		// Retrieve stripes of the failed devices again from the remaining ones
+		for (uint32_t i = 0; i < numHealthy; i++) {
+			if (healthy[i]->jobBytes > 0 && !healthy[i]->jobSucceeded
+					&& !retrieve(isRaw, (int) healthy[i]->jobBytes, healthy[i]->jobBuffer, attemptsLeft - 1)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	for (uint32_t i = 0; i < numHealthy; i++) {
+		if (!ensureScratch(healthy[i], numBytes)) {
+			return false;
+		}
+		healthy[i]->isRawJob = isRaw;
+		healthy[i]->jobBuffer = healthy[i]->scratch;
+		healthy[i]->jobBytes = numBytes;
+		healthy[i]->hasJob = true;
+	}
+	dispatchJobs();
+
+	// Combine the devices that succeeded, the result stays random as long as one of them did
+	bool isCombined = false;
+	for (uint32_t i = 0; i < numHealthy; i++) {
+		if (!healthy[i]->jobSucceeded) {
+			continue;
+		}
+		if (!isCombined) {
+			memcpy(rx, healthy[i]->scratch, numBytes);
+			isCombined = true;
+			continue;
+		}
+		uint64_t *dst64 = (uint64_t*) rx;
+		const uint64_t *src64 = (const uint64_t*) healthy[i]->scratch;
+		uint32_t numWords = numBytes / sizeof(uint64_t);
+		uint32_t j = 0;
+		if (((uintptr_t) rx & (sizeof(uint64_t) - 1)) == 0) {
+			for (; j < numWords; j++) {
+				dst64[j] ^= src64[j];
+			}
+			j *= sizeof(uint64_t);
+		}
+		for (; j < numBytes; j++) {
+			rx[j] ^= healthy[i]->scratch[j];
+		}
+	}
+	return isCombined || retrieve(isRaw, len, rx, attemptsLeft - 1);
+}
+
+/**
+ * Stop and join all device threads
+ */
+void MicroRngPool::stopWorkers() {
+	pthread_mutex_lock(&m_mutex);
+	m_stopRequested = true;
+	pthread_cond_broadcast(&m_jobCond);
+	pthread_mutex_unlock(&m_mutex);
+	for (uint32_t i = 0; i < m_numWorkers; i++) {
+		pthread_join(m_workers[i]->thread, nullptr);
+	}
+}
+
+MicroRngPool::~MicroRngPool() {
+	stopWorkers();
+	for (uint32_t i = 0; i < m_numWorkers; i++) {
+		delete m_workers[i]->device;
+		free(m_workers[i]->scratch);
+		free(m_workers[i]);
+		m_workers[i] = nullptr;
+	}
+	m_numWorkers = 0;
+	pthread_cond_destroy(&m_doneCond);
+	pthread_cond_destroy(&m_jobCond);
+	pthread_mutex_destroy(&m_mutex);
+}
@@ -0,0 +1,128 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngPool.h
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief aggregates random bytes from several MicroRNG devices, each retrieved by its own thread.
+ *
+ *    Devices on separate SPI controllers transfer in parallel. In interleave mode each request is split
+ *    into one stripe per healthy device, in XOR mode every healthy device fills the whole request and
+ *    the results are combined with XOR. A device that fails a retrieval is marked unhealthy and skipped,
+ *    its share of the current request is retrieved again from another healthy device.
+ *
+ *    Usage:
+ *        MicroRngPool pool;
+ *        pool.addDevice("/dev/spidev0.0");
+ *        pool.addDevice("/dev/spidev1.0");
+ *        uint8_t buff[32000];
+ *        bool success = pool.retrieveRandomBytes(sizeof(buff), buff);
+ */
+#ifndef MICRORNGPOOL_H
+#define MICRORNGPOOL_H
+
+#include "MicroRngSPI.h"
+#include <pthread.h>
+
+/**
+ * Max number of MicroRNG devices in a pool
+ */
+#define MCR_POOL_MAX_DEVICES (8)
+
+/**
+ * Ways of combining random bytes retrieved from the pool devices
+ */
+enum McrPoolCombineMode {
+	MCR_POOL_INTERLEAVE,	// each device retrieves a stripe of the request
+	MCR_POOL_XOR		// each device retrieves the whole request, results are XOR-ed
+};
+
+/**
+ * Health and throughput counters of a pool device
+ */
+struct MicroRngPoolDeviceStats {
+	uint64_t bytesRetrieved;	// random bytes retrieved successfully
+	uint64_t retrievals;		// successful retrievals
+	uint64_t failures;		// failed retrievals
+	uint64_t busyNanos;		// time spent retrieving, in nanoseconds
+	bool isHealthy;		// false once a retrieval failed, until re-validated
+};
+
+class MicroRngPool {
+public:
+	MicroRngPool();
+	MicroRngPool(MicroRngPool const&) = delete;
+	MicroRngPool(MicroRngPool&&) = delete;
+	MicroRngPool& operator=(MicroRngPool const&) = delete;
+	MicroRngPool& operator=(MicroRngPool&&) = delete;
+	virtual ~MicroRngPool();
+
+	bool addDevice(const char *devicePath);
+	uint32_t getNumDevices() const;
+	MicroRngSPI* getDevice(uint32_t idx) const;
+	void setCombineMode(McrPoolCombineMode combineMode);
+	McrPoolCombineMode getCombineMode() const;
+	bool retrieveRandomBytes(int len, uint8_t *rx);
+	bool retrieveRawRandomBytes(int len, uint8_t *rx);
+	uint32_t revalidateDevices();
+	bool getDeviceStats(uint32_t idx, MicroRngPoolDeviceStats *stats);
+	void resetStats();
+	const char* getLastErrMsg() const;
+
+private:
+	struct Worker {
+		MicroRngPool *pool;
+		MicroRngSPI *device;
+		pthread_t thread;
+		uint8_t *scratch;
+		uint32_t scratchSize;
+		uint8_t *jobBuffer;
+		uint32_t jobBytes;
+		bool isRawJob;
+		bool hasJob;
+		bool jobSucceeded;
+		MicroRngPoolDeviceStats stats;
+	};
+
+	static void* runWorker(void *arg);
+	void processJob(Worker *worker);
+	bool ensureScratch(Worker *worker, uint32_t numBytes);
+	bool retrieve(bool isRaw, int len, uint8_t *rx, uint32_t attemptsLeft);
+	bool retrieveDirect(Worker *worker, bool isRaw, uint8_t *rx, uint32_t numBytes);
+	void dispatchJobs();
+	void stopWorkers();
+
+	Worker *m_workers[MCR_POOL_MAX_DEVICES];
+	uint32_t m_numWorkers;
+	uint32_t m_pendingJobs;
+	McrPoolCombineMode m_combineMode;
+	bool m_stopRequested;
+	char m_lastError[512];
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_jobCond;
+	pthread_cond_t m_doneCond;
+};
+
+#endif // MICRORNGPOOL_H
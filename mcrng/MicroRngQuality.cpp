@@ -0,0 +1,576 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngQuality.cpp
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief streaming statistical quality tests of MicroRNG random bytes, run on a pool of worker threads.
+ *
+ */
+#include "MicroRngQuality.h"
+
+MicroRngQuality::MicroRngQuality() {
+	m_numThreads = 0;
+	m_blockBytes = 0;
+	m_numBuffers = 0;
+	m_bufferMemory = nullptr;
+	m_freeBuffers = nullptr;
+	m_numFree = 0;
+	m_filledBuffers = nullptr;
+	m_filledHead = 0;
+	m_numFilled = 0;
+	m_fillBuffer = -1;
+	m_isStopping = false;
+	m_isStarted = false;
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_lastError[0] = '\0';
+	pthread_mutex_init(&m_mutex, nullptr);
+	pthread_cond_init(&m_filledCond, nullptr);
+	pthread_cond_init(&m_freeCond, nullptr);
+}
+
+/**
+ * Allocate the block buffers, reset the results and start the worker threads
+ *
+ * @param uint32_t numThreads - number of worker threads, up to MCR_QUALITY_MAX_THREADS
+ * @param uint32_t blockBytes - bytes tested as one block, a multiple of 8
+ * @return true when the worker threads are running
+ */
+bool MicroRngQuality::start(uint32_t numThreads, uint32_t blockBytes) {
+	stop();
+	if (numThreads == 0 || numThreads > MCR_QUALITY_MAX_THREADS) {
+		snprintf(m_lastError, sizeof(m_lastError), "Number of quality test threads must be between 1 and %d",
+				MCR_QUALITY_MAX_THREADS);
+		return false;
+	}
+	if (blockBytes < MCR_QUALITY_MIN_BLOCK_BYTES || blockBytes > MCR_QUALITY_MAX_BLOCK_BYTES || blockBytes % 8 != 0) {
+		snprintf(m_lastError, sizeof(m_lastError), "Quality test block size must be a multiple of 8 between %d and %d",
+				MCR_QUALITY_MIN_BLOCK_BYTES, MCR_QUALITY_MAX_BLOCK_BYTES);
+		return false;
+	}
+
+	// Keep every worker busy while the next block is being filled
+	m_numBuffers = numThreads + 2;
+	m_bufferMemory = (uint8_t*) malloc((size_t) m_numBuffers * blockBytes);
+	m_freeBuffers = (uint32_t*) malloc(m_numBuffers * sizeof(uint32_t));
+	m_filledBuffers = (uint32_t*) malloc(m_numBuffers * sizeof(uint32_t));
+	if (m_bufferMemory == nullptr || m_freeBuffers == nullptr || m_filledBuffers == nullptr) {
+		snprintf(m_lastError, sizeof(m_lastError), "Cannot allocate %u quality test blocks of %u bytes",
+				m_numBuffers, blockBytes);
+		release();
+		return false;
+	}
+	for (uint32_t i = 0; i < m_numBuffers; i++) {
+		m_freeBuffers[i] = i;
+	}
+	m_numFree = m_numBuffers;
+	m_filledHead = 0;
+	m_numFilled = 0;
+	m_fillBuffer = -1;
+	m_blockBytes = blockBytes;
+	m_isStopping = false;
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_stats.minBlockMinEntropy = 8.0;
+	for (uint32_t t = 0; t < MCR_QUALITY_NUM_TESTS; t++) {
+		m_stats.tests[t].minPValue = 1.0;
+	}
+
+	for (m_numThreads = 0; m_numThreads < numThreads; m_numThreads++) {
+		if (pthread_create(&m_threads[m_numThreads], nullptr, runWorker, this) != 0) {
+			snprintf(m_lastError, sizeof(m_lastError), "Cannot start quality test thread");
+			m_isStarted = true;
+			stop();
+			return false;
+		}
+	}
+	m_isStarted = true;
+	return true;
+}
+
+/**
+ * Retrieve a free block buffer to fill, waiting while all buffers are queued or being tested.
+ * The same buffer is returned until it is committed.
+ *
+ * @return pointer to the block buffer, nullptr when not started
+ */
+uint8_t* MicroRngQuality::beginBlock() {
+	pthread_mutex_lock(&m_mutex);
+	if (!m_isStarted) {
+		pthread_mutex_unlock(&m_mutex);
+		return nullptr;
+	}
+	if (m_fillBuffer == -1) {
+		while (m_numFree == 0) {
+			pthread_cond_wait(&m_freeCond, &m_mutex);
+		}
+		m_fillBuffer = (int) m_freeBuffers[--m_numFree];
+	}
+	uint8_t *block = m_bufferMemory + (size_t) m_fillBuffer * m_blockBytes;
+	pthread_mutex_unlock(&m_mutex);
+	return block;
+}
+
+/**
+ * Queue the block buffer returned by beginBlock() for testing
+ */
+void MicroRngQuality::commitBlock() {
+	pthread_mutex_lock(&m_mutex);
+	if (m_fillBuffer != -1) {
+		m_filledBuffers[(m_filledHead + m_numFilled) % m_numBuffers] = (uint32_t) m_fillBuffer;
+		m_numFilled++;
+		m_fillBuffer = -1;
+		pthread_cond_signal(&m_filledCond);
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/**
+ * Wait until all committed blocks are tested and stop the worker threads.
+ * A block that was not committed is not tested. The results stay available.
+ */
+void MicroRngQuality::stop() {
+	pthread_mutex_lock(&m_mutex);
+	if (!m_isStarted) {
+		pthread_mutex_unlock(&m_mutex);
+		return;
+	}
+	m_isStopping = true;
+	pthread_cond_broadcast(&m_filledCond);
+	pthread_mutex_unlock(&m_mutex);
+	for (uint32_t i = 0; i < m_numThreads; i++) {
+		pthread_join(m_threads[i], nullptr);
+	}
+	m_numThreads = 0;
+	m_isStarted = false;
+	release();
+}
+
+/**
+ * @return uint32_t - bytes tested as one block
+ */
+uint32_t MicroRngQuality::getBlockBytes() const {
+	return m_blockBytes;
+}
+
+/**
+ * Retrieve a snapshot of the merged results, can be called while blocks are being tested
+ *
+ * @param MicroRngQualityStats* stats - pointer to receiving the results
+ */
+void MicroRngQuality::getStats(MicroRngQualityStats *stats) {
+	pthread_mutex_lock(&m_mutex);
+	*stats = m_stats;
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/**
+ * Worker thread entry point
+ */
+void* MicroRngQuality::runWorker(void *arg) {
+	((MicroRngQuality*) arg)->processBlocks();
+	return nullptr;
+}
+
+/**
+ * Test queued blocks until stopped and no queued blocks are left
+ */
+void MicroRngQuality::processBlocks() {
+	uint64_t *words = (uint64_t*) malloc(m_blockBytes);
+	BlockResult result;
+	pthread_mutex_lock(&m_mutex);
+	while (true) {
+		while (m_numFilled == 0 && !m_isStopping) {
+			pthread_cond_wait(&m_filledCond, &m_mutex);
+		}
+		if (m_numFilled == 0 || words == nullptr) {
+			break;
+		}
+		uint32_t idx = m_filledBuffers[m_filledHead];
+		m_filledHead = (m_filledHead + 1) % m_numBuffers;
+		m_numFilled--;
+		pthread_mutex_unlock(&m_mutex);
+
+		testBlock(m_bufferMemory + (size_t) idx * m_blockBytes, m_blockBytes, words, &result);
+
+		pthread_mutex_lock(&m_mutex);
+		mergeResult(&result);
+		m_freeBuffers[m_numFree++] = idx;
+		pthread_cond_signal(&m_freeCond);
+	}
+	pthread_mutex_unlock(&m_mutex);
+	free(words);
+}
+
+/**
+ * Add the results of a tested block to the running totals, called with the mutex held
+ *
+ * @param const BlockResult* result - results of the block
+ */
+void MicroRngQuality::mergeResult(const BlockResult *result) {
+	m_stats.bytesTested += m_blockBytes;
+	m_stats.blocksTested++;
+	m_stats.ones += result->ones;
+	for (int i = 0; i < 256; i++) {
+		m_stats.byteCounts[i] += result->byteCounts[i];
+	}
+	if (result->minEntropy < m_stats.minBlockMinEntropy) {
+		m_stats.minBlockMinEntropy = result->minEntropy;
+	}
+	for (uint32_t t = 0; t < MCR_QUALITY_NUM_TESTS; t++) {
+		MicroRngQualityTestStats *test = &m_stats.tests[t];
+		double pValue = result->pValues[t];
+		test->blocks++;
+		if (pValue >= MCR_QUALITY_ALPHA) {
+			test->passed++;
+		}
+		int bin = (int) (pValue * MCR_QUALITY_PVALUE_BINS);
+		test->pValueBins[bin < 0 ? 0 : (bin >= MCR_QUALITY_PVALUE_BINS ? MCR_QUALITY_PVALUE_BINS - 1 : bin)]++;
+		if (pValue < test->minPValue) {
+			test->minPValue = pValue;
+		}
+	}
+}
+
+/**
+ * Free the block buffers
+ */
+void MicroRngQuality::release() {
+	free(m_bufferMemory);
+	m_bufferMemory = nullptr;
+	free(m_freeBuffers);
+	m_freeBuffers = nullptr;
+	free(m_filledBuffers);
+	m_filledBuffers = nullptr;
+	m_numBuffers = 0;
+	m_numFree = 0;
+	m_numFilled = 0;
+	m_fillBuffer = -1;
+}
+
+/**
+ * Run all tests on one block
+ *
+ * @param const uint8_t* block - bytes of the block
+ * @param uint32_t len - number of bytes, a multiple of 8
+ * @param uint64_t* words - scratch space of len bytes
+ * @param BlockResult* result - pointer to receiving the results
+ */
+void MicroRngQuality::testBlock(const uint8_t *block, uint32_t len, uint64_t *words, BlockResult *result) {
+	uint32_t numWords = len / 8;
+	double numBits = (double) len * 8;
+
+	// The bit sequence is taken most significant bit first, big-endian words keep that order
+	uint64_t ones = 0;
+	for (uint32_t i = 0; i < numWords; i++) {
+		uint64_t word;
+		memcpy(&word, block + (size_t) i * 8, sizeof(word));
+		words[i] = __builtin_bswap64(word);
+		ones += (uint64_t) __builtin_popcountll(words[i]);
+	}
+	result->ones = ones;
+	result->pValues[MCR_QUALITY_FREQUENCY] = erfc(fabs(2.0 * (double) ones - numBits) / sqrt(numBits) / sqrt(2.0));
+
+	memset(result->byteCounts, 0, sizeof(result->byteCounts));
+	for (uint32_t i = 0; i < len; i++) {
+		result->byteCounts[block[i]]++;
+	}
+	computeChiSquare(result->byteCounts, len, &result->pValues[MCR_QUALITY_CHI_SQUARE]);
+	result->minEntropy = computeMinEntropy(result->byteCounts, len);
+
+	testRuns(words, numWords, ones, result);
+	testSerial(block, len, result);
+	testAutocorrelation(words, numWords, result);
+}
+
+/**
+ * Runs test, NIST SP 800-22 section 2.3
+ */
+void MicroRngQuality::testRuns(const uint64_t *words, uint32_t numWords, uint64_t ones, BlockResult *result) {
+	double numBits = (double) numWords * 64;
+	double proportion = (double) ones / numBits;
+	// The test is not applicable when the frequency test fails by far
+	if (fabs(proportion - 0.5) >= 2.0 / sqrt(numBits)) {
+		result->pValues[MCR_QUALITY_RUNS] = 0.0;
+		return;
+	}
+	uint64_t transitions = 0;
+	for (uint32_t i = 0; i < numWords; i++) {
+		uint64_t next = i + 1 < numWords ? words[i + 1] : 0;
+		uint64_t changes = words[i] ^ ((words[i] << 1) | (next >> 63));
+		if (i + 1 == numWords) {
+			// The last bit has no successor
+			changes &= ~(uint64_t) 1;
+		}
+		transitions += (uint64_t) __builtin_popcountll(changes);
+	}
+	double runs = (double) transitions + 1;
+	double expected = 2.0 * numBits * proportion * (1.0 - proportion);
+	result->pValues[MCR_QUALITY_RUNS] = erfc(fabs(runs - expected)
+			/ (2.0 * sqrt(2.0 * numBits) * proportion * (1.0 - proportion)));
+}
+
+/**
+ * Serial test with overlapping patterns of MCR_QUALITY_SERIAL_BITS bits, NIST SP 800-22 section 2.11.
+ * Patterns wrap around the end of the block, so the counts of shorter patterns follow from the longer ones.
+ */
+void MicroRngQuality::testSerial(const uint8_t *block, uint32_t len, BlockResult *result) {
+	const uint32_t numPatterns = 1 << MCR_QUALITY_SERIAL_BITS;
+	uint64_t counts[1 << MCR_QUALITY_SERIAL_BITS] = { };
+	for (uint32_t i = 0; i < len; i++) {
+		uint32_t window = ((uint32_t) block[i] << 8) | block[i + 1 < len ? i + 1 : 0];
+		for (int shift = 8; shift > 0; shift--) {
+			counts[(window >> shift) & 0xFF]++;
+		}
+	}
+
+	double numBits = (double) len * 8;
+	double psiSquared[3];
+	for (int level = 0; level < 3; level++) {
+		uint32_t levelPatterns = numPatterns >> level;
+		double sum = 0;
+		for (uint32_t p = 0; p < levelPatterns; p++) {
+			sum += (double) counts[p] * (double) counts[p];
+		}
+		psiSquared[level] = (double) levelPatterns / numBits * sum - numBits;
+		// Pattern counts one bit shorter
+		for (uint32_t p = 0; p < levelPatterns / 2; p++) {
+			counts[p] = counts[2 * p] + counts[2 * p + 1];
+		}
+	}
+	double delta = psiSquared[0] - psiSquared[1];
+	double delta2 = psiSquared[0] - 2.0 * psiSquared[1] + psiSquared[2];
+	result->pValues[MCR_QUALITY_SERIAL_1] = igamc(numPatterns / 4, delta / 2.0);
+	result->pValues[MCR_QUALITY_SERIAL_2] = igamc(numPatterns / 8, delta2 / 2.0);
+}
+
+/**
+ * Autocorrelation test, the number of bits differing from the bit lag positions later is
+ * binomially distributed for independent bits
+ */
+void MicroRngQuality::testAutocorrelation(const uint64_t *words, uint32_t numWords, BlockResult *result) {
+	uint64_t differences[MCR_QUALITY_AUTOCORRELATION_LAGS] = { };
+	for (uint32_t i = 0; i < numWords; i++) {
+		uint64_t next = i + 1 < numWords ? words[i + 1] : 0;
+		for (int lag = 1; lag <= MCR_QUALITY_AUTOCORRELATION_LAGS; lag++) {
+			uint64_t diff = words[i] ^ ((words[i] << lag) | (next >> (64 - lag)));
+			if (i + 1 == numWords) {
+				// The last lag bits have no counterpart
+				diff &= ~(((uint64_t) 1 << lag) - 1);
+			}
+			differences[lag - 1] += (uint64_t) __builtin_popcountll(diff);
+		}
+	}
+	for (int lag = 1; lag <= MCR_QUALITY_AUTOCORRELATION_LAGS; lag++) {
+		double numPairs = (double) numWords * 64 - lag;
+		double z = (2.0 * (double) differences[lag - 1] - numPairs) / sqrt(numPairs);
+		result->pValues[MCR_QUALITY_AUTOCORRELATION + lag - 1] = erfc(fabs(z) / sqrt(2.0));
+	}
+}
+
+/**
+ * Regularized upper incomplete gamma function Q(a, x), from its series below a + 1 and
+ * its continued fraction above
+ */
+double MicroRngQuality::igamc(double a, double x) {
+	if (x <= 0) {
+		return 1.0;
+	}
+	int sign;
+	double logPrefix = -x + a * log(x) - lgamma_r(a, &sign);
+	if (x < a + 1) {
+		double term = 1.0 / a;
+		double sum = term;
+		for (int n = 1; n < 10000; n++) {
+			term *= x / (a + n);
+			sum += term;
+			if (fabs(term) < fabs(sum) * 1e-15) {
+				break;
+			}
+		}
+		double q = 1.0 - sum * exp(logPrefix);
+		return q < 0 ? 0 : q;
+	}
+	const double tiny = 1e-300;
+	double b = x + 1 - a;
+	double c = 1.0 / tiny;
+	double d = 1.0 / b;
+	double h = d;
+	for (int i = 1; i < 10000; i++) {
+		double an = -i * (i - a);
+		b += 2;
+		d = an * d + b;
+		d = fabs(d) < tiny ? tiny : d;
+		c = b + an / c;
+		c = fabs(c) < tiny ? tiny : c;
+		d = 1.0 / d;
+		double delta = d * c;
+		h *= delta;
+		if (fabs(delta - 1.0) < 1e-15) {
+			break;
+		}
+	}
+	return exp(logPrefix) * h;
+}
+
+/**
+ * @param uint32_t test - test index, lower than MCR_QUALITY_NUM_TESTS
+ * @return const char* - name of the test
+ */
+const char* MicroRngQuality::getTestName(uint32_t test) {
+	static const char *names[MCR_QUALITY_NUM_TESTS] = { "frequency", "runs", "serial 1", "serial 2",
+			"chi-square", "autocorr lag 1", "autocorr lag 2", "autocorr lag 3", "autocorr lag 4",
+			"autocorr lag 5", "autocorr lag 6", "autocorr lag 7", "autocorr lag 8" };
+	return test < MCR_QUALITY_NUM_TESTS ? names[test] : "unknown";
+}
+
+/**
+ * Compute the least amount of passing blocks in the acceptable proportion range,
+ * NIST SP 800-22 section 4.2.1
+ *
+ * @param uint64_t blocks - number of blocks tested
+ * @return uint64_t - least amount of blocks that must pass
+ */
+uint64_t MicroRngQuality::computeMinPassed(uint64_t blocks) {
+	if (blocks == 0) {
+		return 0;
+	}
+	double expected = 1.0 - MCR_QUALITY_ALPHA;
+	double minProportion = expected - 3.0 * sqrt(expected * MCR_QUALITY_ALPHA / (double) blocks);
+	return minProportion <= 0 ? 0 : (uint64_t) ceil(minProportion * (double) blocks - 1e-9);
+}
+
+/**
+ * Check that the P-values of a test are uniformly distributed, NIST SP 800-22 section 4.2.2
+ *
+ * @param const MicroRngQualityTestStats* test - merged results of the test
+ * @return double - P-value of the chi-square statistic of the P-value histogram, 1 with too few blocks
+ */
+double MicroRngQuality::computeUniformity(const MicroRngQualityTestStats *test) {
+	if (test->blocks < MCR_QUALITY_UNIFORMITY_MIN_BLOCKS) {
+		return 1.0;
+	}
+	double expected = (double) test->blocks / MCR_QUALITY_PVALUE_BINS;
+	double chiSquare = 0;
+	for (int i = 0; i < MCR_QUALITY_PVALUE_BINS; i++) {
+		double diff = (double) test->pValueBins[i] - expected;
+		chiSquare += diff * diff / expected;
+	}
+	return igamc((MCR_QUALITY_PVALUE_BINS - 1) / 2.0, chiSquare / 2.0);
+}
+
+/**
+ * @param const MicroRngQualityTestStats* test - merged results of a test
+ * @return true when the proportion of passing blocks and the P-value distribution are acceptable
+ */
+bool MicroRngQuality::isTestPassed(const MicroRngQualityTestStats *test) {
+	return test->passed >= computeMinPassed(test->blocks)
+			&& computeUniformity(test) >= MCR_QUALITY_UNIFORMITY_CUTOFF;
+}
+
+/**
+ * @param const MicroRngQualityStats* stats - merged results
+ * @return true when all tests passed
+ */
+bool MicroRngQuality::isPassed(const MicroRngQualityStats *stats) {
+	for (uint32_t t = 0; t < MCR_QUALITY_NUM_TESTS; t++) {
+		if (!isTestPassed(&stats->tests[t])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @param const MicroRngQualityStats* stats - merged results
+ * @return double - Shannon entropy of the byte frequencies in bits per byte
+ */
+double MicroRngQuality::computeShannonEntropy(const MicroRngQualityStats *stats) {
+	if (stats->bytesTested == 0) {
+		return 0;
+	}
+	double entropy = 0;
+	for (int i = 0; i < 256; i++) {
+		if (stats->byteCounts[i] > 0) {
+			double probability = (double) stats->byteCounts[i] / (double) stats->bytesTested;
+			entropy -= probability * log2(probability);
+		}
+	}
+	return entropy;
+}
+
+/**
+ * Most common value min-entropy estimate, NIST SP 800-90B section 6.3.1
+ *
+ * @param const uint64_t* byteCounts - byte frequencies
+ * @param uint64_t numBytes - number of bytes counted
+ * @return double - min-entropy estimate in bits per byte
+ */
+double MicroRngQuality::computeMinEntropy(const uint64_t *byteCounts, uint64_t numBytes) {
+	if (numBytes < 2) {
+		return 0;
+	}
+	uint64_t maxCount = 0;
+	for (int i = 0; i < 256; i++) {
+		maxCount = byteCounts[i] > maxCount ? byteCounts[i] : maxCount;
+	}
+	double proportion = (double) maxCount / (double) numBytes;
+	double upperBound = proportion + 2.576 * sqrt(proportion * (1.0 - proportion) / (double) (numBytes - 1));
+	return -log2(upperBound < 1.0 ? upperBound : 1.0);
+}
+
+/**
+ * Chi-square statistic of byte frequencies with 255 degrees of freedom
+ *
+ * @param const uint64_t* byteCounts - byte frequencies
+ * @param uint64_t numBytes - number of bytes counted
+ * @param double* pValue - pointer to receiving the P-value of the statistic
+ * @return double - chi-square statistic
+ */
+double MicroRngQuality::computeChiSquare(const uint64_t *byteCounts, uint64_t numBytes, double *pValue) {
+	double expected = (double) numBytes / 256;
+	double chiSquare = 0;
+	for (int i = 0; i < 256; i++) {
+		double diff = (double) byteCounts[i] - expected;
+		chiSquare += diff * diff / expected;
+	}
+	*pValue = igamc(255 / 2.0, chiSquare / 2.0);
+	return chiSquare;
+}
+
+/**
+ * Retrieve the last error message.
+ *
+ * @return const char* - pointer to the last error message
+ */
+const char* MicroRngQuality::getLastErrMsg() const {
+	return m_lastError;
+}
+
+MicroRngQuality::~MicroRngQuality() {
+	stop();
+	pthread_cond_destroy(&m_freeCond);
+	pthread_cond_destroy(&m_filledCond);
+	pthread_mutex_destroy(&m_mutex);
+}
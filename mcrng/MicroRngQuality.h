@@ -0,0 +1,198 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngQuality.h
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief streaming statistical quality tests of MicroRNG random bytes, run on a pool of worker threads.
+ *
+ *    The stream is split into blocks of equal size, each block is tested by one of the worker threads
+ *    and its results are merged into running totals, so the bytes are never stored. Each block gets
+ *    a P-value from the NIST SP 800-22 frequency, runs and serial tests, a byte frequency chi-square test
+ *    and a bit autocorrelation test at several lags. As in NIST SP 800-22 section 4.2, a test passes
+ *    when the proportion of blocks with a P-value of at least MCR_QUALITY_ALPHA is within the expected
+ *    range and its P-values are uniformly distributed. Shannon entropy and the SP 800-90B most common
+ *    value min-entropy estimate are computed from the byte frequencies of the whole stream.
+ *
+ *    Usage:
+ *        MicroRngQuality quality;
+ *        quality.start(numThreads, MCR_QUALITY_DEFAULT_BLOCK_BYTES);
+ *        while (...) {
+ *            uint8_t *block = quality.beginBlock();
+ *            device.retrieveRandomBytes(MCR_QUALITY_DEFAULT_BLOCK_BYTES, block);
+ *            quality.commitBlock();
+ *        }
+ *        quality.stop();
+ *        quality.getStats(&stats);
+ */
+#ifndef MICRORNGQUALITY_H
+#define MICRORNGQUALITY_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+/**
+ * Default, smallest and largest amount of bytes tested as one block
+ */
+#define MCR_QUALITY_DEFAULT_BLOCK_BYTES (1048576)
+#define MCR_QUALITY_MIN_BLOCK_BYTES (8192)
+#define MCR_QUALITY_MAX_BLOCK_BYTES (67108864)
+
+/**
+ * Max amount of worker threads
+ */
+#define MCR_QUALITY_MAX_THREADS (64)
+
+/**
+ * Significance level of each block test
+ */
+#define MCR_QUALITY_ALPHA (0.01)
+
+/**
+ * Pattern length of the serial test
+ */
+#define MCR_QUALITY_SERIAL_BITS (8)
+
+/**
+ * Bit lags checked by the autocorrelation test, from 1 up to this value
+ */
+#define MCR_QUALITY_AUTOCORRELATION_LAGS (8)
+
+/**
+ * Number of P-value histogram bins and the smallest acceptable P-value of the uniformity check
+ */
+#define MCR_QUALITY_PVALUE_BINS (10)
+#define MCR_QUALITY_UNIFORMITY_CUTOFF (0.0001)
+
+/**
+ * Least amount of blocks for a meaningful P-value uniformity check
+ */
+#define MCR_QUALITY_UNIFORMITY_MIN_BLOCKS (55)
+
+/**
+ * Block tests, the autocorrelation test adds one entry for each lag
+ */
+enum McrQualityTest {
+	MCR_QUALITY_FREQUENCY = 0,		// share of one bits
+	MCR_QUALITY_RUNS,			// number of uninterrupted runs of identical bits
+	MCR_QUALITY_SERIAL_1,			// first serial test statistic, overlapping bit patterns
+	MCR_QUALITY_SERIAL_2,			// second serial test statistic
+	MCR_QUALITY_CHI_SQUARE,			// byte frequencies
+	MCR_QUALITY_AUTOCORRELATION		// bits compared with bits lag positions later
+};
+
+#define MCR_QUALITY_NUM_TESTS (MCR_QUALITY_AUTOCORRELATION + MCR_QUALITY_AUTOCORRELATION_LAGS)
+
+/**
+ * Merged results of one block test
+ */
+struct MicroRngQualityTestStats {
+	uint64_t blocks;				// blocks tested
+	uint64_t passed;				// blocks with a P-value of at least MCR_QUALITY_ALPHA
+	uint64_t pValueBins[MCR_QUALITY_PVALUE_BINS];	// P-value histogram
+	double minPValue;				// smallest P-value seen
+};
+
+/**
+ * Snapshot of the merged results of all tested blocks
+ */
+struct MicroRngQualityStats {
+	uint64_t bytesTested;
+	uint64_t blocksTested;
+	uint64_t ones;				// one bits in the whole stream
+	uint64_t byteCounts[256];		// byte frequencies of the whole stream
+	double minBlockMinEntropy;		// lowest min-entropy estimate of a single block, in bits per byte
+	MicroRngQualityTestStats tests[MCR_QUALITY_NUM_TESTS];
+};
+
+class MicroRngQuality {
+public:
+	MicroRngQuality();
+	MicroRngQuality(MicroRngQuality const&) = delete;
+	MicroRngQuality(MicroRngQuality&&) = delete;
+	MicroRngQuality& operator=(MicroRngQuality const&) = delete;
+	MicroRngQuality& operator=(MicroRngQuality&&) = delete;
+	virtual ~MicroRngQuality();
+
+	bool start(uint32_t numThreads, uint32_t blockBytes);
+	uint8_t* beginBlock();
+	void commitBlock();
+	void stop();
+	uint32_t getBlockBytes() const;
+	void getStats(MicroRngQualityStats *stats);
+	const char* getLastErrMsg() const;
+
+	static const char* getTestName(uint32_t test);
+	static uint64_t computeMinPassed(uint64_t blocks);
+	static double computeUniformity(const MicroRngQualityTestStats *test);
+	static bool isTestPassed(const MicroRngQualityTestStats *test);
+	static bool isPassed(const MicroRngQualityStats *stats);
+	static double computeShannonEntropy(const MicroRngQualityStats *stats);
+	static double computeMinEntropy(const uint64_t *byteCounts, uint64_t numBytes);
+	static double computeChiSquare(const uint64_t *byteCounts, uint64_t numBytes, double *pValue);
+
+private:
+	struct BlockResult {
+		uint64_t ones;
+		uint64_t byteCounts[256];
+		double minEntropy;
+		double pValues[MCR_QUALITY_NUM_TESTS];
+	};
+
+	static void* runWorker(void *arg);
+	void processBlocks();
+	void mergeResult(const BlockResult *result);
+	void release();
+	static void testBlock(const uint8_t *block, uint32_t len, uint64_t *words, BlockResult *result);
+	static void testRuns(const uint64_t *words, uint32_t numWords, uint64_t ones, BlockResult *result);
+	static void testSerial(const uint8_t *block, uint32_t len, BlockResult *result);
+	static void testAutocorrelation(const uint64_t *words, uint32_t numWords, BlockResult *result);
+	static double igamc(double a, double x);
+
+	uint32_t m_numThreads;
+	uint32_t m_blockBytes;
+	uint32_t m_numBuffers;
+	uint8_t *m_bufferMemory;
+	uint32_t *m_freeBuffers;
+	uint32_t m_numFree;
+	uint32_t *m_filledBuffers;
+	uint32_t m_filledHead;
+	uint32_t m_numFilled;
+	int m_fillBuffer;
+	bool m_isStopping;
+	bool m_isStarted;
+	pthread_t m_threads[MCR_QUALITY_MAX_THREADS];
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_filledCond;
+	pthread_cond_t m_freeCond;
+	MicroRngQualityStats m_stats;
+	char m_lastError[256];
+};
+
+#endif // MICRORNGQUALITY_H
@@ -33,6 +33,8 @@
 
 MicroRngSPI::MicroRngSPI() {
 	initialize();
+	m_isLatencyHistogramEnabled.store(false, std::memory_order_relaxed);
+	resetStats();
 }
 
 /**
@@ -41,12 +43,17 @@ MicroRngSPI::MicroRngSPI() {
  */
 void MicroRngSPI::initialize() {
 	m_deviceConnected = false;
+	m_clockCalibrated = false;
+	m_cachedClockHz = 0;
+	m_devicePath[0] = '\0';
+	strcpy(m_calibrationCacheDir, MCR_SPI_CALIBRATION_CACHE_DIR);
 	m_fd = -1;
 	setErrMsg("Not Connected");
 	m_spiMode = SPI_CPHA;
 	m_spiBits = 8;
 	m_minClockHz = 250000;
-	m_clockHz = m_minClockHz;
+	m_clockHz.store(m_minClockHz, std::memory_order_relaxed);
+	m_clockCeilingHz = m_minClockHz;
 	m_lastSentCommand = '\0';
 	m_testCommand = 't';
 	m_randomByteCommand = 'l';
@@ -56,6 +63,31 @@ void MicroRngSPI::initialize() {
 	m_startUpCommand = 'U';
 	m_resetUartSpeedCommand = 'R';
 	m_maxClockHz = 60000000;
+	m_detectedMaxClockHz = 0;
+	m_autodetectConfirmPasses = MCR_SPI_AUTODETECT_CONFIRM_PASSES;
+	m_autodetectMarginPercent = 0;
+	m_txBuffer = nullptr;
+	m_maxMessageBytes = MCR_SPI_MAX_TRANSFER_BYTES;
+	m_segmentBytes = MCR_SPI_MAX_TRANSFER_BYTES;
+	m_segmentCsChange = 0;
+	m_segmentDelayUsecs = 0;
+	m_adaptiveClock = false;
+	m_adaptiveCheckIntervalBytes = MCR_SPI_ADAPTIVE_CHECK_INTERVAL_BYTES;
+	m_adaptiveStableChecks = MCR_SPI_ADAPTIVE_STABLE_CHECKS;
+	m_bytesSinceCheck = 0;
+	m_passedChecks = 0;
+	m_probeBackoff = 1;
+	m_isProbing = false;
+	m_clockDownshifts.store(0, std::memory_order_relaxed);
+	m_clockUpshifts.store(0, std::memory_order_relaxed);
+	m_isFastProbe = true;
+	m_isDeferredValidation = false;
+	m_isValidationPending = false;
+	m_isDeviceValidated = false;
+	m_lastErrno = 0;
+	m_isTransferFailed = false;
+	m_maxRetries = MCR_SPI_DEFAULT_MAX_RETRIES;
+	m_retryBackoffUsecs = MCR_SPI_DEFAULT_RETRY_BACKOFF_USECS;
 }
 
 /**
@@ -82,17 +114,48 @@ bool MicroRngSPI::isConnected() const {
  * @return true if connected successfully
  */
 bool MicroRngSPI::connect(const char *devicePath) {
-	int retCode;
-
 	if (isConnected()) {
 		return false;
 	}
 
 	clearErrMsg();
 
+	if (!openDevice(devicePath)) {
+		return false;
+	}
+
+	// Size the exchange buffer to the amount of bytes one SPI message may carry
+	m_maxMessageBytes = readSpidevBufferSize();
+	m_txBuffer = (uint8_t*) malloc(m_maxMessageBytes);
+	if (m_txBuffer == nullptr) {
+		close(m_fd);
+		m_fd = -1;
+		sprintf(m_lastError, "Could not allocate SPI transfer buffer");
+		return false;
+	}
+
+	m_deviceConnected = true;
+	snprintf(m_devicePath, sizeof(m_devicePath), "%s", devicePath);
+
+	// Look up the clock frequency calibrated earlier for this device and board, checked by calibrateClockFrequency()
+	loadCalibration();
+	clearErrMsg();
+	return true;
+}
+
+/**
+ * Open the SPI device and configure its mode, word size and clock frequency
+ *
+ * @param devicePath complete path to SPI device
+ *
+ * @return true if opened and configured successfully
+ */
+bool MicroRngSPI::openDevice(const char *devicePath) {
+	int retCode;
+
 	m_fd = open(devicePath, O_RDWR);
 	if (m_fd < 0) {
-		sprintf(m_lastError, "Could not open SPI device: %s", devicePath);
+		sprintf(m_lastError, "Could not open SPI device: %.200s", devicePath);
 		return false;
 	}
 
@@ -100,6 +163,7 @@ bool MicroRngSPI::connect(const char *devicePath) {
 	retCode = ioctl(m_fd, SPI_IOC_WR_MODE, &m_spiMode);
 	if (retCode == -1) {
 		close(m_fd);
+		m_fd = -1;
 		sprintf(m_lastError, "Could not set SPI write mode");
 		return false;
 	}
@@ -107,6 +171,7 @@ bool MicroRngSPI::connect(const char *devicePath) {
 	retCode = ioctl(m_fd, SPI_IOC_RD_MODE, &m_spiMode);
 	if (retCode == -1) {
 		close(m_fd);
+		m_fd = -1;
 		sprintf(m_lastError, "Could not set SPI read mode");
 		return false;
 	}
@@ -115,6 +180,7 @@ bool MicroRngSPI::connect(const char *devicePath) {
 	retCode = ioctl(m_fd, SPI_IOC_WR_BITS_PER_WORD, &m_spiBits);
 	if (retCode == -1) {
 		close(m_fd);
+		m_fd = -1;
 		sprintf(m_lastError, "Could not set SPI transmission word bits");
 		return false;
 	}
@@ -122,29 +188,168 @@ bool MicroRngSPI::connect(const char *devicePath) {
 	retCode = ioctl(m_fd, SPI_IOC_RD_BITS_PER_WORD, &m_spiBits);
 	if (retCode == -1) {
 		close(m_fd);
+		m_fd = -1;
 		sprintf(m_lastError, "Could not set SPI word bits");
 		return false;
 	}
 
 	// Set clock frequency
-	retCode = ioctl(m_fd, SPI_IOC_WR_MAX_SPEED_HZ, &m_clockHz);
+	uint32_t clockHz = m_clockHz.load(std::memory_order_relaxed);
+	retCode = ioctl(m_fd, SPI_IOC_WR_MAX_SPEED_HZ, &clockHz);
 	if (retCode == -1) {
 		close(m_fd);
+		m_fd = -1;
 		sprintf(m_lastError, "Could not set SPI transmission clock frequency");
 		return false;
 	}
 
-	retCode = ioctl(m_fd, SPI_IOC_RD_MAX_SPEED_HZ, &m_clockHz);
+	retCode = ioctl(m_fd, SPI_IOC_RD_MAX_SPEED_HZ, &clockHz);
 	if (retCode == -1) {
 		close(m_fd);
+		m_fd = -1;
 		sprintf(m_lastError, "Could not set SPI clock frequency");
 		return false;
 	}
+	m_clockHz.store(clockHz, std::memory_order_relaxed);
+	return true;
+}
 
-	m_deviceConnected = true;
+/**
+ * Close and open the SPI device again, used when the descriptor no longer works,
+ * for instance after the spidev driver was rebound
+ *
+ * @return true if reopened successfully
+ */
+bool MicroRngSPI::reopenDevice() {
+	if (m_fd != -1) {
+		close(m_fd);
+		m_fd = -1;
+	}
+	if (!openDevice(m_devicePath)) {
+		return false;
+	}
+	m_statReopens.fetch_add(1, std::memory_order_relaxed);
+	// The device may have lost the command sent last
+	m_lastSentCommand = '\0';
 	return true;
 }
 
+/**
+ * Resynchronize the command pipeline after a failed exchange. The device may or may not have
+ * received the command bytes of the failed exchange, so the response of the next byte is unknown.
+ * A command switch is forced and a short transfer ID sequence confirms the responses line up again.
+ *
+ * @return true when the transfer IDs are consecutive
+ */
+bool MicroRngSPI::resyncDevice() {
+	uint8_t transactionIDs[MCR_SPI_RESYNC_TEST_BYTES];
+	m_lastSentCommand = '\0';
+	if (!executeBatchCommand(m_testCommand, MCR_SPI_RESYNC_TEST_BYTES, transactionIDs)) {
+		return false;
+	}
+	for (int i = 1; i < MCR_SPI_RESYNC_TEST_BYTES; i++) {
+		if (transactionIDs[i] != (uint8_t) (transactionIDs[i - 1] + 1)) {
+			setErrMsg("Could not resynchronize with MicroRNG device");
+			return false;
+		}
+	}
+	m_statResyncs.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+/**
+ * Execute a chunk retrieval, repeating it after a failed SPI message. Before each attempt it waits
+ * an exponentially growing backoff, reopens the device when the descriptor failed, and
+ * resynchronizes the command pipeline. The chunk is retrieved again from its first byte.
+ * Other errors, such as a failed deferred device validation or the adaptive clock giving up
+ * at its lowest frequency, are returned right away.
+ *
+ * @param cmd command to execute
+ * @param len how many bytes to retrieve
+ * @param rx pointer to receiving bytes
+ *
+ * @return true if successful, possibly after retries
+ */
+bool MicroRngSPI::executeRecoverableCommand(char cmd, int len, uint8_t *rx) {
+	m_isTransferFailed = false;
+	if (executeAdaptiveCommand(cmd, len, rx)) {
+		return true;
+	}
+	if (!m_isTransferFailed) {
+		return false;
+	}
+	uint32_t backoffUsecs = m_retryBackoffUsecs;
+	for (uint32_t attempt = 0; attempt < m_maxRetries; attempt++) {
+		m_statRetries.fetch_add(1, std::memory_order_relaxed);
+		usleep(backoffUsecs);
+		backoffUsecs = backoffUsecs > MCR_SPI_MAX_RETRY_BACKOFF_USECS / 2 ? MCR_SPI_MAX_RETRY_BACKOFF_USECS : backoffUsecs * 2;
+
+		// Only the errno of the failure that led to this attempt counts
+		int failedErrno = m_lastErrno;
+		m_lastErrno = 0;
+		bool isDeviceLost = m_fd == -1 || failedErrno == EBADF || failedErrno == ENODEV || failedErrno == ENXIO
+				|| failedErrno == EIO || failedErrno == ESHUTDOWN;
+		if (isDeviceLost && !reopenDevice()) {
+			continue;
+		}
+		if (!resyncDevice()) {
+			// Try a fresh descriptor once when the open one doesn't resynchronize
+			if (isDeviceLost || !reopenDevice() || !resyncDevice()) {
+				continue;
+			}
+		}
+		m_isTransferFailed = false;
+		if (executeAdaptiveCommand(cmd, len, rx)) {
+			return true;
+		}
+		if (!m_isTransferFailed) {
+			return false;
+		}
+	}
+	m_statUnrecoveredErrors.fetch_add(1, std::memory_order_relaxed);
+	if (m_maxRetries > 0) {
+		char error[256];
+		snprintf(error, sizeof(error), "%.200s, retried %u times", m_lastError, m_maxRetries);
+		setErrMsg(error);
+	}
+	return false;
+}
+
+/**
+ * Configure the recovery of failed random byte retrievals. A failed retrieval is repeated up to
+ * maxRetries times, the wait before each attempt doubles from backoffUsecs up to MCR_SPI_MAX_RETRY_BACKOFF_USECS.
+ * Enabled by default with MCR_SPI_DEFAULT_MAX_RETRIES retries.
+ *
+ * @param maxRetries max number of attempts after a failed retrieval, 0 to disable the recovery
+ * @param backoffUsecs wait in microseconds before the first attempt
+ *
+ */
+void MicroRngSPI::setErrorRecovery(uint32_t maxRetries, uint32_t backoffUsecs) {
+	this->m_maxRetries = maxRetries;
+	this->m_retryBackoffUsecs = backoffUsecs;
+}
+
+/**
+ * Read the 'bufsiz' parameter of the spidev kernel module, which limits the total amount of bytes
+ * exchanged with a single SPI_IOC_MESSAGE(n) system call.
+ *
+ * A 'bufsiz' smaller than MCR_SPI_SEGMENT_ALIGN is used as it is, see exchangeMessages().
+ *
+ * @return max amount of bytes per SPI message, MCR_SPI_MAX_TRANSFER_BYTES if the parameter is not available
+ */
+uint32_t MicroRngSPI::readSpidevBufferSize() const {
+	uint32_t bufferSize = MCR_SPI_MAX_TRANSFER_BYTES;
+	FILE *bufsizFile = fopen(MCR_SPIDEV_BUFSIZ_PATH, "r");
+	if (bufsizFile != nullptr) {
+		unsigned long value;
+		if (fscanf(bufsizFile, "%lu", &value) == 1 && value > 0) {
+			bufferSize = (uint32_t) value;
+		}
+		fclose(bufsizFile);
+	}
+	return bufferSize;
+}
+
 /**
  * Exchange bytes with connected MicroRNG device by sending a command 
  * while receiving response for the previous command.
@@ -155,7 +360,6 @@ bool MicroRngSPI::connect(const char *devicePath) {
  * @return true when data exchanged successfully
  */
 bool MicroRngSPI::exhangeByte(char cmd, uint8_t *rx) {
-	int retCode;
 	if (!isConnected()) {
 		return false;
 	}
@@ -166,15 +370,10 @@ bool MicroRngSPI::exhangeByte(char cmd, uint8_t *rx) {
 	tr.rx_buf = (unsigned long) rx;
 	tr.len = 1;
 	tr.delay_usecs = 0;
-	tr.speed_hz = m_clockHz;
+	tr.speed_hz = m_clockHz.load(std::memory_order_relaxed);
 	tr.bits_per_word = m_spiBits;
 
-	retCode = ioctl(m_fd, SPI_IOC_MESSAGE(1), &tr);
-	if (retCode < 1) {
-		sprintf(m_lastError, "Could not exchange SPI bytes");
-		return false;
-	}
-	return true;
+	return transferMessage(1, &tr, 1);
 }
 
 /**
@@ -190,26 +389,248 @@ bool MicroRngSPI::executeCommand(char cmd, uint8_t *rx) {
 	if (!isConnected()) {
 		return false;
 	}
-
-	if (cmd != m_lastSentCommand && !exhangeByte(cmd, rx)) {
-		// Will need two data transfers because the current command is different from the one that was sent last time.
+	if (!runPendingValidation()) {
 		return false;
 	}
+
+	if (cmd != m_lastSentCommand) {
+		m_statCommandSwitches.fetch_add(1, std::memory_order_relaxed);
+		if (!exhangeByte(cmd, rx)) {
+			// Will need two data transfers because the current command is different from the one that was sent last time.
+			return false;
+		}
+	}
 	return exhangeByte(cmd, rx);
 }
 
+/**
+ * Exchange a series of bytes with connected MicroRNG device by repeatedly sending the same command
+ * while receiving responses for the previously sent commands. The bytes are split into transfer segments
+ * and as many segments as the spidev 'bufsiz' limit allows are submitted with a single SPI_IOC_MESSAGE(n) system call.
+ *
+ * @param cmd one byte command that will be sent repeatedly to connected device through SPI interface
+ * @param len how many bytes to exchange
+ * @param rx pointer to receiving bytes from connected device through SPI interface
+ * @param primeRx when not nullptr, one extra command is sent ahead of the others and its response is stored here
+ *
+ * @return true when data exchanged successfully
+ */
+bool MicroRngSPI::exchangeBytes(char cmd, int len, uint8_t *rx, uint8_t *primeRx) {
+	if (!isConnected()) {
+		return false;
+	}
+	memset(m_txBuffer, cmd, (uint32_t) len < m_maxMessageBytes ? len : m_maxMessageBytes);
+	return exchangeMessages(m_txBuffer, true, len, rx, primeRx);
+}
+
+/**
+ * Exchange an arbitrary sequence of command bytes with as few SPI messages as the message budget allows.
+ * Each received byte is the response to the command byte sent before it, the first received byte
+ * is the response to the last command byte of the previous exchange.
+ *
+ * @param tx pointer to the command bytes to send
+ * @param len how many bytes to exchange
+ * @param rx pointer to receiving response bytes
+ *
+ * @return true if successful
+ */
+bool MicroRngSPI::exchangeCommandSequence(const uint8_t *tx, int len, uint8_t *rx) {
+	if (!isConnected()) {
+		return false;
+	}
+	if (len <= 0) {
+		setErrMsg("Invalid amount of command bytes requested");
+		return false;
+	}
+	if (!runPendingValidation()) {
+		return false;
+	}
+	return exchangeMessages(tx, false, len, rx, nullptr);
+}
+
+/**
+ * @return the command byte sent last, its response is received with the next exchanged byte
+ */
+char MicroRngSPI::getLastSentCommand() const {
+	return m_lastSentCommand;
+}
+
+/**
+ * Exchange bytes using SPI messages of up to m_maxMessageBytes, split into transfer segments
+ *
+ * @param tx pointer to the bytes to send
+ * @param isTxRepeated true when the same first m_maxMessageBytes of 'tx' are sent with every message
+ * @param len how many bytes to exchange
+ * @param rx pointer to receiving bytes
+ * @param primeRx when not nullptr, the first byte of 'tx' is sent one extra time as a leading segment
+ *        of the first message and the response to it, which belongs to the previous command, is stored here
+ *
+ * @return true if successful
+ */
+bool MicroRngSPI::exchangeMessages(const uint8_t *tx, bool isTxRepeated, int len, uint8_t *rx, uint8_t *primeRx) {
+	memset(rx, 0, len);    // Set it initially to zero to avoid 'valgrind' complains
+	m_lastSentCommand = (char) tx[isTxRepeated ? 0 : len - 1];
+
+	uint32_t clockHz = m_clockHz.load(std::memory_order_relaxed);
+
+	// Keep each segment within the message budget after the driver aligns its length.
+	// A budget below the alignment can't hold an aligned segment, each message then carries
+	// a single segment of up to the whole budget.
+	uint32_t segmentAlign = m_maxMessageBytes < MCR_SPI_SEGMENT_ALIGN ? 1 : MCR_SPI_SEGMENT_ALIGN;
+	uint32_t maxSegmentBytes = m_segmentBytes;
+	if (maxSegmentBytes > m_maxMessageBytes - m_maxMessageBytes % segmentAlign) {
+		maxSegmentBytes = m_maxMessageBytes - m_maxMessageBytes % segmentAlign;
+	}
+
+	while (len > 0) {
+		uint32_t numSegments = 0;
+		uint32_t messageBytes = 0;
+		uint32_t messageBudget = m_maxMessageBytes;
+		const uint8_t *txSegment = tx;
+		if (primeRx != nullptr) {
+			struct spi_ioc_transfer *tr = &m_segments[numSegments++];
+			memset(tr, 0, sizeof(*tr));
+			tr->tx_buf = (unsigned long) tx;
+			tr->rx_buf = (unsigned long) primeRx;
+			tr->len = 1;
+			tr->cs_change = m_segmentCsChange;
+			tr->delay_usecs = m_segmentDelayUsecs;
+			tr->speed_hz = clockHz;
+			tr->bits_per_word = m_spiBits;
+			messageBytes++;
+			messageBudget -= segmentAlign;
+			primeRx = nullptr;
+		}
+		while (len > 0 && numSegments < MCR_SPI_MAX_SEGMENTS) {
+			uint32_t segmentLen = (uint32_t) len < maxSegmentBytes ? len : maxSegmentBytes;
+			// Shorten the last segment to whatever is left of the budget
+			if (segmentLen > messageBudget - messageBudget % segmentAlign) {
+				segmentLen = messageBudget - messageBudget % segmentAlign;
+			}
+			if (segmentLen == 0) {
+				break;
+			}
+			uint32_t alignedLen = (segmentLen + segmentAlign - 1) / segmentAlign * segmentAlign;
+			struct spi_ioc_transfer *tr = &m_segments[numSegments++];
+			memset(tr, 0, sizeof(*tr));
+			tr->tx_buf = (unsigned long) txSegment;
+			tr->rx_buf = (unsigned long) rx;
+			tr->len = segmentLen;
+			tr->cs_change = m_segmentCsChange;
+			tr->delay_usecs = m_segmentDelayUsecs;
+			tr->speed_hz = clockHz;
+			tr->bits_per_word = m_spiBits;
+			txSegment += segmentLen;
+			rx += segmentLen;
+			len -= segmentLen;
+			messageBytes += segmentLen;
+			messageBudget -= alignedLen;
+		}
+		// Chip select always gets released at the end of the message
+		m_segments[numSegments - 1].cs_change = 0;
+
+		if (!transferMessage(numSegments, m_segments, messageBytes)) {
+			return false;
+		}
+		if (!isTxRepeated) {
+			tx = txSegment;
+		}
+	}
+	return true;
+}
+
+/**
+ * Submit an SPI message with a single system call and account for it in the transfer counters
+ *
+ * @param numSegments number of SPI transfer segments in the message
+ * @param segments pointer to SPI transfer segments
+ * @param numBytes total amount of bytes the message exchanges
+ *
+ * @return true if all bytes exchanged successfully
+ */
+bool MicroRngSPI::transferMessage(uint32_t numSegments, struct spi_ioc_transfer *segments, uint32_t numBytes) {
+	struct timespec start;
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	int retCode = ioctl(m_fd, SPI_IOC_MESSAGE(numSegments), segments);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	uint64_t nanos = (uint64_t) (end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec;
+	m_statIoctls.fetch_add(1, std::memory_order_relaxed);
+	m_statKernelNanos.fetch_add(nanos, std::memory_order_relaxed);
+	if (m_isLatencyHistogramEnabled.load(std::memory_order_relaxed)) {
+		uint32_t bucket = 0;
+		for (uint64_t usecs = nanos / 1000; usecs > 0 && bucket < MCR_SPI_LATENCY_BUCKETS - 1; usecs >>= 1) {
+			bucket++;
+		}
+		m_statLatency[bucket].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (retCode < (int) numBytes) {
+		m_lastErrno = retCode == -1 ? errno : 0;
+		m_isTransferFailed = true;
+		m_statErrors.fetch_add(1, std::memory_order_relaxed);
+		sprintf(m_lastError, "Could not exchange SPI bytes");
+		return false;
+	}
+	m_statBytes.fetch_add(numBytes, std::memory_order_relaxed);
+	return true;
+}
+
+/**
+ * Execute the same command multiple times using batched SPI transfers.
+ * When the last command sent was different, one extra command is exchanged within the first SPI message
+ * and its response, which belongs to the previous command, is discarded.
+ *
+ * @param cmd one byte command that will be sent to connected device through SPI interface
+ * @param len how many times to execute the command
+ * @param rx pointer to receiving bytes from connected device through SPI interface
+ *
+ * @return true when commands executed successfully
+ */
+bool MicroRngSPI::executeBatchCommand(char cmd, int len, uint8_t *rx) {
+	uint8_t prevResponse;
+	if (!isConnected()) {
+		return false;
+	}
+	if (!runPendingValidation()) {
+		return false;
+	}
+
+	if (cmd != m_lastSentCommand) {
+		// The extra command rides along as the leading segment of the first message
+		m_statCommandSwitches.fetch_add(1, std::memory_order_relaxed);
+		return exchangeBytes(cmd, len, rx, &prevResponse);
+	}
+	return exchangeBytes(cmd, len, rx, nullptr);
+}
+
 /**
  * Check to see if the MicroRNG device is actually responding to requests.
+ * Nothing is exchanged when a test byte sequence already passed at the current clock frequency,
+ * as when a cached clock frequency was re-validated by calibrateClockFrequency(). In deferred validation mode
+ * the check is postponed to the first exchange, see setDeferredValidation().
  *
- * @return true when validated successfully
+ * @return true when validated successfully, or when the validation is deferred
  */
 bool MicroRngSPI::validateDevice() {
 	if (!isConnected()) {
 		return false;
 	}
+	if (m_isDeviceValidated) {
+		return true;
+	}
+	if (m_isDeferredValidation) {
+		m_isValidationPending = true;
+		return true;
+	}
+	if (m_isFastProbe) {
+		return probeDevice();
+	}
 
 	uint8_t beginTransactionID;
-	for (int i = 1; i <= 257; ++i) {
+	for (int i = 1; i <= MCR_SPI_PROBE_BYTES; ++i) {
 		uint8_t transactionID;
 		if (!executeCommand('t', &transactionID)) {
 			return false;
@@ -224,6 +645,156 @@ bool MicroRngSPI::validateDevice() {
 			return false;
 		}
 	}
+	m_isDeviceValidated = true;
+	return true;
+}
+
+/**
+ * Check the transfer ID sequence with a single batched exchange of test bytes
+ *
+ * @return true when the device responded with consecutive transfer IDs
+ */
+bool MicroRngSPI::probeDevice() {
+	uint8_t transactionIDs[MCR_SPI_PROBE_BYTES];
+	if (!retrieveTestBytes(MCR_SPI_PROBE_BYTES, transactionIDs)) {
+		return false;
+	}
+	for (int i = 1; i < MCR_SPI_PROBE_BYTES; i++) {
+		if (transactionIDs[i] != (uint8_t) (transactionIDs[i - 1] + 1)) {
+			sprintf(m_lastError, "MicroRNG device not found");
+			return false;
+		}
+	}
+	m_isDeviceValidated = true;
+	return true;
+}
+
+/**
+ * Select how validateDevice() checks the transfer ID sequence. The fast probe, enabled by default,
+ * retrieves all transfer IDs with one batched exchange. Otherwise each transfer ID is
+ * retrieved with its own SPI transfer, which also exercises the chip select between bytes.
+ *
+ * @param enabled true for the batched probe
+ *
+ */
+void MicroRngSPI::setFastProbe(bool enabled) {
+	m_isFastProbe = enabled;
+}
+
+/**
+ * Enable or disable deferred device validation. When enabled, validateDevice() doesn't exchange
+ * anything, the transfer ID sequence is instead checked within the first SPI message of the
+ * next random byte retrieval, together with the first data bytes, or before any other command.
+ * A device that doesn't respond is then reported by that retrieval failing.
+ *
+ * @param enabled true to defer the validation to the first exchange
+ *
+ */
+void MicroRngSPI::setDeferredValidation(bool enabled) {
+	m_isDeferredValidation = enabled;
+	if (!enabled && m_isValidationPending) {
+		m_isValidationPending = false;
+		m_isDeviceValidated = false;
+	}
+}
+
+/**
+ * @return true when a deferred device validation has not run yet
+ */
+bool MicroRngSPI::isValidationPending() const {
+	return m_isValidationPending;
+}
+
+/**
+ * Run the deferred device validation, if pending, before exchanging another command.
+ * The validation stays pending until it passes.
+ *
+ * @return true when no validation was pending or the device validated successfully
+ */
+bool MicroRngSPI::runPendingValidation() {
+	if (!m_isValidationPending) {
+		return true;
+	}
+	// Cleared while probing, so the probe exchanges don't run the validation again
+	m_isValidationPending = false;
+	if (probeDevice() || recalibrateAfterFailedProbe()) {
+		return true;
+	}
+	m_isValidationPending = true;
+	return false;
+}
+
+/**
+ * Recover from a failed deferred validation at a calibrated clock frequency. The frequency may be stale,
+ * as a cached frequency the device no longer keeps up with, so it is detected again with
+ * autodetectMaxFrequency(), saved to the calibration cache and the device validated at the new frequency.
+ * An explicitly set clock frequency is kept and the failure reported. The validation stays pending
+ * unless the device validated.
+ *
+ * @return true when the clock frequency was detected again and the device validated
+ */
+bool MicroRngSPI::recalibrateAfterFailedProbe() {
+	if (!m_clockCalibrated) {
+		m_isValidationPending = true;
+		return false;
+	}
+	// Cleared while detecting, so the test byte exchanges don't run the validation again
+	m_isValidationPending = false;
+	if (autodetectMaxFrequency()) {
+		m_clockCalibrated = true;
+		// Failing to update the cache doesn't affect the detected frequency
+		saveCalibration();
+		if (probeDevice()) {
+			return true;
+		}
+	}
+	m_isValidationPending = true;
+	return false;
+}
+
+/**
+ * Run the deferred device validation in the same SPI message as the first bytes of a chunk.
+ * The transfer IDs are requested first, followed by the chunk command, so the response to the
+ * first chunk command is the last transfer ID and the chunk bytes follow it.
+ *
+ * @param cmd chunk command
+ * @param len how many chunk bytes are requested
+ * @param rx pointer to receiving chunk bytes
+ * @param numServed pointer to receiving amount of chunk bytes already retrieved
+ *
+ * This exchange is fail-fast, it is not retried by the error recovery: a failure here means the
+ * device could not be validated, which a retry would only hide. Callers detect a calibrated clock
+ * frequency again with recalibrateAfterFailedProbe() instead.
+ *
+ * @return true when the device validated and the bytes exchanged successfully
+ */
+bool MicroRngSPI::exchangeProbeWithChunk(char cmd, int len, uint8_t *rx, int *numServed) {
+	uint8_t tx[MCR_SPI_MAX_TRANSFER_BYTES];
+	uint8_t response[MCR_SPI_MAX_TRANSFER_BYTES];
+	int numChunkBytes = len < MCR_SPI_MAX_TRANSFER_BYTES - MCR_SPI_PROBE_BYTES - 1
+			? len : MCR_SPI_MAX_TRANSFER_BYTES - MCR_SPI_PROBE_BYTES - 1;
+	int numBytes = MCR_SPI_PROBE_BYTES + 1 + numChunkBytes;
+
+	*numServed = 0;
+	memset(tx, m_testCommand, MCR_SPI_PROBE_BYTES);
+	memset(tx + MCR_SPI_PROBE_BYTES, cmd, numChunkBytes + 1);
+	if (cmd != m_lastSentCommand) {
+		m_statCommandSwitches.fetch_add(1, std::memory_order_relaxed);
+	}
+	if (!exchangeMessages(tx, false, numBytes, response, nullptr)) {
+		return false;
+	}
+	// The first response belongs to the command sent before the exchange
+	for (int i = 2; i <= MCR_SPI_PROBE_BYTES; i++) {
+		if (response[i] != (uint8_t) (response[i - 1] + 1)) {
+			sprintf(m_lastError, "MicroRNG device not found");
+			return false;
+		}
+	}
+	m_isDeviceValidated = true;
+	m_isValidationPending = false;
+	memcpy(rx, response + MCR_SPI_PROBE_BYTES + 1, numChunkBytes);
+	*numServed = numChunkBytes;
 	return true;
 }
 
@@ -295,17 +866,32 @@ bool MicroRngSPI::resetUART(uint8_t *rx) {
  * @return true when communication to MicroRNG is validated
  */
 bool MicroRngSPI::validateCommunication() {
+	return validateCommunication(MCR_SPI_VALIDATION_BYTES);
+}
+
+/**
+ * Validate SPI communication with MicroRNG device by sending a series of test commands and inspecting results.
+ *
+ * @param numTestBytes how many test bytes to exchange, between 2 and MCR_SPI_VALIDATION_BYTES
+ *
+ * @return true when communication to MicroRNG is validated
+ */
+bool MicroRngSPI::validateCommunication(int numTestBytes) {
 	if (!isConnected()) {
 		return false;
 	}
+	if (numTestBytes < 2 || numTestBytes > MCR_SPI_VALIDATION_BYTES) {
+		setErrMsg("Invalid amount of test bytes requested");
+		return false;
+	}
 
-	uint8_t testBuffer[2048];
-	if (!retrieveTestBytes(sizeof(testBuffer), testBuffer)) {
+	uint8_t testBuffer[MCR_SPI_VALIDATION_BYTES];
+	if (!retrieveTestBytes(numTestBytes, testBuffer)) {
 		return false;
 	}
 
 	uint8_t expectedTestByte = 0;
-	for (unsigned int i = 0; i < sizeof(testBuffer); i++) {
+	for (int i = 0; i < numTestBytes; i++) {
 		if (i == 0) {
 			expectedTestByte = testBuffer[i];
 		} else {
@@ -315,32 +901,290 @@ bool MicroRngSPI::validateCommunication() {
 			}
 		}
 	}
+	// Long enough a sequence to identify the device as well
+	if (numTestBytes >= MCR_SPI_QUICK_VALIDATION_BYTES) {
+		m_isDeviceValidated = true;
+		m_isValidationPending = false;
+	}
+	return true;
+}
+
+/**
+ * Validate SPI communication at a clock frequency expressed as a multiple of the min clock frequency.
+ *
+ * @param step clock frequency multiplier
+ * @param passes how many consecutive validations must succeed
+ *
+ * @return true when all validations succeeded
+ */
+bool MicroRngSPI::validateClockStep(uint32_t step, uint32_t passes) {
+	setMaxClockFrequency(step * m_minClockHz);
+	for (uint32_t i = 0; i < passes; i++) {
+		if (!validateCommunication()) {
+			return false;
+		}
+	}
 	return true;
 }
 
 /**
  * Identify the maximum SPI master clock frequency while still maintaining a valid communication with MicroRNG device.
+ * Frequencies are probed in min clock frequency steps with a binary search, the best candidate is then
+ * confirmed with a number of consecutive validations and lowered by the safety margin, if any.
  *
  * @return true when maximum clock frequency is successfully determined
  */
 bool MicroRngSPI::autodetectMaxFrequency() {
-	bool success = false;
 	if (!isConnected()) {
 		return false;
 	}
-	for (uint32_t freqHz = m_minClockHz; freqHz < m_maxClockHz; freqHz +=
-			m_minClockHz) {
-		uint32_t prevClockHz = getMaxClockFrequency();
-		setMaxClockFrequency(freqHz);
-		bool status = validateCommunication();
-		if (status) {
-			success = true;
+	uint32_t prevClockHz = getMaxClockFrequency();
+
+	// The lowest frequency has to work, otherwise there is nothing to search for
+	uint32_t goodStep = 1;
+	if (!validateClockStep(goodStep, 1)) {
+		setMaxClockFrequency(prevClockHz);
+		return false;
+	}
+
+	// Highest step is the last frequency below the max clock frequency, the same range as a linear sweep
+	uint32_t badStep = (m_maxClockHz - 1) / m_minClockHz + 1;
+	while (badStep - goodStep > 1) {
+		uint32_t step = goodStep + (badStep - goodStep) / 2;
+		if (validateClockStep(step, 1)) {
+			goodStep = step;
 		} else {
+			badStep = step;
+		}
+	}
+
+	// Step down until the candidate survives all confirmation passes
+	while (!validateClockStep(goodStep, m_autodetectConfirmPasses)) {
+		if (--goodStep == 0) {
+			setErrMsg("Could not confirm SPI clock frequency");
 			setMaxClockFrequency(prevClockHz);
-			break;
+			return false;
+		}
+	}
+	m_detectedMaxClockHz = goodStep * m_minClockHz;
+
+	// Back off by the safety margin, keep at least the min clock frequency
+	uint32_t marginSteps = (uint32_t) ((uint64_t) goodStep * m_autodetectMarginPercent / 100);
+	if (marginSteps >= goodStep) {
+		marginSteps = goodStep - 1;
+	}
+	setMaxClockFrequency((goodStep - marginSteps) * m_minClockHz);
+	return true;
+}
+
+/**
+ * Configure how autodetectMaxFrequency() settles on the max clock frequency.
+ *
+ * @param confirmationPasses how many consecutive validations must succeed at the detected frequency, at least 1
+ * @param safetyMarginPercent how much to lower the detected frequency by, in percents
+ *
+ */
+void MicroRngSPI::setAutodetectParameters(uint32_t confirmationPasses, uint32_t safetyMarginPercent) {
+	this->m_autodetectConfirmPasses = confirmationPasses == 0 ? 1 : confirmationPasses;
+	this->m_autodetectMarginPercent = safetyMarginPercent > 100 ? 100 : safetyMarginPercent;
+}
+
+/**
+ * Get the max SPI master clock frequency found by the last autodetectMaxFrequency() call, before the safety margin
+ *
+ * @return detected max SPI master clock frequency in Hz, zero when not detected yet
+ *
+ */
+uint32_t MicroRngSPI::getDetectedMaxClockFrequency() const {
+	return m_detectedMaxClockHz;
+}
+
+/**
+ * Set the directory of the clock frequency calibration cache.
+ *
+ * @param cacheDir complete path to the cache directory, nullptr disables the cache
+ *
+ */
+void MicroRngSPI::setCalibrationCacheDir(const char *cacheDir) {
+	if (cacheDir == nullptr) {
+		m_calibrationCacheDir[0] = '\0';
+	} else {
+		snprintf(m_calibrationCacheDir, sizeof(m_calibrationCacheDir), "%s", cacheDir);
+	}
+}
+
+/**
+ * Check if the current SPI master clock frequency has been calibrated for the connected device
+ *
+ * @return true if the clock frequency was loaded from the calibration cache or detected
+ */
+bool MicroRngSPI::isClockFrequencyCalibrated() const {
+	return m_clockCalibrated;
+}
+
+/**
+ * Make sure the connected device runs at a calibrated SPI master clock frequency.
+ * The frequency loaded from the calibration cache when connecting is used when still valid,
+ * otherwise the max frequency is detected with autodetectMaxFrequency() and saved to the cache.
+ * The cached frequency is re-validated with a short series of test bytes. In deferred validation
+ * mode it is used without exchanging anything, the deferred probe of the first exchange then checks
+ * the device and the cached frequency together. When that probe fails the frequency is detected
+ * again and the cache rewritten before the exchange continues.
+ *
+ * @return true when the clock frequency is calibrated
+ */
+bool MicroRngSPI::calibrateClockFrequency() {
+	if (!isConnected()) {
+		return false;
+	}
+	if (m_clockCalibrated) {
+		return true;
+	}
+	if (m_cachedClockHz != 0) {
+		uint32_t prevClockHz = getMaxClockFrequency();
+		setMaxClockFrequency(m_cachedClockHz);
+		m_cachedClockHz = 0;
+		if (m_isDeferredValidation) {
+			m_clockCalibrated = true;
+			m_isValidationPending = true;
+			return true;
+		}
+		if (validateCommunication(MCR_SPI_QUICK_VALIDATION_BYTES)) {
+			m_clockCalibrated = true;
+			return true;
+		}
+		setMaxClockFrequency(prevClockHz);
+		clearErrMsg();
+	}
+	if (!autodetectMaxFrequency()) {
+		return false;
+	}
+	m_clockCalibrated = true;
+	// Failing to update the cache doesn't affect the detected frequency
+	saveCalibration();
+	return true;
+}
+
+/**
+ * Build complete path to the calibration cache file of the connected device
+ *
+ * @param path pointer to receiving path
+ * @param pathSize size of the receiving path buffer
+ */
+void MicroRngSPI::buildCalibrationPath(char *path, size_t pathSize) const {
+	const char *deviceName = strrchr(m_devicePath, '/');
+	deviceName = deviceName == nullptr ? m_devicePath : deviceName + 1;
+	snprintf(path, pathSize, "%s/%s.conf", m_calibrationCacheDir, deviceName);
+}
+
+/**
+ * Identify the board model, used for keying the calibration cache
+ *
+ * @param model pointer to receiving board model
+ * @param modelSize size of the receiving model buffer
+ */
+void MicroRngSPI::readBoardModel(char *model, size_t modelSize) const {
+	const char *modelPaths[] = { "/proc/device-tree/model", "/sys/class/dmi/id/product_name" };
+	snprintf(model, modelSize, "unknown");
+	for (const char *modelPath : modelPaths) {
+		FILE *modelFile = fopen(modelPath, "r");
+		if (modelFile == nullptr) {
+			continue;
+		}
+		size_t len = fread(model, 1, modelSize - 1, modelFile);
+		fclose(modelFile);
+		model[len] = '\0';
+		// Device tree strings are null terminated, DMI strings end with a new line
+		model[strcspn(model, "\r\n")] = '\0';
+		if (model[0] != '\0') {
+			return;
+		}
+		snprintf(model, modelSize, "unknown");
+	}
+}
+
+/**
+ * Load the clock frequency saved in the calibration cache for the connected device and board.
+ * Nothing is exchanged with the device and the current clock frequency is kept, the loaded
+ * frequency is checked and put in use by calibrateClockFrequency().
+ *
+ * @return true when a cache entry matching the device and board was found
+ */
+bool MicroRngSPI::loadCalibration() {
+	m_cachedClockHz = 0;
+	if (!isConnected() || m_calibrationCacheDir[0] == '\0') {
+		return false;
+	}
+
+	char path[MCR_SPI_CALIBRATION_PATH_SIZE];
+	char line[512];
+	char expectedBoard[256];
+	bool isDeviceMatched = false;
+	bool isBoardMatched = false;
+	unsigned long clockHz = 0;
+
+	buildCalibrationPath(path, sizeof(path));
+	readBoardModel(expectedBoard, sizeof(expectedBoard));
+	FILE *cacheFile = fopen(path, "r");
+	if (cacheFile == nullptr) {
+		return false;
+	}
+	while (fgets(line, sizeof(line), cacheFile) != nullptr) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (strncmp(line, "device=", 7) == 0) {
+			isDeviceMatched = strcmp(line + 7, m_devicePath) == 0;
+		} else if (strncmp(line, "board=", 6) == 0) {
+			isBoardMatched = strcmp(line + 6, expectedBoard) == 0;
+		} else if (strncmp(line, "clock_hz=", 9) == 0) {
+			clockHz = strtoul(line + 9, nullptr, 10);
 		}
 	}
-	return success;
+	fclose(cacheFile);
+
+	if (!isDeviceMatched || !isBoardMatched || clockHz < m_minClockHz || clockHz > m_maxClockHz) {
+		return false;
+	}
+
+	m_cachedClockHz = (uint32_t) clockHz;
+	return true;
+}
+
+/**
+ * Save the current clock frequency to the calibration cache for the connected device and board
+ *
+ * @return true when saved successfully
+ */
+bool MicroRngSPI::saveCalibration() {
+	if (!isConnected() || m_calibrationCacheDir[0] == '\0') {
+		return false;
+	}
+
+	char path[MCR_SPI_CALIBRATION_PATH_SIZE];
+	char tmpPath[MCR_SPI_CALIBRATION_PATH_SIZE + 8];
+	char board[256];
+
+	if (mkdir(m_calibrationCacheDir, 0755) != 0 && errno != EEXIST) {
+		sprintf(m_lastError, "Could not create calibration cache directory");
+		return false;
+	}
+	buildCalibrationPath(path, sizeof(path));
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+	readBoardModel(board, sizeof(board));
+
+	// Write a temporary file first so readers never see a partial entry
+	FILE *cacheFile = fopen(tmpPath, "w");
+	if (cacheFile == nullptr) {
+		sprintf(m_lastError, "Could not write calibration cache file");
+		return false;
+	}
+	fprintf(cacheFile, "device=%s\nboard=%s\nclock_hz=%lu\n", m_devicePath, board,
+			(unsigned long) getMaxClockFrequency());
+	if (fclose(cacheFile) != 0 || rename(tmpPath, path) != 0) {
+		unlink(tmpPath);
+		sprintf(m_lastError, "Could not write calibration cache file");
+		return false;
+	}
+	return true;
 }
 
 /**
@@ -359,6 +1203,8 @@ bool MicroRngSPI::retrieveRandomByte(uint8_t *rx) {
 
 /**
  * Retrieves random bytes processed internally with an embedded Linear Corrector (P. Lacharme)
+ * A failed SPI message is retried as configured with setErrorRecovery(), a pending deferred
+ * device validation is fail-fast.
  *
  * @param len how many random bytes to retrieve
  * @param rx pointer to receiving random bytes
@@ -366,7 +1212,6 @@ bool MicroRngSPI::retrieveRandomByte(uint8_t *rx) {
  * @return true when random data successfully retrieved
  */
 bool MicroRngSPI::retrieveRandomBytes(int len, uint8_t *rx) {
-	bool status = true;
 	if (!isConnected()) {
 		return false;
 	}
@@ -374,15 +1219,21 @@ bool MicroRngSPI::retrieveRandomBytes(int len, uint8_t *rx) {
 		setErrMsg("Invalid ammount of random bytes requested");
 		return false;
 	}
-
-	for (int i = 0; i < len; i++) {
-		status = retrieveRandomByte(rx + i);
-		if (!status) {
-			break;
+	if (m_isValidationPending) {
+		int numServed;
+		// A failed deferred validation is not retried, only a stale calibrated clock is detected again
+		if (!exchangeProbeWithChunk(m_randomByteCommand, len, rx, &numServed)
+				&& !recalibrateAfterFailedProbe()) {
+			return false;
 		}
+		if (numServed == len) {
+			return true;
+		}
+		len -= numServed;
+		rx += numServed;
 	}
 
-	return status;
+	return executeRecoverableCommand(m_randomByteCommand, len, rx);
 }
 
 /**
@@ -412,7 +1263,6 @@ bool MicroRngSPI::retrieveTestByte(uint8_t *rx) {
  * @return true when transfer IDs successfully retrieved
  */
 bool MicroRngSPI::retrieveTestBytes(int len, uint8_t *rx) {
-	bool status = true;
 	if (!isConnected()) {
 		return false;
 	}
@@ -421,14 +1271,7 @@ bool MicroRngSPI::retrieveTestBytes(int len, uint8_t *rx) {
 		return false;
 	}
 
-	for (int i = 0; i < len; i++) {
-		status = retrieveTestByte(rx + i);
-		if (!status) {
-			break;
-		}
-	}
-
-	return status;
+	return executeBatchCommand(m_testCommand, len, rx);
 }
 
 /**
@@ -449,6 +1292,8 @@ bool MicroRngSPI::retrieveRawRandomByte(uint8_t *rx) {
 /**
  * Retrieves a raw (unprocessed) random bytes.
  * It should only be used for verification or when used with external post-processing implementations.
+ * A failed SPI message is retried as configured with setErrorRecovery(), a pending deferred
+ * device validation is fail-fast.
  *
  * @param len how many random bytes to retrieve
  * @param rx pointer to receiving random bytes
@@ -456,7 +1301,6 @@ bool MicroRngSPI::retrieveRawRandomByte(uint8_t *rx) {
  * @return true when random data successfully retrieved
  */
 bool MicroRngSPI::retrieveRawRandomBytes(int len, uint8_t *rx) {
-	bool status = true;
 	if (!isConnected()) {
 		return false;
 	}
@@ -464,25 +1308,241 @@ bool MicroRngSPI::retrieveRawRandomBytes(int len, uint8_t *rx) {
 		setErrMsg("Invalid amount of raw random bytes requested");
 		return false;
 	}
-
-	for (int i = 0; i < len; i++) {
-		status = retrieveRawRandomByte(rx + i);
-		if (!status) {
-			break;
+	if (m_isValidationPending) {
+		int numServed;
+		// A failed deferred validation is not retried, only a stale calibrated clock is detected again
+		if (!exchangeProbeWithChunk(m_rawRandomByteCommand, len, rx, &numServed)
+				&& !recalibrateAfterFailedProbe()) {
+			return false;
+		}
+		if (numServed == len) {
+			return true;
 		}
+		len -= numServed;
+		rx += numServed;
 	}
 
-	return status;
+	return executeRecoverableCommand(m_rawRandomByteCommand, len, rx);
 }
 
 /**
  * Set new SPI master clock speed. Setting this value too high may result in miss communication over SPI interface.
+ * In adaptive clock mode this is also the highest frequency probed.
  *
  * @param clockHz new SPI master clock frequency in Hz
  *
  */
 void MicroRngSPI::setMaxClockFrequency(uint32_t clockHz) {
-	this->m_clockHz = clockHz;
+	this->m_clockHz.store(clockHz, std::memory_order_relaxed);
+	this->m_clockCeilingHz = clockHz;
+	this->m_clockCalibrated = false;
+	this->m_passedChecks = 0;
+	this->m_isDeviceValidated = false;
+}
+
+/**
+ * Enable or disable adaptive clock mode for random byte retrieval.
+ * In adaptive mode the communication is checked with a short series of test bytes after every
+ * 'checkIntervalBytes' random bytes. When the check fails, the clock frequency drops one step
+ * and the random bytes of the current call are retrieved again. Bytes returned by earlier calls since
+ * the last successful check are not verified again, a 'checkIntervalBytes' no larger than the bytes
+ * retrieved per call has every call checked before it returns. After 'stableChecks' consecutive successful checks
+ * the clock frequency is raised one step, never above the one set with setMaxClockFrequency().
+ * Each failed probe doubles the successful checks required before the next one.
+ *
+ * @param enabled true to enable adaptive clock mode
+ * @param checkIntervalBytes amount of random bytes retrieved between two checks, 0 for default
+ * @param stableChecks consecutive successful checks before probing a higher frequency, 0 for default
+ *
+ */
+void MicroRngSPI::setAdaptiveClock(bool enabled, uint32_t checkIntervalBytes, uint32_t stableChecks) {
+	m_adaptiveClock = enabled;
+	m_adaptiveCheckIntervalBytes = checkIntervalBytes == 0 ? MCR_SPI_ADAPTIVE_CHECK_INTERVAL_BYTES : checkIntervalBytes;
+	m_adaptiveStableChecks = stableChecks == 0 ? MCR_SPI_ADAPTIVE_STABLE_CHECKS : stableChecks;
+	m_bytesSinceCheck = 0;
+	m_passedChecks = 0;
+	m_probeBackoff = 1;
+	m_isProbing = false;
+}
+
+/**
+ * @return true if adaptive clock mode is enabled
+ */
+bool MicroRngSPI::isAdaptiveClockEnabled() const {
+	return m_adaptiveClock;
+}
+
+/**
+ * @return how many times the clock frequency dropped a step in adaptive clock mode since connected
+ */
+uint32_t MicroRngSPI::getClockDownshiftCount() const {
+	return m_clockDownshifts.load(std::memory_order_relaxed);
+}
+
+/**
+ * @return how many times a higher clock frequency was probed in adaptive clock mode since connected
+ */
+uint32_t MicroRngSPI::getClockUpshiftCount() const {
+	return m_clockUpshifts.load(std::memory_order_relaxed);
+}
+
+/**
+ * Retrieve a snapshot of the SPI transfer counters. Counters are updated with relaxed atomic operations,
+ * so a snapshot taken while another thread transfers bytes may be slightly inconsistent.
+ *
+ * @param stats pointer to receiving counters
+ */
+void MicroRngSPI::getStats(MicroRngSPIStats *stats) const {
+	stats->bytesTransferred = m_statBytes.load(std::memory_order_relaxed);
+	stats->ioctls = m_statIoctls.load(std::memory_order_relaxed);
+	stats->commandSwitches = m_statCommandSwitches.load(std::memory_order_relaxed);
+	stats->errors = m_statErrors.load(std::memory_order_relaxed);
+	stats->kernelNanos = m_statKernelNanos.load(std::memory_order_relaxed);
+	for (uint32_t i = 0; i < MCR_SPI_LATENCY_BUCKETS; i++) {
+		stats->latencyHistogram[i] = m_statLatency[i].load(std::memory_order_relaxed);
+	}
+	stats->retries = m_statRetries.load(std::memory_order_relaxed);
+	stats->resyncs = m_statResyncs.load(std::memory_order_relaxed);
+	stats->reopens = m_statReopens.load(std::memory_order_relaxed);
+	stats->unrecoveredErrors = m_statUnrecoveredErrors.load(std::memory_order_relaxed);
+	stats->clockDownshifts = m_clockDownshifts.load(std::memory_order_relaxed);
+	stats->clockUpshifts = m_clockUpshifts.load(std::memory_order_relaxed);
+}
+
+/**
+ * Reset the SPI transfer counters
+ */
+void MicroRngSPI::resetStats() {
+	m_statBytes.store(0, std::memory_order_relaxed);
+	m_statIoctls.store(0, std::memory_order_relaxed);
+	m_statCommandSwitches.store(0, std::memory_order_relaxed);
+	m_statErrors.store(0, std::memory_order_relaxed);
+	m_statKernelNanos.store(0, std::memory_order_relaxed);
+	for (uint32_t i = 0; i < MCR_SPI_LATENCY_BUCKETS; i++) {
+		m_statLatency[i].store(0, std::memory_order_relaxed);
+	}
+	m_statRetries.store(0, std::memory_order_relaxed);
+	m_statResyncs.store(0, std::memory_order_relaxed);
+	m_statReopens.store(0, std::memory_order_relaxed);
+	m_statUnrecoveredErrors.store(0, std::memory_order_relaxed);
+	m_clockDownshifts.store(0, std::memory_order_relaxed);
+	m_clockUpshifts.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * Enable or disable the SPI_IOC_MESSAGE latency histogram, disabled by default
+ *
+ * @param enabled true to collect latencies
+ */
+void MicroRngSPI::setLatencyHistogramEnabled(bool enabled) {
+	m_isLatencyHistogramEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+/**
+ * Check the communication at the current clock frequency in adaptive clock mode and adjust the frequency.
+ * Drops the clock one step when the check fails, probes one step higher after enough successful checks.
+ *
+ * @param isClockStable pointer to receiving true when the check passed
+ *
+ * @return false if the check failed at the lowest clock frequency
+ */
+bool MicroRngSPI::checkAdaptiveClock(bool *isClockStable) {
+	m_bytesSinceCheck = 0;
+	*isClockStable = validateCommunication(MCR_SPI_ADAPTIVE_CHECK_BYTES);
+	if (!*isClockStable) {
+		m_passedChecks = 0;
+		if (m_isProbing && m_probeBackoff < MCR_SPI_ADAPTIVE_MAX_PROBE_BACKOFF) {
+			// The probed frequency didn't hold, wait longer before probing it again
+			m_probeBackoff *= 2;
+		}
+		m_isProbing = false;
+		uint32_t clockHz = m_clockHz.load(std::memory_order_relaxed);
+		if (clockHz <= m_minClockHz) {
+			return false;
+		}
+		m_clockHz.store(clockHz - m_minClockHz < m_minClockHz ? m_minClockHz : clockHz - m_minClockHz,
+				std::memory_order_relaxed);
+		m_clockDownshifts.fetch_add(1, std::memory_order_relaxed);
+		// Verify the bytes retrieved again at the lower frequency
+		m_bytesSinceCheck = m_adaptiveCheckIntervalBytes;
+		return true;
+	}
+
+	if (m_isProbing) {
+		m_isProbing = false;
+		m_probeBackoff = 1;
+	}
+	uint32_t clockHz = m_clockHz.load(std::memory_order_relaxed);
+	if (++m_passedChecks >= m_adaptiveStableChecks * m_probeBackoff && clockHz < m_clockCeilingHz) {
+		m_passedChecks = 0;
+		m_isProbing = true;
+		m_clockHz.store(m_clockCeilingHz - clockHz < m_minClockHz ? m_clockCeilingHz : clockHz + m_minClockHz,
+				std::memory_order_relaxed);
+		m_clockUpshifts.fetch_add(1, std::memory_order_relaxed);
+		// Verify the probed frequency right after the next retrieval
+		m_bytesSinceCheck = m_adaptiveCheckIntervalBytes;
+	}
+	return true;
+}
+
+/**
+ * Execute a batch command, checking the communication and adjusting the clock frequency when in adaptive clock mode.
+ * Bytes of this call retrieved before a failed check are retrieved again at the lower clock frequency,
+ * bytes returned by earlier calls since the last successful check are not, see setAdaptiveClock().
+ *
+ * @param cmd command to execute
+ * @param len how many bytes to retrieve
+ * @param rx pointer to receiving bytes
+ *
+ * @return true if successful
+ */
+bool MicroRngSPI::executeAdaptiveCommand(char cmd, int len, uint8_t *rx) {
+	if (!m_adaptiveClock) {
+		return executeBatchCommand(cmd, len, rx);
+	}
+
+	bool isClockStable = false;
+	while (!isClockStable) {
+		if (!executeBatchCommand(cmd, len, rx)) {
+			return false;
+		}
+		m_bytesSinceCheck += (uint32_t) len;
+		if (m_bytesSinceCheck < m_adaptiveCheckIntervalBytes) {
+			return true;
+		}
+		if (!checkAdaptiveClock(&isClockStable)) {
+			// Not a failed SPI message, retrying the chunk would not help
+			m_isTransferFailed = false;
+			setErrMsg("Could not validate SPI communication at the lowest clock frequency");
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Configure how bulk data exchanges are split into SPI transfer segments.
+ * Segments submitted with the same system call follow the current clock frequency and word size.
+ *
+ * @param segmentBytes max amount of bytes per transfer segment, 0 selects one segment per SPI message
+ * @param csChange true to deselect the device between segments of the same SPI message
+ * @param delayUsecs delay in microseconds after each segment before the next one starts
+ *
+ */
+void MicroRngSPI::setTransferSegmentation(uint32_t segmentBytes, bool csChange, uint16_t delayUsecs) {
+	this->m_segmentBytes = segmentBytes == 0 ? UINT32_MAX : segmentBytes;
+	this->m_segmentCsChange = csChange ? 1 : 0;
+	this->m_segmentDelayUsecs = delayUsecs;
+}
+
+/**
+ * Get max amount of bytes exchanged with a single SPI message (system call)
+ *
+ * @return max amount of bytes per SPI message
+ *
+ */
+uint32_t MicroRngSPI::getMaxMessageBytes() const {
+	return m_maxMessageBytes;
 }
 
 /**
@@ -492,7 +1552,8 @@ void MicroRngSPI::setMaxClockFrequency(uint32_t clockHz) {
  *
  */
 uint32_t MicroRngSPI::getMaxClockFrequency() const {
-	return m_clockHz;
+	// Read by statistics threads while adaptive clock mode adjusts it
+	return m_clockHz.load(std::memory_order_relaxed);
 }
 
 /**
@@ -514,7 +1575,10 @@ bool MicroRngSPI::disconnect() {
 	if (!isConnected()) {
 		return false;
 	}
-	close(m_fd);
+	if (m_fd != -1) {
+		close(m_fd);
+	}
+	free(m_txBuffer);
 	initialize();
 	return true;
 }
@@ -43,10 +43,120 @@
 #include <sys/ioctl.h>
 #include <linux/ioctl.h>
 #include <sys/stat.h>
+#include <errno.h>
 #include <linux/types.h>
 #include <linux/spi/spidev.h>
+#include <atomic>
+#include "MicroRngTransport.h"
 
-class MicroRngSPI {
+/**
+ * Default max amount of bytes exchanged with a single SPI transfer segment, matches the default spidev 'bufsiz' module parameter
+ */
+#define MCR_SPI_MAX_TRANSFER_BYTES (4096)
+
+/**
+ * Max amount of SPI transfer segments submitted with a single SPI_IOC_MESSAGE(n) system call
+ */
+#define MCR_SPI_MAX_SEGMENTS (256)
+
+/**
+ * Conservative DMA alignment the spidev driver applies to each segment when accounting for its 'bufsiz' limit
+ */
+#define MCR_SPI_SEGMENT_ALIGN (128)
+
+/**
+ * Default number of consecutive validations required at the detected max SPI clock frequency
+ */
+#define MCR_SPI_AUTODETECT_CONFIRM_PASSES (3)
+
+/**
+ * Max amount of test bytes exchanged when validating SPI communication
+ */
+#define MCR_SPI_VALIDATION_BYTES (2048)
+
+/**
+ * Amount of test bytes exchanged when re-validating a cached clock frequency
+ */
+#define MCR_SPI_QUICK_VALIDATION_BYTES (256)
+
+/**
+ * Amount of consecutive transfer IDs checked when probing for the device
+ */
+#define MCR_SPI_PROBE_BYTES (257)
+
+/**
+ * Default max number of times a failed chunk retrieval is repeated, and the bounds of the exponential backoff between attempts
+ */
+#define MCR_SPI_DEFAULT_MAX_RETRIES (5)
+#define MCR_SPI_DEFAULT_RETRY_BACKOFF_USECS (1000)
+#define MCR_SPI_MAX_RETRY_BACKOFF_USECS (100000)
+
+/**
+ * Amount of consecutive transfer IDs checked when resynchronizing after a failed exchange
+ */
+#define MCR_SPI_RESYNC_TEST_BYTES (16)
+
+/**
+ * Default directory of the clock frequency calibration cache
+ */
+#define MCR_SPI_CALIBRATION_CACHE_DIR "/var/cache/microrng"
+
+/**
+ * Size of a calibration cache file path buffer, fits the cache directory and the device name
+ */
+#define MCR_SPI_CALIBRATION_PATH_SIZE (600)
+
+/**
+ * Default amount of random bytes retrieved between two communication checks in adaptive clock mode.
+ * Bytes already returned by earlier calls when a check fails, up to this amount, are not verified again.
+ */
+#define MCR_SPI_ADAPTIVE_CHECK_INTERVAL_BYTES (4096)
+
+/**
+ * Default number of consecutive successful checks before probing a higher clock frequency in adaptive clock mode
+ */
+#define MCR_SPI_ADAPTIVE_STABLE_CHECKS (16)
+
+/**
+ * Max factor the required successful checks grow by after repeatedly failed probes in adaptive clock mode
+ */
+#define MCR_SPI_ADAPTIVE_MAX_PROBE_BACKOFF (64)
+
+/**
+ * Amount of test bytes exchanged with each communication check in adaptive clock mode
+ */
+#define MCR_SPI_ADAPTIVE_CHECK_BYTES (64)
+
+/**
+ * Number of ioctl latency histogram buckets, bucket 0 counts calls under 1 microsecond and
+ * bucket N counts calls between 2^(N-1) and 2^N microseconds, the last bucket counts all longer calls
+ */
+#define MCR_SPI_LATENCY_BUCKETS (24)
+
+/**
+ * Location of the spidev 'bufsiz' module parameter
+ */
+#define MCR_SPIDEV_BUFSIZ_PATH "/sys/module/spidev/parameters/bufsiz"
+
+/**
+ * Snapshot of SPI transfer counters, accumulated since the object was created or the counters were reset
+ */
+struct MicroRngSPIStats {
+	uint64_t bytesTransferred;		// bytes exchanged successfully, including command switch exchanges
+	uint64_t ioctls;			// SPI_IOC_MESSAGE system calls
+	uint64_t commandSwitches;		// extra exchanges sent because the command differs from the previous one
+	uint64_t errors;			// failed SPI_IOC_MESSAGE system calls
+	uint64_t kernelNanos;			// wall-clock time spent in SPI_IOC_MESSAGE system calls
+	uint64_t latencyHistogram[MCR_SPI_LATENCY_BUCKETS];	// SPI_IOC_MESSAGE latencies, when enabled
+	uint64_t retries;			// chunk retrievals repeated after a failed exchange
+	uint64_t resyncs;			// command pipelines resynchronized with the transfer ID sequence
+	uint64_t reopens;			// times the spidev device was reopened
+	uint64_t unrecoveredErrors;		// chunk retrievals failed after all retries
+	uint32_t clockDownshifts;		// adaptive clock mode frequency drops
+	uint32_t clockUpshifts;			// adaptive clock mode frequency probes
+};
+
+class MicroRngSPI : public MicroRngTransport {
 public:
 	MicroRngSPI();
 	MicroRngSPI(MicroRngSPI const&) = delete;
@@ -58,11 +168,16 @@ public:
 	bool isConnected() const;
 	bool connect(const char *devicePath);
 	bool validateDevice();
+	void setFastProbe(bool enabled);
+	void setDeferredValidation(bool enabled);
+	bool isValidationPending() const;
 	bool disconnect();
 	bool executeCommand(char cmd, uint8_t *rx);
 	const char* getLastErrMsg() const;
 	void setMaxClockFrequency(uint32_t clockHz);
 	uint32_t getMaxClockFrequency() const;
+	void setTransferSegmentation(uint32_t segmentBytes, bool csChange, uint16_t delayUsecs);
+	uint32_t getMaxMessageBytes() const;
 	bool retrieveRandomByte(uint8_t *rx);
 	bool retrieveRandomBytes(int len, uint8_t *rx);
 	bool retrieveRawRandomByte(uint8_t *rx);
@@ -74,22 +189,66 @@ public:
 	bool startUpNoiseSources(uint8_t *rx);
 	bool resetUART(uint8_t *rx);
 	bool validateCommunication();
+	bool validateCommunication(int numTestBytes);
 	bool autodetectMaxFrequency();
+	void setAutodetectParameters(uint32_t confirmationPasses, uint32_t safetyMarginPercent);
+	uint32_t getDetectedMaxClockFrequency() const;
+	void setCalibrationCacheDir(const char *cacheDir);
+	bool isClockFrequencyCalibrated() const;
+	bool calibrateClockFrequency();
+	bool loadCalibration();
+	bool saveCalibration();
+	void setAdaptiveClock(bool enabled, uint32_t checkIntervalBytes, uint32_t stableChecks);
+	void setErrorRecovery(uint32_t maxRetries, uint32_t backoffUsecs);
+	bool isAdaptiveClockEnabled() const;
+	uint32_t getClockDownshiftCount() const;
+	uint32_t getClockUpshiftCount() const;
+	void getStats(MicroRngSPIStats *stats) const;
+	void resetStats();
+	void setLatencyHistogramEnabled(bool enabled);
+	bool exchangeCommandSequence(const uint8_t *tx, int len, uint8_t *rx);
+	char getLastSentCommand() const;
 
 private:
 	void setErrMsg(const char *errMessage);
 	void clearErrMsg();
 	void initialize();
+	bool openDevice(const char *devicePath);
+	bool reopenDevice();
+	bool resyncDevice();
+	bool executeRecoverableCommand(char cmd, int len, uint8_t *rx);
+	uint32_t readSpidevBufferSize() const;
+	bool validateClockStep(uint32_t step, uint32_t passes);
+	void buildCalibrationPath(char *path, size_t pathSize) const;
+	void readBoardModel(char *model, size_t modelSize) const;
 	bool exhangeByte(char cmd, uint8_t *rx);
+	bool exchangeBytes(char cmd, int len, uint8_t *rx, uint8_t *primeRx);
+	bool exchangeMessages(const uint8_t *tx, bool isTxRepeated, int len, uint8_t *rx, uint8_t *primeRx);
+	bool transferMessage(uint32_t numSegments, struct spi_ioc_transfer *segments, uint32_t numBytes);
+	bool executeBatchCommand(char cmd, int len, uint8_t *rx);
+	bool executeAdaptiveCommand(char cmd, int len, uint8_t *rx);
+	bool checkAdaptiveClock(bool *isClockStable);
+	bool probeDevice();
+	bool runPendingValidation();
+	bool recalibrateAfterFailedProbe();
+	bool exchangeProbeWithChunk(char cmd, int len, uint8_t *rx, int *numServed);
 
 	int m_fd;
-	uint32_t m_clockHz;
+	std::atomic<uint32_t> m_clockHz;
 	uint32_t m_maxClockHz;
 	uint32_t m_minClockHz;
+	uint32_t m_clockCeilingHz;
+	uint32_t m_detectedMaxClockHz;
+	uint32_t m_autodetectConfirmPasses;
+	uint32_t m_autodetectMarginPercent;
 	char m_lastSentCommand;
 	uint32_t m_spiMode;
 	uint8_t m_spiBits;
 	bool m_deviceConnected;
+	bool m_clockCalibrated;
+	uint32_t m_cachedClockHz;
+	char m_devicePath[256];
+	char m_calibrationCacheDir[256];
 	char m_lastError[512];
 	char m_testCommand;
 	char m_randomByteCommand;
@@ -98,6 +257,40 @@ private:
 	char m_shutDownCommand;
 	char m_startUpCommand;
 	char m_resetUartSpeedCommand;
+	uint8_t *m_txBuffer;
+	uint32_t m_maxMessageBytes;
+	uint32_t m_segmentBytes;
+	uint8_t m_segmentCsChange;
+	uint16_t m_segmentDelayUsecs;
+	struct spi_ioc_transfer m_segments[MCR_SPI_MAX_SEGMENTS];
+	bool m_adaptiveClock;
+	uint32_t m_adaptiveCheckIntervalBytes;
+	uint32_t m_adaptiveStableChecks;
+	uint64_t m_bytesSinceCheck;
+	uint32_t m_passedChecks;
+	uint32_t m_probeBackoff;
+	bool m_isProbing;
+	std::atomic<uint32_t> m_clockDownshifts;
+	std::atomic<uint32_t> m_clockUpshifts;
+	bool m_isFastProbe;
+	bool m_isDeferredValidation;
+	bool m_isValidationPending;
+	bool m_isDeviceValidated;
+	int m_lastErrno;
+	bool m_isTransferFailed;
+	uint32_t m_maxRetries;
+	uint32_t m_retryBackoffUsecs;
+	std::atomic<uint64_t> m_statBytes;
+	std::atomic<uint64_t> m_statIoctls;
+	std::atomic<uint64_t> m_statCommandSwitches;
+	std::atomic<uint64_t> m_statErrors;
+	std::atomic<uint64_t> m_statKernelNanos;
+	std::atomic<uint64_t> m_statLatency[MCR_SPI_LATENCY_BUCKETS];
+	std::atomic<uint64_t> m_statRetries;
+	std::atomic<uint64_t> m_statResyncs;
+	std::atomic<uint64_t> m_statReopens;
+	std::atomic<uint64_t> m_statUnrecoveredErrors;
+	std::atomic<bool> m_isLatencyHistogramEnabled;
 
 };
 
@@ -0,0 +1,393 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngScheduler.cpp
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief queues typed MicroRNG requests from any number of threads and executes them with as few SPI exchanges as possible.
+ *
+ */
+#include "MicroRngScheduler.h"
+
+MicroRngScheduler::MicroRngScheduler(MicroRngSPI &device) :
+		m_device(device) {
+	m_queueHead = nullptr;
+	m_queueTail = nullptr;
+	m_isCombining = false;
+	m_txBuffer = nullptr;
+	m_rxBuffer = nullptr;
+	m_bufferSize = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+	memset(m_typeBytes, 0, sizeof(m_typeBytes));
+	strcpy(m_lastError, "");
+	pthread_mutex_init(&m_mutex, nullptr);
+	pthread_cond_init(&m_doneCond, nullptr);
+}
+
+/**
+ * Map a request type to the MicroRNG command byte
+ *
+ * @param type request type
+ *
+ * @return command byte
+ */
+char MicroRngScheduler::getCommand(McrRequestType type) {
+	switch (type) {
+	case MCR_REQUEST_RAW:
+		return 'r';
+	case MCR_REQUEST_STATUS:
+		return 's';
+	case MCR_REQUEST_TEST:
+		return 't';
+	default:
+		return 'l';
+	}
+}
+
+/**
+ * Queue a request without executing it. The request must stay valid until it is completed by perform()
+ * or by a thread calling execute().
+ *
+ * @param request pointer to the request
+ *
+ * @return false if the request is invalid
+ */
+bool MicroRngScheduler::submit(MicroRngRequest *request) {
+	if (request == nullptr || request->rx == nullptr || request->len == 0
+			|| request->type < MCR_REQUEST_RANDOM || request->type >= MCR_REQUEST_TYPES) {
+		return false;
+	}
+	request->isDone = false;
+	request->isSuccess = false;
+	request->next = nullptr;
+	pthread_mutex_lock(&m_mutex);
+	if (m_queueTail == nullptr) {
+		m_queueHead = request;
+	} else {
+		m_queueTail->next = request;
+	}
+	m_queueTail = request;
+	pthread_mutex_unlock(&m_mutex);
+	return true;
+}
+
+/**
+ * Execute all queued requests, waiting first if another thread is executing requests
+ *
+ * @return true if all requests executed by this call succeeded
+ */
+bool MicroRngScheduler::perform() {
+	MicroRngRequest *requests;
+	bool isSuccess = true;
+
+	pthread_mutex_lock(&m_mutex);
+	while (m_isCombining) {
+		pthread_cond_wait(&m_doneCond, &m_mutex);
+	}
+	m_isCombining = true;
+	while (takeQueue(&requests)) {
+		pthread_mutex_unlock(&m_mutex);
+		isSuccess = executeBatch(requests) && isSuccess;
+		pthread_mutex_lock(&m_mutex);
+	}
+	m_isCombining = false;
+	pthread_cond_broadcast(&m_doneCond);
+	pthread_mutex_unlock(&m_mutex);
+	return isSuccess;
+}
+
+/**
+ * Execute a request, together with the requests other threads queued meanwhile
+ *
+ * @param type request type
+ * @param len how many response bytes to retrieve
+ * @param rx pointer to receiving response bytes
+ *
+ * @return true if successful
+ */
+bool MicroRngScheduler::execute(McrRequestType type, uint32_t len, uint8_t *rx) {
+	MicroRngRequest request = { type, len, rx, false, false, nullptr };
+	MicroRngRequest *requests;
+
+	if (!submit(&request)) {
+		sprintf(m_lastError, "Invalid request");
+		return false;
+	}
+	pthread_mutex_lock(&m_mutex);
+	while (!request.isDone) {
+		if (m_isCombining) {
+			// Another thread is exchanging, it may pick this request up with its next batch
+			pthread_cond_wait(&m_doneCond, &m_mutex);
+			continue;
+		}
+		m_isCombining = true;
+		if (takeQueue(&requests)) {
+			pthread_mutex_unlock(&m_mutex);
+			executeBatch(requests);
+			pthread_mutex_lock(&m_mutex);
+		}
+		m_isCombining = false;
+		pthread_cond_broadcast(&m_doneCond);
+	}
+	pthread_mutex_unlock(&m_mutex);
+	return request.isSuccess;
+}
+
+/**
+ * Retrieve a snapshot of the scheduler counters
+ *
+ * @param stats pointer to receiving counters
+ */
+void MicroRngScheduler::getStats(MicroRngSchedulerStats *stats) {
+	pthread_mutex_lock(&m_mutex);
+	*stats = m_stats;
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/**
+ * Retrieve the last error message.
+ *
+ * @return last error message
+ */
+const char* MicroRngScheduler::getLastErrMsg() const {
+	return m_lastError;
+}
+
+/**
+ * Detach all queued requests, must be called with the mutex locked
+ *
+ * @param requests pointer to receiving the first detached request
+ *
+ * @return false if the queue is empty
+ */
+bool MicroRngScheduler::takeQueue(MicroRngRequest **requests) {
+	*requests = m_queueHead;
+	m_queueHead = nullptr;
+	m_queueTail = nullptr;
+	return *requests != nullptr;
+}
+
+/**
+ * Group requests by type and exchange them with command sequences of up to MCR_SCHED_MAX_BATCH_BYTES
+ *
+ * @param requests pointer to the first detached request
+ *
+ * @return true if successful
+ */
+bool MicroRngScheduler::executeBatch(MicroRngRequest *requests) {
+	MicroRngRequest *groupHead[MCR_REQUEST_TYPES] = { };
+	MicroRngRequest *groupTail[MCR_REQUEST_TYPES] = { };
+	McrRequestType groupOrder[MCR_REQUEST_TYPES];
+	uint32_t numGroups = 0;
+
+	// Keep the submission order within each type and the order types first appeared in
+	MicroRngRequest *request = requests;
+	while (request != nullptr) {
+		MicroRngRequest *next = request->next;
+		request->next = nullptr;
+		if (groupHead[request->type] == nullptr) {
+			groupHead[request->type] = request;
+			groupOrder[numGroups++] = request->type;
+		} else {
+			groupTail[request->type]->next = request;
+		}
+		groupTail[request->type] = request;
+		request = next;
+	}
+
+	// Start with the type of the command sent last, its response is already on the way
+	for (uint32_t i = 1; i < numGroups; i++) {
+		if (getCommand(groupOrder[i]) == m_device.getLastSentCommand()) {
+			McrRequestType first = groupOrder[i];
+			memmove(&groupOrder[1], &groupOrder[0], i * sizeof(McrRequestType));
+			groupOrder[0] = first;
+			break;
+		}
+	}
+
+	// Chain the groups into one list and exchange it in runs that fit a command sequence
+	MicroRngRequest *head = nullptr;
+	MicroRngRequest *tail = nullptr;
+	for (uint32_t i = 0; i < numGroups; i++) {
+		if (head == nullptr) {
+			head = groupHead[groupOrder[i]];
+		} else {
+			tail->next = groupHead[groupOrder[i]];
+		}
+		tail = groupTail[groupOrder[i]];
+	}
+
+	bool isSuccess = true;
+	while (head != nullptr) {
+		MicroRngRequest *runTail = head;
+		uint64_t runBytes = head->len;
+		while (runTail->next != nullptr && runBytes + runTail->next->len <= MCR_SCHED_MAX_BATCH_BYTES) {
+			runTail = runTail->next;
+			runBytes += runTail->len;
+		}
+		MicroRngRequest *nextRun = runTail->next;
+		runTail->next = nullptr;
+		bool isRunSuccess = exchangeGroups(head, (uint32_t) runBytes);
+		completeRequests(head, isRunSuccess);
+		isSuccess = isSuccess && isRunSuccess;
+		head = nextRun;
+	}
+	return isSuccess;
+}
+
+/**
+ * Exchange a run of requests with a single command sequence. The response to command byte N is received
+ * with byte N + 1, so each request's command bytes are sent one byte ahead of its responses. The response
+ * to the last command byte is received by the next run, used when the next run starts with the same type.
+ *
+ * @param requests pointer to the first request of the run, requests are linked in exchange order
+ * @param numBytes total amount of response bytes requested by the run
+ *
+ * @return true if successful
+ */
+bool MicroRngScheduler::exchangeGroups(MicroRngRequest *requests, uint32_t numBytes) {
+	MicroRngRequest *first = requests;
+	bool isResponseReused = getCommand(first->type) == m_device.getLastSentCommand();
+	uint32_t offset = isResponseReused ? 0 : 1;
+	uint32_t sequenceBytes = numBytes + offset;
+
+	if (!ensureBuffers(sequenceBytes)) {
+		return false;
+	}
+
+	uint32_t pos = offset;
+	uint64_t transitions = 0;
+	char lastCommand = '\0';
+	for (MicroRngRequest *request = first; request != nullptr; request = request->next) {
+		char cmd = getCommand(request->type);
+		// Responses for this request land at [pos, pos + len), sent one byte earlier
+		uint32_t txStart = pos == 0 ? 0 : pos - 1;
+		memset(m_txBuffer + txStart, cmd, pos + request->len - 1 - txStart);
+		if (lastCommand != '\0' && cmd != lastCommand) {
+			transitions++;
+		}
+		lastCommand = cmd;
+		pos += request->len;
+		m_typeBytes[request->type] += request->len;
+	}
+	m_txBuffer[sequenceBytes - 1] = (uint8_t) predictNextCommand(lastCommand);
+
+	if (!m_device.exchangeCommandSequence(m_txBuffer, (int) sequenceBytes, m_rxBuffer)) {
+		sprintf(m_lastError, "%s", m_device.getLastErrMsg());
+		return false;
+	}
+
+	pos = offset;
+	for (MicroRngRequest *request = first; request != nullptr; request = request->next) {
+		memcpy(request->rx, m_rxBuffer + pos, request->len);
+		pos += request->len;
+	}
+
+	pthread_mutex_lock(&m_mutex);
+	m_stats.batches++;
+	m_stats.bytesRequested += numBytes;
+	m_stats.bytesExchanged += sequenceBytes;
+	m_stats.commandTransitions += transitions;
+	if (isResponseReused) {
+		m_stats.reusedResponses++;
+	}
+	pthread_mutex_unlock(&m_mutex);
+	return true;
+}
+
+/**
+ * Pick the command most likely needed by the next run, the one of the type requested the most bytes so far
+ *
+ * @param lastCommand command of the last request in the current run, used when no type dominates
+ *
+ * @return command byte
+ */
+char MicroRngScheduler::predictNextCommand(char lastCommand) const {
+	char command = lastCommand;
+	uint64_t maxBytes = 0;
+	for (int type = MCR_REQUEST_RANDOM; type < MCR_REQUEST_TYPES; type++) {
+		if (m_typeBytes[type] > maxBytes) {
+			maxBytes = m_typeBytes[type];
+			command = getCommand((McrRequestType) type);
+		}
+	}
+	return command;
+}
+
+/**
+ * Make sure the command and response buffers can hold the requested amount of bytes
+ *
+ * @param numBytes required buffer size
+ *
+ * @return true if successful
+ */
+bool MicroRngScheduler::ensureBuffers(uint32_t numBytes) {
+	if (m_bufferSize >= numBytes) {
+		return true;
+	}
+	uint8_t *txBuffer = (uint8_t*) realloc(m_txBuffer, numBytes);
+	if (txBuffer != nullptr) {
+		m_txBuffer = txBuffer;
+	}
+	uint8_t *rxBuffer = (uint8_t*) realloc(m_rxBuffer, numBytes);
+	if (rxBuffer != nullptr) {
+		m_rxBuffer = rxBuffer;
+	}
+	if (txBuffer == nullptr || rxBuffer == nullptr) {
+		sprintf(m_lastError, "Could not allocate %u bytes for command sequence", numBytes);
+		return false;
+	}
+	m_bufferSize = numBytes;
+	return true;
+}
+
+/**
+ * Mark a run of requests as completed and wake up the threads waiting for them
+ *
+ * @param requests pointer to the first request of the run
+ * @param isSuccess true if the requests were executed successfully
+ */
+void MicroRngScheduler::completeRequests(MicroRngRequest *requests, bool isSuccess) {
+	pthread_mutex_lock(&m_mutex);
+	while (requests != nullptr) {
+		// A completed request may be released by its owner right away
+		MicroRngRequest *next = requests->next;
+		requests->isSuccess = isSuccess;
+		requests->isDone = true;
+		if (isSuccess) {
+			m_stats.requests++;
+		}
+		requests = next;
+	}
+	pthread_cond_broadcast(&m_doneCond);
+	pthread_mutex_unlock(&m_mutex);
+}
+
+MicroRngScheduler::~MicroRngScheduler() {
+	free(m_txBuffer);
+	free(m_rxBuffer);
+	pthread_cond_destroy(&m_doneCond);
+	pthread_mutex_destroy(&m_mutex);
+}
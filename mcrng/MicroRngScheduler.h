@@ -0,0 +1,133 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngScheduler.h
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief queues typed MicroRNG requests from any number of threads and executes them with as few SPI exchanges as possible.
+ *
+ *    Each byte exchanged with MicroRNG returns the response to the previously sent command byte, so requests
+ *    of different types can share one command sequence without the extra exchange MicroRngSPI::executeCommand()
+ *    spends on every command switch. Queued requests are grouped by type, the group matching the command sent
+ *    last goes first so the response already in flight is used instead of discarded. The last command byte of
+ *    a sequence is the command of the type requested the most so far, so the response it puts in flight is
+ *    likely used by the next sequence. A single command sequence costs at most one byte more than the bytes requested.
+ *
+ *    Threads calling execute() combine: the first one to find the device idle executes the requests queued
+ *    by all threads meanwhile, the others wait for their request to complete.
+ *
+ *    The scheduler bypasses MicroRngSPI adaptive clock mode, don't use the device directly while a
+ *    scheduler executes requests.
+ *
+ *    Usage:
+ *        MicroRngScheduler scheduler(spi);
+ *        uint8_t status;
+ *        bool success = scheduler.execute(MCR_REQUEST_STATUS, 1, &status);
+ */
+#ifndef MICRORNGSCHEDULER_H
+#define MICRORNGSCHEDULER_H
+
+#include "MicroRngSPI.h"
+#include <pthread.h>
+
+/**
+ * Max amount of bytes exchanged with one command sequence, larger batches are split
+ */
+#define MCR_SCHED_MAX_BATCH_BYTES (1048576)
+
+/**
+ * Types of MicroRNG requests
+ */
+enum McrRequestType {
+	MCR_REQUEST_RANDOM,	// random bytes, MicroRNG command 'l'
+	MCR_REQUEST_RAW,	// raw random bytes, MicroRNG command 'r'
+	MCR_REQUEST_STATUS,	// device status byte, MicroRNG command 's'
+	MCR_REQUEST_TEST,	// transfer ID test bytes, MicroRNG command 't'
+	MCR_REQUEST_TYPES
+};
+
+/**
+ * A MicroRNG request, owned by the caller until completed
+ */
+struct MicroRngRequest {
+	McrRequestType type;
+	uint32_t len;
+	uint8_t *rx;
+	bool isDone;
+	bool isSuccess;
+	MicroRngRequest *next;
+};
+
+/**
+ * Counters of executed requests
+ */
+struct MicroRngSchedulerStats {
+	uint64_t requests;		// completed requests
+	uint64_t batches;		// command sequences exchanged
+	uint64_t bytesRequested;	// bytes delivered to requests
+	uint64_t bytesExchanged;	// bytes exchanged with the device
+	uint64_t commandTransitions;	// command changes within command sequences
+	uint64_t reusedResponses;	// in-flight responses used instead of discarded
+};
+
+class MicroRngScheduler {
+public:
+	explicit MicroRngScheduler(MicroRngSPI &device);
+	MicroRngScheduler(MicroRngScheduler const&) = delete;
+	MicroRngScheduler(MicroRngScheduler&&) = delete;
+	MicroRngScheduler& operator=(MicroRngScheduler const&) = delete;
+	MicroRngScheduler& operator=(MicroRngScheduler&&) = delete;
+	virtual ~MicroRngScheduler();
+
+	bool submit(MicroRngRequest *request);
+	bool perform();
+	bool execute(McrRequestType type, uint32_t len, uint8_t *rx);
+	void getStats(MicroRngSchedulerStats *stats);
+	const char* getLastErrMsg() const;
+
+private:
+	static char getCommand(McrRequestType type);
+	bool takeQueue(MicroRngRequest **requests);
+	bool executeBatch(MicroRngRequest *requests);
+	bool exchangeGroups(MicroRngRequest *requests, uint32_t numBytes);
+	bool ensureBuffers(uint32_t numBytes);
+	char predictNextCommand(char lastCommand) const;
+	void completeRequests(MicroRngRequest *requests, bool isSuccess);
+
+	MicroRngSPI &m_device;
+	MicroRngRequest *m_queueHead;
+	MicroRngRequest *m_queueTail;
+	bool m_isCombining;
+	uint8_t *m_txBuffer;
+	uint8_t *m_rxBuffer;
+	uint32_t m_bufferSize;
+	MicroRngSchedulerStats m_stats;
+	uint64_t m_typeBytes[MCR_REQUEST_TYPES];
+	char m_lastError[512];
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_doneCond;
+};
+
+#endif // MICRORNGSCHEDULER_H
@@ -0,0 +1,229 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngShm.h
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief shared-memory ring of MicroRNG random bytes filled by 'mcrngshm' server and consumed by local processes.
+ *
+ *    The server is the only producer. Any number of consumer processes may fetch bytes concurrently:
+ *    a consumer copies the bytes it wants first and then claims them with a single compare-and-swap
+ *    of the shared read position. The claim only succeeds when no other consumer took those bytes meanwhile,
+ *    and the producer never overwrites bytes that have not been claimed, so each random byte is handed out once.
+ *    The server zeroes claimed bytes in the ring shortly after the claim, before refilling that space.
+ *    Fetching bytes doesn't need any system calls. Link consumers with -lrt.
+ *
+ *    Every process able to map the segment is trusted with all the data in the ring: it can read the
+ *    bytes not claimed yet, and the bytes other consumers claim until the server wipes them.
+ *    Restrict the segment permissions to the processes that share that trust.
+ *
+ *    Usage:
+ *        MicroRngShmClient client;
+ *        if (client.open(MCR_SHM_DEFAULT_NAME)) {
+ *            uint8_t key[32];
+ *            bool success = client.fetch(key, sizeof(key));
+ *        }
+ */
+#ifndef MICRORNGSHM_H
+#define MICRORNGSHM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <atomic>
+
+#define MCR_SHM_DEFAULT_NAME "/microrng"
+#define MCR_SHM_MAGIC (0x4d524e47)
+#define MCR_SHM_VERSION (1)
+#define MCR_SHM_CACHE_LINE (64)
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared ring requires lock-free 64 bit atomics");
+
+/**
+ * Layout of the shared-memory segment header, the ring data follows the header
+ */
+struct MicroRngShmHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t capacity;		// ring data size in bytes, always a power of two
+	uint64_t dataOffset;		// offset of the ring data from the beginning of the segment
+	std::atomic<uint32_t> serverActive;	// cleared when the server stops filling the ring
+	alignas(MCR_SHM_CACHE_LINE) std::atomic<uint64_t> writePos;	// total bytes published by the server
+	alignas(MCR_SHM_CACHE_LINE) std::atomic<uint64_t> readPos;	// total bytes claimed by consumers
+};
+
+/**
+ * Consumer side of the shared-memory ring
+ */
+class MicroRngShmClient {
+public:
+	MicroRngShmClient() :
+			m_header(nullptr), m_data(nullptr), m_mask(0), m_mappedSize(0) {
+	}
+	MicroRngShmClient(MicroRngShmClient const&) = delete;
+	MicroRngShmClient& operator=(MicroRngShmClient const&) = delete;
+	virtual ~MicroRngShmClient() {
+		close();
+	}
+
+	/**
+	 * Map the shared-memory segment created by the server
+	 *
+	 * @param shmName name of the shared-memory segment
+	 *
+	 * @return true if the segment is mapped successfully
+	 */
+	bool open(const char *shmName) {
+		close();
+		int fd = shm_open(shmName, O_RDWR, 0);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat shmStat;
+		if (fstat(fd, &shmStat) != 0 || (size_t) shmStat.st_size < sizeof(MicroRngShmHeader)) {
+			::close(fd);
+			return false;
+		}
+		void *addr = mmap(nullptr, shmStat.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (addr == MAP_FAILED) {
+			return false;
+		}
+		MicroRngShmHeader *header = (MicroRngShmHeader*) addr;
+		if (header->magic != MCR_SHM_MAGIC || header->version != MCR_SHM_VERSION
+				|| header->dataOffset + header->capacity > (uint64_t) shmStat.st_size) {
+			munmap(addr, shmStat.st_size);
+			return false;
+		}
+		m_header = header;
+		m_data = (const uint8_t*) addr + header->dataOffset;
+		m_mask = header->capacity - 1;
+		m_mappedSize = shmStat.st_size;
+		return true;
+	}
+
+	/**
+	 * Unmap the shared-memory segment
+	 */
+	void close() {
+		if (m_header != nullptr) {
+			munmap(m_header, m_mappedSize);
+			m_header = nullptr;
+			m_data = nullptr;
+		}
+	}
+
+	/**
+	 * Fetch random bytes from the ring without blocking
+	 *
+	 * @param buffer pointer to receiving random bytes
+	 * @param len how many random bytes to fetch
+	 *
+	 * @return true if all bytes fetched, false when the ring doesn't hold enough bytes
+	 */
+	bool fetch(uint8_t *buffer, size_t len) {
+		if (m_header == nullptr || len > m_header->capacity) {
+			return false;
+		}
+		uint64_t readPos = m_header->readPos.load(std::memory_order_acquire);
+		while (true) {
+			uint64_t writePos = m_header->writePos.load(std::memory_order_acquire);
+			if (writePos - readPos < len) {
+				return false;
+			}
+			copyOut(readPos, buffer, len);
+			if (m_header->readPos.compare_exchange_weak(readPos, readPos + len,
+					std::memory_order_acq_rel, std::memory_order_acquire)) {
+				return true;
+			}
+			// Another consumer claimed these bytes first, readPos holds the new position
+		}
+	}
+
+	/**
+	 * Fetch random bytes from the ring, waiting for the server to publish more bytes when needed
+	 *
+	 * @param buffer pointer to receiving random bytes
+	 * @param len how many random bytes to fetch
+	 * @param timeoutMs max wait time in milliseconds
+	 *
+	 * @return true if all bytes fetched before the timeout expired
+	 */
+	bool fetchWait(uint8_t *buffer, size_t len, uint32_t timeoutMs) {
+		struct timespec pause = { 0, 100000 };
+		for (uint64_t waitedUs = 0; waitedUs <= (uint64_t) timeoutMs * 1000; waitedUs += 100) {
+			if (fetch(buffer, len)) {
+				return true;
+			}
+			if (!isServerActive()) {
+				return false;
+			}
+			nanosleep(&pause, nullptr);
+		}
+		return false;
+	}
+
+	/**
+	 * @return amount of random bytes currently available in the ring
+	 */
+	uint64_t getAvailableBytes() const {
+		if (m_header == nullptr) {
+			return 0;
+		}
+		uint64_t readPos = m_header->readPos.load(std::memory_order_acquire);
+		return m_header->writePos.load(std::memory_order_acquire) - readPos;
+	}
+
+	/**
+	 * @return true if the server is still filling the ring, re-open the segment when the server has been restarted
+	 */
+	bool isServerActive() const {
+		return m_header != nullptr && m_header->serverActive.load(std::memory_order_acquire) != 0;
+	}
+
+private:
+	void copyOut(uint64_t pos, uint8_t *buffer, size_t len) const {
+		size_t offset = (size_t) (pos & m_mask);
+		size_t firstPart = (size_t) m_header->capacity - offset;
+		if (firstPart >= len) {
+			memcpy(buffer, m_data + offset, len);
+		} else {
+			memcpy(buffer, m_data + offset, firstPart);
+			memcpy(buffer + firstPart, m_data, len - firstPart);
+		}
+	}
+
+	MicroRngShmHeader *m_header;
+	const uint8_t *m_data;
+	uint64_t m_mask;
+	size_t m_mappedSize;
+};
+
+#endif // MICRORNGSHM_H
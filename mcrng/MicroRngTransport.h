@@ -0,0 +1,66 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngTransport.h
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief interface of the MicroRNG device transports, implemented by MicroRngSPI and MicroRngUART.
+ *
+ *    Code written against MicroRngTransport works with a device connected through either interface,
+ *    clock calibration and other interface specific settings stay with the implementing classes.
+ *
+ *    Usage:
+ *        MicroRngTransport *device = isUart ? (MicroRngTransport*) &uart : &spi;
+ *        bool success = device->retrieveRandomBytes(len, buffer);
+ */
+#ifndef MICRORNGTRANSPORT_H
+#define MICRORNGTRANSPORT_H
+
+#include <stdint.h>
+
+class MicroRngTransport {
+public:
+	virtual ~MicroRngTransport() {
+	}
+
+	virtual bool isConnected() const = 0;
+	virtual bool connect(const char *devicePath) = 0;
+	virtual bool validateDevice() = 0;
+	virtual bool disconnect() = 0;
+	virtual const char* getLastErrMsg() const = 0;
+	virtual bool retrieveRandomByte(uint8_t *rx) = 0;
+	virtual bool retrieveRandomBytes(int len, uint8_t *rx) = 0;
+	virtual bool retrieveRawRandomByte(uint8_t *rx) = 0;
+	virtual bool retrieveRawRandomBytes(int len, uint8_t *rx) = 0;
+	virtual bool retrieveTestByte(uint8_t *rx) = 0;
+	virtual bool retrieveTestBytes(int len, uint8_t *rx) = 0;
+	virtual bool retrieveDeviceStatusByte(uint8_t *rx) = 0;
+	virtual bool shutDownNoiseSources(uint8_t *rx) = 0;
+	virtual bool startUpNoiseSources(uint8_t *rx) = 0;
+	virtual bool resetUART(uint8_t *rx) = 0;
+	virtual bool validateCommunication() = 0;
+};
+
+#endif // MICRORNGTRANSPORT_H
@@ -0,0 +1,479 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngUART.cpp
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief communicates with MicroRNG device through the 2-wire UART interface on Raspberry PI 3+ or other Linux-based single-board computers.
+ *
+ */
+#include "MicroRngUART.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+
+/**
+ * Max amount of command bytes passed to a single write() call
+ */
+#define MCR_UART_MAX_WRITE_BYTES (4096)
+
+MicroRngUART::MicroRngUART() {
+	m_fd = -1;
+	m_deviceConnected = false;
+	m_baudRate = MCR_UART_DEFAULT_BAUD_RATE;
+	m_windowBytes = MCR_UART_DEFAULT_WINDOW_BYTES;
+	memset(&m_stats, 0, sizeof(m_stats));
+	strcpy(m_lastError, "");
+}
+
+/**
+ * Check if connection to the serial port is established
+ *
+ * @return true if connected
+ */
+bool MicroRngUART::isConnected() const {
+	return m_deviceConnected;
+}
+
+/**
+ * Connect to MicroRNG using a serial port
+ *
+ * @param devicePath complete path to the serial port, for example /dev/serial0
+ *
+ * @return true if connected successfully
+ */
+bool MicroRngUART::connect(const char *devicePath) {
+	if (isConnected()) {
+		return false;
+	}
+	strcpy(m_lastError, "");
+
+	m_fd = open(devicePath, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (m_fd < 0) {
+		sprintf(m_lastError, "Could not open serial port: %s", devicePath);
+		return false;
+	}
+	if (!configurePort()) {
+		close(m_fd);
+		m_fd = -1;
+		return false;
+	}
+	// Drop whatever the device sent before the port was configured
+	tcflush(m_fd, TCIOFLUSH);
+	m_deviceConnected = true;
+	return true;
+}
+
+/**
+ * Validate the connected device by retrieving transfer IDs, each one is expected to be incremented by one.
+ *
+ * @return true when MicroRNG device is detected
+ */
+bool MicroRngUART::validateDevice() {
+	if (!isConnected()) {
+		return false;
+	}
+	uint8_t testBuffer[257];
+	if (!retrieveTestBytes(sizeof(testBuffer), testBuffer)) {
+		return false;
+	}
+	for (uint32_t i = 1; i < sizeof(testBuffer); i++) {
+		if (testBuffer[i] != (uint8_t) (testBuffer[i - 1] + 1)) {
+			sprintf(m_lastError, "MicroRNG device not found");
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Disconnect from the serial port
+ *
+ * @return true if disconnected successfully
+ */
+bool MicroRngUART::disconnect() {
+	if (!isConnected()) {
+		return false;
+	}
+	close(m_fd);
+	m_fd = -1;
+	m_deviceConnected = false;
+	return true;
+}
+
+/**
+ * Retrieves a pointer to the internally saved error message
+ */
+const char* MicroRngUART::getLastErrMsg() const {
+	return m_lastError;
+}
+
+/**
+ * Set the baud rate of the serial port, it has to match the baud rate the device is configured for.
+ * Applied right away when connected.
+ *
+ * @param baudRate baud rate, max MCR_UART_MAX_BAUD_RATE
+ *
+ * @return true if the baud rate is supported
+ */
+bool MicroRngUART::setBaudRate(uint32_t baudRate) {
+	speed_t speed;
+	if (baudRate > MCR_UART_MAX_BAUD_RATE || !getSpeed(baudRate, &speed)) {
+		sprintf(m_lastError, "Unsupported baud rate: %u", baudRate);
+		return false;
+	}
+	m_baudRate = baudRate;
+	if (isConnected()) {
+		return configurePort();
+	}
+	return true;
+}
+
+/**
+ * @return baud rate of the serial port
+ */
+uint32_t MicroRngUART::getBaudRate() const {
+	return m_baudRate;
+}
+
+/**
+ * Set how many command bytes may be sent ahead of the received responses. A larger window hides the latency
+ * of the serial driver, but the device has to hold the commands not answered yet.
+ *
+ * @param windowBytes amount of command bytes, between 1 and MCR_UART_MAX_WINDOW_BYTES
+ *
+ * @return true if set successfully
+ */
+bool MicroRngUART::setTransferWindow(uint32_t windowBytes) {
+	if (windowBytes == 0 || windowBytes > MCR_UART_MAX_WINDOW_BYTES) {
+		sprintf(m_lastError, "Transfer window must be between 1 and %d bytes", MCR_UART_MAX_WINDOW_BYTES);
+		return false;
+	}
+	m_windowBytes = windowBytes;
+	return true;
+}
+
+/**
+ * Retrieve a random byte
+ *
+ * @param rx pointer to receiving random byte
+ *
+ * @return true when random byte successfully retrieved
+ */
+bool MicroRngUART::retrieveRandomByte(uint8_t *rx) {
+	return retrieveRandomBytes(1, rx);
+}
+
+/**
+ * Retrieve a sequence of random bytes
+ *
+ * @param len number of random bytes to retrieve
+ * @param rx pointer to receiving random bytes
+ *
+ * @return true when random bytes successfully retrieved
+ */
+bool MicroRngUART::retrieveRandomBytes(int len, uint8_t *rx) {
+	return exchangeBytes('l', len, rx);
+}
+
+/**
+ * Retrieve a raw (unprocessed) random byte
+ *
+ * @param rx pointer to receiving raw random byte
+ *
+ * @return true when raw random byte successfully retrieved
+ */
+bool MicroRngUART::retrieveRawRandomByte(uint8_t *rx) {
+	return retrieveRawRandomBytes(1, rx);
+}
+
+/**
+ * Retrieve a sequence of raw (unprocessed) random bytes
+ *
+ * @param len number of raw random bytes to retrieve
+ * @param rx pointer to receiving raw random bytes
+ *
+ * @return true when raw random bytes successfully retrieved
+ */
+bool MicroRngUART::retrieveRawRandomBytes(int len, uint8_t *rx) {
+	return exchangeBytes('r', len, rx);
+}
+
+/**
+ * Retrieve the internal transfer ID which is incremented with each transfer
+ *
+ * @param rx pointer to receiving transfer ID
+ *
+ * @return true when transfer ID successfully retrieved
+ */
+bool MicroRngUART::retrieveTestByte(uint8_t *rx) {
+	return retrieveTestBytes(1, rx);
+}
+
+/**
+ * Retrieve a sequence of transfer IDs
+ *
+ * @param len number of transfer IDs to retrieve
+ * @param rx pointer to receiving transfer IDs
+ *
+ * @return true when transfer IDs successfully retrieved
+ */
+bool MicroRngUART::retrieveTestBytes(int len, uint8_t *rx) {
+	return exchangeBytes('t', len, rx);
+}
+
+/**
+ * Retrieve MicroRNG internal status
+ *
+ * @param rx pointer to receiving status byte of the RNG. A zero value indicates a healthy status.
+ *
+ * @return true when status retrieved successfully
+ */
+bool MicroRngUART::retrieveDeviceStatusByte(uint8_t *rx) {
+	return exchangeBytes('s', 1, rx);
+}
+
+/**
+ * Shut down both random noise sources of the MicroRNG device
+ *
+ * @param rx pointer to RNG status byte. Expected value is decimal 200
+ *
+ * @return true when command exchanged successfully
+ */
+bool MicroRngUART::shutDownNoiseSources(uint8_t *rx) {
+	return exchangeBytes('D', 1, rx);
+}
+
+/**
+ * Start up both random noise sources of the MicroRNG device
+ *
+ * @param rx pointer to receiving status byte of the RNG. A zero value indicates that noise sources are turned on.
+ *
+ * @return true when command exchanged successfully
+ */
+bool MicroRngUART::startUpNoiseSources(uint8_t *rx) {
+	return exchangeBytes('U', 1, rx);
+}
+
+/**
+ * Reset the UART baud rate of the device to the factory default value MCR_UART_DEFAULT_BAUD_RATE,
+ * it takes effect after the device is powered off-and-on or after RST signal assertion.
+ *
+ * @param rx pointer to receiving status byte
+ *
+ * @return true when command exchanged successfully
+ */
+bool MicroRngUART::resetUART(uint8_t *rx) {
+	return exchangeBytes('R', 1, rx);
+}
+
+/**
+ * Validate UART communication with MicroRNG device by retrieving a series of transfer IDs
+ *
+ * @return true when communication to MicroRNG is validated
+ */
+bool MicroRngUART::validateCommunication() {
+	uint8_t testBuffer[MCR_UART_VALIDATION_BYTES];
+	if (!retrieveTestBytes(MCR_UART_VALIDATION_BYTES, testBuffer)) {
+		return false;
+	}
+	for (uint32_t i = 1; i < MCR_UART_VALIDATION_BYTES; i++) {
+		if (testBuffer[i] != (uint8_t) (testBuffer[i - 1] + 1)) {
+			sprintf(m_lastError, "Could not validate UART communication");
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Retrieve a copy of the UART transfer counters
+ *
+ * @param stats pointer to receiving counters
+ */
+void MicroRngUART::getStats(MicroRngUARTStats *stats) const {
+	*stats = m_stats;
+}
+
+/**
+ * Reset the UART transfer counters
+ */
+void MicroRngUART::resetStats() {
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+/**
+ * Map a baud rate to a termios speed
+ *
+ * @param baudRate baud rate
+ * @param speed pointer to receiving termios speed
+ *
+ * @return true if the baud rate is supported
+ */
+bool MicroRngUART::getSpeed(uint32_t baudRate, speed_t *speed) {
+	static const struct {
+		uint32_t baudRate;
+		speed_t speed;
+	} speeds[] = { { 9600, B9600 }, { 19200, B19200 }, { 38400, B38400 }, { 57600, B57600 },
+			{ 115200, B115200 }, { 230400, B230400 }, { 460800, B460800 }, { 500000, B500000 },
+			{ 576000, B576000 }, { 921600, B921600 }, { 1000000, B1000000 }, { 1152000, B1152000 },
+			{ 1500000, B1500000 } };
+	for (uint32_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++) {
+		if (speeds[i].baudRate == baudRate) {
+			*speed = speeds[i].speed;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Configure the serial port raw, 8N1 without flow control, at the selected baud rate
+ *
+ * @return true if configured successfully
+ */
+bool MicroRngUART::configurePort() {
+	struct termios options;
+	speed_t speed;
+	if (!getSpeed(m_baudRate, &speed)) {
+		sprintf(m_lastError, "Unsupported baud rate: %u", m_baudRate);
+		return false;
+	}
+	if (tcgetattr(m_fd, &options) != 0) {
+		sprintf(m_lastError, "Could not retrieve serial port attributes, error: %d", errno);
+		return false;
+	}
+	cfmakeraw(&options);
+	options.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS | CSIZE);
+	options.c_cflag |= CS8 | CLOCAL | CREAD;
+	options.c_cc[VMIN] = 0;
+	options.c_cc[VTIME] = 0;
+	cfsetispeed(&options, speed);
+	cfsetospeed(&options, speed);
+	if (tcsetattr(m_fd, TCSANOW, &options) != 0) {
+		sprintf(m_lastError, "Could not set serial port attributes, error: %d", errno);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Send a command byte for each requested response byte and collect the responses. Up to the transfer
+ * window of commands are sent ahead, responses are read as soon as they arrive.
+ *
+ * @param cmd command byte
+ * @param len number of response bytes to retrieve
+ * @param rx pointer to receiving response bytes
+ *
+ * @return true when all response bytes retrieved successfully
+ */
+bool MicroRngUART::exchangeBytes(char cmd, int len, uint8_t *rx) {
+	if (!isConnected()) {
+		return false;
+	}
+	if (len <= 0) {
+		sprintf(m_lastError, "Invalid amount of bytes requested");
+		return false;
+	}
+	uint8_t tx[MCR_UART_MAX_WRITE_BYTES];
+	memset(tx, cmd, sizeof(tx) < (size_t) len ? sizeof(tx) : (size_t) len);
+
+	int numSent = 0;
+	int numReceived = 0;
+	while (numReceived < len) {
+		struct pollfd pfd;
+		pfd.fd = m_fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		int numInFlight = numSent - numReceived;
+		if (numSent < len && numInFlight < (int) m_windowBytes) {
+			pfd.events |= POLLOUT;
+		}
+		int ret = poll(&pfd, 1, MCR_UART_RESPONSE_TIMEOUT_MSECS);
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			m_stats.errors++;
+			sprintf(m_lastError, "Could not poll serial port, error: %d", errno);
+			return false;
+		}
+		if (ret == 0) {
+			// Drop late responses so they aren't taken for responses to the next request
+			tcflush(m_fd, TCIOFLUSH);
+			m_stats.timeouts++;
+			sprintf(m_lastError, "Timeout waiting for device response, received %d of %d bytes", numReceived, len);
+			return false;
+		}
+		if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+			m_stats.errors++;
+			sprintf(m_lastError, "Serial port error");
+			return false;
+		}
+		if (pfd.revents & POLLIN) {
+			ssize_t numRead = read(m_fd, rx + numReceived, len - numReceived);
+			if (numRead < 0 && errno != EAGAIN && errno != EINTR) {
+				m_stats.errors++;
+				sprintf(m_lastError, "Could not read from serial port, error: %d", errno);
+				return false;
+			}
+			if (numRead > 0) {
+				numReceived += (int) numRead;
+				m_stats.reads++;
+				m_stats.bytesTransferred += numRead;
+			}
+		}
+		if (pfd.revents & POLLOUT) {
+			int numBytes = len - numSent;
+			if (numBytes > (int) m_windowBytes - numInFlight) {
+				numBytes = (int) m_windowBytes - numInFlight;
+			}
+			if (numBytes > MCR_UART_MAX_WRITE_BYTES) {
+				numBytes = MCR_UART_MAX_WRITE_BYTES;
+			}
+			ssize_t numWritten = write(m_fd, tx, numBytes);
+			if (numWritten < 0 && errno != EAGAIN && errno != EINTR) {
+				m_stats.errors++;
+				sprintf(m_lastError, "Could not write to serial port, error: %d", errno);
+				return false;
+			}
+			if (numWritten > 0) {
+				numSent += (int) numWritten;
+				m_stats.writes++;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * De-allocate resources
+ */
+MicroRngUART::~MicroRngUART() {
+	if (isConnected()) {
+		disconnect();
+	}
+}
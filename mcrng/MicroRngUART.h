@@ -0,0 +1,132 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file MicroRngUART.h
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief communicates with MicroRNG device through the 2-wire UART interface on Raspberry PI 3+ or other Linux-based single-board computers.
+ *
+ *    The serial port is configured raw, 8N1 without flow control, at the baud rate the device is configured for.
+ *    MicroRNG answers each received command byte with one response byte. Commands of a request are written ahead
+ *    of the responses, up to the transfer window, so the line is kept busy in both directions while responses
+ *    are collected with large read() batches.
+ *
+ *    Usage:
+ *        MicroRngUART uart;
+ *        uart.setBaudRate(1500000);
+ *        if (uart.connect("/dev/serial0") && uart.validateDevice()) {
+ *            bool success = uart.retrieveRandomBytes(len, buffer);
+ *        }
+ */
+#ifndef MICRORNGUART_H
+#define MICRORNGUART_H
+
+#include "MicroRngTransport.h"
+#include <stdio.h>
+#include <string.h>
+#include <termios.h>
+
+/**
+ * Factory default baud rate of the MicroRNG UART interface
+ */
+#define MCR_UART_DEFAULT_BAUD_RATE (19200)
+
+/**
+ * Max baud rate of the MicroRNG UART interface
+ */
+#define MCR_UART_MAX_BAUD_RATE (1500000)
+
+/**
+ * Default and max amount of command bytes sent ahead of the received responses
+ */
+#define MCR_UART_DEFAULT_WINDOW_BYTES (256)
+#define MCR_UART_MAX_WINDOW_BYTES (4096)
+
+/**
+ * Max time to wait for the next response bytes
+ */
+#define MCR_UART_RESPONSE_TIMEOUT_MSECS (1000)
+
+/**
+ * Amount of test bytes exchanged when validating UART communication
+ */
+#define MCR_UART_VALIDATION_BYTES (2048)
+
+/**
+ * Snapshot of UART transfer counters, accumulated since the object was created or the counters were reset
+ */
+struct MicroRngUARTStats {
+	uint64_t bytesTransferred;	// response bytes received
+	uint64_t reads;			// read() system calls returning response bytes
+	uint64_t writes;		// write() system calls sending command bytes
+	uint64_t timeouts;		// requests failed waiting for responses
+	uint64_t errors;		// failed read() or write() system calls
+};
+
+class MicroRngUART : public MicroRngTransport {
+public:
+	MicroRngUART();
+	MicroRngUART(MicroRngUART const&) = delete;
+	MicroRngUART(MicroRngUART&&) = delete;
+	MicroRngUART& operator=(MicroRngUART const&) = delete;
+	MicroRngUART& operator=(MicroRngUART&&) = delete;
+	virtual ~MicroRngUART();
+
+	bool isConnected() const;
+	bool connect(const char *devicePath);
+	bool validateDevice();
+	bool disconnect();
+	const char* getLastErrMsg() const;
+	bool setBaudRate(uint32_t baudRate);
+	uint32_t getBaudRate() const;
+	bool setTransferWindow(uint32_t windowBytes);
+	bool retrieveRandomByte(uint8_t *rx);
+	bool retrieveRandomBytes(int len, uint8_t *rx);
+	bool retrieveRawRandomByte(uint8_t *rx);
+	bool retrieveRawRandomBytes(int len, uint8_t *rx);
+	bool retrieveTestByte(uint8_t *rx);
+	bool retrieveTestBytes(int len, uint8_t *rx);
+	bool retrieveDeviceStatusByte(uint8_t *rx);
+	bool shutDownNoiseSources(uint8_t *rx);
+	bool startUpNoiseSources(uint8_t *rx);
+	bool resetUART(uint8_t *rx);
+	bool validateCommunication();
+	void getStats(MicroRngUARTStats *stats) const;
+	void resetStats();
+
+private:
+	static bool getSpeed(uint32_t baudRate, speed_t *speed);
+	bool configurePort();
+	bool exchangeBytes(char cmd, int len, uint8_t *rx);
+
+	int m_fd;
+	bool m_deviceConnected;
+	uint32_t m_baudRate;
+	uint32_t m_windowBytes;
+	MicroRngUARTStats m_stats;
+	char m_lastError[512];
+};
+
+#endif // MICRORNGUART_H
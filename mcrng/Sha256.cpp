@@ -0,0 +1,335 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file Sha256.cpp
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief SHA-256 hash (FIPS 180-4) used for conditioning raw MicroRNG random bytes.
+ *
+ */
+#include "Sha256.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SHA256_X86_EXTENSIONS
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined(__ARM_FEATURE_SHA2)
+#include <arm_neon.h>
+#endif
+
+static const uint32_t roundConstants[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t initialState[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static inline uint32_t rotateRight(uint32_t value, int bits) {
+	return (value >> bits) | (value << (32 - bits));
+}
+
+/**
+ * Compress blocks with plain C
+ *
+ * @param state hash state
+ * @param blocks pointer to the blocks
+ * @param numBlocks number of blocks
+ */
+static void compressBlocksPortable(uint32_t *state, const uint8_t *blocks, size_t numBlocks) {
+	uint32_t w[64];
+	for (; numBlocks > 0; numBlocks--, blocks += SHA256_BLOCK_BYTES) {
+		for (int i = 0; i < 16; i++) {
+			w[i] = (uint32_t) blocks[i * 4] << 24 | (uint32_t) blocks[i * 4 + 1] << 16
+					| (uint32_t) blocks[i * 4 + 2] << 8 | (uint32_t) blocks[i * 4 + 3];
+		}
+		for (int i = 16; i < 64; i++) {
+			uint32_t s0 = rotateRight(w[i - 15], 7) ^ rotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+			uint32_t s1 = rotateRight(w[i - 2], 17) ^ rotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+			w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+		}
+		uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+		uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+		for (int i = 0; i < 64; i++) {
+			uint32_t t1 = h + (rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25))
+					+ ((e & f) ^ (~e & g)) + roundConstants[i] + w[i];
+			uint32_t t2 = (rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22))
+					+ ((a & b) ^ (a & c) ^ (b & c));
+			h = g;
+			g = f;
+			f = e;
+			e = d + t1;
+			d = c;
+			c = b;
+			b = a;
+			a = t1 + t2;
+		}
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+		state[5] += f;
+		state[6] += g;
+		state[7] += h;
+	}
+}
+
+#if defined(SHA256_X86_EXTENSIONS)
+
+/**
+ * @return true when the processor supports the SHA extensions
+ */
+static bool detectShaExtensions() {
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || (ecx & bit_SSE4_1) == 0) {
+		return false;
+	}
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+		return false;
+	}
+	return (ebx & bit_SHA) != 0;
+}
+
+static const bool isShaExtensionSupported = detectShaExtensions();
+
+/**
+ * Compress blocks with the x86 SHA extensions
+ *
+ * @param state hash state
+ * @param blocks pointer to the blocks
+ * @param numBlocks number of blocks
+ */
+__attribute__((target("sha,sse4.1")))
+static void compressBlocksShaExtensions(uint32_t *state, const uint8_t *blocks, size_t numBlocks) {
+	const __m128i byteSwapMask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+	// The instructions expect the state as ABEF and CDGH
+	__m128i dcba = _mm_loadu_si128((const __m128i*) &state[0]);
+	__m128i hgfe = _mm_loadu_si128((const __m128i*) &state[4]);
+	__m128i cdab = _mm_shuffle_epi32(dcba, 0xB1);
+	__m128i efgh = _mm_shuffle_epi32(hgfe, 0x1B);
+	__m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+	__m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xF0);
+
+	for (; numBlocks > 0; numBlocks--, blocks += SHA256_BLOCK_BYTES) {
+		__m128i abefSaved = abef;
+		__m128i cdghSaved = cdgh;
+		__m128i messages[4];
+		for (int i = 0; i < 4; i++) {
+			messages[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (blocks + i * 16)), byteSwapMask);
+		}
+		for (int i = 0; i < 16; i++) {
+			__m128i words = _mm_add_epi32(messages[i % 4],
+					_mm_loadu_si128((const __m128i*) &roundConstants[i * 4]));
+			if (i < 12) {
+				__m128i next = _mm_sha256msg1_epu32(messages[i % 4], messages[(i + 1) % 4]);
+				next = _mm_add_epi32(next, _mm_alignr_epi8(messages[(i + 3) % 4], messages[(i + 2) % 4], 4));
+				messages[i % 4] = _mm_sha256msg2_epu32(next, messages[(i + 3) % 4]);
+			}
+			cdgh = _mm_sha256rnds2_epu32(cdgh, abef, words);
+			words = _mm_shuffle_epi32(words, 0x0E);
+			abef = _mm_sha256rnds2_epu32(abef, cdgh, words);
+		}
+		abef = _mm_add_epi32(abef, abefSaved);
+		cdgh = _mm_add_epi32(cdgh, cdghSaved);
+	}
+
+	__m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+	__m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+	_mm_storeu_si128((__m128i*) &state[0], _mm_blend_epi16(feba, dchg, 0xF0));
+	_mm_storeu_si128((__m128i*) &state[4], _mm_alignr_epi8(dchg, feba, 8));
+}
+
+#elif defined(__ARM_FEATURE_SHA2)
+
+/**
+ * Compress blocks with the ARMv8 cryptography extension
+ *
+ * @param state hash state
+ * @param blocks pointer to the blocks
+ * @param numBlocks number of blocks
+ */
+static void compressBlocksArmv8(uint32_t *state, const uint8_t *blocks, size_t numBlocks) {
+	uint32x4_t abcd = vld1q_u32(&state[0]);
+	uint32x4_t efgh = vld1q_u32(&state[4]);
+
+	for (; numBlocks > 0; numBlocks--, blocks += SHA256_BLOCK_BYTES) {
+		uint32x4_t abcdSaved = abcd;
+		uint32x4_t efghSaved = efgh;
+		uint32x4_t messages[4];
+		for (int i = 0; i < 4; i++) {
+			messages[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(blocks + i * 16)));
+		}
+		for (int i = 0; i < 16; i++) {
+			uint32x4_t words = vaddq_u32(messages[i % 4], vld1q_u32(&roundConstants[i * 4]));
+			if (i < 12) {
+				uint32x4_t next = vsha256su0q_u32(messages[i % 4], messages[(i + 1) % 4]);
+				messages[i % 4] = vsha256su1q_u32(next, messages[(i + 2) % 4], messages[(i + 3) % 4]);
+			}
+			uint32x4_t abcdPrevious = abcd;
+			abcd = vsha256hq_u32(abcd, efgh, words);
+			efgh = vsha256h2q_u32(efgh, abcdPrevious, words);
+		}
+		abcd = vaddq_u32(abcd, abcdSaved);
+		efgh = vaddq_u32(efgh, efghSaved);
+	}
+
+	vst1q_u32(&state[0], abcd);
+	vst1q_u32(&state[4], efgh);
+}
+
+#endif
+
+Sha256::Sha256() {
+	init();
+}
+
+/**
+ * Start a new hash
+ */
+void Sha256::init() {
+	memcpy(m_state, initialState, sizeof(m_state));
+	m_bufferBytes = 0;
+	m_totalBytes = 0;
+}
+
+/**
+ * Hash more bytes
+ *
+ * @param bytes pointer to the bytes
+ * @param len number of bytes
+ */
+void Sha256::update(const uint8_t *bytes, size_t len) {
+	m_totalBytes += len;
+	if (m_bufferBytes > 0) {
+		size_t numBytes = SHA256_BLOCK_BYTES - m_bufferBytes;
+		if (numBytes > len) {
+			numBytes = len;
+		}
+		memcpy(m_buffer + m_bufferBytes, bytes, numBytes);
+		m_bufferBytes += numBytes;
+		bytes += numBytes;
+		len -= numBytes;
+		if (m_bufferBytes < SHA256_BLOCK_BYTES) {
+			return;
+		}
+		compressBlocks(m_state, m_buffer, 1);
+		m_bufferBytes = 0;
+	}
+	size_t numBlocks = len / SHA256_BLOCK_BYTES;
+	if (numBlocks > 0) {
+		compressBlocks(m_state, bytes, numBlocks);
+		bytes += numBlocks * SHA256_BLOCK_BYTES;
+		len -= numBlocks * SHA256_BLOCK_BYTES;
+	}
+	memcpy(m_buffer, bytes, len);
+	m_bufferBytes = len;
+}
+
+/**
+ * Finish the hash
+ *
+ * @param digest pointer to receiving SHA256_DIGEST_BYTES bytes of the hash
+ */
+void Sha256::final(uint8_t *digest) {
+	uint64_t totalBits = m_totalBytes * 8;
+	m_buffer[m_bufferBytes++] = 0x80;
+	if (m_bufferBytes > SHA256_BLOCK_BYTES - 8) {
+		memset(m_buffer + m_bufferBytes, 0, SHA256_BLOCK_BYTES - m_bufferBytes);
+		compressBlocks(m_state, m_buffer, 1);
+		m_bufferBytes = 0;
+	}
+	memset(m_buffer + m_bufferBytes, 0, SHA256_BLOCK_BYTES - 8 - m_bufferBytes);
+	for (int i = 0; i < 8; i++) {
+		m_buffer[SHA256_BLOCK_BYTES - 1 - i] = (uint8_t) (totalBits >> (i * 8));
+	}
+	compressBlocks(m_state, m_buffer, 1);
+	for (int i = 0; i < 8; i++) {
+		digest[i * 4] = (uint8_t) (m_state[i] >> 24);
+		digest[i * 4 + 1] = (uint8_t) (m_state[i] >> 16);
+		digest[i * 4 + 2] = (uint8_t) (m_state[i] >> 8);
+		digest[i * 4 + 3] = (uint8_t) m_state[i];
+	}
+	memset(m_buffer, 0, sizeof(m_buffer));
+	init();
+}
+
+/**
+ * Hash bytes at once
+ *
+ * @param bytes pointer to the bytes
+ * @param len number of bytes
+ * @param digest pointer to receiving SHA256_DIGEST_BYTES bytes of the hash
+ */
+void Sha256::hash(const uint8_t *bytes, size_t len, uint8_t *digest) {
+	Sha256 sha;
+	sha.update(bytes, len);
+	sha.final(digest);
+}
+
+/**
+ * @return true when blocks are compressed with processor SHA instructions
+ */
+bool Sha256::isHardwareAccelerated() {
+#if defined(SHA256_X86_EXTENSIONS)
+	return isShaExtensionSupported;
+#elif defined(__ARM_FEATURE_SHA2)
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Compress blocks with the fastest implementation available
+ *
+ * @param state hash state
+ * @param blocks pointer to the blocks
+ * @param numBlocks number of blocks
+ */
+void Sha256::compressBlocks(uint32_t *state, const uint8_t *blocks, size_t numBlocks) {
+#if defined(SHA256_X86_EXTENSIONS)
+	if (isShaExtensionSupported) {
+		compressBlocksShaExtensions(state, blocks, numBlocks);
+		return;
+	}
+#elif defined(__ARM_FEATURE_SHA2)
+	compressBlocksArmv8(state, blocks, numBlocks);
+	return;
+#endif
+	compressBlocksPortable(state, blocks, numBlocks);
+}
+
+Sha256::~Sha256() {
+	memset(m_state, 0, sizeof(m_state));
+}
@@ -0,0 +1,69 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file Sha256.h
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief SHA-256 hash (FIPS 180-4) used for conditioning raw MicroRNG random bytes.
+ *
+ *    Blocks are compressed with the SHA extensions of x86 processors or with the ARMv8 cryptography
+ *    extension when available. The x86 extensions are detected at run time, the ARMv8 extension is used
+ *    when the compiler targets it (for example -march=armv8-a+crypto).
+ *
+ *    Usage:
+ *        uint8_t digest[SHA256_DIGEST_BYTES];
+ *        Sha256::hash(bytes, len, digest);
+ */
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define SHA256_DIGEST_BYTES (32)
+#define SHA256_BLOCK_BYTES (64)
+
+class Sha256 {
+public:
+	Sha256();
+	virtual ~Sha256();
+
+	void init();
+	void update(const uint8_t *bytes, size_t len);
+	void final(uint8_t *digest);
+	static void hash(const uint8_t *bytes, size_t len, uint8_t *digest);
+	static bool isHardwareAccelerated();
+
+private:
+	static void compressBlocks(uint32_t *state, const uint8_t *blocks, size_t numBlocks);
+
+	uint32_t m_state[8];
+	uint8_t m_buffer[SHA256_BLOCK_BYTES];
+	size_t m_bufferBytes;
+	uint64_t m_totalBytes;
+};
+
+#endif // SHA256_H
@@ -0,0 +1,490 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file mcbench.cpp
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief measures MicroRNG throughput and call latency through SPI interface on Raspberry PI 3+ or other Linux-based single-board computers.
+ *
+ */
+#include "mcbench.h"
+
+/**
+ * Display usage message
+ *
+ */
+static void displayUsage() {
+    printf("---------------------------------------------------------------------------\n");
+    printf("---     TectroLabs - mcbench - MicroRNG benchmark utility Version 1.0    ---\n");
+    printf("---     Use with RPI 3+ or other Linux-based single-board computers     ---\n");
+    printf("---------------------------------------------------------------------------\n");
+    printf("NAME\n");
+    printf("     mcbench  - True Random Number Generator MicroRNG benchmark utility \n");
+    printf("SYNOPSIS\n");
+    printf("     mcbench  [options] \n");
+    printf("\n");
+    printf("DESCRIPTION\n");
+    printf("     Mcbench measures wall-clock throughput and call latency of random byte\n");
+    printf("     retrieval for each combination of clock frequency, transfer mode and\n");
+    printf("     chunk size.\n");
+    printf("\n");
+    printf("OPTIONS\n");
+    printf("     Operation modifiers:\n");
+    printf("\n");
+    printf("     -dp PATH, --device-path PATH\n");
+    printf("           SPI device path, default value: /dev/spidev0.0\n");
+    printf("\n");
+    printf("     -cf LIST, --clock-frequency LIST\n");
+    printf("           comma separated SPI master clock frequencies in KHz,\n");
+    printf("           skip this option for the max frequency calibrated for the device\n");
+    printf("\n");
+    printf("     -cs LIST, --chunk-size LIST\n");
+    printf("           comma separated chunk sizes in bytes for chunk based modes,\n");
+    printf("           default value: %s\n", MCRB_DEFAULT_CHUNK_SIZES);
+    printf("\n");
+    printf("     -tm MODE, --transfer-mode MODE\n");
+    printf("           transfer MODE to measure, default value: all\n");
+    printf("           per-byte  - one call and one ioctl per random byte\n");
+    printf("           batched   - one call per chunk\n");
+    printf("           mixed     - one call per chunk and one per status byte\n");
+    printf("           scheduled - a chunk and a status byte requested together\n");
+    printf("                       through MicroRngScheduler\n");
+    printf("           async     - one chunk per call submitted to the MicroRngAsync\n");
+    printf("                       worker thread, waiting for completion\n");
+    printf("           buffered  - one call per chunk served by the MicroRngBuffer\n");
+    printf("                       filler thread and per-thread cache\n");
+    printf("           all       - all modes\n");
+    printf("\n");
+    printf("     -nb NUMBER, --number-bytes NUMBER\n");
+    printf("           NUMBER of random bytes retrieved for each measurement,\n");
+    printf("           max value %d, default value: %d\n", MCRB_MAX_BYTES_PER_POINT, MCRB_DEFAULT_BYTES_PER_POINT);
+    printf("\n");
+    printf("     -of FORMAT, --output-format FORMAT\n");
+    printf("           report FORMAT: text, csv or json, default value: text\n");
+    printf("EXAMPLES:\n");
+    printf("     It may require 'sudo' permissions to run this utility.\n");
+    printf("     To compare chunk sizes at two clock frequencies in CSV format\n");
+    printf("           mcbench  -dp /dev/spidev0.0 -cf 8000,16000 -cs 512,4096 -of csv\n");
+    printf("\n");
+}
+
+/**
+ * Validate command line argument count
+ *
+ * @param int curIdx
+ * @param int actualArgumentCount
+ * @return true if run successfully
+ */
+static bool validateArgumentCount(int curIdx, int actualArgumentCount) {
+	if (curIdx >= actualArgumentCount) {
+		fprintf(stderr, "\nMissing command line arguments\n\n");
+		displayUsage();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Parse a comma separated list of positive numbers
+ *
+ * @param const char* list - comma separated numbers
+ * @param uint32_t multiplier - each number is multiplied by this value
+ * @param uint32_t* values - pointer to receiving values
+ * @param uint32_t* numValues - pointer to receiving number of values
+ * @return int - 0 when successfully parsed
+ */
+static int parseList(const char *list, uint32_t multiplier, uint32_t *values, uint32_t *numValues) {
+	*numValues = 0;
+	const char *cur = list;
+	while (*cur != '\0') {
+		char *end;
+		long value = strtol(cur, &end, 10);
+		if (end == cur || value <= 0 || value > UINT32_MAX / multiplier
+				|| (*end != ',' && *end != '\0')) {
+			fprintf(stderr, "Invalid list of numbers: %s\n", list);
+			return -1;
+		}
+		if (*numValues >= MCRB_MAX_SWEEP_VALUES) {
+			fprintf(stderr, "Cannot sweep more than %d values\n", MCRB_MAX_SWEEP_VALUES);
+			return -1;
+		}
+		values[(*numValues)++] = (uint32_t) value * multiplier;
+		cur = *end == ',' ? end + 1 : end;
+	}
+	return *numValues > 0 ? 0 : -1;
+}
+
+/**
+ * Parse arguments for extracting command line parameters
+ *
+ * @param int argc
+ * @param char** argv
+ * @return int - 0 when run successfully
+ */
+static int processArguments(int argc, char **argv) {
+	int idx = 1;
+	strcpy(devicePath, DEFAULT_SPI_DEV_PATH);
+	parseList(MCRB_DEFAULT_CHUNK_SIZES, 1, chunkSizes, &numChunkSizes);
+	while (idx < argc) {
+		if (strcmp("-dp", argv[idx]) == 0
+				|| strcmp("--device-path", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			strcpy(devicePath, argv[idx++]);
+		} else if (strcmp("-cf", argv[idx]) == 0
+				|| strcmp("--clock-frequency", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			if (parseList(argv[idx++], 1000, clockFrequencies, &numClockFrequencies) == -1) {
+				return -1;
+			}
+		} else if (strcmp("-cs", argv[idx]) == 0
+				|| strcmp("--chunk-size", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			if (parseList(argv[idx++], 1, chunkSizes, &numChunkSizes) == -1) {
+				return -1;
+			}
+		} else if (strcmp("-tm", argv[idx]) == 0
+				|| strcmp("--transfer-mode", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			const char *modeName = argv[idx++];
+			bool isModeKnown = false;
+			for (int mode = 0; mode < MCRB_MODES; mode++) {
+				isModeEnabled[mode] = strcmp(transferModeNames[mode], modeName) == 0
+						|| strcmp("all", modeName) == 0;
+				isModeKnown = isModeKnown || isModeEnabled[mode];
+			}
+			if (!isModeKnown) {
+				fprintf(stderr, "Unknown transfer mode: %s\n", modeName);
+				return -1;
+			}
+		} else if (strcmp("-nb", argv[idx]) == 0
+				|| strcmp("--number-bytes", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			int64_t value = atoll(argv[idx++]);
+			if (value <= 0 || value > MCRB_MAX_BYTES_PER_POINT) {
+				fprintf(stderr, "Number of bytes must be between 1 and %d\n", MCRB_MAX_BYTES_PER_POINT);
+				return -1;
+			}
+			bytesPerPoint = (uint64_t) value;
+		} else if (strcmp("-of", argv[idx]) == 0
+				|| strcmp("--output-format", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			const char *formatName = argv[idx++];
+			if (strcmp("text", formatName) == 0) {
+				outputFormat = MCRB_FORMAT_TEXT;
+			} else if (strcmp("csv", formatName) == 0) {
+				outputFormat = MCRB_FORMAT_CSV;
+			} else if (strcmp("json", formatName) == 0) {
+				outputFormat = MCRB_FORMAT_JSON;
+			} else {
+				fprintf(stderr, "Unknown output format: %s\n", formatName);
+				return -1;
+			}
+		} else if (strcmp("-h", argv[idx]) == 0
+				|| strcmp("--help", argv[idx]) == 0) {
+			displayUsage();
+			return -1;
+		} else {
+			// Could not handle the argument, skip to the next one
+			++idx;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @return uint64_t - wall-clock time in nanoseconds, not affected by system time changes
+ */
+static uint64_t getMonotonicNanos() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+/**
+ * Compare two latency values for qsort()
+ */
+static int compareLatencies(const void *a, const void *b) {
+	uint64_t first = *(const uint64_t*) a;
+	uint64_t second = *(const uint64_t*) b;
+	return first < second ? -1 : (first > second ? 1 : 0);
+}
+
+/**
+ * Pick a percentile of the sorted call latencies
+ *
+ * @param uint64_t numCalls - number of measured calls
+ * @param double percentile - percentile between 0 and 100
+ * @return double - latency in microseconds
+ */
+static double getPercentileUsecs(uint64_t numCalls, double percentile) {
+	uint64_t rank = (uint64_t) ((double) numCalls * percentile / 100);
+	if (rank >= numCalls) {
+		rank = numCalls - 1;
+	}
+	return (double) pLatencies[rank] / 1000;
+}
+
+/**
+ * Retrieve one chunk of random bytes using a transfer mode
+ *
+ * @param McrbTransferMode mode - transfer mode
+ * @param uint32_t chunkSize - bytes retrieved per call
+ * @return true when retrieved successfully
+ */
+static bool retrieveChunk(McrbTransferMode mode, uint32_t chunkSize) {
+	uint8_t deviceStatus;
+	switch (mode) {
+	case MCRB_MODE_PER_BYTE:
+		return spi.retrieveRandomByte(pChunkBuffer);
+	case MCRB_MODE_MIXED:
+		return spi.retrieveRandomBytes(chunkSize, pChunkBuffer) && spi.retrieveDeviceStatusByte(&deviceStatus);
+	case MCRB_MODE_SCHEDULED: {
+		MicroRngRequest randomRequest = { MCR_REQUEST_RANDOM, chunkSize, pChunkBuffer, false, false, nullptr };
+		MicroRngRequest statusRequest = { MCR_REQUEST_STATUS, 1, &deviceStatus, false, false, nullptr };
+		return scheduler.submit(&randomRequest) && scheduler.submit(&statusRequest) && scheduler.perform();
+	}
+	case MCRB_MODE_ASYNC: {
+		std::future<bool> completion = async.submitRead(chunkSize, pChunkBuffer);
+		return completion.valid() && completion.get();
+	}
+	case MCRB_MODE_BUFFERED:
+		return buffer.getRandom(pChunkBuffer, chunkSize);
+	default:
+		return spi.retrieveRandomBytes(chunkSize, pChunkBuffer);
+	}
+}
+
+/**
+ * Measure one sweep point
+ *
+ * @param uint32_t clockHz - SPI master clock frequency
+ * @param McrbTransferMode mode - transfer mode
+ * @param uint32_t chunkSize - bytes retrieved per call in chunk based modes
+ * @param McrbResult* result - pointer to receiving results
+ * @return true when measured successfully
+ */
+static bool measurePoint(uint32_t clockHz, McrbTransferMode mode, uint32_t chunkSize, McrbResult *result) {
+	if (mode == MCRB_MODE_PER_BYTE) {
+		chunkSize = 1;
+	}
+	uint64_t numCalls = (bytesPerPoint + chunkSize - 1) / chunkSize;
+
+	spi.setMaxClockFrequency(clockHz);
+	if (mode == MCRB_MODE_BUFFERED && !buffer.start(MCR_BUFFER_DEFAULT_CAPACITY_BYTES)) {
+		fprintf(stderr, "Cannot start buffer filler, error: %s\n", buffer.getLastErrMsg());
+		return false;
+	}
+
+	// Warm up so the first measured call doesn't pay for the command switch
+	if (!retrieveChunk(mode, chunkSize)) {
+		fprintf(stderr, "Failed to receive random bytes, error: %s\n", spi.getLastErrMsg());
+		buffer.stop();
+		return false;
+	}
+
+	spi.resetStats();
+	uint64_t startNanos = getMonotonicNanos();
+	uint64_t prevNanos = startNanos;
+	for (uint64_t i = 0; i < numCalls; i++) {
+		if (!retrieveChunk(mode, chunkSize)) {
+			fprintf(stderr, "Failed to receive random bytes, error: %s\n", spi.getLastErrMsg());
+			buffer.stop();
+			return false;
+		}
+		uint64_t nowNanos = getMonotonicNanos();
+		pLatencies[i] = nowNanos - prevNanos;
+		prevNanos = nowNanos;
+	}
+	double durationSecs = (double) (prevNanos - startNanos) / 1000000000;
+	// The filler thread owns the device while the buffer runs
+	buffer.stop();
+
+	qsort(pLatencies, numCalls, sizeof(uint64_t), compareLatencies);
+
+	MicroRngSPIStats stats;
+	spi.getStats(&stats);
+
+	result->clockHz = clockHz;
+	result->mode = mode;
+	result->chunkSize = chunkSize;
+	result->numCalls = numCalls;
+	result->numBytes = numCalls * chunkSize;
+	result->durationSecs = durationSecs;
+	result->kbitsPerSecond = durationSecs > 0 ? (double) result->numBytes * 8 / durationSecs / 1000 : 0;
+	result->p50Usecs = getPercentileUsecs(numCalls, 50);
+	result->p99Usecs = getPercentileUsecs(numCalls, 99);
+	result->p999Usecs = getPercentileUsecs(numCalls, 99.9);
+	result->syscallsPerByte = (double) stats.ioctls / result->numBytes;
+	return true;
+}
+
+/**
+ * Print the beginning of the report
+ */
+static void reportHeader() {
+	switch (outputFormat) {
+	case MCRB_FORMAT_CSV:
+		printf("clock_hz,mode,chunk_bytes,bytes,calls,duration_s,kbps,p50_us,p99_us,p999_us,syscalls_per_byte\n");
+		break;
+	case MCRB_FORMAT_JSON:
+		printf("{\n  \"device\": \"%s\",\n  \"max_message_bytes\": %u,\n  \"results\": [", devicePath,
+				spi.getMaxMessageBytes());
+		break;
+	default:
+		printf("Device %s, max SPI message %u bytes\n", devicePath, spi.getMaxMessageBytes());
+		printf("%10s %10s %10s %12s %10s %10s %10s %10s %10s\n", "clock Hz", "mode", "chunk", "bytes",
+				"kbps", "p50 us", "p99 us", "p999 us", "ioctl/B");
+		break;
+	}
+}
+
+/**
+ * Print results of one sweep point
+ *
+ * @param const McrbResult* result - pointer to the results
+ */
+static void reportResult(const McrbResult *result) {
+	const char *modeName = transferModeNames[result->mode];
+	switch (outputFormat) {
+	case MCRB_FORMAT_CSV:
+		printf("%u,%s,%u,%llu,%llu,%.6f,%.1f,%.2f,%.2f,%.2f,%.6f\n", result->clockHz, modeName,
+				result->chunkSize, (unsigned long long) result->numBytes,
+				(unsigned long long) result->numCalls, result->durationSecs, result->kbitsPerSecond,
+				result->p50Usecs, result->p99Usecs, result->p999Usecs, result->syscallsPerByte);
+		break;
+	case MCRB_FORMAT_JSON:
+		printf("%s\n    {\"clock_hz\": %u, \"mode\": \"%s\", \"chunk_bytes\": %u, \"bytes\": %llu, "
+				"\"calls\": %llu, \"duration_s\": %.6f, \"kbps\": %.1f, \"p50_us\": %.2f, "
+				"\"p99_us\": %.2f, \"p999_us\": %.2f, \"syscalls_per_byte\": %.6f}",
+				numReportedResults > 0 ? "," : "", result->clockHz, modeName, result->chunkSize,
+				(unsigned long long) result->numBytes, (unsigned long long) result->numCalls,
+				result->durationSecs, result->kbitsPerSecond, result->p50Usecs, result->p99Usecs,
+				result->p999Usecs, result->syscallsPerByte);
+		break;
+	default:
+		printf("%10u %10s %10u %12llu %10.1f %10.2f %10.2f %10.2f %10.6f\n", result->clockHz, modeName,
+				result->chunkSize, (unsigned long long) result->numBytes, result->kbitsPerSecond,
+				result->p50Usecs, result->p99Usecs, result->p999Usecs, result->syscallsPerByte);
+		break;
+	}
+	numReportedResults++;
+}
+
+/**
+ * Print the end of the report
+ */
+static void reportFooter() {
+	if (outputFormat == MCRB_FORMAT_JSON) {
+		printf("\n  ]\n}\n");
+	}
+}
+
+/**
+ * Connect to the device and measure all sweep points
+ *
+ * @return int - 0 when run successfully
+ */
+static int runBenchmark() {
+	McrbResult result;
+
+	if (!spi.connect(devicePath)) {
+		fprintf(stderr, " Cannot open SPI device %s, error: %s ... \n",
+				devicePath, spi.getLastErrMsg());
+		return -1;
+	}
+	if (numClockFrequencies == 0) {
+		if (!spi.calibrateClockFrequency()) {
+			fprintf(stderr, " Cannot calibrate SPI clock frequency, error: %s ... \n",
+					spi.getLastErrMsg());
+			return -1;
+		}
+		clockFrequencies[numClockFrequencies++] = spi.getMaxClockFrequency();
+	}
+	if (!spi.validateDevice()) {
+		fprintf(stderr, " Cannot access device, error: %s ... \n",
+				spi.getLastErrMsg());
+		return -1;
+	}
+
+	uint32_t maxChunkSize = 1;
+	for (uint32_t i = 0; i < numChunkSizes; i++) {
+		if (chunkSizes[i] > maxChunkSize) {
+			maxChunkSize = chunkSizes[i];
+		}
+	}
+	pChunkBuffer = (uint8_t*) malloc(maxChunkSize);
+	pLatencies = (uint64_t*) malloc(bytesPerPoint * sizeof(uint64_t));
+	if (pChunkBuffer == nullptr || pLatencies == nullptr) {
+		fprintf(stderr, "Cannot allocate memory for the benchmark\n");
+		return -1;
+	}
+	if (isModeEnabled[MCRB_MODE_ASYNC] && !async.start()) {
+		fprintf(stderr, "Cannot start asynchronous worker, error: %s\n", async.getLastErrMsg());
+		return -1;
+	}
+
+	reportHeader();
+	for (uint32_t c = 0; c < numClockFrequencies; c++) {
+		if (isModeEnabled[MCRB_MODE_PER_BYTE]) {
+			if (!measurePoint(clockFrequencies[c], MCRB_MODE_PER_BYTE, 1, &result)) {
+				return -1;
+			}
+			reportResult(&result);
+		}
+		for (int mode = MCRB_MODE_BATCHED; mode < MCRB_MODES; mode++) {
+			for (uint32_t s = 0; isModeEnabled[mode] && s < numChunkSizes; s++) {
+				if (!measurePoint(clockFrequencies[c], (McrbTransferMode) mode, chunkSizes[s], &result)) {
+					return -1;
+				}
+				reportResult(&result);
+			}
+		}
+	}
+	reportFooter();
+
+	async.stop();
+	free(pLatencies);
+	free(pChunkBuffer);
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	if (processArguments(argc, argv) != 0) {
+		return -1;
+	}
+	return runBenchmark() == 0 ? 0 : -1;
+}
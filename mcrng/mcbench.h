@@ -0,0 +1,151 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file mcbench.h
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief measures MicroRNG throughput and call latency through SPI interface on Raspberry PI 3+ or other Linux-based single-board computers.
+ *
+ */
+#ifndef MCBENCH_H_
+#define MCBENCH_H_
+
+#include "MicroRngSPI.h"
+#include "MicroRngScheduler.h"
+#include "MicroRngAsync.h"
+#include "MicroRngBuffer.h"
+#include <unistd.h>
+
+#include <stdlib.h>
+#include <errno.h>
+
+#define DEFAULT_SPI_DEV_PATH "/dev/spidev0.0"
+#define MCRB_MAX_SWEEP_VALUES (32)
+#define MCRB_DEFAULT_CHUNK_SIZES "1,64,512,4096,32000"
+#define MCRB_DEFAULT_BYTES_PER_POINT (128000)
+#define MCRB_MAX_BYTES_PER_POINT (10000000)
+
+/**
+ * Ways of retrieving random bytes measured by the benchmark
+ */
+enum McrbTransferMode {
+	MCRB_MODE_PER_BYTE,	// one retrieveRandomByte() call, one ioctl, per byte
+	MCRB_MODE_BATCHED,	// one retrieveRandomBytes() call per chunk
+	MCRB_MODE_MIXED,	// one retrieveRandomBytes() and one retrieveDeviceStatusByte() call per chunk
+	MCRB_MODE_SCHEDULED,	// a chunk and a status byte per call, requested together through MicroRngScheduler
+	MCRB_MODE_ASYNC,	// one chunk per call submitted to the MicroRngAsync worker, waiting on the returned future
+	MCRB_MODE_BUFFERED,	// one MicroRngBuffer::getRandom() call per chunk, small chunks served from the per-thread cache
+	MCRB_MODES
+};
+
+/**
+ * Transfer mode names used on the command line and in reports
+ */
+static const char *transferModeNames[MCRB_MODES] = { "per-byte", "batched", "mixed", "scheduled", "async", "buffered" };
+
+/**
+ * Formats of the benchmark report
+ */
+enum McrbOutputFormat {
+	MCRB_FORMAT_TEXT,
+	MCRB_FORMAT_CSV,
+	MCRB_FORMAT_JSON
+};
+
+/**
+ * Results of one benchmark sweep point
+ */
+struct McrbResult {
+	uint32_t clockHz;
+	McrbTransferMode mode;
+	uint32_t chunkSize;
+	uint64_t numBytes;
+	uint64_t numCalls;
+	double durationSecs;
+	double kbitsPerSecond;
+	double p50Usecs;
+	double p99Usecs;
+	double p999Usecs;
+	double syscallsPerByte;
+};
+
+/**
+ * SPI device path
+ */
+static char devicePath[256];
+
+/**
+ * Chunk sizes in bytes to sweep (a command line argument)
+ */
+static uint32_t chunkSizes[MCRB_MAX_SWEEP_VALUES];
+static uint32_t numChunkSizes = 0;
+
+/**
+ * SPI master clock frequencies in Hz to sweep (a command line argument), the calibrated frequency when empty
+ */
+static uint32_t clockFrequencies[MCRB_MAX_SWEEP_VALUES];
+static uint32_t numClockFrequencies = 0;
+
+/**
+ * Transfer modes to sweep (a command line argument)
+ */
+static bool isModeEnabled[MCRB_MODES] = { true, true, true, true, true, true };
+
+/**
+ * Amount of random bytes retrieved for each sweep point (a command line argument)
+ */
+static uint64_t bytesPerPoint = MCRB_DEFAULT_BYTES_PER_POINT;
+
+/**
+ * Format of the report (a command line argument)
+ */
+static McrbOutputFormat outputFormat = MCRB_FORMAT_TEXT;
+
+static MicroRngSPI spi;
+static MicroRngScheduler scheduler(spi);
+static MicroRngAsync async(spi);
+static MicroRngBuffer buffer(spi);
+static uint8_t *pChunkBuffer = nullptr;
+static uint64_t *pLatencies = nullptr;
+static uint32_t numReportedResults = 0;
+
+/**
+ * Function Declarations
+ */
+static void displayUsage();
+static int processArguments(int argc, char **argv);
+static bool validateArgumentCount(int curIdx, int actualArgumentCount);
+static int parseList(const char *list, uint32_t multiplier, uint32_t *values, uint32_t *numValues);
+static uint64_t getMonotonicNanos();
+static int compareLatencies(const void *a, const void *b);
+static double getPercentileUsecs(uint64_t numCalls, double percentile);
+static bool retrieveChunk(McrbTransferMode mode, uint32_t chunkSize);
+static bool measurePoint(uint32_t clockHz, McrbTransferMode mode, uint32_t chunkSize, McrbResult *result);
+static void reportHeader();
+static void reportResult(const McrbResult *result);
+static void reportFooter();
+static int runBenchmark();
+
+#endif /* MCBENCH_H_ */
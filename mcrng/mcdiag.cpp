@@ -30,17 +30,179 @@
  *
  */
 #include "MicroRngSPI.h"
+#include "MicroRngUART.h"
+#include "MicroRngQuality.h"
 #include <math.h>
+#include <signal.h>
 
 #define BLOCK_SIZE_TEST_BYTES (32000)
 #define TEST_RETRIEVE_BLOCKS (20)
+#define QUALITY_DEFAULT_REPORT_INTERVAL_SECS (10)
+
+static volatile sig_atomic_t isQualityStopRequested = 0;
+
+/**
+ * Stop the quality tests after the blocks retrieved so far
+ *
+ * @param int signum - signal number
+ */
+static void handleStopSignal(int signum) {
+	(void) signum;
+	isQualityStopRequested = 1;
+}
+
+/**
+ * Compute the elapsed time between two points
+ *
+ * @param const struct timespec* start - start time
+ * @param const struct timespec* end - end time
+ * @return double - elapsed seconds
+ */
+static double computeElapsedSecs(const struct timespec *start, const struct timespec *end) {
+	return (double) (end->tv_sec - start->tv_sec) + (double) (end->tv_nsec - start->tv_nsec) / 1000000000;
+}
+
+/**
+ * Print one progress line of the quality tests
+ *
+ * @param const MicroRngQualityStats* stats - merged results so far
+ * @param double elapsedSecs - seconds since the tests started
+ */
+static void printQualityProgress(const MicroRngQualityStats *stats, double elapsedSecs) {
+	uint32_t worstTest = 0;
+	for (uint32_t t = 1; t < MCR_QUALITY_NUM_TESTS; t++) {
+		if (stats->tests[t].passed < stats->tests[worstTest].passed) {
+			worstTest = t;
+		}
+	}
+	printf("Tested %llu blocks, %llu bytes, %.0f kbps, entropy %.6f bits per byte, lowest pass count: %s %llu/%llu\n",
+			(unsigned long long) stats->blocksTested, (unsigned long long) stats->bytesTested,
+			(double) stats->bytesTested * 8 / elapsedSecs / 1000, MicroRngQuality::computeShannonEntropy(stats),
+			MicroRngQuality::getTestName(worstTest), (unsigned long long) stats->tests[worstTest].passed,
+			(unsigned long long) stats->tests[worstTest].blocks);
+}
+
+/**
+ * Print the merged results of the quality tests
+ *
+ * @param const MicroRngQualityStats* stats - merged results
+ * @return true when all tests passed
+ */
+static bool printQualityReport(const MicroRngQualityStats *stats) {
+	printf("Test               Passed  Min passed  Uniformity  Min P-value  Result\n");
+	for (uint32_t t = 0; t < MCR_QUALITY_NUM_TESTS; t++) {
+		const MicroRngQualityTestStats *test = &stats->tests[t];
+		char uniformity[16];
+		if (test->blocks < MCR_QUALITY_UNIFORMITY_MIN_BLOCKS) {
+			snprintf(uniformity, sizeof(uniformity), "n/a");
+		} else {
+			snprintf(uniformity, sizeof(uniformity), "%.4f", MicroRngQuality::computeUniformity(test));
+		}
+		printf("%-14s %6llu/%-6llu %6llu  %10s  %11.6f  %s\n", MicroRngQuality::getTestName(t),
+				(unsigned long long) test->passed, (unsigned long long) test->blocks,
+				(unsigned long long) MicroRngQuality::computeMinPassed(test->blocks), uniformity, test->minPValue,
+				MicroRngQuality::isTestPassed(test) ? "PASS" : "FAIL");
+	}
+	double pValue;
+	double chiSquare = MicroRngQuality::computeChiSquare(stats->byteCounts, stats->bytesTested, &pValue);
+	printf("Shannon entropy ------------------------- %.6f bits per byte\n", MicroRngQuality::computeShannonEntropy(stats));
+	printf("Min-entropy estimate -------------------- %.6f bits per byte\n",
+			MicroRngQuality::computeMinEntropy(stats->byteCounts, stats->bytesTested));
+	printf("Lowest min-entropy estimate of a block -- %.6f bits per byte\n", stats->minBlockMinEntropy);
+	printf("Chi-square of byte frequencies ---------- %.2f, P-value %.4f\n", chiSquare, pValue);
+	printf("Proportion of one bits ------------------ %.6f\n",
+			(double) stats->ones / ((double) stats->bytesTested * 8));
+	return MicroRngQuality::isPassed(stats);
+}
+
+/**
+ * Stream random bytes from the device through the statistical quality tests without storing them
+ *
+ * @param MicroRngTransport* device - connected device
+ * @param uint64_t numBytes - amount of bytes to test, rounded up to whole blocks, 0 to test until interrupted
+ * @param uint32_t numThreads - number of test threads
+ * @param uint32_t blockBytes - bytes tested as one block
+ * @param uint32_t reportIntervalSecs - seconds between progress lines, 0 for no progress lines
+ * @return int - 0 when all tests passed
+ */
+static int runQualityTests(MicroRngTransport *device, uint64_t numBytes, uint32_t numThreads, uint32_t blockBytes,
+		uint32_t reportIntervalSecs) {
+	MicroRngQuality quality;
+	MicroRngQualityStats stats;
+	struct timespec start;
+	struct timespec now;
+
+	if (!quality.start(numThreads, blockBytes)) {
+		printf("Cannot start quality tests, error: %s\n", quality.getLastErrMsg());
+		return -1;
+	}
+	struct sigaction stopAction = { };
+	stopAction.sa_handler = handleStopSignal;
+	stopAction.sa_flags = SA_RESTART;
+	sigaction(SIGINT, &stopAction, nullptr);
+	sigaction(SIGTERM, &stopAction, nullptr);
+
+	uint64_t numBlocks = (numBytes + blockBytes - 1) / blockBytes;
+	printf("Running quality tests on blocks of %u bytes with %u threads%s\n", blockBytes, numThreads,
+			numBlocks == 0 ? ", press Ctrl-C to stop" : "");
+	if (numBlocks > 0) {
+		printf("Amount of blocks to test ------------------------------ %llu\n", (unsigned long long) numBlocks);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	double nextReportSecs = reportIntervalSecs;
+	bool status = true;
+	for (uint64_t block = 0; (numBlocks == 0 || block < numBlocks) && status; block++) {
+		uint8_t *bytes = quality.beginBlock();
+		// Retrieve in small pieces to stop promptly when interrupted
+		for (uint32_t offset = 0; offset < blockBytes && !isQualityStopRequested; offset += BLOCK_SIZE_TEST_BYTES) {
+			uint32_t len = blockBytes - offset < BLOCK_SIZE_TEST_BYTES ? blockBytes - offset : BLOCK_SIZE_TEST_BYTES;
+			status = device->retrieveRandomBytes((int) len, bytes + offset);
+			if (!status) {
+				printf("*FAILED* to retrieve random bytes, error: %s\n", device->getLastErrMsg());
+				break;
+			}
+		}
+		if (isQualityStopRequested || !status) {
+			break;
+		}
+		quality.commitBlock();
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		double elapsedSecs = computeElapsedSecs(&start, &now);
+		if (reportIntervalSecs > 0 && elapsedSecs >= nextReportSecs) {
+			quality.getStats(&stats);
+			printQualityProgress(&stats, elapsedSecs);
+			nextReportSecs = elapsedSecs + reportIntervalSecs;
+		}
+	}
+	quality.stop();
+	quality.getStats(&stats);
+	if (stats.blocksTested == 0) {
+		printf("No blocks tested\n");
+		return -1;
+	}
+	printf("Tested %llu bytes in %llu blocks\n", (unsigned long long) stats.bytesTested,
+			(unsigned long long) stats.blocksTested);
+	bool isPassed = printQualityReport(&stats);
+	printf("Quality tests ------------------------------------------ %s\n", isPassed ? " Passed" : "*FAILED*");
+	return isPassed && status ? 0 : -1;
+}
 
 int main(int argc, char **argv) {
 	MicroRngSPI spi;
+	MicroRngUART uart;
+	MicroRngTransport *device = &spi;
+	bool isUart = false;
+	bool isQualityMode = false;
+	uint64_t qualityBytes = 0;
+	uint32_t qualityThreads = (uint32_t) sysconf(_SC_NPROCESSORS_ONLN);
+	uint32_t qualityBlockBytes = MCR_QUALITY_DEFAULT_BLOCK_BYTES;
+	uint32_t reportIntervalSecs = QUALITY_DEFAULT_REPORT_INTERVAL_SECS;
+	char *devicePath = nullptr;
 	bool status;
 	uint8_t testBuff[BLOCK_SIZE_TEST_BYTES];
 	uint8_t rngStatus;
-	clock_t t;
+	struct timespec start;
+	struct timespec end;
 
 	printf("-------------------------------------------------------------------\n");
 	printf("--- TectroLabs - mcdiag - MicroRNG diagnostics utility Ver 1.1  ---\n");
@@ -49,75 +211,125 @@ int main(int argc, char **argv) {
 
 	setbuf(stdout, nullptr);
 
-	if (argc < 2) {
-		printf("Usage: mcdiag <spi device>\n");
+	for (int idx = 1; idx < argc; idx++) {
+		if ((strcmp("-tr", argv[idx]) == 0 || strcmp("--transport", argv[idx]) == 0) && idx + 1 < argc) {
+			if (strcmp("uart", argv[++idx]) == 0) {
+				isUart = true;
+			} else if (strcmp("spi", argv[idx]) != 0) {
+				printf("Unknown transport: %s\n", argv[idx]);
+				return -1;
+			}
+		} else if ((strcmp("-br", argv[idx]) == 0 || strcmp("--baud-rate", argv[idx]) == 0) && idx + 1 < argc) {
+			if (!uart.setBaudRate((uint32_t) atoi(argv[++idx]))) {
+				printf("%s\n", uart.getLastErrMsg());
+				return -1;
+			}
+		} else if (strcmp("-q", argv[idx]) == 0 || strcmp("--quality", argv[idx]) == 0) {
+			isQualityMode = true;
+		} else if ((strcmp("-nb", argv[idx]) == 0 || strcmp("--bytes", argv[idx]) == 0) && idx + 1 < argc) {
+			qualityBytes = (uint64_t) atoll(argv[++idx]);
+		} else if ((strcmp("-th", argv[idx]) == 0 || strcmp("--threads", argv[idx]) == 0) && idx + 1 < argc) {
+			qualityThreads = (uint32_t) atoi(argv[++idx]);
+		} else if ((strcmp("-bs", argv[idx]) == 0 || strcmp("--block-size", argv[idx]) == 0) && idx + 1 < argc) {
+			qualityBlockBytes = (uint32_t) atoi(argv[++idx]);
+		} else if ((strcmp("-ri", argv[idx]) == 0 || strcmp("--report-interval", argv[idx]) == 0) && idx + 1 < argc) {
+			reportIntervalSecs = (uint32_t) atoi(argv[++idx]);
+		} else {
+			devicePath = argv[idx];
+		}
+	}
+
+	if (devicePath == nullptr) {
+		printf("Usage: mcdiag [-tr spi|uart] [-br <uart baud rate>] [-q [-nb <bytes>] [-th <threads>] [-bs <block bytes>]\n");
+		printf("              [-ri <report interval seconds>]] <spi device or serial port>\n");
+		printf("  -q, --quality  stream random bytes through statistical tests after the diagnostics,\n");
+		printf("                 until <bytes> are tested or Ctrl-C is pressed when -nb is omitted\n");
+		printf("  -th, --threads  number of test worker threads, default: number of online CPU cores\n");
+		printf("  -bs, --block-size  bytes per tested block, between %d and %d, default: %d\n",
+				MCR_QUALITY_MIN_BLOCK_BYTES, MCR_QUALITY_MAX_BLOCK_BYTES, MCR_QUALITY_DEFAULT_BLOCK_BYTES);
+		printf("  -ri, --report-interval  seconds between progress lines, 0 for none, default: %d\n",
+				QUALITY_DEFAULT_REPORT_INTERVAL_SECS);
 		printf("Example: mcdiag /dev/spidev0.0\n");
+		printf("Example: mcdiag -tr uart -br 1500000 /dev/serial0\n");
+		printf("Example: mcdiag -q -nb 1000000000 /dev/spidev0.0\n");
 		return -1;
 	}
-
-	char *devicePath = argv[1];
+	if (isUart) {
+		device = &uart;
+	}
 
 	printf("Opening device %s ----------------------------- ", devicePath);
-	status = spi.connect(devicePath);
+	status = device->connect(devicePath);
 	if (!status) {
-		printf("*FAILED*, error: %s\n", spi.getLastErrMsg());
+		printf("*FAILED*, error: %s\n", device->getLastErrMsg());
 		return -1;
 	}
 	printf("Success\n");
 
 	// Make shure the RNG is turned on
-	spi.startUpNoiseSources(testBuff);
+	device->startUpNoiseSources(testBuff);
 
 	printf("Identifying device %s -------------- ", devicePath);
-	status = spi.validateCommunication();
+	status = device->validateCommunication();
 	if (!status) {
 		printf("MicroRNG not found\n");
 		return -1;
 	}
 	printf(" MicroRNG detected\n");
 
-	printf("Identifying maximum SPI clock frequency --------------- ");
-	status = spi.autodetectMaxFrequency();
-	if (!status) {
-		printf("*FAILED*, error: %s\n", spi.getLastErrMsg());
-		return -1;
-	}
-	printf("%8ld Hz\n", (long) spi.getMaxClockFrequency());
+	if (isUart) {
+		printf("UART baud rate ------------------------------------ %8u baud\n", uart.getBaudRate());
+	} else {
+		printf("Identifying maximum SPI clock frequency --------------- ");
+		status = spi.autodetectMaxFrequency();
+		if (!status) {
+			printf("*FAILED*, error: %s\n", spi.getLastErrMsg());
+			return -1;
+		}
+		printf("%8ld Hz\n", (long) spi.getDetectedMaxClockFrequency());
 
-	printf("New SPI clock frequency ------------------------------- ");
-	printf("%8ld Hz\n", (long) spi.getMaxClockFrequency());
+		printf("Saving calibrated SPI clock frequency ----------------- ");
+		if (spi.saveCalibration()) {
+			printf(" Success\n");
+		} else {
+			printf(" Skipped\n");
+		}
+
+		printf("New SPI clock frequency ------------------------------- ");
+		printf("%8ld Hz\n", (long) spi.getMaxClockFrequency());
+	}
 
 	printf("Retrieving %d random bytes ----------------------------- ",
 			BLOCK_SIZE_TEST_BYTES);
-	status = spi.retrieveRandomBytes(BLOCK_SIZE_TEST_BYTES, testBuff);
+	status = device->retrieveRandomBytes(BLOCK_SIZE_TEST_BYTES, testBuff);
 	if (!status) {
-		printf("*FAILED*, error: %s\n", spi.getLastErrMsg());
+		printf("*FAILED*, error: %s\n", device->getLastErrMsg());
 		return -1;
 	}
 	printf("Success\n");
 
 	printf("Retrieving %d RAW random bytes ------------------------- ",
 			BLOCK_SIZE_TEST_BYTES);
-	status = spi.retrieveRawRandomBytes(BLOCK_SIZE_TEST_BYTES, testBuff);
+	status = device->retrieveRawRandomBytes(BLOCK_SIZE_TEST_BYTES, testBuff);
 	if (!status) {
-		printf("*FAILED*, error: %s\n", spi.getLastErrMsg());
+		printf("*FAILED*, error: %s\n", device->getLastErrMsg());
 		return -1;
 	}
 	printf("Success\n");
 
 	printf("Retrieving %d random bytes ----------------------------- ",
 			BLOCK_SIZE_TEST_BYTES);
-	status = spi.retrieveRandomBytes(BLOCK_SIZE_TEST_BYTES, testBuff);
+	status = device->retrieveRandomBytes(BLOCK_SIZE_TEST_BYTES, testBuff);
 	if (!status) {
-		printf("*FAILED*, error: %s\n", spi.getLastErrMsg());
+		printf("*FAILED*, error: %s\n", device->getLastErrMsg());
 		return -1;
 	}
 	printf("Success\n");
 
 	printf("Shutting down RNG ----------------------------------------- ");
-	status = spi.shutDownNoiseSources(testBuff);
+	status = device->shutDownNoiseSources(testBuff);
 	if (!status) {
-		printf("*FAILED*, error: %s\n", spi.getLastErrMsg());
+		printf("*FAILED*, error: %s\n", device->getLastErrMsg());
 		return -1;
 	}
 	if (testBuff[0] == 200) {
@@ -128,9 +340,9 @@ int main(int argc, char **argv) {
 	}
 
 	printf("Starting RNG up ------------------------------------------- ");
-	status = spi.startUpNoiseSources(testBuff);
+	status = device->startUpNoiseSources(testBuff);
 	if (!status) {
-		printf("*FAILED*, error: %s\n", spi.getLastErrMsg());
+		printf("*FAILED*, error: %s\n", device->getLastErrMsg());
 		return -1;
 	}
 	if (testBuff[0] == 0) {
@@ -140,25 +352,27 @@ int main(int argc, char **argv) {
 		return -1;
 	}
 
-	printf("Computing SPI transfer speed ----------------------------");
-	t = clock();
+	printf(isUart ? "Computing UART transfer speed ---------------------------"
+			: "Computing SPI transfer speed ----------------------------");
+	clock_gettime(CLOCK_MONOTONIC, &start);
 	for (int i = 0; i < TEST_RETRIEVE_BLOCKS; i++) {
-		status = spi.retrieveRandomBytes(BLOCK_SIZE_TEST_BYTES, testBuff);
+		status = device->retrieveRandomBytes(BLOCK_SIZE_TEST_BYTES, testBuff);
 		if (!status) {
-			printf("*FAILED*, error: %s\n", spi.getLastErrMsg());
+			printf("*FAILED*, error: %s\n", device->getLastErrMsg());
 			return -1;
 		}
 	}
-	t = clock() - t;
-	double durationSecs = ((double) t) / CLOCKS_PER_SEC;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	// Wall-clock time, the transfer mostly waits for the SPI controller rather than using the CPU
+	double durationSecs = computeElapsedSecs(&start, &end);
 	double kbitsPerSecond = (double) (BLOCK_SIZE_TEST_BYTES
-			* TEST_RETRIEVE_BLOCKS * 8) / durationSecs / 1024;
+			* TEST_RETRIEVE_BLOCKS * 8) / durationSecs / 1000;
 	printf("%5.0f kbps\n", kbitsPerSecond);
 
 	printf("Validating MicroRNG internal status  ---------------------- ");
-	status = spi.retrieveDeviceStatusByte(&rngStatus);
+	status = device->retrieveDeviceStatusByte(&rngStatus);
 	if (!status) {
-		printf("*FAILED*, error: %s\n", spi.getLastErrMsg());
+		printf("*FAILED*, error: %s\n", device->getLastErrMsg());
 		return -1;
 	}
 	if (rngStatus == 0) {
@@ -168,5 +382,8 @@ int main(int argc, char **argv) {
 		return -1;
 	}
 
+	if (isQualityMode) {
+		return runQualityTests(device, qualityBytes, qualityThreads, qualityBlockBytes, reportIntervalSecs);
+	}
 	return 0;
 }
@@ -61,12 +61,119 @@ static void displayUsage() {
     printf("\n");
     printf("     -dp PATH, --device-path PATH\n");
     printf("           SPI device path, default value: /dev/spidev0.0\n");
+    printf("           or serial port path, default value: /dev/serial0\n");
+    printf("           repeat this option to retrieve from up to %d SPI devices in parallel\n", MCR_POOL_MAX_DEVICES);
+    printf("\n");
+    printf("     -tr TRANSPORT, --transport TRANSPORT\n");
+    printf("           interface the device is connected through, default value: spi\n");
+    printf("           spi  - SPI interface, up to 1 Mbps\n");
+    printf("           uart - 2-wire UART interface, up to 1.5 Mbps\n");
+    printf("\n");
+    printf("     -br NUMBER, --baud-rate NUMBER\n");
+    printf("           UART baud rate the device is configured for, max value %d,\n", MCR_UART_MAX_BAUD_RATE);
+    printf("           default value: %d (factory default)\n", MCR_UART_DEFAULT_BAUD_RATE);
+    printf("\n");
+    printf("     -cm MODE, --combine-mode MODE\n");
+    printf("           way of combining bytes of multiple devices, default value: interleave\n");
+    printf("           interleave - each device retrieves a stripe of every chunk\n");
+    printf("           xor        - each device retrieves every chunk, results are XOR-ed\n");
     printf("\n");
     printf("     -cf NUMBER, --clock-frequency NUMBER\n");
     printf("           SPI master clock frequency in KHz, max value 60000,\n");
-    printf("           skip this option for default 250 KHz frequency.\n");
+    printf("           skip this option for the max frequency calibrated for the device,\n");
+    printf("           detected on first use and kept in %s.\n", MCR_SPI_CALIBRATION_CACHE_DIR);
     printf("           Setting this value too high may result in miscommunication.\n");
-    printf("           Use 'mcdiag' utility to determine the max frequency.\n");
+    printf("           Use 'mcdiag' utility to re-calibrate the max frequency.\n");
+    printf("\n");
+    printf("     -ac, --adaptive-clock\n");
+    printf("           check the communication periodically with test bytes, drop the\n");
+    printf("           SPI clock frequency a step on errors and retry, then probe it\n");
+    printf("           back up to the max frequency once the communication is stable\n");
+    printf("\n");
+    printf("     -rr NUMBER, --retries NUMBER\n");
+    printf("           retry a failed chunk retrieval up to NUMBER times, resynchronizing\n");
+    printf("           with the device and reopening it when needed, with a backoff\n");
+    printf("           doubling from 1 ms up to 100 ms, 0 to disable, default value: %d\n", MCR_SPI_DEFAULT_MAX_RETRIES);
+    printf("\n");
+    printf("     -dv, --defer-validation\n");
+    printf("           identify the SPI device within the first chunk exchanged instead\n");
+    printf("           of before it, saves a round trip for short downloads\n");
+    printf("\n");
+    printf("     -cs NUMBER, --chunk-size NUMBER\n");
+    printf("           NUMBER of random bytes retrieved from the device per chunk,\n");
+    printf("           max value 16777216, default value: 32000\n");
+    printf("\n");
+    printf("     -qd NUMBER, --queue-depth NUMBER\n");
+    printf("           NUMBER of chunks buffered between the device and the output,\n");
+    printf("           max value 1024, default value: 4\n");
+    printf("\n");
+    printf("     -om MODE, --output-mode MODE\n");
+    printf("           output backend MODE, default value: stdio\n");
+    printf("           stdio  - buffered stream\n");
+    printf("           write  - unbuffered write(2) of aligned buffers\n");
+    printf("           direct - O_DIRECT file writes, requires a file name\n");
+    printf("           and a chunk size that is a multiple of 4096\n");
+    printf("           splice - vmsplice(2) into a pipe, requires STDOUT to be\n");
+    printf("           a pipe read by the consumer (not spliced further)\n");
+    printf("           uring  - io_uring writes of chunk buffers registered with\n");
+    printf("           the ring, up to queue depth writes in flight to a file\n");
+    printf("\n");
+    printf("     -pp METHOD, --post-process METHOD\n");
+    printf("           retrieve raw random bytes and condition them on the host\n");
+    printf("           sha256 - SHA-256 of each block of raw random bytes\n");
+    printf("           drbg   - ChaCha20 DRBG reseeded with each %d raw random bytes\n", MCR_DRBG_SEED_BYTES);
+    printf("\n");
+    printf("     -pr OUT:IN, --post-process-ratio OUT:IN\n");
+    printf("           OUT bytes produced for each IN raw random bytes,\n");
+    printf("           default value: 1:2 for sha256, 64:1 for drbg\n");
+    printf("\n");
+    printf("     -ex, --expand\n");
+    printf("           expand random bytes with a ChaCha20 DRBG seeded from the device,\n");
+    printf("           a background thread reseeds it with %d random bytes\n", MCR_EXPANDER_SEED_BYTES);
+    printf("           on a byte budget and at a fixed interval\n");
+    printf("\n");
+    printf("     -rb NUMBER, --reseed-bytes NUMBER\n");
+    printf("           reseed the expansion after NUMBER of bytes, min value %d,\n", MCR_EXPANDER_MIN_RESEED_BYTES);
+    printf("           max value %d, default value: %d\n", MCR_EXPANDER_MAX_RESEED_BYTES, MCR_EXPANDER_DEFAULT_RESEED_BYTES);
+    printf("\n");
+    printf("     -ri NUMBER, --reseed-interval NUMBER\n");
+    printf("           reseed the expansion at least every NUMBER of milliseconds,\n");
+    printf("           default value: %d\n", MCR_EXPANDER_DEFAULT_RESEED_MSECS);
+    printf("\n");
+    printf("     -ht ACTION, --health-test ACTION\n");
+    printf("           run SP 800-90B repetition count and adaptive proportion tests\n");
+    printf("           on every retrieved chunk, before post-processing, or on every\n");
+    printf("           expansion seed, ACTION on failure:\n");
+    printf("           stop - stop the download before writing the failing chunk\n");
+    printf("           flag - report the failure to standard error and continue\n");
+    printf("\n");
+    printf("     -hc, --health-chi-square\n");
+    printf("           also run a byte frequency chi-square test for each %d bytes,\n", MCR_HEALTH_CHI_SQUARE_BLOCK_BYTES);
+    printf("           requires -ht option\n");
+    printf("\n");
+    printf("     -rt NUMBER, --real-time NUMBER\n");
+    printf("           retrieve chunks with a SCHED_FIFO thread of priority NUMBER,\n");
+    printf("           between 1 and 99, and lock all memory with mlockall(2);\n");
+    printf("           requires a single device and root or CAP_SYS_NICE permissions\n");
+    printf("\n");
+    printf("     -cp NUMBER, --cpu NUMBER\n");
+    printf("           pin the thread retrieving chunks to CPU core NUMBER\n");
+    printf("\n");
+    printf("     -ci NUMBER, --checkpoint-interval NUMBER\n");
+    printf("           sync the output file and record the committed offset and SHA-256\n");
+    printf("           hash in FILE%s after every NUMBER of bytes written, rounded to\n", MCR_CHECKPOINT_SUFFIX);
+    printf("           whole chunks, default value with -rs: %d\n", MCR_DEFAULT_CHECKPOINT_BYTES);
+    printf("\n");
+    printf("     -rs, --resume\n");
+    printf("           continue an interrupted download from the last checkpoint of the\n");
+    printf("           output file after verifying the committed bytes against its hash,\n");
+    printf("           or start a new download with checkpoints when there is none;\n");
+    printf("           the checkpoint file is removed once the download completes\n");
+    printf("\n");
+    printf("     -st, --stats\n");
+    printf("           print SPI transfer counters and ioctl latencies to standard error\n");
+    printf("           at exit, counters are also printed when receiving SIGUSR1;\n");
+    printf("           chunk retrieval times and scheduling delays are printed at exit\n");
     printf("EXAMPLES:\n");
     printf("     It may require 'sudo' permissions to run this utility.\n");
     printf("     To download 12 MB of true random bytes to 'rnd.bin' file\n");
@@ -75,6 +182,14 @@ static void displayUsage() {
     printf("           mcrng  -dd -fn rnd.bin -nb 12000000 -dp /dev/spidev0.0\n");
     printf("     To download 12 MB of true random bytes to standard output\n");
     printf("           mcrng  -dd -fn STDOUT -nb 12000000 -dp /dev/spidev0.0\n");
+    printf("     To download 12 MB of true random bytes through the UART interface at 1.5 Mbps\n");
+    printf("           mcrng  -dd -fn rnd.bin -nb 12000000 -tr uart -br 1500000 -dp /dev/serial0\n");
+    printf("     To expand 1 GB of random bytes reseeded after each 1 MB to a file\n");
+    printf("           mcrng  -dd -fn rnd.bin -nb 1000000000 -ex -rb 1000000\n");
+    printf("     To download 12 MB with a real-time thread of priority 50 pinned to core 3\n");
+    printf("           mcrng  -dd -fn rnd.bin -nb 12000000 -rt 50 -cp 3 -st\n");
+    printf("     To download 100 GB of true random bytes, run again after a failure to continue\n");
+    printf("           mcrng  -dd -fn rnd.bin -nb 100000000000 -rs\n");
     printf("\n");
 }
 
@@ -109,7 +224,11 @@ static int parseDevicePath(int idx, int argc, char **argv) {
 			if (validateArgumentCount(++idx, argc) == false) {
 				return -1;
 			}
-			strcpy(devicePath, argv[idx++]);
+			if (numDevicePaths >= MCR_POOL_MAX_DEVICES) {
+				fprintf(stderr, "Cannot use more than %d devices\n", MCR_POOL_MAX_DEVICES);
+				return -1;
+			}
+			strcpy(devicePaths[numDevicePaths++], argv[idx++]);
 		}
 	}
 	return 0;
@@ -124,7 +243,6 @@ static int parseDevicePath(int idx, int argc, char **argv) {
  */
 static int processArguments(int argc, char **argv) {
 	int idx = 1;
-	strcpy(devicePath, DEFAULT_SPI_DEV_PATH);
 	if (argc < 2) {
 		displayUsage();
 		return -1;
@@ -152,6 +270,177 @@ static int processArguments(int argc, char **argv) {
 				return -1;
 			}
 			maxSpiMasterClock = (uint32_t) atoi(argv[idx++]) * 1000;
+			isClockFrequencySpecified = true;
+		} else if (strcmp("-ac", argv[idx]) == 0
+				|| strcmp("--adaptive-clock", argv[idx]) == 0) {
+			isAdaptiveClock = true;
+			++idx;
+		} else if (strcmp("-rr", argv[idx]) == 0
+				|| strcmp("--retries", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			if (atoi(argv[idx]) < 0) {
+				fprintf(stderr, "Number of retries cannot be negative\n");
+				return -1;
+			}
+			maxRetries = (uint32_t) atoi(argv[idx++]);
+		} else if (strcmp("-dv", argv[idx]) == 0
+				|| strcmp("--defer-validation", argv[idx]) == 0) {
+			isValidationDeferred = true;
+			++idx;
+		} else if (strcmp("-cs", argv[idx]) == 0
+				|| strcmp("--chunk-size", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			int64_t value = atoll(argv[idx++]);
+			if (value <= 0 || value > MCR_MAX_CHUNK_SIZE_BYTES) {
+				fprintf(stderr, "Chunk size must be between 1 and %d\n", MCR_MAX_CHUNK_SIZE_BYTES);
+				return -1;
+			}
+			chunkSizeBytes = (uint32_t) value;
+		} else if (strcmp("-qd", argv[idx]) == 0
+				|| strcmp("--queue-depth", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			int value = atoi(argv[idx++]);
+			if (value <= 0 || value > MCR_MAX_QUEUE_DEPTH) {
+				fprintf(stderr, "Queue depth must be between 1 and %d\n", MCR_MAX_QUEUE_DEPTH);
+				return -1;
+			}
+			queueDepth = (uint32_t) value;
+		} else if (strcmp("-om", argv[idx]) == 0
+				|| strcmp("--output-mode", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			if (parseOutputMode(argv[idx++]) == -1) {
+				return -1;
+			}
+		} else if (strcmp("-pp", argv[idx]) == 0
+				|| strcmp("--post-process", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			if (parsePostProcess(argv[idx++]) == -1) {
+				return -1;
+			}
+		} else if (strcmp("-pr", argv[idx]) == 0
+				|| strcmp("--post-process-ratio", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			if (parsePostProcessRatio(argv[idx++]) == -1) {
+				return -1;
+			}
+		} else if (strcmp("-ex", argv[idx]) == 0
+				|| strcmp("--expand", argv[idx]) == 0) {
+			isExpansionEnabled = true;
+			++idx;
+		} else if (strcmp("-rb", argv[idx]) == 0
+				|| strcmp("--reseed-bytes", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			int64_t value = atoll(argv[idx++]);
+			if (value < MCR_EXPANDER_MIN_RESEED_BYTES || value > MCR_EXPANDER_MAX_RESEED_BYTES) {
+				fprintf(stderr, "Reseed byte budget must be between %d and %d\n",
+						MCR_EXPANDER_MIN_RESEED_BYTES, MCR_EXPANDER_MAX_RESEED_BYTES);
+				return -1;
+			}
+			expansionReseedBytes = (uint32_t) value;
+		} else if (strcmp("-ri", argv[idx]) == 0
+				|| strcmp("--reseed-interval", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			int64_t value = atoll(argv[idx++]);
+			if (value <= 0 || value > 86400000) {
+				fprintf(stderr, "Reseed interval must be between 1 and 86400000 milliseconds\n");
+				return -1;
+			}
+			expansionReseedIntervalMs = (uint32_t) value;
+		} else if (strcmp("-ht", argv[idx]) == 0
+				|| strcmp("--health-test", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			if (parseHealthAction(argv[idx++]) == -1) {
+				return -1;
+			}
+		} else if (strcmp("-hc", argv[idx]) == 0
+				|| strcmp("--health-chi-square", argv[idx]) == 0) {
+			isChiSquareEnabled = true;
+			++idx;
+		} else if (strcmp("-rt", argv[idx]) == 0
+				|| strcmp("--real-time", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			realTimePriority = atoi(argv[idx++]);
+			if (realTimePriority < sched_get_priority_min(SCHED_FIFO)
+					|| realTimePriority > sched_get_priority_max(SCHED_FIFO)) {
+				fprintf(stderr, "Real-time priority must be between %d and %d\n",
+						sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO));
+				return -1;
+			}
+		} else if (strcmp("-cp", argv[idx]) == 0
+				|| strcmp("--cpu", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			acquisitionCpu = atoi(argv[idx++]);
+			if (acquisitionCpu < 0 || acquisitionCpu >= sysconf(_SC_NPROCESSORS_CONF) || acquisitionCpu >= CPU_SETSIZE) {
+				fprintf(stderr, "CPU core must be between 0 and %ld\n", sysconf(_SC_NPROCESSORS_CONF) - 1);
+				return -1;
+			}
+		} else if (strcmp("-ci", argv[idx]) == 0
+				|| strcmp("--checkpoint-interval", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			int64_t value = atoll(argv[idx++]);
+			if (value <= 0) {
+				fprintf(stderr, "Checkpoint interval must be a positive number\n");
+				return -1;
+			}
+			checkpointIntervalBytes = (uint64_t) value;
+		} else if (strcmp("-rs", argv[idx]) == 0
+				|| strcmp("--resume", argv[idx]) == 0) {
+			isResumeRequested = true;
+			++idx;
+		} else if (strcmp("-st", argv[idx]) == 0
+				|| strcmp("--stats", argv[idx]) == 0) {
+			isStatsReportEnabled = true;
+			++idx;
+		} else if (strcmp("-tr", argv[idx]) == 0
+				|| strcmp("--transport", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			if (parseTransport(argv[idx++]) == -1) {
+				return -1;
+			}
+		} else if (strcmp("-br", argv[idx]) == 0
+				|| strcmp("--baud-rate", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			uartBaudRate = (uint32_t) atoi(argv[idx++]);
+			if (!uart.setBaudRate(uartBaudRate)) {
+				fprintf(stderr, "%s\n", uart.getLastErrMsg());
+				return -1;
+			}
+		} else if (strcmp("-cm", argv[idx]) == 0
+				|| strcmp("--combine-mode", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			if (parseCombineMode(argv[idx++]) == -1) {
+				return -1;
+			}
 		} else if (parseDevicePath(idx, argc, argv) == -1) {
 			return -1;
 		} else {
@@ -159,142 +448,1438 @@ static int processArguments(int argc, char **argv) {
 			++idx;
 		}
 	}
+	if (numDevicePaths == 0) {
+		strcpy(devicePaths[numDevicePaths++],
+				transportType == MCR_TRANSPORT_UART ? DEFAULT_UART_DEV_PATH : DEFAULT_SPI_DEV_PATH);
+	}
+	if (transportType == MCR_TRANSPORT_UART && numDevicePaths > 1) {
+		fprintf(stderr, "UART transport supports a single device\n");
+		return -1;
+	}
+	if (isChiSquareEnabled && healthAction == MCR_HEALTH_ACTION_NONE) {
+		fprintf(stderr, "Chi-square test requires -ht option\n");
+		return -1;
+	}
+	if (isExpansionEnabled && postProcess != MCR_POST_PROCESS_NONE) {
+		fprintf(stderr, "Expansion cannot be combined with post-processing\n");
+		return -1;
+	}
+	if ((realTimePriority > 0 || acquisitionCpu >= 0) && numDevicePaths > 1) {
+		fprintf(stderr, "Real-time mode and CPU pinning require a single device\n");
+		return -1;
+	}
+	if (isResumeRequested && checkpointIntervalBytes == 0) {
+		checkpointIntervalBytes = MCR_DEFAULT_CHECKPOINT_BYTES;
+	}
+	if (checkpointIntervalBytes > 0) {
+		if (filePathName == nullptr || !strcmp(filePathName, "STDOUT") || !strcmp(filePathName, "/dev/stdout")) {
+			fprintf(stderr, "Checkpoints require a file name\n");
+			return -1;
+		}
+		if (strlen(filePathName) + strlen(MCR_CHECKPOINT_SUFFIX) >= sizeof(checkpointPath)) {
+			fprintf(stderr, "File name is too long for a checkpoint file: %s\n", filePathName);
+			return -1;
+		}
+		sprintf(checkpointPath, "%s%s", filePathName, MCR_CHECKPOINT_SUFFIX);
+	}
+	if (postProcessOutputRatio == 0) {
+		postProcessOutputRatio = postProcess == MCR_POST_PROCESS_DRBG ? 64 : 1;
+		postProcessInputRatio = postProcess == MCR_POST_PROCESS_DRBG ? 1 : 2;
+	}
+	if (postProcess == MCR_POST_PROCESS_SHA256 && (postProcessOutputRatio > postProcessInputRatio
+			|| postProcessInputRatio > postProcessOutputRatio * MCR_SHA256_MAX_INPUT_RATIO)) {
+		fprintf(stderr, "SHA-256 post-processing needs between 1 and %d raw bytes per output byte\n",
+				MCR_SHA256_MAX_INPUT_RATIO);
+		return -1;
+	}
+	if (postProcess == MCR_POST_PROCESS_DRBG && (MCR_DRBG_SEED_BYTES * postProcessOutputRatio < postProcessInputRatio
+			|| postProcessOutputRatio > postProcessInputRatio * MCR_DRBG_MAX_OUTPUT_RATIO)) {
+		fprintf(stderr, "DRBG post-processing needs at least 1 output byte per %d raw bytes and max %d output bytes per raw byte\n",
+				MCR_DRBG_SEED_BYTES, MCR_DRBG_MAX_OUTPUT_RATIO);
+		return -1;
+	}
 	return processDownloadRequest();
 }
 
 /**
- * Close file handle
+ * Parse output backend name
  *
+ * @param const char* modeName - name of the output backend
+ * @return int - 0 when successfully parsed
  */
-static void closeHandle() {
-	if (pOutputFile != nullptr) {
-		fclose(pOutputFile);
-		pOutputFile = nullptr;
+static int parseOutputMode(const char *modeName) {
+	if (strcmp("stdio", modeName) == 0) {
+		outputMode = MCR_OUTPUT_STDIO;
+	} else if (strcmp("write", modeName) == 0) {
+		outputMode = MCR_OUTPUT_WRITE;
+	} else if (strcmp("direct", modeName) == 0) {
+		outputMode = MCR_OUTPUT_DIRECT;
+	} else if (strcmp("splice", modeName) == 0) {
+		outputMode = MCR_OUTPUT_SPLICE;
+	} else if (strcmp("uring", modeName) == 0) {
+		outputMode = MCR_OUTPUT_URING;
+	} else {
+		fprintf(stderr, "Unknown output mode: %s\n", modeName);
+		return -1;
 	}
+	return 0;
 }
 
 /**
- * Write bytes out to the file
+ * Parse the way of combining random bytes of multiple devices
  *
- * @param const uint8_t* bytes - pointer to the byte array
- * @param uint32_t numBytes - number of bytes to write
+ * @param const char* modeName - name of the combine mode
+ * @return int - 0 when successfully parsed
  */
-static void writeBytes(const uint8_t *bytes, uint32_t numBytes) {
-	FILE *handle = pOutputFile;
-	fwrite(bytes, 1, numBytes, handle);
+static int parseCombineMode(const char *modeName) {
+	if (strcmp("interleave", modeName) == 0) {
+		combineMode = MCR_POOL_INTERLEAVE;
+	} else if (strcmp("xor", modeName) == 0) {
+		combineMode = MCR_POOL_XOR;
+	} else {
+		fprintf(stderr, "Unknown combine mode: %s\n", modeName);
+		return -1;
+	}
+	return 0;
 }
 
 /**
- * Handle download request
+ * Parse device interface name
  *
- * @return int - 0 when run successfully
+ * @param const char* transportName - name of the interface
+ * @return int - 0 when successfully parsed
  */
-static int handleDownloadRequest() {
-
-	uint8_t receiveByteBuffer[MCR_BUFF_FILE_SIZE_BYTES];
-
-	if (!spi.connect(devicePath)) {
-		fprintf(stderr, " Cannot open SPI device %s, error: %s ... \n",
-				devicePath, spi.getLastErrMsg());
+static int parseTransport(const char *transportName) {
+	if (strcmp("spi", transportName) == 0) {
+		transportType = MCR_TRANSPORT_SPI;
+		pDevice = &spi;
+	} else if (strcmp("uart", transportName) == 0) {
+		transportType = MCR_TRANSPORT_UART;
+		pDevice = &uart;
+	} else {
+		fprintf(stderr, "Unknown transport: %s\n", transportName);
 		return -1;
 	}
+	return 0;
+}
 
-	spi.setMaxClockFrequency(maxSpiMasterClock);
-
-	if (!spi.validateDevice()) {
-		fprintf(stderr, " Cannot access device, error: %s ... \n",
-				spi.getLastErrMsg());
+/**
+ * Parse the response to a failed health test
+ *
+ * @param const char* actionName - name of the response
+ * @return int - 0 when successfully parsed
+ */
+static int parseHealthAction(const char *actionName) {
+	if (strcmp("stop", actionName) == 0) {
+		healthAction = MCR_HEALTH_ACTION_STOP;
+	} else if (strcmp("flag", actionName) == 0) {
+		healthAction = MCR_HEALTH_ACTION_FLAG;
+	} else {
+		fprintf(stderr, "Unknown health test action: %s\n", actionName);
 		return -1;
 	}
+	return 0;
+}
 
-	if (filePathName == nullptr) {
-		fprintf(stderr, "No file name defined.\n");
+/**
+ * Parse the host side conditioning method
+ *
+ * @param const char* processName - name of the conditioning method
+ * @return int - 0 when successfully parsed
+ */
+static int parsePostProcess(const char *processName) {
+	if (strcmp("sha256", processName) == 0) {
+		postProcess = MCR_POST_PROCESS_SHA256;
+	} else if (strcmp("drbg", processName) == 0) {
+		postProcess = MCR_POST_PROCESS_DRBG;
+	} else {
+		fprintf(stderr, "Unknown post-process method: %s\n", processName);
 		return -1;
 	}
+	return 0;
+}
 
-	if (isOutputToStandardOutput == true) {
-		pOutputFile = fdopen(dup(fileno(stdout)), "wb");
-	} else {
-		pOutputFile = fopen(filePathName, "wb");
+/**
+ * Parse the output to input ratio of the conditioning
+ *
+ * @param const char* ratio - ratio as OUT:IN
+ * @return int - 0 when successfully parsed
+ */
+static int parsePostProcessRatio(const char *ratio) {
+	unsigned int outputBytes;
+	unsigned int inputBytes;
+	if (sscanf(ratio, "%u:%u", &outputBytes, &inputBytes) != 2 || outputBytes == 0 || inputBytes == 0
+			|| outputBytes > MCR_DRBG_MAX_OUTPUT_RATIO || inputBytes > MCR_DRBG_MAX_OUTPUT_RATIO) {
+		fprintf(stderr, "Invalid post-process ratio: %s\n", ratio);
+		return -1;
 	}
+	postProcessOutputRatio = outputBytes;
+	postProcessInputRatio = inputBytes;
+	return 0;
+}
 
-	if (pOutputFile == nullptr) {
-		fprintf(stderr, "Cannot open file: %s in write mode\n", filePathName);
-		return -1;
+/**
+ * Compute how many raw random bytes are conditioned into a chunk
+ *
+ * @param uint32_t numBytes - number of bytes in the chunk
+ * @return uint32_t - number of raw random bytes
+ */
+static uint32_t computeRawBytes(uint32_t numBytes) {
+	if (postProcess == MCR_POST_PROCESS_SHA256) {
+		uint64_t blockInputBytes = ((uint64_t) SHA256_DIGEST_BYTES * postProcessInputRatio + postProcessOutputRatio - 1)
+				/ postProcessOutputRatio;
+		uint64_t numBlocks = (numBytes + SHA256_DIGEST_BYTES - 1) / SHA256_DIGEST_BYTES;
+		return (uint32_t) (numBlocks * blockInputBytes);
 	}
+	uint64_t segmentBytes = (uint64_t) MCR_DRBG_SEED_BYTES * postProcessOutputRatio / postProcessInputRatio;
+	uint64_t numSegments = (numBytes + segmentBytes - 1) / segmentBytes;
+	return (uint32_t) (numSegments * MCR_DRBG_SEED_BYTES);
+}
 
-	while (numGenBytes == -1) {
-		// Infinite loop for downloading unlimited random bytes
-		if (!spi.retrieveRandomBytes(MCR_BUFF_FILE_SIZE_BYTES,
-				receiveByteBuffer)) {
-			fprintf(stderr,
-					"Failed to receive %d bytes for unlimited download, error: %s. \n",
-					MCR_BUFF_FILE_SIZE_BYTES, spi.getLastErrMsg());
-			return -1;
+/**
+ * Condition raw random bytes into a chunk
+ *
+ * @param const uint8_t* rawChunk - raw random bytes, as many as computeRawBytes() returns for the chunk
+ * @param uint8_t* chunk - pointer to receiving conditioned bytes
+ * @param uint32_t numBytes - number of bytes in the chunk
+ */
+static void conditionChunk(const uint8_t *rawChunk, uint8_t *chunk, uint32_t numBytes) {
+	uint8_t digest[SHA256_DIGEST_BYTES];
+	if (postProcess == MCR_POST_PROCESS_SHA256) {
+		uint32_t blockInputBytes = (uint32_t) (((uint64_t) SHA256_DIGEST_BYTES * postProcessInputRatio
+				+ postProcessOutputRatio - 1) / postProcessOutputRatio);
+		for (uint32_t offset = 0; offset < numBytes; offset += SHA256_DIGEST_BYTES) {
+			uint32_t blockBytes = numBytes - offset < SHA256_DIGEST_BYTES ? numBytes - offset : SHA256_DIGEST_BYTES;
+			Sha256::hash(rawChunk, blockInputBytes, digest);
+			memcpy(chunk + offset, digest, blockBytes);
+			rawChunk += blockInputBytes;
 		}
-		writeBytes(receiveByteBuffer, MCR_BUFF_FILE_SIZE_BYTES);
+		memset(digest, 0, sizeof(digest));
+		return;
+	}
+	uint32_t segmentBytes = (uint32_t) ((uint64_t) MCR_DRBG_SEED_BYTES * postProcessOutputRatio / postProcessInputRatio);
+	for (uint32_t offset = 0; offset < numBytes; offset += segmentBytes) {
+		drbg.reseed(rawChunk, MCR_DRBG_SEED_BYTES);
+		drbg.generate(chunk + offset, numBytes - offset < segmentBytes ? numBytes - offset : segmentBytes);
+		rawChunk += MCR_DRBG_SEED_BYTES;
 	}
+}
 
-	// Calculate number of complete random byte chunks to download
-	int64_t numCompleteChunks = numGenBytes / MCR_BUFF_FILE_SIZE_BYTES;
+/**
+ * Set the clock frequency of a connected device and validate it
+ *
+ * @param MicroRngSPI& device - connected device
+ * @param const char* path - device path for error messages
+ * @return int - 0 when run successfully
+ */
+static int prepareDevice(MicroRngSPI &device, const char *path) {
+	device.setLatencyHistogramEnabled(isStatsReportEnabled);
+	// Set before calibrating, so a cached clock frequency is checked by the deferred probe
+	device.setDeferredValidation(isValidationDeferred);
+	if (isClockFrequencySpecified) {
+		device.setMaxClockFrequency(maxSpiMasterClock);
+	} else if (!device.calibrateClockFrequency()) {
+		fprintf(stderr, " Cannot calibrate SPI clock frequency of %s, error: %s ... \n",
+				path, device.getLastErrMsg());
+		return -1;
+	}
+	device.setAdaptiveClock(isAdaptiveClock, 0, 0);
+	device.setErrorRecovery(maxRetries, MCR_SPI_DEFAULT_RETRY_BACKOFF_USECS);
 
-	// Calculate number of bytes in the last incomplete chunk
-	uint32_t chunkRemaindBytes = (uint32_t) (numGenBytes
-			% MCR_BUFF_FILE_SIZE_BYTES);
+	if (!device.validateDevice()) {
+		fprintf(stderr, " Cannot access device %s, error: %s ... \n",
+				path, device.getLastErrMsg());
+		return -1;
+	}
+	return 0;
+}
 
-	// Process each chunk
-	for (int64_t chunkNum = 0; chunkNum < numCompleteChunks; chunkNum++) {
-		if (!spi.retrieveRandomBytes(MCR_BUFF_FILE_SIZE_BYTES,
-				receiveByteBuffer)) {
-			fprintf(stderr, "Failed to receive %d bytes, error: %s. \n",
-			MCR_BUFF_FILE_SIZE_BYTES, spi.getLastErrMsg());
+/**
+ * Connect to the device or, when multiple device paths are given, to all pool devices
+ *
+ * @return int - 0 when run successfully
+ */
+static int connectDevices() {
+	if (transportType == MCR_TRANSPORT_UART) {
+		if (!uart.connect(devicePaths[0])) {
+			fprintf(stderr, " Cannot open serial port %s, error: %s ... \n",
+					devicePaths[0], uart.getLastErrMsg());
+			return -1;
+		}
+		if (!uart.validateDevice()) {
+			fprintf(stderr, " Cannot access device %s at %u baud, error: %s ... \n",
+					devicePaths[0], uart.getBaudRate(), uart.getLastErrMsg());
 			return -1;
 		}
-		writeBytes(receiveByteBuffer, MCR_BUFF_FILE_SIZE_BYTES);
+		return 0;
 	}
-
-	if (chunkRemaindBytes > 0) {
-		//Process incomplete chunk
-		if (!spi.retrieveRandomBytes(chunkRemaindBytes, receiveByteBuffer)) {
-			fprintf(stderr,
-					"Failed to receive %d bytes for last chunk, error: code %s. ",
-					chunkRemaindBytes, spi.getLastErrMsg());
+	if (numDevicePaths == 1) {
+		if (!spi.connect(devicePaths[0])) {
+			fprintf(stderr, " Cannot open SPI device %s, error: %s ... \n",
+					devicePaths[0], spi.getLastErrMsg());
 			return -1;
 		}
-		writeBytes(receiveByteBuffer, chunkRemaindBytes);
+		return prepareDevice(spi, devicePaths[0]);
 	}
 
-	closeHandle();
+	for (uint32_t i = 0; i < numDevicePaths; i++) {
+		if (!pool.addDevice(devicePaths[i])) {
+			fprintf(stderr, " Cannot open SPI device %s, error: %s ... \n",
+					devicePaths[i], pool.getLastErrMsg());
+			return -1;
+		}
+		if (prepareDevice(*pool.getDevice(i), devicePaths[i]) != 0) {
+			return -1;
+		}
+	}
+	pool.setCombineMode(combineMode);
 	return 0;
 }
 
 /**
- * Process Request
+ * Retrieve a chunk of random bytes, or raw random bytes for post-processing, from the device or the device pool
  *
- * @return int - 0 when run successfully
+ * @param uint32_t numBytes - how many random bytes to retrieve
+ * @param uint8_t* chunk - pointer to receiving random bytes
+ * @return true when retrieved successfully
  */
-static int processDownloadRequest() {
-	if (filePathName != nullptr
-			&& (!strcmp(filePathName, "STDOUT")
-					|| !strcmp(filePathName, "/dev/stdout"))) {
-		isOutputToStandardOutput = true;
-	} else {
-		isOutputToStandardOutput = false;
+static bool retrieveChunk(uint32_t numBytes, uint8_t *chunk) {
+	bool isRaw = postProcess != MCR_POST_PROCESS_NONE;
+	if (numDevicePaths == 1) {
+		return isRaw ? pDevice->retrieveRawRandomBytes(numBytes, chunk) : pDevice->retrieveRandomBytes(numBytes, chunk);
 	}
-	int status = handleDownloadRequest();
-	return status;
+	return isRaw ? pool.retrieveRawRandomBytes(numBytes, chunk) : pool.retrieveRandomBytes(numBytes, chunk);
 }
 
 /**
- * Main entry
+ * @return const char* - error message of the last failed chunk retrieval
+ */
+static const char* getRetrievalErrMsg() {
+	if (numDevicePaths == 1) {
+		return pDevice->getLastErrMsg();
+	}
+	return pool.getLastErrMsg();
+}
+
+/**
+ * Run the health tests on a retrieved chunk
  *
- * @param int argc - number of parameters
- * @param char ** argv - parameters
+ * @param const uint8_t* chunk - pointer to the random bytes
+ * @param uint32_t numBytes - number of random bytes
+ * @return true when the chunk can be written out
+ */
+static bool checkHealth(const uint8_t *chunk, uint32_t numBytes) {
+	if (health.test(chunk, numBytes) == MCR_HEALTH_PASSED) {
+		return true;
+	}
+	uint8_t deviceStatus;
+	if (numDevicePaths == 1 && pDevice->retrieveDeviceStatusByte(&deviceStatus)) {
+		fprintf(stderr, "%s, device status: %d\n", health.getLastErrMsg(), (int) deviceStatus);
+	} else {
+		fprintf(stderr, "%s\n", health.getLastErrMsg());
+	}
+	return healthAction == MCR_HEALTH_ACTION_FLAG;
+}
+
+/**
+ * Seed source of the expansion, retrieves random bytes from the device or the device pool
+ * and runs the health tests on them. Called by the expander reseeder thread.
  *
+ * @param uint8_t* seed - pointer to receiving random bytes
+ * @param uint32_t len - how many random bytes to retrieve
+ * @param void* context - not used
+ * @return true when the seed can be used
  */
-int main(int argc, char **argv) {
-	if (!processArguments(argc, argv)) {
-		return -1;
+static bool retrieveSeed(uint8_t *seed, uint32_t len, void *context) {
+	(void) context;
+	if (!retrieveChunk(len, seed)) {
+		fprintf(stderr, "Failed to receive %u seed bytes, error: %s. \n", len, getRetrievalErrMsg());
+		return false;
 	}
-	return 0;
+	if (healthAction != MCR_HEALTH_ACTION_NONE && !checkHealth(seed, len)) {
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Print expansion counters to standard error
+ */
+static void printExpansionStats() {
+	MicroRngExpanderStats stats;
+	expander.getStats(&stats);
+	fprintf(stderr, "Expansion: %llu bytes, %llu reseeds (%llu byte budget, %llu interval), %llu seed failures, "
+			"max %llu bytes per seed, %llu stalls, %.3f s stalled\n",
+			(unsigned long long) stats.bytesGenerated, (unsigned long long) stats.reseeds,
+			(unsigned long long) stats.byteBudgetReseeds, (unsigned long long) stats.intervalReseeds,
+			(unsigned long long) stats.seedFailures, (unsigned long long) stats.maxBytesPerSeed,
+			(unsigned long long) stats.stalls, (double) stats.stallNanos / 1000000000);
+}
+
+/**
+ * Print health test counters to standard error
+ */
+static void printHealthStats() {
+	MicroRngHealthStats stats;
+	health.getStats(&stats);
+	fprintf(stderr, "Health tests: %llu bytes, %llu repetition count failures (cutoff %u, max run %u), "
+			"%llu adaptive proportion failures (cutoff %u, max count %u)",
+			(unsigned long long) stats.bytesTested, (unsigned long long) stats.rctFailures,
+			health.getRepetitionCutoff(), stats.maxRepetitionCount,
+			(unsigned long long) stats.aptFailures, health.getProportionCutoff(), stats.maxProportionCount);
+	if (isChiSquareEnabled) {
+		fprintf(stderr, ", %llu chi-square failures in %llu blocks", (unsigned long long) stats.chiSquareFailures,
+				(unsigned long long) stats.chiSquareBlocks);
+	}
+	fprintf(stderr, "\n");
+}
+
+/**
+ * Print health and throughput counters of the pool devices to standard error
+ */
+static void printPoolStats() {
+	MicroRngPoolDeviceStats stats;
+	for (uint32_t i = 0; i < pool.getNumDevices(); i++) {
+		if (!pool.getDeviceStats(i, &stats)) {
+			continue;
+		}
+		double kbps = 0;
+		if (stats.busyNanos > 0) {
+			kbps = (double) stats.bytesRetrieved * 8 * 1000000 / stats.busyNanos;
+		}
+		fprintf(stderr, "Device %s: %llu bytes, %.0f kbps, %llu failures, %s\n",
+				devicePaths[i], (unsigned long long) stats.bytesRetrieved, kbps,
+				(unsigned long long) stats.failures, stats.isHealthy ? "healthy" : "unhealthy");
+	}
+}
+
+/**
+ * Request printing SPI transfer counters
+ *
+ * @param int signum - signal number
+ */
+static void handleStatsSignal(int signum) {
+	(void) signum;
+	isStatsDumpRequested = 1;
+}
+
+/**
+ * Print SPI transfer counters of a device to standard error
+ *
+ * @param const MicroRngSPI& device - device to report
+ * @param const char* path - device path
+ */
+static void printDeviceStats(const MicroRngSPI &device, const char *path) {
+	MicroRngSPIStats stats;
+	device.getStats(&stats);
+	fprintf(stderr, "SPI stats %s: %llu bytes, %llu ioctls, %.1f bytes per ioctl, %llu command switches, "
+			"%llu errors, %.3f s in ioctl, clock %u Hz, %u clock downshifts, %u clock upshifts, "
+			"%llu retries, %llu resyncs, %llu reopens, %llu unrecovered errors\n",
+			path, (unsigned long long) stats.bytesTransferred, (unsigned long long) stats.ioctls,
+			stats.ioctls > 0 ? (double) stats.bytesTransferred / stats.ioctls : 0,
+			(unsigned long long) stats.commandSwitches, (unsigned long long) stats.errors,
+			(double) stats.kernelNanos / 1000000000, device.getMaxClockFrequency(),
+			stats.clockDownshifts, stats.clockUpshifts, (unsigned long long) stats.retries,
+			(unsigned long long) stats.resyncs, (unsigned long long) stats.reopens,
+			(unsigned long long) stats.unrecoveredErrors);
+	for (uint32_t i = 0; i < MCR_SPI_LATENCY_BUCKETS; i++) {
+		if (stats.latencyHistogram[i] == 0) {
+			continue;
+		}
+		if (i == MCR_SPI_LATENCY_BUCKETS - 1) {
+			fprintf(stderr, "    ioctl latency >= %u us: %llu\n", 1U << (i - 1),
+					(unsigned long long) stats.latencyHistogram[i]);
+		} else {
+			fprintf(stderr, "    ioctl latency < %u us: %llu\n", 1U << i,
+					(unsigned long long) stats.latencyHistogram[i]);
+		}
+	}
+}
+
+/**
+ * Print UART transfer counters to standard error
+ */
+static void printUartStats() {
+	MicroRngUARTStats stats;
+	uart.getStats(&stats);
+	fprintf(stderr, "UART stats %s: %llu bytes, %llu reads, %.1f bytes per read, %llu writes, "
+			"%llu timeouts, %llu errors, %u baud\n",
+			devicePaths[0], (unsigned long long) stats.bytesTransferred, (unsigned long long) stats.reads,
+			stats.reads > 0 ? (double) stats.bytesTransferred / stats.reads : 0,
+			(unsigned long long) stats.writes, (unsigned long long) stats.timeouts,
+			(unsigned long long) stats.errors, uart.getBaudRate());
+}
+
+/**
+ * Print transfer counters of all devices to standard error
+ */
+static void printStats() {
+	if (transportType == MCR_TRANSPORT_UART) {
+		printUartStats();
+		return;
+	}
+	if (numDevicePaths == 1) {
+		printDeviceStats(spi, devicePaths[0]);
+		return;
+	}
+	for (uint32_t i = 0; i < pool.getNumDevices(); i++) {
+		printDeviceStats(*pool.getDevice(i), devicePaths[i]);
+	}
+}
+
+/**
+ * Open the output file or standard output using the selected backend
+ *
+ * @return int - 0 when run successfully
+ */
+static int openOutput() {
+	struct stat outputStat;
+
+	switch (outputMode) {
+	case MCR_OUTPUT_STDIO:
+		if (isOutputToStandardOutput == true) {
+			pOutputFile = fdopen(dup(fileno(stdout)), "wb");
+		} else {
+			// Keep the bytes committed by the interrupted download
+			pOutputFile = fopen(filePathName, resumeOffset > 0 ? "r+b" : "wb");
+		}
+		if (pOutputFile == nullptr) {
+			fprintf(stderr, "Cannot open file: %s in write mode\n", filePathName);
+			return -1;
+		}
+		return 0;
+	case MCR_OUTPUT_DIRECT:
+		if (isOutputToStandardOutput == true) {
+			fprintf(stderr, "Direct output mode requires a file name\n");
+			return -1;
+		}
+		if (chunkSizeBytes % CHUNK_RING_BUFF_ALIGNMENT != 0) {
+			fprintf(stderr, "Direct output mode requires a chunk size that is a multiple of %d\n",
+					CHUNK_RING_BUFF_ALIGNMENT);
+			return -1;
+		}
+		if (resumeOffset % CHUNK_RING_BUFF_ALIGNMENT != 0) {
+			fprintf(stderr, "Direct output mode cannot resume at offset %lld, not a multiple of %d\n",
+					(long long) resumeOffset, CHUNK_RING_BUFF_ALIGNMENT);
+			return -1;
+		}
+		outputFd = open(filePathName, O_WRONLY | O_CREAT | (resumeOffset > 0 ? 0 : O_TRUNC) | O_DIRECT, 0644);
+		break;
+	case MCR_OUTPUT_SPLICE:
+		if (isOutputToStandardOutput == false) {
+			fprintf(stderr, "Splice output mode requires STDOUT as file name\n");
+			return -1;
+		}
+		if (fstat(STDOUT_FILENO, &outputStat) == -1 || !S_ISFIFO(outputStat.st_mode)) {
+			fprintf(stderr, "Splice output mode requires standard output to be a pipe\n");
+			return -1;
+		}
+		outputFd = STDOUT_FILENO;
+		break;
+	default:
+		if (isOutputToStandardOutput == true) {
+			outputFd = STDOUT_FILENO;
+		} else {
+			outputFd = open(filePathName, O_WRONLY | O_CREAT | (resumeOffset > 0 ? 0 : O_TRUNC), 0644);
+		}
+		break;
+	}
+
+	if (outputFd == -1) {
+		fprintf(stderr, "Cannot open file: %s in write mode\n", filePathName);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Calculate how many chunks must be spliced into the pipe after a chunk before its buffer
+ * can be refilled. Pages handed over with vmsplice(2) stay referenced by the pipe until the
+ * consumer reads them, and the pipe never holds more pages than its capacity.
+ *
+ * @return number of drained chunks to hold back
+ */
+static uint32_t computeSpliceHoldBack() {
+	long pageSize = sysconf(_SC_PAGESIZE);
+	int pipeSize = fcntl(outputFd, F_GETPIPE_SZ);
+	if (pageSize <= 0) {
+		pageSize = CHUNK_RING_BUFF_ALIGNMENT;
+	}
+	if (pipeSize <= 0) {
+		pipeSize = 16 * pageSize;
+	}
+	uint32_t pipeSlots = (uint32_t) (pipeSize / pageSize);
+	uint32_t chunkSlots = (uint32_t) ((chunkSizeBytes + pageSize - 1) / pageSize);
+	return (pipeSlots + chunkSlots - 1) / chunkSlots + 1;
+}
+
+/**
+ * Close file handle
+ *
+ */
+static void closeHandle() {
+	if (outputMode == MCR_OUTPUT_URING) {
+		releaseUringOutput();
+	}
+	if (pOutputFile != nullptr) {
+		fclose(pOutputFile);
+		pOutputFile = nullptr;
+	}
+	if (outputFd != -1) {
+		if (outputFd != STDOUT_FILENO) {
+			close(outputFd);
+		}
+		outputFd = -1;
+	}
+}
+
+/**
+ * Write bytes out to the file
+ *
+ * @param const uint8_t* bytes - pointer to the byte array
+ * @param uint32_t numBytes - number of bytes to write
+ * @return true if all bytes written successfully
+ */
+static bool writeBytes(const uint8_t *bytes, uint32_t numBytes) {
+	if (outputMode == MCR_OUTPUT_STDIO) {
+		FILE *handle = pOutputFile;
+		return fwrite(bytes, 1, numBytes, handle) == numBytes;
+	}
+
+	if (outputMode == MCR_OUTPUT_DIRECT && numBytes % CHUNK_RING_BUFF_ALIGNMENT != 0) {
+		// The last incomplete chunk cannot be written with direct I/O
+		int flags = fcntl(outputFd, F_GETFL);
+		if (flags == -1 || fcntl(outputFd, F_SETFL, flags & ~O_DIRECT) == -1) {
+			return false;
+		}
+	}
+
+	while (numBytes > 0) {
+		ssize_t written;
+		if (outputMode == MCR_OUTPUT_SPLICE) {
+			struct iovec iov;
+			iov.iov_base = (void*) bytes;
+			iov.iov_len = numBytes;
+			written = vmsplice(outputFd, &iov, 1, 0);
+		} else {
+			written = write(outputFd, bytes, numBytes);
+		}
+		if (written == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		bytes += written;
+		numBytes -= (uint32_t) written;
+	}
+	return true;
+}
+
+/**
+ * Decide how many io_uring writes stay in flight and allocate their tracking slots.
+ * Regular files are written at explicit offsets with up to queue depth writes in flight,
+ * pipes, sockets and files opened for appending get one write in flight to keep the byte order.
+ *
+ * @param uint32_t* holdBackChunks - pointer to receiving the number of drained chunks to hold back
+ * @return int - 0 when run successfully
+ */
+static int prepareUringOutput(uint32_t *holdBackChunks) {
+	struct stat outputStat;
+	int flags = fcntl(outputFd, F_GETFL);
+	if (fstat(outputFd, &outputStat) == 0 && (S_ISREG(outputStat.st_mode) || S_ISBLK(outputStat.st_mode))
+			&& flags != -1 && (flags & O_APPEND) == 0) {
+		uringNextOffset = lseek(outputFd, 0, SEEK_CUR);
+	}
+	if (uringNextOffset == -1) {
+		*holdBackChunks = 1;
+	} else {
+		*holdBackChunks = queueDepth;
+	}
+
+	numUringSlots = *holdBackChunks + 1;
+	pUringWrites = (McrUringWrite*) calloc(numUringSlots, sizeof(McrUringWrite));
+	if (pUringWrites == nullptr) {
+		fprintf(stderr, "Cannot allocate %u io_uring write slots\n", numUringSlots);
+		return -1;
+	}
+	if (!uring.setup(numUringSlots)) {
+		fprintf(stderr, "Cannot set up io_uring output, error: %s\n", uring.getLastErrMsg());
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Register the chunk buffers with the ring. Writes fall back to unregistered buffers when
+ * the kernel refuses, for instance because of the locked memory limit of older kernels.
+ *
+ * @return true when the chunk buffers are registered
+ */
+static bool setupUringBuffers() {
+	uint32_t numChunks = chunkRing.getNumChunks();
+	struct iovec *buffers = (struct iovec*) malloc(numChunks * sizeof(struct iovec));
+	if (buffers == nullptr) {
+		return false;
+	}
+	for (uint32_t i = 0; i < numChunks; i++) {
+		buffers[i].iov_base = chunkRing.getChunk(i);
+		buffers[i].iov_len = chunkRing.getChunkSize();
+	}
+	bool isRegistered = uring.registerBuffers(buffers, numChunks);
+	free(buffers);
+	return isRegistered;
+}
+
+/**
+ * Submit the write of a drained chunk to the ring
+ *
+ * @param const uint8_t* chunk - chunk buffer to write
+ * @param uint32_t numBytes - number of bytes in the chunk
+ * @return true when submitted successfully
+ */
+static bool submitUringWrite(const uint8_t *chunk, uint32_t numBytes) {
+	McrUringWrite *write = &pUringWrites[uringSubmittedSeq % numUringSlots];
+	write->chunk = chunk;
+	write->numBytes = numBytes;
+	write->numWritten = 0;
+	write->offset = uringNextOffset;
+	write->bufIndex = -1;
+	write->isComplete = false;
+	for (uint32_t i = 0; i < chunkRing.getNumChunks(); i++) {
+		if (chunkRing.getChunk(i) == chunk) {
+			write->bufIndex = (int) i;
+			break;
+		}
+	}
+	if (uringNextOffset != -1) {
+		uringNextOffset += numBytes;
+	}
+	if (!uring.prepareWrite(outputFd, chunk, numBytes, write->offset, write->bufIndex, uringSubmittedSeq)
+			|| !uring.submit()) {
+		fprintf(stderr, "Cannot submit io_uring write, error: %s\n", uring.getLastErrMsg());
+		return false;
+	}
+	uringSubmittedSeq++;
+	return true;
+}
+
+/**
+ * Reap io_uring completions until all chunks drained before a sequence number are written.
+ * Short writes are submitted again for the remaining bytes. Chunks count as committed in
+ * drain order, so the checkpoint always describes a contiguous prefix of the output.
+ *
+ * @param uint64_t untilSeq - sequence number of the first chunk allowed to stay in flight
+ * @return true when all the chunks before untilSeq are written
+ */
+static bool completeUringWrites(uint64_t untilSeq) {
+	while (uringCompletedSeq < untilSeq) {
+		McrUringWrite *oldest = &pUringWrites[uringCompletedSeq % numUringSlots];
+		if (oldest->isComplete) {
+			if (checkpointIntervalBytes > 0) {
+				outputHash.update(oldest->chunk, oldest->numBytes);
+				committedBytes += oldest->numBytes;
+			}
+			uringCompletedSeq++;
+			continue;
+		}
+
+		uint64_t seq;
+		int32_t result;
+		if (!uring.waitCompletion(&seq, &result)) {
+			fprintf(stderr, "Failed to wait for io_uring writes, error: %s\n", uring.getLastErrMsg());
+			return false;
+		}
+		McrUringWrite *write = &pUringWrites[seq % numUringSlots];
+		if (result <= 0) {
+			fprintf(stderr, "Failed to write %u bytes to file: %s, error: %s\n", write->numBytes, filePathName,
+					result < 0 ? strerror(-result) : "no bytes written");
+			return false;
+		}
+		write->numWritten += (uint32_t) result;
+		if (write->numWritten == write->numBytes) {
+			write->isComplete = true;
+			continue;
+		}
+		int64_t offset = write->offset == -1 ? -1 : write->offset + write->numWritten;
+		// Registered buffers may be written from any address within the buffer
+		if (!uring.prepareWrite(outputFd, write->chunk + write->numWritten, write->numBytes - write->numWritten,
+				offset, write->bufIndex, seq) || !uring.submit()) {
+			fprintf(stderr, "Cannot submit io_uring write, error: %s\n", uring.getLastErrMsg());
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Tear the io_uring output down
+ */
+static void releaseUringOutput() {
+	uring.release();
+	free(pUringWrites);
+	pUringWrites = nullptr;
+	numUringSlots = 0;
+}
+
+/**
+ * Print io_uring output counters to standard error
+ */
+static void printUringStats() {
+	IoUringStats stats;
+	uring.getStats(&stats);
+	fprintf(stderr, "io_uring stats: %llu writes, %llu completions, %llu io_uring_enter calls, %u registered buffers, %s\n",
+			(unsigned long long) stats.submissions, (unsigned long long) stats.completions,
+			(unsigned long long) stats.enterCalls, stats.registeredBuffers,
+			uringNextOffset == -1 ? "1 write in flight" : "explicit offsets");
+}
+
+/**
+ * Prepare the attributes of the acquisition thread for real-time scheduling and CPU pinning
+ *
+ * @param pthread_attr_t* attr - pointer to the attributes to initialize
+ * @return int - 0 when run successfully
+ */
+static int configureAcquisitionThread(pthread_attr_t *attr) {
+	pthread_attr_init(attr);
+	if (acquisitionCpu >= 0) {
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(acquisitionCpu, &cpus);
+		if (pthread_attr_setaffinity_np(attr, sizeof(cpus), &cpus) != 0) {
+			fprintf(stderr, "Cannot pin acquisition thread to CPU core %d\n", acquisitionCpu);
+			return -1;
+		}
+	}
+	if (realTimePriority > 0) {
+		struct sched_param param = { };
+		param.sched_priority = realTimePriority;
+		// All memory is locked, a small stack keeps the locked amount down
+		if (pthread_attr_setinheritsched(attr, PTHREAD_EXPLICIT_SCHED) != 0
+				|| pthread_attr_setschedpolicy(attr, SCHED_FIFO) != 0
+				|| pthread_attr_setschedparam(attr, &param) != 0
+				|| pthread_attr_setstacksize(attr, MCR_RT_STACK_BYTES) != 0) {
+			fprintf(stderr, "Cannot set real-time scheduling of acquisition thread\n");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @return uint64_t - CLOCK_MONOTONIC time in nanoseconds
+ */
+static uint64_t getMonotonicNanos() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * Read the total time the calling thread spent waiting on a run queue
+ *
+ * @param int schedstatFd - open schedstat file of the thread
+ * @param uint64_t* runDelayNanos - pointer to receiving run queue time in nanoseconds
+ * @return true when the kernel provides scheduler statistics
+ */
+static bool readRunDelay(int schedstatFd, uint64_t *runDelayNanos) {
+	char line[128];
+	ssize_t len = pread(schedstatFd, line, sizeof(line) - 1, 0);
+	if (len <= 0) {
+		return false;
+	}
+	line[len] = '\0';
+	// CPU time, run queue time and number of time slices
+	unsigned long long cpuNanos;
+	unsigned long long waitNanos;
+	if (sscanf(line, "%llu %llu", &cpuNanos, &waitNanos) != 2) {
+		return false;
+	}
+	*runDelayNanos = waitNanos;
+	return true;
+}
+
+/**
+ * Print chunk retrieval times and scheduling counters of the acquisition thread to standard error
+ */
+static void printAcquisitionStats() {
+	const McrAcquisitionStats *stats = &acquisitionStats;
+	if (stats->chunks == 0) {
+		return;
+	}
+	fprintf(stderr, "Acquisition stats: %llu chunks, %.3f ms min, %.3f ms mean, %.3f ms max per chunk, ",
+			(unsigned long long) stats->chunks, (double) stats->minChunkNanos / 1000000,
+			(double) stats->chunkNanos / stats->chunks / 1000000, (double) stats->maxChunkNanos / 1000000);
+	if (stats->isRunDelayAvailable) {
+		fprintf(stderr, "%.3f ms waited for CPU, %.3f ms max per chunk, ",
+				(double) stats->runDelayNanos / 1000000, (double) stats->maxRunDelayNanos / 1000000);
+	}
+	fprintf(stderr, "%ld voluntary and %ld involuntary context switches, %s\n",
+			stats->voluntarySwitches, stats->involuntarySwitches,
+			realTimePriority > 0 ? "SCHED_FIFO" : "SCHED_OTHER");
+}
+
+/**
+ * Load the checkpoint of an interrupted download and verify the bytes it committed,
+ * a download without checkpoint starts from the beginning
+ *
+ * @return int - 0 when run successfully
+ */
+static int loadCheckpoint() {
+	char line[512];
+	char expectedPath[MCR_CHECKPOINT_PATH_SIZE + 8];
+	long long totalBytes = -2;
+	long long offset = -1;
+	uint8_t digest[SHA256_DIGEST_BYTES];
+	bool isDigestFound = false;
+	bool isFileMatched = false;
+
+	FILE *checkpointFile = fopen(checkpointPath, "r");
+	if (checkpointFile == nullptr) {
+		if (errno != ENOENT) {
+			fprintf(stderr, "Cannot open checkpoint file %s, error: %s\n", checkpointPath, strerror(errno));
+			return -1;
+		}
+		fprintf(stderr, "No checkpoint file %s, starting a new download\n", checkpointPath);
+		return 0;
+	}
+	snprintf(expectedPath, sizeof(expectedPath), "file=%s", filePathName);
+	while (fgets(line, sizeof(line), checkpointFile) != nullptr) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (strncmp(line, "file=", 5) == 0) {
+			isFileMatched = strcmp(line, expectedPath) == 0;
+		} else if (strncmp(line, "total_bytes=", 12) == 0) {
+			totalBytes = atoll(line + 12);
+		} else if (strncmp(line, "offset=", 7) == 0) {
+			offset = atoll(line + 7);
+		} else if (strncmp(line, "sha256=", 7) == 0 && strlen(line + 7) == SHA256_DIGEST_BYTES * 2) {
+			isDigestFound = true;
+			for (int i = 0; i < SHA256_DIGEST_BYTES; i++) {
+				unsigned int value;
+				if (sscanf(line + 7 + i * 2, "%2x", &value) != 1) {
+					isDigestFound = false;
+					break;
+				}
+				digest[i] = (uint8_t) value;
+			}
+		}
+	}
+	fclose(checkpointFile);
+
+	if (!isFileMatched || offset < 0 || !isDigestFound) {
+		fprintf(stderr, "Checkpoint file %s is not valid for %s\n", checkpointPath, filePathName);
+		return -1;
+	}
+	if (totalBytes != numGenBytes) {
+		fprintf(stderr, "Checkpoint file %s belongs to a download of %lld bytes, not %lld\n",
+				checkpointPath, totalBytes, (long long) numGenBytes);
+		return -1;
+	}
+	if (numGenBytes >= 0 && offset > numGenBytes) {
+		fprintf(stderr, "Checkpoint file %s is not valid for %s\n", checkpointPath, filePathName);
+		return -1;
+	}
+	resumeOffset = offset;
+	if (verifyCommittedBytes(digest) != 0) {
+		return -1;
+	}
+	committedBytes = (uint64_t) resumeOffset;
+	checkpointedBytes = committedBytes;
+	fprintf(stderr, "Resuming download of %s at byte %lld\n", filePathName, (long long) resumeOffset);
+	return 0;
+}
+
+/**
+ * Hash the bytes committed by the interrupted download and compare them with the checkpoint,
+ * the running hash continues from there
+ *
+ * @param const uint8_t* expectedDigest - SHA-256 hash recorded with the checkpoint
+ * @return int - 0 when the committed bytes match
+ */
+static int verifyCommittedBytes(const uint8_t *expectedDigest) {
+	int fd = open(filePathName, O_RDONLY);
+	if (fd == -1) {
+		fprintf(stderr, "Cannot open file: %s in read mode\n", filePathName);
+		return -1;
+	}
+	uint8_t *bytes = (uint8_t*) malloc(MCR_VERIFY_BUFFER_BYTES);
+	if (bytes == nullptr) {
+		fprintf(stderr, "Cannot allocate %d bytes for verifying file %s\n", MCR_VERIFY_BUFFER_BYTES, filePathName);
+		close(fd);
+		return -1;
+	}
+
+	outputHash.init();
+	int64_t offset = 0;
+	while (offset < resumeOffset) {
+		size_t len = resumeOffset - offset < MCR_VERIFY_BUFFER_BYTES ? (size_t) (resumeOffset - offset) : MCR_VERIFY_BUFFER_BYTES;
+		ssize_t numRead = pread(fd, bytes, len, offset);
+		if (numRead == -1 && errno == EINTR) {
+			continue;
+		}
+		if (numRead <= 0) {
+			break;
+		}
+		outputHash.update(bytes, (size_t) numRead);
+		offset += numRead;
+	}
+	free(bytes);
+	close(fd);
+	if (offset < resumeOffset) {
+		fprintf(stderr, "File %s is shorter than the %lld bytes of its checkpoint\n", filePathName, (long long) resumeOffset);
+		return -1;
+	}
+
+	uint8_t digest[SHA256_DIGEST_BYTES];
+	Sha256 snapshot = outputHash;
+	snapshot.final(digest);
+	if (memcmp(digest, expectedDigest, SHA256_DIGEST_BYTES) != 0) {
+		fprintf(stderr, "File %s doesn't match the SHA-256 hash of its checkpoint\n", filePathName);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Position the output after the committed bytes when resuming, dropping any bytes written
+ * after the last checkpoint, and preallocate the remaining size of a regular file
+ *
+ * @return int - 0 when run successfully
+ */
+static int prepareOutputFile() {
+	if (isOutputToStandardOutput) {
+		return 0;
+	}
+	int fd = pOutputFile != nullptr ? fileno(pOutputFile) : outputFd;
+	struct stat outputStat;
+	if (fstat(fd, &outputStat) == -1 || !S_ISREG(outputStat.st_mode)) {
+		return 0;
+	}
+	if (resumeOffset > 0) {
+		if (ftruncate(fd, resumeOffset) == -1 || lseek(fd, resumeOffset, SEEK_SET) == -1) {
+			fprintf(stderr, "Cannot continue file %s at byte %lld, error: %s\n", filePathName,
+					(long long) resumeOffset, strerror(errno));
+			return -1;
+		}
+	}
+	if (numGenBytes > resumeOffset) {
+		// Allocated blocks beyond the written bytes don't change the file size
+		if (fallocate(fd, FALLOC_FL_KEEP_SIZE, resumeOffset, numGenBytes - resumeOffset) == -1
+				&& errno != EOPNOTSUPP && errno != ENOSYS) {
+			fprintf(stderr, "Cannot preallocate %lld bytes for file %s, error: %s\n",
+					(long long) (numGenBytes - resumeOffset), filePathName, strerror(errno));
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Flush written bytes to the storage device
+ *
+ * @return true if successful
+ */
+static bool syncOutput() {
+	if (pOutputFile != nullptr) {
+		return fflush(pOutputFile) == 0 && fdatasync(fileno(pOutputFile)) == 0;
+	}
+	return fdatasync(outputFd) == 0;
+}
+
+/**
+ * Sync the output and replace the checkpoint file with the committed bytes and their hash
+ *
+ * @return true if successful
+ */
+static bool saveCheckpoint() {
+	char tmpPath[MCR_CHECKPOINT_PATH_SIZE + 8];
+	uint8_t digest[SHA256_DIGEST_BYTES];
+
+	if (!syncOutput()) {
+		fprintf(stderr, "Cannot sync file %s, error: %s\n", filePathName, strerror(errno));
+		return false;
+	}
+	Sha256 snapshot = outputHash;
+	snapshot.final(digest);
+
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", checkpointPath);
+	FILE *checkpointFile = fopen(tmpPath, "w");
+	if (checkpointFile == nullptr) {
+		fprintf(stderr, "Cannot create checkpoint file %s, error: %s\n", tmpPath, strerror(errno));
+		return false;
+	}
+	fprintf(checkpointFile, "file=%s\ntotal_bytes=%lld\noffset=%llu\nsha256=", filePathName,
+			(long long) numGenBytes, (unsigned long long) committedBytes);
+	for (int i = 0; i < SHA256_DIGEST_BYTES; i++) {
+		fprintf(checkpointFile, "%02x", digest[i]);
+	}
+	fprintf(checkpointFile, "\n");
+	bool isWritten = fflush(checkpointFile) == 0 && fsync(fileno(checkpointFile)) == 0;
+	if (fclose(checkpointFile) != 0 || !isWritten || rename(tmpPath, checkpointPath) != 0) {
+		fprintf(stderr, "Cannot write checkpoint file %s, error: %s\n", checkpointPath, strerror(errno));
+		unlink(tmpPath);
+		return false;
+	}
+	checkpointedBytes = committedBytes;
+	numCheckpoints++;
+	return true;
+}
+
+/**
+ * Record the last committed bytes of an incomplete download, or remove the checkpoint file
+ * of a completed one
+ *
+ * @param bool isComplete - true when all requested bytes were written
+ * @return int - 0 when run successfully
+ */
+static int finishCheckpoints(bool isComplete) {
+	if (isComplete) {
+		if (!syncOutput()) {
+			fprintf(stderr, "Cannot sync file %s, error: %s\n", filePathName, strerror(errno));
+			return -1;
+		}
+		if (unlink(checkpointPath) != 0 && errno != ENOENT) {
+			fprintf(stderr, "Cannot remove checkpoint file %s, error: %s\n", checkpointPath, strerror(errno));
+			return -1;
+		}
+		return 0;
+	}
+	if (!saveCheckpoint()) {
+		return -1;
+	}
+	fprintf(stderr, "Download stopped at byte %llu, use -rs to continue\n", (unsigned long long) committedBytes);
+	return 0;
+}
+
+/**
+ * SPI acquisition thread, keeps refilling free chunk buffers with random bytes
+ * until the requested amount is retrieved or the output writer stops.
+ *
+ * @param void* arg - not used
+ * @return nullptr
+ */
+static void* acquireChunks(void *arg) {
+	(void) arg;
+	int64_t remainingBytes = numGenBytes == -1 ? -1 : numGenBytes - resumeOffset;
+	int schedstatFd = -1;
+	uint64_t prevRunDelayNanos = 0;
+	if (isStatsReportEnabled) {
+		schedstatFd = open(MCR_SCHEDSTAT_PATH, O_RDONLY);
+		acquisitionStats.isRunDelayAvailable = schedstatFd != -1 && readRunDelay(schedstatFd, &prevRunDelayNanos);
+		acquisitionStats.minChunkNanos = UINT64_MAX;
+	}
+	while (remainingBytes != 0) {
+		uint32_t numBytes = chunkSizeBytes;
+		if (remainingBytes > 0 && remainingBytes < numBytes) {
+			numBytes = (uint32_t) remainingBytes;
+		}
+		uint8_t *chunk = chunkRing.beginFill();
+		if (chunk == nullptr) {
+			// Output writer stopped
+			break;
+		}
+		if (isExpansionEnabled) {
+			if (!expander.generate(chunk, numBytes)) {
+				fprintf(stderr, "Failed to expand %u bytes, error: %s. \n", numBytes, expander.getLastErrMsg());
+				acquisitionStatus = -1;
+				break;
+			}
+			chunkRing.commitFill(numBytes);
+			if (remainingBytes > 0) {
+				remainingBytes -= numBytes;
+			}
+			continue;
+		}
+		uint8_t *source = chunk;
+		uint32_t numSourceBytes = numBytes;
+		if (postProcess != MCR_POST_PROCESS_NONE) {
+			source = pRawChunk;
+			numSourceBytes = computeRawBytes(numBytes);
+		}
+		uint64_t startNanos = isStatsReportEnabled ? getMonotonicNanos() : 0;
+		bool isRetrieved = retrieveChunk(numSourceBytes, source);
+		if (isStatsReportEnabled) {
+			uint64_t chunkNanos = getMonotonicNanos() - startNanos;
+			McrAcquisitionStats *stats = &acquisitionStats;
+			stats->chunks++;
+			stats->chunkNanos += chunkNanos;
+			stats->minChunkNanos = chunkNanos < stats->minChunkNanos ? chunkNanos : stats->minChunkNanos;
+			stats->maxChunkNanos = chunkNanos > stats->maxChunkNanos ? chunkNanos : stats->maxChunkNanos;
+			uint64_t runDelayNanos;
+			if (stats->isRunDelayAvailable && readRunDelay(schedstatFd, &runDelayNanos)) {
+				uint64_t chunkRunDelayNanos = runDelayNanos - prevRunDelayNanos;
+				stats->runDelayNanos += chunkRunDelayNanos;
+				if (chunkRunDelayNanos > stats->maxRunDelayNanos) {
+					stats->maxRunDelayNanos = chunkRunDelayNanos;
+				}
+				prevRunDelayNanos = runDelayNanos;
+			}
+		}
+		if (!isRetrieved) {
+			if (numGenBytes == -1) {
+				fprintf(stderr,
+						"Failed to receive %u bytes for unlimited download, error: %s. \n",
+						numSourceBytes, getRetrievalErrMsg());
+			} else {
+				fprintf(stderr, "Failed to receive %u bytes, error: %s. \n",
+						numSourceBytes, getRetrievalErrMsg());
+			}
+			acquisitionStatus = -1;
+			break;
+		}
+		if (healthAction != MCR_HEALTH_ACTION_NONE && !checkHealth(source, numSourceBytes)) {
+			acquisitionStatus = -1;
+			break;
+		}
+		if (postProcess != MCR_POST_PROCESS_NONE) {
+			conditionChunk(source, chunk, numBytes);
+		}
+		chunkRing.commitFill(numBytes);
+		if (remainingBytes > 0) {
+			remainingBytes -= numBytes;
+		}
+	}
+	if (isStatsReportEnabled) {
+		struct rusage usage;
+		if (getrusage(RUSAGE_THREAD, &usage) == 0) {
+			acquisitionStats.voluntarySwitches = usage.ru_nvcsw;
+			acquisitionStats.involuntarySwitches = usage.ru_nivcsw;
+		}
+		if (schedstatFd != -1) {
+			close(schedstatFd);
+		}
+	}
+	// Let the output writer drain the chunks retrieved so far
+	chunkRing.finish();
+	return nullptr;
+}
+
+/**
+ * Output writer, drains filled chunk buffers to the file
+ *
+ * @return int - 0 when run successfully
+ */
+static int drainChunks() {
+	uint8_t *chunk;
+	uint32_t numBytes;
+	while ((chunk = chunkRing.beginDrain(&numBytes)) != nullptr) {
+		if (outputMode == MCR_OUTPUT_URING) {
+			// The chunk released by commitDrain() must be written out first
+			if (!submitUringWrite(chunk, numBytes)
+					|| !completeUringWrites(uringSubmittedSeq < numUringSlots ? 0 : uringSubmittedSeq - numUringSlots + 1)) {
+				chunkRing.abort();
+				return -1;
+			}
+		} else if (!writeBytes(chunk, numBytes)) {
+			fprintf(stderr, "Failed to write %u bytes to file: %s\n", numBytes,
+					filePathName);
+			chunkRing.abort();
+			return -1;
+		}
+		if (checkpointIntervalBytes > 0 && outputMode != MCR_OUTPUT_URING) {
+			outputHash.update(chunk, numBytes);
+			committedBytes += numBytes;
+		}
+		chunkRing.commitDrain();
+		if (checkpointIntervalBytes > 0 && committedBytes - checkpointedBytes >= checkpointIntervalBytes
+				&& !saveCheckpoint()) {
+			chunkRing.abort();
+			return -1;
+		}
+		if (isStatsDumpRequested) {
+			isStatsDumpRequested = 0;
+			printStats();
+		}
+	}
+	// Chunks retrieved before an acquisition failure are still written out
+	if (outputMode == MCR_OUTPUT_URING && !completeUringWrites(uringSubmittedSeq)) {
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Handle download request
+ *
+ * @return int - 0 when run successfully
+ */
+static int handleDownloadRequest() {
+
+	pthread_t acquisitionThread;
+
+	struct sigaction statsAction = { };
+	statsAction.sa_handler = handleStatsSignal;
+	statsAction.sa_flags = SA_RESTART;
+	sigaction(SIGUSR1, &statsAction, nullptr);
+
+	if (connectDevices() != 0) {
+		return -1;
+	}
+
+	if (filePathName == nullptr) {
+		fprintf(stderr, "No file name defined.\n");
+		return -1;
+	}
+
+	if (checkpointIntervalBytes > 0) {
+		outputHash.init();
+		if (isResumeRequested && loadCheckpoint() != 0) {
+			return -1;
+		}
+	}
+
+	if (openOutput() != 0) {
+		return -1;
+	}
+	if (prepareOutputFile() != 0) {
+		closeHandle();
+		return -1;
+	}
+	health.setChiSquareEnabled(isChiSquareEnabled);
+
+	// Chunks spliced into a pipe can only be refilled after the consumer reads them
+	uint32_t holdBackChunks = 0;
+	if (outputMode == MCR_OUTPUT_SPLICE) {
+		holdBackChunks = computeSpliceHoldBack();
+	}
+	// Chunks written through io_uring can only be refilled after their writes complete
+	if (outputMode == MCR_OUTPUT_URING && prepareUringOutput(&holdBackChunks) != 0) {
+		closeHandle();
+		return -1;
+	}
+
+	if (!chunkRing.allocate(queueDepth + holdBackChunks, chunkSizeBytes)) {
+		fprintf(stderr, "Cannot allocate %u chunk buffers of %u bytes\n",
+				queueDepth + holdBackChunks, chunkSizeBytes);
+		closeHandle();
+		return -1;
+	}
+	chunkRing.setDrainHoldBack(holdBackChunks);
+	if (outputMode == MCR_OUTPUT_URING) {
+		setupUringBuffers();
+	}
+
+	if (postProcess != MCR_POST_PROCESS_NONE) {
+		pRawChunk = (uint8_t*) malloc(computeRawBytes(chunkSizeBytes));
+		if (pRawChunk == nullptr) {
+			fprintf(stderr, "Cannot allocate %u bytes for raw random bytes\n", computeRawBytes(chunkSizeBytes));
+			closeHandle();
+			return -1;
+		}
+	}
+
+	if (isExpansionEnabled && !expander.start(expansionReseedBytes, expansionReseedIntervalMs)) {
+		fprintf(stderr, "Cannot start expansion, error: %s\n", expander.getLastErrMsg());
+		closeHandle();
+		return -1;
+	}
+
+	if (realTimePriority > 0) {
+		if (pRawChunk != nullptr) {
+			memset(pRawChunk, 0, computeRawBytes(chunkSizeBytes));
+		}
+		// Chunk buffers are already touched, locking keeps them and all later allocations resident
+		if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+			fprintf(stderr, "Cannot lock memory for real-time mode, error: %s\n", strerror(errno));
+			expander.stop();
+			free(pRawChunk);
+			closeHandle();
+			return -1;
+		}
+	}
+
+	pthread_attr_t acquisitionAttr;
+	if (configureAcquisitionThread(&acquisitionAttr) != 0) {
+		pthread_attr_destroy(&acquisitionAttr);
+		expander.stop();
+		free(pRawChunk);
+		closeHandle();
+		return -1;
+	}
+	int retCode = pthread_create(&acquisitionThread, &acquisitionAttr, acquireChunks, nullptr);
+	pthread_attr_destroy(&acquisitionAttr);
+	if (retCode != 0) {
+		fprintf(stderr, "Cannot start SPI acquisition thread, error: %s\n", strerror(retCode));
+		if (retCode == EPERM) {
+			fprintf(stderr, "Real-time mode requires root or CAP_SYS_NICE permissions\n");
+		}
+		expander.stop();
+		free(pRawChunk);
+		closeHandle();
+		return -1;
+	}
+
+	int writeStatus = drainChunks();
+	pthread_join(acquisitionThread, nullptr);
+	expander.stop();
+	free(pRawChunk);
+	pRawChunk = nullptr;
+
+	int checkpointStatus = 0;
+	if (checkpointIntervalBytes > 0) {
+		bool isComplete = writeStatus == 0 && acquisitionStatus == 0 && numGenBytes >= 0
+				&& committedBytes == (uint64_t) numGenBytes;
+		checkpointStatus = finishCheckpoints(isComplete);
+		if (isStatsReportEnabled) {
+			uint8_t digest[SHA256_DIGEST_BYTES];
+			Sha256 snapshot = outputHash;
+			snapshot.final(digest);
+			fprintf(stderr, "Checkpoints: %llu written, %llu bytes committed, SHA-256 ",
+					(unsigned long long) numCheckpoints, (unsigned long long) committedBytes);
+			for (int i = 0; i < SHA256_DIGEST_BYTES; i++) {
+				fprintf(stderr, "%02x", digest[i]);
+			}
+			fprintf(stderr, "\n");
+		}
+	}
+
+	closeHandle();
+	if (isStatsReportEnabled) {
+		printStats();
+		printAcquisitionStats();
+		if (outputMode == MCR_OUTPUT_URING) {
+			printUringStats();
+		}
+	}
+	if (numDevicePaths > 1) {
+		printPoolStats();
+	}
+	if (healthAction != MCR_HEALTH_ACTION_NONE && isStatsReportEnabled) {
+		printHealthStats();
+	}
+	if (isExpansionEnabled && isStatsReportEnabled) {
+		printExpansionStats();
+	}
+	if (writeStatus != 0 || acquisitionStatus != 0 || checkpointStatus != 0) {
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Process Request
+ *
+ * @return int - 0 when run successfully
+ */
+static int processDownloadRequest() {
+	if (filePathName != nullptr
+			&& (!strcmp(filePathName, "STDOUT")
+					|| !strcmp(filePathName, "/dev/stdout"))) {
+		isOutputToStandardOutput = true;
+	} else {
+		isOutputToStandardOutput = false;
+	}
+	int status = handleDownloadRequest();
+	return status;
+}
+
+/**
+ * Main entry
+ *
+ * @param int argc - number of parameters
+ * @param char ** argv - parameters
+ *
+ */
+int main(int argc, char **argv) {
+	return processArguments(argc, argv) == 0 ? 0 : -1;
 }
@@ -33,13 +33,41 @@
 #define MCRNG_H_
 
 #include "MicroRngSPI.h"
+#include "MicroRngUART.h"
+#include "ChunkRing.h"
+#include "MicroRngPool.h"
+#include "MicroRngHealth.h"
+#include "MicroRngDrbg.h"
+#include "MicroRngExpander.h"
+#include "Sha256.h"
+#include "IoUring.h"
 #include <unistd.h>
+#include <pthread.h>
 
 #include <stdlib.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include <signal.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 
 #define MCR_BUFF_FILE_SIZE_BYTES (32000)
+#define MCR_MAX_CHUNK_SIZE_BYTES (16777216)
+#define MCR_DEFAULT_QUEUE_DEPTH (4)
+#define MCR_MAX_QUEUE_DEPTH (1024)
 #define DEFAULT_SPI_DEV_PATH "/dev/spidev0.0"
+#define DEFAULT_UART_DEV_PATH "/dev/serial0"
+#define MCR_SHA256_MAX_INPUT_RATIO (64)
+#define MCR_DRBG_MAX_OUTPUT_RATIO (1048576)
+#define MCR_DRBG_SEED_BYTES (64)
+#define MCR_DEFAULT_CHECKPOINT_BYTES (67108864)
+#define MCR_CHECKPOINT_SUFFIX ".checkpoint"
+#define MCR_CHECKPOINT_PATH_SIZE (4096)
+#define MCR_VERIFY_BUFFER_BYTES (1048576)
+#define MCR_RT_STACK_BYTES (262144)
+#define MCR_SCHEDSTAT_PATH "/proc/thread-self/schedstat"
 
 /**
  * Total number of random bytes needed (a command line argument) max 100000000000 bytes
@@ -52,18 +80,240 @@ static int64_t numGenBytes = -1;
 static char *filePathName = NULL;
 
 /**
- * SPI device path
+ * SPI device paths (a command line argument), more than one device retrieves through a device pool
  */
-static char devicePath[256];
+static char devicePaths[MCR_POOL_MAX_DEVICES][256];
+static uint32_t numDevicePaths = 0;
+
+/**
+ * Interfaces MicroRNG can be connected through
+ */
+enum McrTransportType {
+	MCR_TRANSPORT_SPI,	// SPI interface, up to 1 Mbps
+	MCR_TRANSPORT_UART	// 2-wire UART interface, up to 1.5 Mbps
+};
+
+/**
+ * Interface of the device (a command line argument)
+ */
+static McrTransportType transportType = MCR_TRANSPORT_SPI;
+
+/**
+ * UART baud rate the device is configured for (a command line argument)
+ */
+static uint32_t uartBaudRate = MCR_UART_DEFAULT_BAUD_RATE;
+
+/**
+ * Way of combining random bytes of multiple devices (a command line argument)
+ */
+static McrPoolCombineMode combineMode = MCR_POOL_INTERLEAVE;
 
 /**
  * Max SPI master clock frequency in Hz
  */
 static uint32_t maxSpiMasterClock = 250000;
 
+/**
+ * True when the SPI master clock frequency is set with a command line argument,
+ * otherwise the calibrated frequency is used
+ */
+static bool isClockFrequencySpecified = false;
+
+/**
+ * Lower the SPI master clock frequency on communication errors and probe it back up when stable (a command line argument)
+ */
+static bool isAdaptiveClock = false;
+
+/**
+ * Max number of times a failed chunk retrieval is repeated after resynchronizing with the device (a command line argument)
+ */
+static uint32_t maxRetries = MCR_SPI_DEFAULT_MAX_RETRIES;
+
+/**
+ * Identify the SPI device within the first chunk exchanged (a command line argument)
+ */
+static bool isValidationDeferred = false;
+
+/**
+ * Size of each chunk of random bytes retrieved from the device (a command line argument)
+ */
+static uint32_t chunkSizeBytes = MCR_BUFF_FILE_SIZE_BYTES;
+
+/**
+ * Number of chunk buffers queued between the SPI acquisition thread and the output writer (a command line argument)
+ */
+static uint32_t queueDepth = MCR_DEFAULT_QUEUE_DEPTH;
+
+/**
+ * Backends available for writing random bytes out
+ */
+enum McrOutputMode {
+	MCR_OUTPUT_STDIO,	// buffered stdio stream
+	MCR_OUTPUT_WRITE,	// unbuffered write(2) of aligned chunk buffers
+	MCR_OUTPUT_DIRECT,	// write(2) to a file opened with O_DIRECT
+	MCR_OUTPUT_SPLICE,	// vmsplice(2) chunk buffers into a standard output pipe
+	MCR_OUTPUT_URING	// io_uring writes of chunk buffers registered with the ring
+};
+
+/**
+ * Output backend (a command line argument)
+ */
+static McrOutputMode outputMode = MCR_OUTPUT_STDIO;
+
+/**
+ * A chunk write submitted to the io_uring instance, its buffer is held back until the write completes
+ */
+struct McrUringWrite {
+	const uint8_t *chunk;	// chunk buffer being written
+	uint32_t numBytes;	// size of the chunk
+	uint32_t numWritten;	// bytes of the chunk written so far
+	int64_t offset;		// file offset of the chunk, -1 for streams written at the current position
+	int bufIndex;		// index of the chunk buffer registered with the ring
+	bool isComplete;	// all bytes of the chunk written
+};
+
+/**
+ * io_uring output state, writes are tracked by their drain sequence number
+ */
+static IoUring uring;
+static McrUringWrite *pUringWrites = nullptr;
+static uint32_t numUringSlots = 0;
+static uint64_t uringSubmittedSeq = 0;
+static uint64_t uringCompletedSeq = 0;
+static int64_t uringNextOffset = -1;
+
+/**
+ * Responses to a failed health test of the random bytes
+ */
+enum McrHealthAction {
+	MCR_HEALTH_ACTION_NONE,	// health tests disabled
+	MCR_HEALTH_ACTION_STOP,	// stop the download before writing the failing chunk
+	MCR_HEALTH_ACTION_FLAG	// report the failure to standard error and continue
+};
+
+/**
+ * Response to a failed health test (a command line argument)
+ */
+static McrHealthAction healthAction = MCR_HEALTH_ACTION_NONE;
+
+/**
+ * Run the byte frequency chi-square test along with the health tests (a command line argument)
+ */
+static bool isChiSquareEnabled = false;
+
+/**
+ * Host side conditioning of raw random bytes
+ */
+enum McrPostProcess {
+	MCR_POST_PROCESS_NONE,		// random bytes conditioned by the device
+	MCR_POST_PROCESS_SHA256,	// SHA-256 of each block of raw random bytes
+	MCR_POST_PROCESS_DRBG		// ChaCha20 DRBG reseeded with raw random bytes
+};
+
+/**
+ * Conditioning of raw random bytes (a command line argument)
+ */
+static McrPostProcess postProcess = MCR_POST_PROCESS_NONE;
+
+/**
+ * Output bytes produced for a number of raw input bytes (a command line argument), 0 for the post-process default
+ */
+static uint32_t postProcessOutputRatio = 0;
+static uint32_t postProcessInputRatio = 0;
+
+/**
+ * Expand random bytes with a ChaCha20 DRBG reseeded from the device on a schedule (a command line argument)
+ */
+static bool isExpansionEnabled = false;
+
+/**
+ * Reseed byte budget and reseed interval in milliseconds of the expansion (command line arguments)
+ */
+static uint32_t expansionReseedBytes = MCR_EXPANDER_DEFAULT_RESEED_BYTES;
+static uint32_t expansionReseedIntervalMs = MCR_EXPANDER_DEFAULT_RESEED_MSECS;
+
+/**
+ * Print SPI transfer counters and ioctl latencies at exit (a command line argument)
+ */
+static bool isStatsReportEnabled = false;
+
+/**
+ * SCHED_FIFO priority of the acquisition thread (a command line argument), 0 for the default scheduling policy
+ */
+static int realTimePriority = 0;
+
+/**
+ * CPU core the acquisition thread is pinned to (a command line argument), -1 when not pinned
+ */
+static int acquisitionCpu = -1;
+
+/**
+ * Timing and scheduling counters of the acquisition thread, collected when counters are printed
+ */
+struct McrAcquisitionStats {
+	uint64_t chunks;		// chunks retrieved from the device
+	uint64_t chunkNanos;		// total time retrieving chunks
+	uint64_t minChunkNanos;		// fastest chunk retrieval
+	uint64_t maxChunkNanos;		// slowest chunk retrieval
+	uint64_t runDelayNanos;		// time the thread was runnable but waiting for a CPU
+	uint64_t maxRunDelayNanos;	// longest wait for a CPU during one chunk
+	bool isRunDelayAvailable;	// the kernel provides scheduler statistics
+	long voluntarySwitches;		// context switches while blocking in the kernel
+	long involuntarySwitches;	// context switches by preemption
+};
+static McrAcquisitionStats acquisitionStats;
+
+/**
+ * Continue an interrupted download from its checkpoint file (a command line argument)
+ */
+static bool isResumeRequested = false;
+
+/**
+ * Amount of bytes written between two checkpoints (a command line argument), 0 when checkpoints are disabled
+ */
+static uint64_t checkpointIntervalBytes = 0;
+
+/**
+ * Checkpoint file of the output, the output file name followed by MCR_CHECKPOINT_SUFFIX
+ */
+static char checkpointPath[MCR_CHECKPOINT_PATH_SIZE];
+
+/**
+ * Amount of bytes already committed to the output by the interrupted download, kept when resuming
+ */
+static int64_t resumeOffset = 0;
+
+/**
+ * Bytes written to the output so far, at the last checkpoint, and their running SHA-256 hash
+ */
+static uint64_t committedBytes = 0;
+static uint64_t checkpointedBytes = 0;
+static uint64_t numCheckpoints = 0;
+static Sha256 outputHash;
+
+/**
+ * Set by SIGUSR1 for printing SPI transfer counters while downloading
+ */
+static volatile sig_atomic_t isStatsDumpRequested = 0;
+
 static FILE *pOutputFile = NULL;
+static int outputFd = -1;
 static bool isOutputToStandardOutput = false;
 static MicroRngSPI spi;
+static MicroRngUART uart;
+static MicroRngTransport *pDevice = &spi;
+static MicroRngPool pool;
+static ChunkRing chunkRing;
+static MicroRngHealth health;
+static MicroRngDrbg drbg;
+static uint8_t *pRawChunk = nullptr;
+static bool retrieveSeed(uint8_t *seed, uint32_t len, void *context);
+static MicroRngExpander expander(retrieveSeed, nullptr);
+
+/**
+ * Completion status of the SPI acquisition thread, 0 when all chunks retrieved successfully
+ */
+static int acquisitionStatus = 0;
 
 /**
  * Function Declarations
@@ -74,6 +324,46 @@ static bool validateArgumentCount(int curIdx, int actualArgumentCount);
 static int parseDevicePath(int idx, int argc, char **argv);
 static int processDownloadRequest();
 static int handleDownloadRequest();
-static void writeBytes(const uint8_t *bytes, uint32_t numBytes);
+static int parseOutputMode(const char *modeName);
+static int parseCombineMode(const char *modeName);
+static int parseTransport(const char *transportName);
+static int parseHealthAction(const char *actionName);
+static bool checkHealth(const uint8_t *chunk, uint32_t numBytes);
+static int parsePostProcess(const char *processName);
+static int parsePostProcessRatio(const char *ratio);
+static uint32_t computeRawBytes(uint32_t numBytes);
+static void conditionChunk(const uint8_t *rawChunk, uint8_t *chunk, uint32_t numBytes);
+static void printHealthStats();
+static void printExpansionStats();
+static int prepareDevice(MicroRngSPI &device, const char *path);
+static int connectDevices();
+static bool retrieveChunk(uint32_t numBytes, uint8_t *chunk);
+static const char* getRetrievalErrMsg();
+static void printPoolStats();
+static void handleStatsSignal(int signum);
+static void printDeviceStats(const MicroRngSPI &device, const char *path);
+static void printUartStats();
+static void printStats();
+static int openOutput();
+static uint32_t computeSpliceHoldBack();
+static bool writeBytes(const uint8_t *bytes, uint32_t numBytes);
+static int prepareUringOutput(uint32_t *holdBackChunks);
+static bool setupUringBuffers();
+static bool submitUringWrite(const uint8_t *chunk, uint32_t numBytes);
+static bool completeUringWrites(uint64_t untilSeq);
+static void releaseUringOutput();
+static void printUringStats();
+static void* acquireChunks(void *arg);
+static int drainChunks();
+static int configureAcquisitionThread(pthread_attr_t *attr);
+static uint64_t getMonotonicNanos();
+static bool readRunDelay(int schedstatFd, uint64_t *runDelayNanos);
+static void printAcquisitionStats();
+static int loadCheckpoint();
+static int verifyCommittedBytes(const uint8_t *expectedDigest);
+static int prepareOutputFile();
+static bool syncOutput();
+static bool saveCheckpoint();
+static int finishCheckpoints(bool isComplete);
 
 #endif /* MCRNG_H_ */
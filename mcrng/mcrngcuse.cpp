@@ -0,0 +1,772 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file mcrngcuse.cpp
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief exposes MicroRNG device as a character device through CUSE on Raspberry PI 3+ or other Linux-based single-board computers.
+ *
+ */
+#include "mcrngcuse.h"
+
+/**
+ * Display usage message
+ *
+ */
+static void displayUsage() {
+    printf("---------------------------------------------------------------------------\n");
+    printf("---  TectroLabs - mcrngcuse - MicroRNG character device Version 1.0     ---\n");
+    printf("---     Use with RPI 3+ or other Linux-based single-board computers     ---\n");
+    printf("---------------------------------------------------------------------------\n");
+    printf("NAME\n");
+    printf("     mcrngcuse  - True Random Number Generator MicroRNG character device \n");
+    printf("SYNOPSIS\n");
+    printf("     mcrngcuse  [options] \n");
+    printf("\n");
+    printf("DESCRIPTION\n");
+    printf("     Mcrngcuse creates character device /dev/%s through CUSE\n", MCRC_DEFAULT_DEVICE_NAME);
+    printf("     (character device in userspace) and serves random bytes from MicroRNG\n");
+    printf("     device to processes reading it. Random bytes are kept ready in a buffer.\n");
+    printf("     A blocking read returns all requested bytes, a non-blocking read returns\n");
+    printf("     the bytes available or fails with EAGAIN. poll() and select() report\n");
+    printf("     the device readable while random bytes are available.\n");
+    printf("     It requires the cuse kernel module, the device is created with owner\n");
+    printf("     root and mode 600, use a udev rule for other access permissions.\n");
+    printf("\n");
+    printf("OPTIONS\n");
+    printf("     Operation modifiers:\n");
+    printf("\n");
+    printf("     -dp PATH, --device-path PATH\n");
+    printf("           SPI device path, default value: /dev/spidev0.0\n");
+    printf("\n");
+    printf("     -cf NUMBER, --clock-frequency NUMBER\n");
+    printf("           SPI master clock frequency in KHz, max value 60000,\n");
+    printf("           skip this option for the max frequency calibrated for the device,\n");
+    printf("           detected on first use and kept in %s.\n", MCR_SPI_CALIBRATION_CACHE_DIR);
+    printf("           Use 'mcdiag' utility to re-calibrate the max frequency.\n");
+    printf("\n");
+    printf("     -ac, --adaptive-clock\n");
+    printf("           check the communication periodically with test bytes, drop the\n");
+    printf("           SPI clock frequency a step on errors and retry, then probe it\n");
+    printf("           back up to the max frequency once the communication is stable\n");
+    printf("\n");
+    printf("     -dn NAME, --device-name NAME\n");
+    printf("           NAME of the character device created in /dev,\n");
+    printf("           default value: %s\n", MCRC_DEFAULT_DEVICE_NAME);
+    printf("\n");
+    printf("     -bs NUMBER, --buffer-size NUMBER\n");
+    printf("           NUMBER of random bytes kept ready by the device filler thread,\n");
+    printf("           default value: %d\n", MCR_BUFFER_DEFAULT_CAPACITY_BYTES * 16);
+    printf("\n");
+    printf("     -lw NUMBER, --low-watermark NUMBER\n");
+    printf("           refill the buffer once it holds no more than NUMBER of bytes,\n");
+    printf("           default value: %d%% of the buffer size\n", MCR_BUFFER_DEFAULT_LOW_WATERMARK_PERCENT);
+    printf("\n");
+    printf("     -hw NUMBER, --high-watermark NUMBER\n");
+    printf("           stop refilling the buffer once it holds NUMBER of bytes,\n");
+    printf("           default value: %d%% of the buffer size\n", MCR_BUFFER_DEFAULT_HIGH_WATERMARK_PERCENT);
+    printf("\n");
+    printf("     -it NUMBER, --idle-timeout NUMBER\n");
+    printf("           shut the noise sources down after NUMBER of milliseconds without\n");
+    printf("           reads while the buffer is full, they are started up again ahead\n");
+    printf("           of the predicted demand, default value: 0 (always on)\n");
+    printf("\n");
+    printf("     -st, --stats\n");
+    printf("           print character device counters to standard error at exit,\n");
+    printf("           counters are also printed when receiving SIGUSR1\n");
+    printf("EXAMPLES:\n");
+    printf("     It may require 'sudo' permissions to run this utility.\n");
+    printf("     To create /dev/microrng for MicroRNG device on /dev/spidev0.0\n");
+    printf("           mcrngcuse  -dp /dev/spidev0.0\n");
+    printf("\n");
+}
+
+/**
+ * Validate command line argument count
+ *
+ * @param int curIdx
+ * @param int actualArgumentCount
+ * @return true if run successfully
+ */
+static bool validateArgumentCount(int curIdx, int actualArgumentCount) {
+	if (curIdx >= actualArgumentCount) {
+		fprintf(stderr, "\nMissing command line arguments\n\n");
+		displayUsage();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Parse arguments for extracting command line parameters
+ *
+ * @param int argc
+ * @param char** argv
+ * @return int - 0 when run successfully
+ */
+static int processArguments(int argc, char **argv) {
+	int idx = 1;
+	strcpy(devicePath, DEFAULT_SPI_DEV_PATH);
+	strcpy(deviceName, MCRC_DEFAULT_DEVICE_NAME);
+	while (idx < argc) {
+		if (strcmp("-dp", argv[idx]) == 0
+				|| strcmp("--device-path", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			strcpy(devicePath, argv[idx++]);
+		} else if (strcmp("-cf", argv[idx]) == 0
+				|| strcmp("--clock-frequency", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			maxSpiMasterClock = (uint32_t) atoi(argv[idx++]) * 1000;
+			isClockFrequencySpecified = true;
+		} else if (strcmp("-ac", argv[idx]) == 0
+				|| strcmp("--adaptive-clock", argv[idx]) == 0) {
+			isAdaptiveClock = true;
+			++idx;
+		} else if (strcmp("-dn", argv[idx]) == 0
+				|| strcmp("--device-name", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			if (strlen(argv[idx]) == 0 || strlen(argv[idx]) >= sizeof(deviceName)
+					|| strchr(argv[idx], '/') != nullptr) {
+				fprintf(stderr, "Device name must be between 1 and %d characters without '/'\n",
+						(int) sizeof(deviceName) - 1);
+				return -1;
+			}
+			strcpy(deviceName, argv[idx++]);
+		} else if (strcmp("-bs", argv[idx]) == 0
+				|| strcmp("--buffer-size", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			int64_t value = atoll(argv[idx++]);
+			if (value < MCR_BUFFER_MIN_CAPACITY_BYTES || value > MCR_BUFFER_MAX_CAPACITY_BYTES) {
+				fprintf(stderr, "Buffer size must be between %d and %d\n",
+						MCR_BUFFER_MIN_CAPACITY_BYTES, MCR_BUFFER_MAX_CAPACITY_BYTES);
+				return -1;
+			}
+			bufferSizeBytes = (uint32_t) value;
+		} else if (strcmp("-lw", argv[idx]) == 0
+				|| strcmp("--low-watermark", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			int64_t value = atoll(argv[idx++]);
+			if (value <= 0 || value > MCR_BUFFER_MAX_CAPACITY_BYTES) {
+				fprintf(stderr, "Low watermark must be between 1 and %d\n", MCR_BUFFER_MAX_CAPACITY_BYTES);
+				return -1;
+			}
+			lowWatermarkBytes = (uint32_t) value;
+		} else if (strcmp("-hw", argv[idx]) == 0
+				|| strcmp("--high-watermark", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			int64_t value = atoll(argv[idx++]);
+			if (value <= 0 || value > MCR_BUFFER_MAX_CAPACITY_BYTES) {
+				fprintf(stderr, "High watermark must be between 1 and %d\n", MCR_BUFFER_MAX_CAPACITY_BYTES);
+				return -1;
+			}
+			highWatermarkBytes = (uint32_t) value;
+		} else if (strcmp("-it", argv[idx]) == 0
+				|| strcmp("--idle-timeout", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			int64_t value = atoll(argv[idx++]);
+			if (value < 0 || value > UINT32_MAX) {
+				fprintf(stderr, "Idle timeout must be between 0 and %u\n", UINT32_MAX);
+				return -1;
+			}
+			idleTimeoutMs = (uint32_t) value;
+		} else if (strcmp("-st", argv[idx]) == 0
+				|| strcmp("--stats", argv[idx]) == 0) {
+			isStatsReportEnabled = true;
+			++idx;
+		} else if (strcmp("-h", argv[idx]) == 0
+				|| strcmp("--help", argv[idx]) == 0) {
+			displayUsage();
+			return -1;
+		} else {
+			// Could not handle the argument, skip to the next one
+			++idx;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Request the main loop to stop
+ *
+ * @param int signum - signal number
+ */
+static void handleTerminationSignal(int signum) {
+	(void) signum;
+	isTerminationRequested = 1;
+}
+
+/**
+ * Request printing character device counters
+ *
+ * @param int signum - signal number
+ */
+static void handleStatsSignal(int signum) {
+	(void) signum;
+	isStatsDumpRequested = 1;
+}
+
+/**
+ * Connect to the device and start the filler thread of the random byte buffer
+ *
+ * @return int - 0 when run successfully
+ */
+static int connectDevice() {
+	if (!spi.connect(devicePath)) {
+		fprintf(stderr, " Cannot open SPI device %s, error: %s ... \n",
+				devicePath, spi.getLastErrMsg());
+		return -1;
+	}
+
+	if (isClockFrequencySpecified) {
+		spi.setMaxClockFrequency(maxSpiMasterClock);
+	} else if (!spi.calibrateClockFrequency()) {
+		fprintf(stderr, " Cannot calibrate SPI clock frequency, error: %s ... \n",
+				spi.getLastErrMsg());
+		return -1;
+	}
+	spi.setAdaptiveClock(isAdaptiveClock, 0, 0);
+
+	if (!spi.validateDevice()) {
+		fprintf(stderr, " Cannot access device, error: %s ... \n",
+				spi.getLastErrMsg());
+		return -1;
+	}
+
+	if (!buffer.setWatermarks(lowWatermarkBytes, highWatermarkBytes)) {
+		fprintf(stderr, " Invalid buffer watermarks, error: %s ... \n", buffer.getLastErrMsg());
+		return -1;
+	}
+	buffer.setIdleShutdown(idleTimeoutMs);
+	if (!buffer.start(bufferSizeBytes)) {
+		fprintf(stderr, " Cannot start random byte buffer, error: %s ... \n",
+				buffer.getLastErrMsg());
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Send a reply to a kernel request
+ *
+ * @param uint64_t unique - identifier of the request
+ * @param int error - 0 or a negative errno value
+ * @param const void *data - reply payload, ignored on error
+ * @param size_t len - size of the reply payload
+ * @return bool - true when the reply was accepted
+ */
+static bool sendReply(uint64_t unique, int error, const void *data, size_t len) {
+	struct fuse_out_header header;
+	struct iovec iov[2];
+	if (error != 0) {
+		len = 0;
+	}
+	header.len = (uint32_t) (sizeof(header) + len);
+	header.error = error;
+	header.unique = unique;
+	iov[0].iov_base = &header;
+	iov[0].iov_len = sizeof(header);
+	iov[1].iov_base = (void*) data;
+	iov[1].iov_len = len;
+	// ENOENT means the request was interrupted and already answered
+	return writev(cuseFd, iov, len > 0 ? 2 : 1) == (ssize_t) header.len;
+}
+
+/**
+ * Notify the kernel that a poll handle became readable
+ *
+ * @param uint64_t kh - poll handle
+ */
+static void sendPollWakeup(uint64_t kh) {
+	struct fuse_out_header header;
+	struct fuse_notify_poll_wakeup_out wakeup;
+	struct iovec iov[2];
+	header.len = sizeof(header) + sizeof(wakeup);
+	header.error = FUSE_NOTIFY_POLL;
+	header.unique = 0;
+	wakeup.kh = kh;
+	iov[0].iov_base = &header;
+	iov[0].iov_len = sizeof(header);
+	iov[1].iov_base = &wakeup;
+	iov[1].iov_len = sizeof(wakeup);
+	if (writev(cuseFd, iov, 2) < 0) {
+		// The waiting process closed the device
+		return;
+	}
+}
+
+/**
+ * Answer the CUSE initialization request with the device name and transfer limits
+ *
+ * @param const struct fuse_in_header *header - request header
+ * @param const uint8_t *payload - cuse_init_in structure
+ */
+static void handleInit(const struct fuse_in_header *header, const uint8_t *payload) {
+	const struct cuse_init_in *in = (const struct cuse_init_in*) payload;
+	uint8_t reply[sizeof(struct cuse_init_out) + 128];
+	struct cuse_init_out *out = (struct cuse_init_out*) reply;
+	memset(reply, 0, sizeof(reply));
+	out->major = FUSE_KERNEL_VERSION;
+	out->minor = in->minor < FUSE_KERNEL_MINOR_VERSION ? in->minor : FUSE_KERNEL_MINOR_VERSION;
+	out->max_read = MCRC_MAX_READ_BYTES;
+	out->max_write = MCRC_MAX_WRITE_BYTES;
+	// The device info is a list of zero-terminated KEY=VALUE strings
+	int infoLen = sprintf((char*) reply + sizeof(struct cuse_init_out), "DEVNAME=%s", deviceName) + 1;
+	if (in->major != FUSE_KERNEL_VERSION) {
+		fprintf(stderr, "Unsupported CUSE protocol version %u.%u\n", in->major, in->minor);
+		sendReply(header->unique, -EPROTO, nullptr, 0);
+		return;
+	}
+	sendReply(header->unique, 0, reply, sizeof(struct cuse_init_out) + infoLen);
+}
+
+/**
+ * Open the device for a process, only reading is allowed
+ *
+ * @param const struct fuse_in_header *header - request header
+ */
+static void handleOpen(const struct fuse_in_header *header) {
+	struct fuse_open_out out = { };
+	out.fh = nextFileHandle++;
+	out.open_flags = FOPEN_DIRECT_IO | FOPEN_NONSEEKABLE;
+	pthread_mutex_lock(&waitMutex);
+	stats.opens++;
+	pthread_mutex_unlock(&waitMutex);
+	sendReply(header->unique, 0, &out, sizeof(out));
+}
+
+/**
+ * Serve a read request from the buffer, or queue it for the reply thread
+ * when the buffer cannot serve it without waiting
+ *
+ * @param const struct fuse_in_header *header - request header
+ * @param const struct fuse_read_in *in - read request
+ */
+static void handleRead(const struct fuse_in_header *header, const struct fuse_read_in *in) {
+	uint32_t size = in->size < MCRC_MAX_READ_BYTES ? in->size : MCRC_MAX_READ_BYTES;
+	if (size == 0) {
+		sendReply(header->unique, 0, nullptr, 0);
+		return;
+	}
+	if (in->flags & O_NONBLOCK) {
+		// Take what the buffer holds in one step, the reply thread may drain it at any time
+		uint32_t numRead = buffer.tryGetRandom(pReadBytes, 1, size);
+		pthread_mutex_lock(&waitMutex);
+		if (numRead == 0) {
+			stats.emptyReads++;
+		} else {
+			stats.reads++;
+			stats.bytesServed += numRead;
+		}
+		pthread_mutex_unlock(&waitMutex);
+		if (numRead == 0) {
+			sendReply(header->unique, -EAGAIN, nullptr, 0);
+			return;
+		}
+		sendReply(header->unique, 0, pReadBytes, numRead);
+		return;
+	}
+
+	pthread_mutex_lock(&waitMutex);
+	// Keep the order of blocking reads behind the ones already waiting
+	if (pPendingHead == nullptr && buffer.tryGetRandom(pReadBytes, size, size) == size) {
+		stats.reads++;
+		stats.bytesServed += size;
+		pthread_mutex_unlock(&waitMutex);
+		sendReply(header->unique, 0, pReadBytes, size);
+		return;
+	}
+	McrcPendingRead *pending = (McrcPendingRead*) malloc(sizeof(McrcPendingRead));
+	if (pending == nullptr) {
+		pthread_mutex_unlock(&waitMutex);
+		sendReply(header->unique, -ENOMEM, nullptr, 0);
+		return;
+	}
+	pending->unique = header->unique;
+	pending->size = size;
+	pending->next = nullptr;
+	if (pPendingTail == nullptr) {
+		pPendingHead = pending;
+	} else {
+		pPendingTail->next = pending;
+	}
+	pPendingTail = pending;
+	pthread_cond_signal(&waitCond);
+	pthread_mutex_unlock(&waitMutex);
+}
+
+/**
+ * Fail a waiting read interrupted by a signal, a read already being answered completes normally
+ *
+ * @param const struct fuse_interrupt_in *in - interrupt request
+ */
+static void handleInterrupt(const struct fuse_interrupt_in *in) {
+	pthread_mutex_lock(&waitMutex);
+	McrcPendingRead *prev = nullptr;
+	McrcPendingRead *pending = pPendingHead;
+	while (pending != nullptr && pending->unique != in->unique) {
+		prev = pending;
+		pending = pending->next;
+	}
+	if (pending == nullptr) {
+		pthread_mutex_unlock(&waitMutex);
+		return;
+	}
+	if (prev == nullptr) {
+		pPendingHead = pending->next;
+	} else {
+		prev->next = pending->next;
+	}
+	if (pPendingTail == pending) {
+		pPendingTail = prev;
+	}
+	stats.interrupts++;
+	pthread_mutex_unlock(&waitMutex);
+	sendReply(pending->unique, -EINTR, nullptr, 0);
+	free(pending);
+}
+
+/**
+ * Report whether random bytes are available, and register the poll handle
+ * for a wakeup notification when they are not. When all MCRC_MAX_POLL_HANDLES are taken,
+ * the oldest handle is woken up early to make room, its process polls again.
+ *
+ * @param const struct fuse_in_header *header - request header
+ * @param const struct fuse_poll_in *in - poll request
+ */
+static void handlePoll(const struct fuse_in_header *header, const struct fuse_poll_in *in) {
+	struct fuse_poll_out out = { };
+	if (buffer.getAvailableBytes() > 0) {
+		out.revents = POLLIN | POLLRDNORM;
+	}
+	pthread_mutex_lock(&waitMutex);
+	stats.polls++;
+	if (out.revents == 0 && (in->flags & FUSE_POLL_SCHEDULE_NOTIFY)) {
+		uint32_t i = 0;
+		while (i < numPollHandles && pollHandles[i] != in->kh) {
+			i++;
+		}
+		if (i == numPollHandles) {
+			if (numPollHandles == MCRC_MAX_POLL_HANDLES) {
+				sendPollWakeup(pollHandles[0]);
+				stats.pollEvictions++;
+				memmove(pollHandles, pollHandles + 1, (MCRC_MAX_POLL_HANDLES - 1) * sizeof(pollHandles[0]));
+				numPollHandles--;
+			}
+			pollHandles[numPollHandles++] = in->kh;
+			pthread_cond_signal(&waitCond);
+		}
+	}
+	pthread_mutex_unlock(&waitMutex);
+	sendReply(header->unique, 0, &out, sizeof(out));
+}
+
+/**
+ * Dispatch a kernel request
+ *
+ * @param const uint8_t *request - request header followed by the operation arguments
+ * @param size_t len - size of the request
+ */
+static void handleRequest(const uint8_t *request, size_t len) {
+	const struct fuse_in_header *header = (const struct fuse_in_header*) request;
+	const uint8_t *payload = request + sizeof(struct fuse_in_header);
+	if (len < sizeof(struct fuse_in_header)) {
+		return;
+	}
+	switch (header->opcode) {
+	case CUSE_INIT:
+		handleInit(header, payload);
+		break;
+	case FUSE_OPEN:
+		handleOpen(header);
+		break;
+	case FUSE_READ:
+		handleRead(header, (const struct fuse_read_in*) payload);
+		break;
+	case FUSE_INTERRUPT:
+		// The kernel expects no reply to the interrupt itself
+		handleInterrupt((const struct fuse_interrupt_in*) payload);
+		break;
+	case FUSE_POLL:
+		handlePoll(header, (const struct fuse_poll_in*) payload);
+		break;
+	case FUSE_WRITE:
+		pthread_mutex_lock(&waitMutex);
+		stats.rejectedWrites++;
+		pthread_mutex_unlock(&waitMutex);
+		sendReply(header->unique, -EPERM, nullptr, 0);
+		break;
+	case FUSE_IOCTL:
+		sendReply(header->unique, -ENOTTY, nullptr, 0);
+		break;
+	case FUSE_RELEASE:
+	case FUSE_FLUSH:
+	case FUSE_FSYNC:
+		sendReply(header->unique, 0, nullptr, 0);
+		break;
+	default:
+		sendReply(header->unique, -ENOSYS, nullptr, 0);
+		break;
+	}
+}
+
+/**
+ * Reply thread: answers the queued blocking reads in order, waiting for the buffer as needed,
+ * and wakes poll handles once random bytes are available
+ *
+ * @param void *arg - not used
+ * @return void* - nullptr
+ */
+static void* runReplyThread(void *arg) {
+	(void) arg;
+	pthread_mutex_lock(&waitMutex);
+	while (!isReplyThreadStopping) {
+		if (pPendingHead != nullptr) {
+			McrcPendingRead *pending = pPendingHead;
+			pPendingHead = pending->next;
+			if (pPendingHead == nullptr) {
+				pPendingTail = nullptr;
+			}
+			pthread_mutex_unlock(&waitMutex);
+
+			bool isRetrieved = buffer.getRandom(pReplyBytes, pending->size);
+			if (isRetrieved) {
+				sendReply(pending->unique, 0, pReplyBytes, pending->size);
+			} else {
+				sendReply(pending->unique, -EIO, nullptr, 0);
+			}
+
+			pthread_mutex_lock(&waitMutex);
+			if (isRetrieved) {
+				stats.reads++;
+				stats.waitingReads++;
+				stats.bytesServed += pending->size;
+			} else {
+				stats.failedReads++;
+			}
+			free(pending);
+			continue;
+		}
+		if (numPollHandles > 0) {
+			if (buffer.getAvailableBytes() > 0) {
+				for (uint32_t i = 0; i < numPollHandles; i++) {
+					sendPollWakeup(pollHandles[i]);
+				}
+				stats.pollNotifications += numPollHandles;
+				numPollHandles = 0;
+				continue;
+			}
+			// The buffer signals no waiters on refill, check it again shortly
+			struct timespec deadline;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			deadline.tv_nsec += MCRC_POLL_CHECK_MSECS * 1000000;
+			if (deadline.tv_nsec >= 1000000000) {
+				deadline.tv_sec++;
+				deadline.tv_nsec -= 1000000000;
+			}
+			pthread_cond_timedwait(&waitCond, &waitMutex, &deadline);
+			continue;
+		}
+		pthread_cond_wait(&waitCond, &waitMutex);
+	}
+	pthread_mutex_unlock(&waitMutex);
+	return nullptr;
+}
+
+/**
+ * Print character device and buffer counters
+ */
+static void printStats() {
+	pthread_mutex_lock(&waitMutex);
+	McrcStats snapshot = stats;
+	uint32_t numWaiting = 0;
+	for (McrcPendingRead *pending = pPendingHead; pending != nullptr; pending = pending->next) {
+		numWaiting++;
+	}
+	pthread_mutex_unlock(&waitMutex);
+	fprintf(stderr, "Device stats: %llu opens, %llu reads, %llu bytes, %llu waiting reads, %u reads waiting now, "
+			"%llu EAGAIN reads, %llu failed reads, %llu interrupts, %llu polls, %llu poll notifications, "
+			"%llu poll evictions, %llu rejected writes\n",
+			(unsigned long long) snapshot.opens, (unsigned long long) snapshot.reads,
+			(unsigned long long) snapshot.bytesServed, (unsigned long long) snapshot.waitingReads, numWaiting,
+			(unsigned long long) snapshot.emptyReads, (unsigned long long) snapshot.failedReads,
+			(unsigned long long) snapshot.interrupts, (unsigned long long) snapshot.polls,
+			(unsigned long long) snapshot.pollNotifications, (unsigned long long) snapshot.pollEvictions,
+			(unsigned long long) snapshot.rejectedWrites);
+	MicroRngBufferStats bufferStats;
+	buffer.getStats(&bufferStats);
+	fprintf(stderr, "Buffer stats: %u of %u bytes available, %llu hits, %llu misses, %.3f s waited, "
+			"%llu refills, %llu refill failures\n",
+			bufferStats.availableBytes, bufferSizeBytes, (unsigned long long) bufferStats.hits,
+			(unsigned long long) bufferStats.misses, (double) bufferStats.missWaitNanos / 1000000000,
+			(unsigned long long) bufferStats.refills, (unsigned long long) bufferStats.refillFailures);
+}
+
+/**
+ * Create the character device and serve kernel requests until termination is requested
+ *
+ * @return int - 0 when run successfully
+ */
+static int runDevice() {
+	pRequestBytes = (uint8_t*) malloc(MCRC_REQUEST_BUFFER_BYTES);
+	pReadBytes = (uint8_t*) malloc(MCRC_MAX_READ_BYTES);
+	pReplyBytes = (uint8_t*) malloc(MCRC_MAX_READ_BYTES);
+	if (pRequestBytes == nullptr || pReadBytes == nullptr || pReplyBytes == nullptr) {
+		fprintf(stderr, "Cannot allocate memory for request buffers\n");
+		return -1;
+	}
+
+	if (connectDevice() != 0) {
+		return -1;
+	}
+
+	cuseFd = open(MCRC_CUSE_PATH, O_RDWR | O_CLOEXEC);
+	if (cuseFd < 0) {
+		fprintf(stderr, "Cannot open %s, error: %s, is the cuse kernel module loaded?\n",
+				MCRC_CUSE_PATH, strerror(errno));
+		buffer.stop();
+		spi.disconnect();
+		return -1;
+	}
+
+	// Signals are only delivered while waiting for requests, so none is missed between checks.
+	// The reply thread inherits the blocked signals.
+	sigset_t blockedSignals;
+	sigset_t waitSignals;
+	sigemptyset(&blockedSignals);
+	sigaddset(&blockedSignals, SIGTERM);
+	sigaddset(&blockedSignals, SIGINT);
+	sigaddset(&blockedSignals, SIGHUP);
+	sigaddset(&blockedSignals, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &blockedSignals, &waitSignals);
+	sigdelset(&waitSignals, SIGTERM);
+	sigdelset(&waitSignals, SIGINT);
+	sigdelset(&waitSignals, SIGHUP);
+	sigdelset(&waitSignals, SIGUSR1);
+
+	struct sigaction action = { };
+	action.sa_handler = handleTerminationSignal;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGTERM, &action, nullptr);
+	sigaction(SIGINT, &action, nullptr);
+	sigaction(SIGHUP, &action, nullptr);
+	struct sigaction statsAction = { };
+	statsAction.sa_handler = handleStatsSignal;
+	sigemptyset(&statsAction.sa_mask);
+	sigaction(SIGUSR1, &statsAction, nullptr);
+
+	if (pthread_create(&replyThread, nullptr, runReplyThread, nullptr) != 0) {
+		fprintf(stderr, "Cannot create reply thread\n");
+		close(cuseFd);
+		buffer.stop();
+		spi.disconnect();
+		return -1;
+	}
+
+	int status = 0;
+	struct pollfd pfd;
+	pfd.fd = cuseFd;
+	pfd.events = POLLIN;
+	while (!isTerminationRequested) {
+		if (isStatsDumpRequested) {
+			isStatsDumpRequested = 0;
+			printStats();
+		}
+		if (ppoll(&pfd, 1, nullptr, &waitSignals) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "Cannot wait for requests, error: %s\n", strerror(errno));
+			status = -1;
+			break;
+		}
+		ssize_t len = read(cuseFd, pRequestBytes, MCRC_REQUEST_BUFFER_BYTES);
+		if (len < 0) {
+			// ENOENT: the request was aborted before it was read
+			if (errno == EINTR || errno == EAGAIN || errno == ENOENT) {
+				continue;
+			}
+			if (errno != ENODEV) {
+				fprintf(stderr, "Cannot read CUSE request, error: %s\n", strerror(errno));
+				status = -1;
+			}
+			break;
+		}
+		if (len == 0) {
+			break;
+		}
+		handleRequest(pRequestBytes, (size_t) len);
+	}
+
+	if (isStatsReportEnabled) {
+		printStats();
+	}
+	pthread_mutex_lock(&waitMutex);
+	isReplyThreadStopping = true;
+	pthread_cond_signal(&waitCond);
+	pthread_mutex_unlock(&waitMutex);
+	// Wakes the reply thread when waiting for random bytes
+	buffer.stop();
+	pthread_join(replyThread, nullptr);
+	// Closing the channel removes the device and fails the reads still waiting
+	close(cuseFd);
+	while (pPendingHead != nullptr) {
+		McrcPendingRead *pending = pPendingHead;
+		pPendingHead = pending->next;
+		free(pending);
+	}
+	spi.disconnect();
+	free(pReplyBytes);
+	free(pReadBytes);
+	free(pRequestBytes);
+	return status;
+}
+
+/**
+ * Main entry
+ *
+ * @param int argc - number of parameters
+ * @param char ** argv - parameters
+ *
+ */
+int main(int argc, char **argv) {
+	if (processArguments(argc, argv) != 0) {
+		return -1;
+	}
+	return runDevice() == 0 ? 0 : -1;
+}
@@ -0,0 +1,199 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file mcrngcuse.h
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief exposes MicroRNG device as a character device, /dev/microrng by default, through CUSE (character device in userspace) on Raspberry PI 3+ or other Linux-based single-board computers.
+ *
+ *    The CUSE kernel protocol is spoken directly over /dev/cuse, no libfuse is needed. Reads are served from
+ *    the MicroRngBuffer kept filled by its filler thread. A blocking read waits for all requested bytes,
+ *    a read of a descriptor opened with O_NONBLOCK returns the bytes available or fails with EAGAIN.
+ *    poll() and select() report the device readable while the buffer holds random bytes.
+ */
+#ifndef MCRNGCUSE_H_
+#define MCRNGCUSE_H_
+
+#include "MicroRngSPI.h"
+#include "MicroRngBuffer.h"
+#include <unistd.h>
+#include <pthread.h>
+
+#include <stdlib.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <linux/fuse.h>
+
+#define DEFAULT_SPI_DEV_PATH "/dev/spidev0.0"
+#define MCRC_CUSE_PATH "/dev/cuse"
+#define MCRC_DEFAULT_DEVICE_NAME "microrng"
+
+/**
+ * Max amount of bytes the kernel asks for with one read request
+ */
+#define MCRC_MAX_READ_BYTES (131072)
+
+/**
+ * Max amount of bytes the kernel passes with one write request, writes are rejected
+ */
+#define MCRC_MAX_WRITE_BYTES (4096)
+
+/**
+ * Size of the buffer receiving kernel requests, fits the largest write request
+ */
+#define MCRC_REQUEST_BUFFER_BYTES (MCRC_MAX_WRITE_BYTES + 8192)
+
+/**
+ * Max amount of poll handles waiting for random bytes
+ */
+#define MCRC_MAX_POLL_HANDLES (1024)
+
+/**
+ * How often the reply thread checks the buffer for waiting poll handles
+ */
+#define MCRC_POLL_CHECK_MSECS (5)
+
+/**
+ * A blocking read waiting for random bytes
+ */
+struct McrcPendingRead {
+	uint64_t unique;
+	uint32_t size;
+	McrcPendingRead *next;
+};
+
+/**
+ * Counters of the character device
+ */
+struct McrcStats {
+	uint64_t opens;			// open() calls
+	uint64_t reads;			// answered read requests
+	uint64_t bytesServed;		// random bytes handed out
+	uint64_t waitingReads;		// blocking reads answered by the reply thread
+	uint64_t emptyReads;		// non-blocking reads failed with EAGAIN
+	uint64_t failedReads;		// reads failed with EIO
+	uint64_t interrupts;		// waiting reads interrupted by a signal
+	uint64_t polls;			// poll requests
+	uint64_t pollNotifications;	// poll handles woken up
+	uint64_t pollEvictions;		// poll handles woken up early to make room for a new one
+	uint64_t rejectedWrites;	// write requests
+};
+
+/**
+ * SPI device path (a command line argument)
+ */
+static char devicePath[256];
+
+/**
+ * Max SPI master clock frequency in Hz (a command line argument)
+ */
+static uint32_t maxSpiMasterClock = 250000;
+
+/**
+ * True when the SPI master clock frequency is set with a command line argument,
+ * otherwise the calibrated frequency is used
+ */
+static bool isClockFrequencySpecified = false;
+
+/**
+ * Lower the SPI master clock frequency on communication errors and probe it back up when stable (a command line argument)
+ */
+static bool isAdaptiveClock = false;
+
+/**
+ * Name of the character device created in /dev (a command line argument)
+ */
+static char deviceName[64];
+
+/**
+ * Size of the random byte buffer kept filled by the device (a command line argument)
+ */
+static uint32_t bufferSizeBytes = MCR_BUFFER_DEFAULT_CAPACITY_BYTES * 16;
+
+/**
+ * Refill watermarks of the random byte buffer in bytes, 0 for the buffer defaults (command line arguments)
+ */
+static uint32_t lowWatermarkBytes = 0;
+static uint32_t highWatermarkBytes = 0;
+
+/**
+ * Idle time in milliseconds before the noise sources are shut down while the buffer is full,
+ * 0 to keep them on (a command line argument)
+ */
+static uint32_t idleTimeoutMs = 0;
+
+/**
+ * Print character device counters at exit (a command line argument), counters are also printed when receiving SIGUSR1
+ */
+static bool isStatsReportEnabled = false;
+
+static volatile sig_atomic_t isTerminationRequested = 0;
+static volatile sig_atomic_t isStatsDumpRequested = 0;
+static MicroRngSPI spi;
+static MicroRngBuffer buffer(spi);
+static int cuseFd = -1;
+static uint64_t nextFileHandle = 1;
+static uint8_t *pRequestBytes = nullptr;
+static uint8_t *pReadBytes = nullptr;
+static uint8_t *pReplyBytes = nullptr;
+static McrcStats stats;
+
+/**
+ * Blocking reads and poll handles waiting for the reply thread, and the counters, guarded by waitMutex
+ */
+static McrcPendingRead *pPendingHead = nullptr;
+static McrcPendingRead *pPendingTail = nullptr;
+static uint64_t pollHandles[MCRC_MAX_POLL_HANDLES];
+static uint32_t numPollHandles = 0;
+static bool isReplyThreadStopping = false;
+static pthread_mutex_t waitMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t waitCond = PTHREAD_COND_INITIALIZER;
+static pthread_t replyThread;
+
+/**
+ * Function Declarations
+ */
+static void displayUsage();
+static int processArguments(int argc, char **argv);
+static bool validateArgumentCount(int curIdx, int actualArgumentCount);
+static void handleTerminationSignal(int signum);
+static void handleStatsSignal(int signum);
+static int connectDevice();
+static bool sendReply(uint64_t unique, int error, const void *data, size_t len);
+static void sendPollWakeup(uint64_t kh);
+static void handleInit(const struct fuse_in_header *header, const uint8_t *payload);
+static void handleOpen(const struct fuse_in_header *header);
+static void handleRead(const struct fuse_in_header *header, const struct fuse_read_in *in);
+static void handleInterrupt(const struct fuse_interrupt_in *in);
+static void handlePoll(const struct fuse_in_header *header, const struct fuse_poll_in *in);
+static void handleRequest(const uint8_t *request, size_t len);
+static void* runReplyThread(void *arg);
+static void printStats();
+static int runDevice();
+
+#endif /* MCRNGCUSE_H_ */
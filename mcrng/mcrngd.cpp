@@ -0,0 +1,400 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file mcrngd.cpp
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief feeds the Linux kernel entropy pool with random bytes from MicroRNG device through SPI interface on Raspberry PI 3+ or other Linux-based single-board computers.
+ *
+ */
+#include "mcrngd.h"
+
+/**
+ * Display usage message
+ *
+ */
+static void displayUsage() {
+    printf("---------------------------------------------------------------------------\n");
+    printf("---     TectroLabs - mcrngd - MicroRNG entropy daemon Version 1.0       ---\n");
+    printf("---     Use with RPI 3+ or other Linux-based single-board computers     ---\n");
+    printf("---------------------------------------------------------------------------\n");
+    printf("NAME\n");
+    printf("     mcrngd  - True Random Number Generator MicroRNG entropy daemon \n");
+    printf("SYNOPSIS\n");
+    printf("     mcrngd  [options] \n");
+    printf("\n");
+    printf("DESCRIPTION\n");
+    printf("     Mcrngd feeds the kernel entropy pool with random bytes from MicroRNG\n");
+    printf("     device. It waits until /dev/random becomes writable, which happens when\n");
+    printf("     the kernel needs entropy (see write_wakeup_threshold), and submits\n");
+    printf("     batches of random bytes with RNDADDENTROPY.\n");
+    printf("\n");
+    printf("OPTIONS\n");
+    printf("     Operation modifiers:\n");
+    printf("\n");
+    printf("     -dp PATH, --device-path PATH\n");
+    printf("           SPI device path, default value: /dev/spidev0.0\n");
+    printf("\n");
+    printf("     -cf NUMBER, --clock-frequency NUMBER\n");
+    printf("           SPI master clock frequency in KHz, max value 60000,\n");
+    printf("           skip this option for the max frequency calibrated for the device,\n");
+    printf("           detected on first use and kept in %s.\n", MCR_SPI_CALIBRATION_CACHE_DIR);
+    printf("           Use 'mcdiag' utility to re-calibrate the max frequency.\n");
+    printf("\n");
+    printf("     -ac, --adaptive-clock\n");
+    printf("           check the communication periodically with test bytes, drop the\n");
+    printf("           SPI clock frequency a step on errors and retry, then probe it\n");
+    printf("           back up to the max frequency once the communication is stable\n");
+    printf("\n");
+    printf("     -bs NUMBER, --batch-size NUMBER\n");
+    printf("           NUMBER of random bytes submitted to the kernel at once,\n");
+    printf("           max value 65536, default value: 512\n");
+    printf("\n");
+    printf("     -eb NUMBER, --entropy-bits NUMBER\n");
+    printf("           NUMBER of entropy bits credited for each random byte,\n");
+    printf("           value between 1 and 8, default value: 8\n");
+    printf("\n");
+    printf("     -ri NUMBER, --refresh-interval NUMBER\n");
+    printf("           max NUMBER of seconds between entropy pool checks,\n");
+    printf("           default value: 60\n");
+    printf("\n");
+    printf("     -bg, --background\n");
+    printf("           run in background and log through syslog\n");
+    printf("EXAMPLES:\n");
+    printf("     It requires 'sudo' permissions to run this utility.\n");
+    printf("     To feed the kernel entropy pool using device path\n");
+    printf("           mcrngd  -dp /dev/spidev0.0 -cf 20000\n");
+    printf("\n");
+}
+
+/**
+ * Validate command line argument count
+ *
+ * @param int curIdx
+ * @param int actualArgumentCount
+ * @return true if run successfully
+ */
+static bool validateArgumentCount(int curIdx, int actualArgumentCount) {
+	if (curIdx >= actualArgumentCount) {
+		fprintf(stderr, "\nMissing command line arguments\n\n");
+		displayUsage();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Parse arguments for extracting command line parameters
+ *
+ * @param int argc
+ * @param char** argv
+ * @return int - 0 when run successfully
+ */
+static int processArguments(int argc, char **argv) {
+	int idx = 1;
+	strcpy(devicePath, DEFAULT_SPI_DEV_PATH);
+	while (idx < argc) {
+		if (strcmp("-dp", argv[idx]) == 0
+				|| strcmp("--device-path", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			strcpy(devicePath, argv[idx++]);
+		} else if (strcmp("-cf", argv[idx]) == 0
+				|| strcmp("--clock-frequency", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			maxSpiMasterClock = (uint32_t) atoi(argv[idx++]) * 1000;
+			isClockFrequencySpecified = true;
+		} else if (strcmp("-ac", argv[idx]) == 0
+				|| strcmp("--adaptive-clock", argv[idx]) == 0) {
+			isAdaptiveClock = true;
+			++idx;
+		} else if (strcmp("-bs", argv[idx]) == 0
+				|| strcmp("--batch-size", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			int value = atoi(argv[idx++]);
+			if (value <= 0 || value > MCRD_MAX_BATCH_SIZE_BYTES) {
+				fprintf(stderr, "Batch size must be between 1 and %d\n", MCRD_MAX_BATCH_SIZE_BYTES);
+				return -1;
+			}
+			batchSizeBytes = (uint32_t) value;
+		} else if (strcmp("-eb", argv[idx]) == 0
+				|| strcmp("--entropy-bits", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			entropyBitsPerByte = atoi(argv[idx++]);
+			if (entropyBitsPerByte < 1 || entropyBitsPerByte > 8) {
+				fprintf(stderr, "Entropy bits per byte must be between 1 and 8\n");
+				return -1;
+			}
+		} else if (strcmp("-ri", argv[idx]) == 0
+				|| strcmp("--refresh-interval", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			refreshIntervalSecs = atoi(argv[idx++]);
+			if (refreshIntervalSecs <= 0) {
+				fprintf(stderr, "Refresh interval must be a positive number of seconds\n");
+				return -1;
+			}
+		} else if (strcmp("-bg", argv[idx]) == 0
+				|| strcmp("--background", argv[idx]) == 0) {
+			runInBackground = true;
+			++idx;
+		} else if (strcmp("-h", argv[idx]) == 0
+				|| strcmp("--help", argv[idx]) == 0) {
+			displayUsage();
+			return -1;
+		} else {
+			// Could not handle the argument, skip to the next one
+			++idx;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Log a message to standard error or to syslog when running in background
+ *
+ * @param int priority - syslog priority of the message
+ * @param const char* format - printf style message format
+ */
+static void logMessage(int priority, const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	if (runInBackground) {
+		vsyslog(priority, format, args);
+	} else {
+		vfprintf(stderr, format, args);
+		fprintf(stderr, "\n");
+	}
+	va_end(args);
+}
+
+/**
+ * Request the main loop to stop
+ *
+ * @param int signum - signal number
+ */
+static void handleTerminationSignal(int signum) {
+	(void) signum;
+	isTerminationRequested = 1;
+}
+
+/**
+ * Read an integer value from a /proc file
+ *
+ * @param const char* path - complete path to the /proc file
+ * @param int defaultValue - value returned when the file cannot be read
+ * @return int - the value read
+ */
+static int readProcValue(const char *path, int defaultValue) {
+	int value = defaultValue;
+	FILE *procFile = fopen(path, "r");
+	if (procFile != nullptr) {
+		if (fscanf(procFile, "%d", &value) != 1) {
+			value = defaultValue;
+		}
+		fclose(procFile);
+	}
+	return value;
+}
+
+/**
+ * Connect to MicroRNG device and validate it, retrying until successful or until termination is requested
+ *
+ * @return true if connected successfully
+ */
+static bool connectDevice() {
+	while (!isTerminationRequested) {
+		if (spi.isConnected()) {
+			spi.disconnect();
+		}
+		if (spi.connect(devicePath)) {
+			if (isClockFrequencySpecified) {
+				spi.setMaxClockFrequency(maxSpiMasterClock);
+			}
+			spi.setAdaptiveClock(isAdaptiveClock, 0, 0);
+			if ((isClockFrequencySpecified || spi.calibrateClockFrequency()) && spi.validateDevice()) {
+				return true;
+			}
+		}
+		logMessage(LOG_ERR, "Cannot access SPI device %s, error: %s, retrying in %d seconds",
+				devicePath, spi.getLastErrMsg(), MCRD_RECONNECT_DELAY_SECS);
+		sleep(MCRD_RECONNECT_DELAY_SECS);
+	}
+	return false;
+}
+
+/**
+ * Retrieve a batch of random bytes from the device straight into the pool info buffer
+ * and submit it to the kernel entropy pool
+ *
+ * @return true if submitted successfully
+ */
+static bool submitEntropy() {
+	if (!spi.retrieveRandomBytes(batchSizeBytes, (uint8_t*) pPoolInfo->buf)) {
+		logMessage(LOG_ERR, "Failed to receive %u bytes, error: %s", batchSizeBytes,
+				spi.getLastErrMsg());
+		if (!connectDevice()) {
+			return false;
+		}
+		if (!spi.retrieveRandomBytes(batchSizeBytes, (uint8_t*) pPoolInfo->buf)) {
+			return false;
+		}
+	}
+	if (spi.getMaxClockFrequency() != reportedClockHz) {
+		if (reportedClockHz != 0) {
+			logMessage(LOG_NOTICE, "SPI clock frequency changed from %u Hz to %u Hz", reportedClockHz,
+					spi.getMaxClockFrequency());
+		}
+		reportedClockHz = spi.getMaxClockFrequency();
+	}
+	pPoolInfo->buf_size = (int) batchSizeBytes;
+	pPoolInfo->entropy_count = (int) batchSizeBytes * entropyBitsPerByte;
+	int retCode = ioctl(randomDevFd, RNDADDENTROPY, pPoolInfo);
+
+	// Don't keep the submitted bytes in process memory
+	memset(pPoolInfo->buf, 0, batchSizeBytes);
+
+	if (retCode == -1) {
+		logMessage(LOG_ERR, "Cannot add entropy to %s, error: %s", MCRD_RANDOM_DEV_PATH,
+				strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Feed the kernel entropy pool until termination is requested
+ *
+ * @return int - 0 when run successfully
+ */
+static int runDaemon() {
+	int status = 0;
+
+	randomDevFd = open(MCRD_RANDOM_DEV_PATH, O_RDWR);
+	if (randomDevFd == -1) {
+		fprintf(stderr, "Cannot open %s, error: %s\n", MCRD_RANDOM_DEV_PATH, strerror(errno));
+		return -1;
+	}
+
+	pPoolInfo = (struct rand_pool_info*) malloc(sizeof(struct rand_pool_info) + batchSizeBytes);
+	if (pPoolInfo == nullptr) {
+		fprintf(stderr, "Cannot allocate %u bytes for entropy batches\n", batchSizeBytes);
+		close(randomDevFd);
+		return -1;
+	}
+
+	if (runInBackground) {
+		if (daemon(0, 0) == -1) {
+			fprintf(stderr, "Cannot run in background, error: %s\n", strerror(errno));
+			return -1;
+		}
+		openlog("mcrngd", LOG_PID, LOG_DAEMON);
+	}
+
+	struct sigaction action = { };
+	action.sa_handler = handleTerminationSignal;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGTERM, &action, nullptr);
+	sigaction(SIGINT, &action, nullptr);
+	sigaction(SIGHUP, &action, nullptr);
+
+	if (!connectDevice()) {
+		return -1;
+	}
+
+	int poolSizeBits = readProcValue(MCRD_POOLSIZE_PATH, 4096);
+	logMessage(LOG_INFO, "Feeding %s from %s, pool size: %d bits, write wakeup threshold: %d bits",
+			MCRD_RANDOM_DEV_PATH, devicePath, poolSizeBits,
+			readProcValue(MCRD_WAKEUP_THRESHOLD_PATH, -1));
+
+	int batchEntropyBits = (int) batchSizeBytes * entropyBitsPerByte;
+	while (!isTerminationRequested) {
+		struct pollfd pfd;
+		pfd.fd = randomDevFd;
+		pfd.events = POLLOUT;
+		pfd.revents = 0;
+		int retCode = poll(&pfd, 1, refreshIntervalSecs * 1000);
+		if (retCode == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			logMessage(LOG_ERR, "Cannot poll %s, error: %s", MCRD_RANDOM_DEV_PATH, strerror(errno));
+			status = -1;
+			break;
+		}
+
+		int entropyAvailBits;
+		if (ioctl(randomDevFd, RNDGETENTCNT, &entropyAvailBits) == -1) {
+			entropyAvailBits = 0;
+		}
+
+		// Pull only as many bytes from the device as the pool can take
+		int numBatches = (poolSizeBits - entropyAvailBits + batchEntropyBits - 1) / batchEntropyBits;
+		if (numBatches <= 0 && (pfd.revents & POLLOUT)) {
+			// The kernel still asks for entropy
+			numBatches = 1;
+		}
+		if (numBatches > MCRD_MAX_BATCHES_PER_WAKEUP) {
+			numBatches = MCRD_MAX_BATCHES_PER_WAKEUP;
+		}
+		for (int i = 0; i < numBatches && !isTerminationRequested; i++) {
+			if (!submitEntropy()) {
+				status = -1;
+				break;
+			}
+		}
+		if (status != 0) {
+			break;
+		}
+	}
+
+	logMessage(LOG_INFO, "Stopped feeding %s", MCRD_RANDOM_DEV_PATH);
+	spi.disconnect();
+	free(pPoolInfo);
+	close(randomDevFd);
+	return status;
+}
+
+/**
+ * Main entry
+ *
+ * @param int argc - number of parameters
+ * @param char ** argv - parameters
+ *
+ */
+int main(int argc, char **argv) {
+	if (processArguments(argc, argv) != 0) {
+		return -1;
+	}
+	return runDaemon() == 0 ? 0 : -1;
+}
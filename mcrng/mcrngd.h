@@ -0,0 +1,118 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file mcrngd.h
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief feeds the Linux kernel entropy pool with random bytes from MicroRNG device through SPI interface on Raspberry PI 3+ or other Linux-based single-board computers.
+ *
+ */
+#ifndef MCRNGD_H_
+#define MCRNGD_H_
+
+#include "MicroRngSPI.h"
+#include <unistd.h>
+
+#include <stdlib.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <syslog.h>
+#include <linux/random.h>
+
+#define DEFAULT_SPI_DEV_PATH "/dev/spidev0.0"
+#define MCRD_RANDOM_DEV_PATH "/dev/random"
+#define MCRD_POOLSIZE_PATH "/proc/sys/kernel/random/poolsize"
+#define MCRD_WAKEUP_THRESHOLD_PATH "/proc/sys/kernel/random/write_wakeup_threshold"
+#define MCRD_DEFAULT_BATCH_SIZE_BYTES (512)
+#define MCRD_MAX_BATCH_SIZE_BYTES (65536)
+#define MCRD_MAX_BATCHES_PER_WAKEUP (64)
+#define MCRD_DEFAULT_ENTROPY_BITS_PER_BYTE (8)
+#define MCRD_DEFAULT_REFRESH_SECS (60)
+#define MCRD_RECONNECT_DELAY_SECS (5)
+
+/**
+ * SPI device path
+ */
+static char devicePath[256];
+
+/**
+ * Max SPI master clock frequency in Hz (a command line argument)
+ */
+static uint32_t maxSpiMasterClock = 250000;
+
+/**
+ * True when the SPI master clock frequency is set with a command line argument,
+ * otherwise the calibrated frequency is used
+ */
+static bool isClockFrequencySpecified = false;
+
+/**
+ * Lower the SPI master clock frequency on communication errors and probe it back up when stable (a command line argument)
+ */
+static bool isAdaptiveClock = false;
+
+/**
+ * Amount of random bytes submitted to the kernel with a single RNDADDENTROPY call (a command line argument)
+ */
+static uint32_t batchSizeBytes = MCRD_DEFAULT_BATCH_SIZE_BYTES;
+
+/**
+ * Entropy bits credited to the kernel for each random byte (a command line argument)
+ */
+static int entropyBitsPerByte = MCRD_DEFAULT_ENTROPY_BITS_PER_BYTE;
+
+/**
+ * Max time in seconds between entropy pool refreshes when the kernel doesn't ask for entropy (a command line argument)
+ */
+static int refreshIntervalSecs = MCRD_DEFAULT_REFRESH_SECS;
+
+/**
+ * Detach from the terminal and log through syslog (a command line argument)
+ */
+static bool runInBackground = false;
+
+static volatile sig_atomic_t isTerminationRequested = 0;
+static int randomDevFd = -1;
+static uint32_t reportedClockHz = 0;
+static struct rand_pool_info *pPoolInfo = nullptr;
+static MicroRngSPI spi;
+
+/**
+ * Function Declarations
+ */
+static void displayUsage();
+static int processArguments(int argc, char **argv);
+static bool validateArgumentCount(int curIdx, int actualArgumentCount);
+static void logMessage(int priority, const char *format, ...);
+static void handleTerminationSignal(int signum);
+static int readProcValue(const char *path, int defaultValue);
+static bool connectDevice();
+static bool submitEntropy();
+static int runDaemon();
+
+#endif /* MCRNGD_H_ */
@@ -0,0 +1,1076 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file mcrngserver.cpp
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief serves random bytes from MicroRNG device to network clients over TCP and Unix domain sockets, on Raspberry PI 3+ or other Linux-based single-board computers.
+ *
+ */
+#include "mcrngserver.h"
+
+/**
+ * Display usage message
+ *
+ */
+static void displayUsage() {
+    printf("---------------------------------------------------------------------------\n");
+    printf("---   TectroLabs - mcrng-server - MicroRNG network server Version 1.0   ---\n");
+    printf("---     Use with RPI 3+ or other Linux-based single-board computers     ---\n");
+    printf("---------------------------------------------------------------------------\n");
+    printf("NAME\n");
+    printf("     mcrng-server  - True Random Number Generator MicroRNG network server \n");
+    printf("SYNOPSIS\n");
+    printf("     mcrng-server  [options] \n");
+    printf("\n");
+    printf("DESCRIPTION\n");
+    printf("     Mcrng-server serves random bytes from MicroRNG device to clients\n");
+    printf("     connected over TCP or a Unix domain socket. A client sends requests,\n");
+    printf("     each one a 4 byte big-endian number of bytes between 1 and %d,\n", MCRSV_MAX_REQUEST_BYTES);
+    printf("     and receives for each request a 4 byte big-endian length followed\n");
+    printf("     by that many random bytes, a zero length reports a device failure.\n");
+    printf("     Requests of all clients are coalesced into one read of random bytes.\n");
+    printf("\n");
+    printf("OPTIONS\n");
+    printf("     Operation modifiers:\n");
+    printf("\n");
+    printf("     -dp PATH, --device-path PATH\n");
+    printf("           SPI device path, default value: /dev/spidev0.0\n");
+    printf("\n");
+    printf("     -cf NUMBER, --clock-frequency NUMBER\n");
+    printf("           SPI master clock frequency in KHz, max value 60000,\n");
+    printf("           skip this option for the max frequency calibrated for the device,\n");
+    printf("           detected on first use and kept in %s.\n", MCR_SPI_CALIBRATION_CACHE_DIR);
+    printf("           Use 'mcdiag' utility to re-calibrate the max frequency.\n");
+    printf("\n");
+    printf("     -ac, --adaptive-clock\n");
+    printf("           check the communication periodically with test bytes, drop the\n");
+    printf("           SPI clock frequency a step on errors and retry, then probe it\n");
+    printf("           back up to the max frequency once the communication is stable\n");
+    printf("\n");
+    printf("     -ta HOST:PORT, --tcp-address HOST:PORT\n");
+    printf("           listen for TCP clients on HOST:PORT, use * or [::] as HOST\n");
+    printf("           for all IPv4 or IPv6 addresses\n");
+    printf("\n");
+    printf("     -us PATH, --unix-socket PATH\n");
+    printf("           listen for local clients on a Unix domain socket PATH,\n");
+    printf("           default value when -ta is not used: %s\n", MCRSV_DEFAULT_UNIX_SOCKET);
+    printf("\n");
+    printf("     -pm MODE, --permissions MODE\n");
+    printf("           octal access MODE of the Unix domain socket, default value: 666\n");
+    printf("\n");
+    printf("     -bs NUMBER, --buffer-size NUMBER\n");
+    printf("           NUMBER of random bytes kept ready by the device filler thread,\n");
+    printf("           requests larger than the buffer hold up all clients while read,\n");
+    printf("           default value: %d\n", MCR_BUFFER_DEFAULT_CAPACITY_BYTES * 16);
+    printf("\n");
+    printf("     -lw NUMBER, --low-watermark NUMBER\n");
+    printf("           refill the buffer once it holds no more than NUMBER of bytes,\n");
+    printf("           default value: %d%% of the buffer size\n", MCR_BUFFER_DEFAULT_LOW_WATERMARK_PERCENT);
+    printf("\n");
+    printf("     -hw NUMBER, --high-watermark NUMBER\n");
+    printf("           stop refilling the buffer once it holds NUMBER of bytes,\n");
+    printf("           default value: %d%% of the buffer size\n", MCR_BUFFER_DEFAULT_HIGH_WATERMARK_PERCENT);
+    printf("\n");
+    printf("     -it NUMBER, --idle-timeout NUMBER\n");
+    printf("           shut the noise sources down after NUMBER of milliseconds without\n");
+    printf("           reads while the buffer is full, they are started up again ahead\n");
+    printf("           of the predicted demand, default value: 0 (always on)\n");
+    printf("\n");
+    printf("     -mc NUMBER, --max-clients NUMBER\n");
+    printf("           max NUMBER of connected clients, max value %d,\n", MCRSV_MAX_CLIENTS);
+    printf("           default value: %d\n", MCRSV_DEFAULT_MAX_CLIENTS);
+    printf("\n");
+    printf("     -rl NUMBER, --rate-limit NUMBER\n");
+    printf("           max NUMBER of random bytes per second served to each client,\n");
+    printf("           skip this option for unlimited clients\n");
+    printf("\n");
+    printf("     -st, --stats\n");
+    printf("           print server and client counters to standard error at exit,\n");
+    printf("           counters are also printed when receiving SIGUSR1\n");
+    printf("EXAMPLES:\n");
+    printf("     It may require 'sudo' permissions to run this utility.\n");
+    printf("     To serve random bytes to the rack on TCP port 5400, 1 MB per second per client\n");
+    printf("           mcrng-server  -dp /dev/spidev0.0 -ta *:5400 -rl 1000000\n");
+    printf("\n");
+}
+
+/**
+ * Validate command line argument count
+ *
+ * @param int curIdx
+ * @param int actualArgumentCount
+ * @return true if run successfully
+ */
+static bool validateArgumentCount(int curIdx, int actualArgumentCount) {
+	if (curIdx >= actualArgumentCount) {
+		fprintf(stderr, "\nMissing command line arguments\n\n");
+		displayUsage();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Parse arguments for extracting command line parameters
+ *
+ * @param int argc
+ * @param char** argv
+ * @return int - 0 when run successfully
+ */
+static int processArguments(int argc, char **argv) {
+	int idx = 1;
+	strcpy(devicePath, DEFAULT_SPI_DEV_PATH);
+	strcpy(tcpAddress, "");
+	strcpy(unixSocketPath, "");
+	while (idx < argc) {
+		if (strcmp("-dp", argv[idx]) == 0
+				|| strcmp("--device-path", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			strcpy(devicePath, argv[idx++]);
+		} else if (strcmp("-cf", argv[idx]) == 0
+				|| strcmp("--clock-frequency", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			maxSpiMasterClock = (uint32_t) atoi(argv[idx++]) * 1000;
+			isClockFrequencySpecified = true;
+		} else if (strcmp("-ac", argv[idx]) == 0
+				|| strcmp("--adaptive-clock", argv[idx]) == 0) {
+			isAdaptiveClock = true;
+			++idx;
+		} else if (strcmp("-ta", argv[idx]) == 0
+				|| strcmp("--tcp-address", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			if (strchr(argv[idx], ':') == nullptr || strlen(argv[idx]) >= sizeof(tcpAddress)) {
+				fprintf(stderr, "TCP address must be given as HOST:PORT\n");
+				return -1;
+			}
+			strcpy(tcpAddress, argv[idx++]);
+		} else if (strcmp("-us", argv[idx]) == 0
+				|| strcmp("--unix-socket", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			if (strlen(argv[idx]) == 0 || strlen(argv[idx]) >= sizeof(unixSocketPath)) {
+				fprintf(stderr, "Unix domain socket path must be between 1 and %d characters\n",
+						(int) sizeof(unixSocketPath) - 1);
+				return -1;
+			}
+			strcpy(unixSocketPath, argv[idx++]);
+		} else if (strcmp("-pm", argv[idx]) == 0
+				|| strcmp("--permissions", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			socketPermissions = (mode_t) strtol(argv[idx++], nullptr, 8) & 0777;
+		} else if (strcmp("-bs", argv[idx]) == 0
+				|| strcmp("--buffer-size", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			int64_t value = atoll(argv[idx++]);
+			if (value < MCR_BUFFER_MIN_CAPACITY_BYTES || value > MCR_BUFFER_MAX_CAPACITY_BYTES) {
+				fprintf(stderr, "Buffer size must be between %d and %d\n",
+						MCR_BUFFER_MIN_CAPACITY_BYTES, MCR_BUFFER_MAX_CAPACITY_BYTES);
+				return -1;
+			}
+			bufferSizeBytes = (uint32_t) value;
+		} else if (strcmp("-lw", argv[idx]) == 0
+				|| strcmp("--low-watermark", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			int64_t value = atoll(argv[idx++]);
+			if (value <= 0 || value > MCR_BUFFER_MAX_CAPACITY_BYTES) {
+				fprintf(stderr, "Low watermark must be between 1 and %d\n", MCR_BUFFER_MAX_CAPACITY_BYTES);
+				return -1;
+			}
+			lowWatermarkBytes = (uint32_t) value;
+		} else if (strcmp("-hw", argv[idx]) == 0
+				|| strcmp("--high-watermark", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			int64_t value = atoll(argv[idx++]);
+			if (value <= 0 || value > MCR_BUFFER_MAX_CAPACITY_BYTES) {
+				fprintf(stderr, "High watermark must be between 1 and %d\n", MCR_BUFFER_MAX_CAPACITY_BYTES);
+				return -1;
+			}
+			highWatermarkBytes = (uint32_t) value;
+		} else if (strcmp("-it", argv[idx]) == 0
+				|| strcmp("--idle-timeout", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			int64_t value = atoll(argv[idx++]);
+			if (value < 0 || value > UINT32_MAX) {
+				fprintf(stderr, "Idle timeout must be between 0 and %u\n", UINT32_MAX);
+				return -1;
+			}
+			idleTimeoutMs = (uint32_t) value;
+		} else if (strcmp("-mc", argv[idx]) == 0
+				|| strcmp("--max-clients", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			int64_t value = atoll(argv[idx++]);
+			if (value <= 0 || value > MCRSV_MAX_CLIENTS) {
+				fprintf(stderr, "Max clients must be between 1 and %d\n", MCRSV_MAX_CLIENTS);
+				return -1;
+			}
+			maxClients = (uint32_t) value;
+		} else if (strcmp("-rl", argv[idx]) == 0
+				|| strcmp("--rate-limit", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			int64_t value = atoll(argv[idx++]);
+			if (value <= 0) {
+				fprintf(stderr, "Rate limit must be a positive number\n");
+				return -1;
+			}
+			rateLimitBytes = (uint64_t) value;
+		} else if (strcmp("-st", argv[idx]) == 0
+				|| strcmp("--stats", argv[idx]) == 0) {
+			isStatsReportEnabled = true;
+			++idx;
+		} else if (strcmp("-h", argv[idx]) == 0
+				|| strcmp("--help", argv[idx]) == 0) {
+			displayUsage();
+			return -1;
+		} else {
+			// Could not handle the argument, skip to the next one
+			++idx;
+		}
+	}
+	if (strlen(tcpAddress) == 0 && strlen(unixSocketPath) == 0) {
+		strcpy(unixSocketPath, MCRSV_DEFAULT_UNIX_SOCKET);
+	}
+	return 0;
+}
+
+/**
+ * Request the main loop to stop
+ *
+ * @param int signum - signal number
+ */
+static void handleTerminationSignal(int signum) {
+	(void) signum;
+	isTerminationRequested = 1;
+}
+
+/**
+ * Request printing server counters
+ *
+ * @param int signum - signal number
+ */
+static void handleStatsSignal(int signum) {
+	(void) signum;
+	isStatsDumpRequested = 1;
+}
+
+/**
+ * @return uint64_t - CLOCK_MONOTONIC time in nanoseconds
+ */
+static uint64_t getMonotonicNanos() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * Connect to the device and start the filler thread of the random byte buffer
+ *
+ * @return int - 0 when run successfully
+ */
+static int connectDevice() {
+	if (!spi.connect(devicePath)) {
+		fprintf(stderr, " Cannot open SPI device %s, error: %s ... \n",
+				devicePath, spi.getLastErrMsg());
+		return -1;
+	}
+
+	if (isClockFrequencySpecified) {
+		spi.setMaxClockFrequency(maxSpiMasterClock);
+	} else if (!spi.calibrateClockFrequency()) {
+		fprintf(stderr, " Cannot calibrate SPI clock frequency, error: %s ... \n",
+				spi.getLastErrMsg());
+		return -1;
+	}
+	spi.setAdaptiveClock(isAdaptiveClock, 0, 0);
+
+	if (!spi.validateDevice()) {
+		fprintf(stderr, " Cannot access device, error: %s ... \n",
+				spi.getLastErrMsg());
+		return -1;
+	}
+
+	if (!buffer.setWatermarks(lowWatermarkBytes, highWatermarkBytes)) {
+		fprintf(stderr, " Invalid buffer watermarks, error: %s ... \n", buffer.getLastErrMsg());
+		return -1;
+	}
+	buffer.setIdleShutdown(idleTimeoutMs);
+	if (!buffer.start(bufferSizeBytes)) {
+		fprintf(stderr, " Cannot start random byte buffer, error: %s ... \n",
+				buffer.getLastErrMsg());
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Add a listening socket to the epoll set
+ *
+ * @param int fd - listening socket
+ * @return int - 0 when run successfully
+ */
+static int addListener(int fd) {
+	struct epoll_event event = { };
+	event.events = EPOLLIN;
+	event.data.u64 = numListeners;
+	if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+		fprintf(stderr, "Cannot watch listening socket, error: %s\n", strerror(errno));
+		close(fd);
+		return -1;
+	}
+	listenerFds[numListeners++] = fd;
+	return 0;
+}
+
+/**
+ * Listen for TCP clients on the TCP address
+ *
+ * @return int - 0 when run successfully
+ */
+static int listenTcp() {
+	char host[256];
+	strcpy(host, tcpAddress);
+	char *port = strrchr(host, ':');
+	*port++ = '\0';
+	char *node = host;
+	if (node[0] == '[' && node[strlen(node) - 1] == ']') {
+		node[strlen(node) - 1] = '\0';
+		node++;
+	}
+	if (strcmp(node, "*") == 0 || strlen(node) == 0) {
+		node = nullptr;
+	}
+
+	struct addrinfo hints = { };
+	struct addrinfo *addresses;
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE;
+	int retCode = getaddrinfo(node, port, &hints, &addresses);
+	if (retCode != 0) {
+		fprintf(stderr, "Cannot resolve TCP address %s, error: %s\n", tcpAddress, gai_strerror(retCode));
+		return -1;
+	}
+	int fd = socket(addresses->ai_family, addresses->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+			addresses->ai_protocol);
+	if (fd < 0) {
+		fprintf(stderr, "Cannot create TCP socket, error: %s\n", strerror(errno));
+		freeaddrinfo(addresses);
+		return -1;
+	}
+	int option = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option));
+	if (bind(fd, addresses->ai_addr, addresses->ai_addrlen) != 0
+			|| listen(fd, MCRSV_LISTEN_BACKLOG) != 0) {
+		fprintf(stderr, "Cannot listen on TCP address %s, error: %s\n", tcpAddress, strerror(errno));
+		freeaddrinfo(addresses);
+		close(fd);
+		return -1;
+	}
+	freeaddrinfo(addresses);
+	return addListener(fd);
+}
+
+/**
+ * Remove a socket left at the Unix domain socket path, nothing but a socket is ever removed
+ *
+ * @return int - 0 when the path is free or a socket was removed
+ */
+static int removeStaleSocket() {
+	struct stat pathStat;
+	if (lstat(unixSocketPath, &pathStat) != 0) {
+		if (errno == ENOENT) {
+			return 0;
+		}
+		fprintf(stderr, "Cannot access Unix domain socket path %s, error: %s\n", unixSocketPath, strerror(errno));
+		return -1;
+	}
+	if (!S_ISSOCK(pathStat.st_mode)) {
+		fprintf(stderr, "Cannot listen on %s, the path exists and is not a socket\n", unixSocketPath);
+		return -1;
+	}
+	if (unlink(unixSocketPath) != 0) {
+		fprintf(stderr, "Cannot remove stale socket %s, error: %s\n", unixSocketPath, strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Listen for local clients on the Unix domain socket path, replacing a stale socket
+ *
+ * @return int - 0 when run successfully
+ */
+static int listenUnix() {
+	struct sockaddr_un address = { };
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, unixSocketPath);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		fprintf(stderr, "Cannot create Unix domain socket, error: %s\n", strerror(errno));
+		return -1;
+	}
+	if (removeStaleSocket() != 0) {
+		close(fd);
+		return -1;
+	}
+	if (bind(fd, (struct sockaddr*) &address, sizeof(address)) != 0
+			|| listen(fd, MCRSV_LISTEN_BACKLOG) != 0) {
+		fprintf(stderr, "Cannot listen on Unix domain socket %s, error: %s\n", unixSocketPath, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	// Not affected by umask
+	chmod(unixSocketPath, socketPermissions);
+	return addListener(fd);
+}
+
+/**
+ * Accept all pending connections of a listening socket
+ *
+ * @param int listenerFd - listening socket
+ */
+static void acceptClients(int listenerFd) {
+	while (true) {
+		struct sockaddr_storage address;
+		socklen_t addressLen = sizeof(address);
+		int fd = accept4(listenerFd, (struct sockaddr*) &address, &addressLen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+				fprintf(stderr, "Cannot accept connection, error: %s\n", strerror(errno));
+			}
+			return;
+		}
+		if (numClients >= maxClients) {
+			stats.rejectedConnections++;
+			close(fd);
+			continue;
+		}
+		uint32_t slot = 0;
+		while (pClients[slot].fd >= 0) {
+			slot++;
+		}
+		McrsvClient *client = &pClients[slot];
+		memset(client, 0, sizeof(McrsvClient));
+		client->fd = fd;
+		char host[INET6_ADDRSTRLEN];
+		if (address.ss_family == AF_INET) {
+			struct sockaddr_in *in = (struct sockaddr_in*) &address;
+			inet_ntop(AF_INET, &in->sin_addr, host, sizeof(host));
+			sprintf(client->address, "%s:%u", host, (unsigned) ntohs(in->sin_port));
+		} else if (address.ss_family == AF_INET6) {
+			struct sockaddr_in6 *in6 = (struct sockaddr_in6*) &address;
+			inet_ntop(AF_INET6, &in6->sin6_addr, host, sizeof(host));
+			sprintf(client->address, "[%s]:%u", host, (unsigned) ntohs(in6->sin6_port));
+		} else {
+			sprintf(client->address, "unix:%d", fd);
+		}
+		if (address.ss_family != AF_UNIX) {
+			int option = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &option, sizeof(option));
+		}
+		client->tokens = (double) rateLimitBytes;
+		client->tokenNanos = getMonotonicNanos();
+		client->connectNanos = client->tokenNanos;
+
+		struct epoll_event event = { };
+		event.events = EPOLLIN | EPOLLRDHUP;
+		event.data.u64 = MCRSV_CLIENT_TAG + slot;
+		if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+			fprintf(stderr, "Cannot watch client connection, error: %s\n", strerror(errno));
+			close(fd);
+			client->fd = -1;
+			continue;
+		}
+		client->epollEvents = event.events;
+		numClients++;
+		stats.connections++;
+	}
+}
+
+/**
+ * Close a client connection and release its slot
+ *
+ * @param McrsvClient* client - client to close
+ */
+static void closeClient(McrsvClient *client) {
+	if (client->fd < 0) {
+		return;
+	}
+	close(client->fd);
+	client->fd = -1;
+	free(client->pOutput);
+	client->pOutput = nullptr;
+	numClients--;
+}
+
+/**
+ * Close a client connection once it shut down its sending side and all its requests are answered
+ *
+ * @param McrsvClient* client - client to check
+ */
+static void closeIfDone(McrsvClient *client) {
+	if (client->fd >= 0 && client->isInputClosed && client->inputBytes < MCRSV_HEADER_BYTES
+			&& client->outputBytes == 0) {
+		closeClient(client);
+	}
+}
+
+/**
+ * Watch a client for the events it is ready for: requests while its input buffer has room
+ * and the sending side is open, socket space while responses are queued
+ *
+ * @param McrsvClient* client - client to update
+ */
+static void updateEvents(McrsvClient *client) {
+	uint32_t events = 0;
+	if (!client->isInputClosed && client->inputBytes < MCRSV_INPUT_BUFFER_BYTES) {
+		events |= EPOLLIN | EPOLLRDHUP;
+	}
+	if (client->outputBytes > 0) {
+		events |= EPOLLOUT;
+	}
+	if (events == client->epollEvents) {
+		return;
+	}
+	struct epoll_event event = { };
+	event.events = events;
+	event.data.u64 = MCRSV_CLIENT_TAG + (uint64_t) (client - pClients);
+	epoll_ctl(epollFd, EPOLL_CTL_MOD, client->fd, &event);
+	client->epollEvents = events;
+}
+
+/**
+ * Receive request bytes of a client into its input buffer
+ *
+ * @param McrsvClient* client - readable client
+ */
+static void readRequests(McrsvClient *client) {
+	ssize_t numRead = read(client->fd, client->input + client->inputBytes,
+			MCRSV_INPUT_BUFFER_BYTES - client->inputBytes);
+	if (numRead < 0) {
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+			closeClient(client);
+		}
+		return;
+	}
+	if (numRead == 0) {
+		client->isInputClosed = true;
+		updateEvents(client);
+		closeIfDone(client);
+		return;
+	}
+	client->inputBytes += (uint32_t) numRead;
+	updateEvents(client);
+}
+
+/**
+ * Send queued response bytes of a client
+ *
+ * @param McrsvClient* client - writable client
+ * @return true when the connection is still open
+ */
+static bool flushOutput(McrsvClient *client) {
+	ssize_t numWritten = write(client->fd, client->pOutput + client->outputOffset, client->outputBytes);
+	if (numWritten < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+			return true;
+		}
+		closeClient(client);
+		return false;
+	}
+	client->outputOffset += (uint32_t) numWritten;
+	client->outputBytes -= (uint32_t) numWritten;
+	if (client->outputBytes == 0) {
+		client->outputOffset = 0;
+	}
+	updateEvents(client);
+	closeIfDone(client);
+	return client->fd >= 0;
+}
+
+/**
+ * Queue response bytes the socket didn't accept
+ *
+ * @param McrsvClient* client - client to queue for
+ * @param const struct iovec* iov - response headers and random bytes
+ * @param int numIov - number of iovec entries
+ * @param size_t skipBytes - leading bytes already sent
+ * @return true when queued successfully
+ */
+static bool queueOutput(McrsvClient *client, const struct iovec *iov, int numIov, size_t skipBytes) {
+	size_t numBytes = 0;
+	for (int i = 0; i < numIov; i++) {
+		numBytes += iov[i].iov_len;
+	}
+	numBytes -= skipBytes;
+	if (client->outputOffset > 0) {
+		memmove(client->pOutput, client->pOutput + client->outputOffset, client->outputBytes);
+		client->outputOffset = 0;
+	}
+	if (client->outputBytes + numBytes > client->outputCapacity) {
+		uint8_t *pOutput = (uint8_t*) realloc(client->pOutput, client->outputBytes + numBytes);
+		if (pOutput == nullptr) {
+			return false;
+		}
+		client->pOutput = pOutput;
+		client->outputCapacity = (uint32_t) (client->outputBytes + numBytes);
+	}
+	for (int i = 0; i < numIov; i++) {
+		size_t len = iov[i].iov_len;
+		const uint8_t *bytes = (const uint8_t*) iov[i].iov_base;
+		if (skipBytes >= len) {
+			skipBytes -= len;
+			continue;
+		}
+		memcpy(client->pOutput + client->outputBytes, bytes + skipBytes, len - skipBytes);
+		client->outputBytes += (uint32_t) (len - skipBytes);
+		skipBytes = 0;
+	}
+	return true;
+}
+
+/**
+ * Add the tokens a client earned since the last refill, up to one second worth of bytes
+ *
+ * @param McrsvClient* client - client to refill
+ * @param uint64_t nowNanos - CLOCK_MONOTONIC time in nanoseconds
+ */
+static void refillTokens(McrsvClient *client, uint64_t nowNanos) {
+	if (rateLimitBytes == 0) {
+		return;
+	}
+	client->tokens += (double) (nowNanos - client->tokenNanos) * rateLimitBytes / 1000000000;
+	if (client->tokens > (double) rateLimitBytes) {
+		client->tokens = (double) rateLimitBytes;
+	}
+	client->tokenNanos = nowNanos;
+}
+
+/**
+ * Answer requests of one client, the random bytes of each response follow its header.
+ * Responses are written with writev(), whatever the socket doesn't accept is queued.
+ *
+ * @param McrsvClient* client - client to answer
+ * @param const uint32_t* lengths - requested amounts of random bytes
+ * @param const uint8_t* bytes - random bytes of all responses, one after another
+ * @param uint32_t numResponses - number of requests to answer
+ * @param bool isSuccess - false to answer with zero length responses
+ */
+static void sendResponses(McrsvClient *client, const uint32_t *lengths, const uint8_t *bytes,
+		uint32_t numResponses, bool isSuccess) {
+	uint32_t headers[MCRSV_MAX_WRITEV_RESPONSES];
+	struct iovec iov[MCRSV_MAX_WRITEV_RESPONSES * 2];
+	for (uint32_t first = 0; first < numResponses; first += MCRSV_MAX_WRITEV_RESPONSES) {
+		uint32_t count = numResponses - first;
+		if (count > MCRSV_MAX_WRITEV_RESPONSES) {
+			count = MCRSV_MAX_WRITEV_RESPONSES;
+		}
+		int numIov = 0;
+		size_t numBytes = 0;
+		for (uint32_t i = 0; i < count; i++) {
+			uint32_t len = lengths[first + i];
+			headers[i] = htonl(isSuccess ? len : 0);
+			iov[numIov].iov_base = &headers[i];
+			iov[numIov++].iov_len = MCRSV_HEADER_BYTES;
+			numBytes += MCRSV_HEADER_BYTES;
+			if (isSuccess) {
+				iov[numIov].iov_base = (void*) bytes;
+				iov[numIov++].iov_len = len;
+				numBytes += len;
+				client->bytesServed += len;
+				stats.bytesServed += len;
+			} else {
+				stats.failedRequests++;
+			}
+			bytes += len;
+		}
+		client->requests += count;
+		stats.requests += count;
+
+		ssize_t numWritten = 0;
+		if (client->outputBytes == 0) {
+			numWritten = writev(client->fd, iov, numIov);
+			if (numWritten < 0) {
+				if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+					closeClient(client);
+					return;
+				}
+				numWritten = 0;
+			}
+		}
+		if ((size_t) numWritten < numBytes) {
+			stats.partialWrites++;
+			if (!queueOutput(client, iov, numIov, (size_t) numWritten)) {
+				fprintf(stderr, "Cannot queue %u response bytes for client %s\n",
+						(unsigned) (numBytes - numWritten), client->address);
+				closeClient(client);
+				return;
+			}
+		}
+	}
+	updateEvents(client);
+	closeIfDone(client);
+}
+
+/**
+ * Coalesce the pending requests of all clients into one read from the random byte buffer
+ * and answer them. Clients with queued responses or spent rate limits are skipped.
+ * A batch only takes the bytes the buffer already holds, so the read doesn't block the event loop,
+ * except for a request larger than the buffer, which is read on its own.
+ *
+ * @param uint64_t nowNanos - CLOCK_MONOTONIC time in nanoseconds
+ * @return int - MCRSV_BATCH_DONE, MCRSV_BATCH_BACKLOGGED or MCRSV_BATCH_BUFFER_SHORT
+ */
+static int serveBatch(uint64_t nowNanos) {
+	static McrsvClient *batchClients[MCRSV_MAX_BATCH_REQUESTS];
+	static uint32_t batchLengths[MCRSV_MAX_BATCH_REQUESTS];
+	static uint32_t nextSlot = 0;
+	uint32_t numRequests = 0;
+	uint64_t numBytes = 0;
+	uint64_t numAvailable = buffer.getAvailableBytes();
+	int status = MCRSV_BATCH_DONE;
+
+	// Start with a different client each batch so a full batch doesn't always favor the same clients
+	uint32_t slot = nextSlot;
+	for (uint32_t n = 0; n < maxClients && status != MCRSV_BATCH_BACKLOGGED; n++, slot = (slot + 1) % maxClients) {
+		McrsvClient *client = &pClients[slot];
+		if (client->fd < 0 || client->outputBytes > 0 || client->inputBytes < MCRSV_HEADER_BYTES) {
+			continue;
+		}
+		refillTokens(client, nowNanos);
+		uint32_t offset = 0;
+		while (client->inputBytes - offset >= MCRSV_HEADER_BYTES) {
+			uint32_t len;
+			memcpy(&len, client->input + offset, sizeof(len));
+			len = ntohl(len);
+			if (len == 0 || len > MCRSV_MAX_REQUEST_BYTES) {
+				if (offset == 0) {
+					stats.protocolErrors++;
+					closeClient(client);
+				}
+				// Otherwise answer the valid requests first
+				break;
+			}
+			if (rateLimitBytes > 0 && client->tokens < 0) {
+				if (!client->isThrottled) {
+					client->isThrottled = true;
+					client->throttles++;
+					stats.throttles++;
+				}
+				break;
+			}
+			if (numRequests == MCRSV_MAX_BATCH_REQUESTS || numBytes + len > MCRSV_MAX_BATCH_BYTES) {
+				status = MCRSV_BATCH_BACKLOGGED;
+				nextSlot = slot;
+				break;
+			}
+			// Requests of other clients may still fit, the first waiting client starts the next batch
+			if (numBytes + len > numAvailable && (numRequests > 0 || len <= bufferSizeBytes)) {
+				if (status == MCRSV_BATCH_DONE) {
+					status = MCRSV_BATCH_BUFFER_SHORT;
+					nextSlot = slot;
+				}
+				break;
+			}
+			batchClients[numRequests] = client;
+			batchLengths[numRequests++] = len;
+			numBytes += len;
+			offset += MCRSV_HEADER_BYTES;
+			client->tokens -= len;
+			client->isThrottled = false;
+		}
+		if (client->fd >= 0 && offset > 0) {
+			client->inputBytes -= offset;
+			memmove(client->input, client->input + offset, client->inputBytes);
+			updateEvents(client);
+		}
+	}
+	if (numRequests == 0) {
+		return status;
+	}
+
+	bool isSuccess = buffer.getRandom(pBatchBytes, (uint32_t) numBytes);
+	if (!isSuccess) {
+		fprintf(stderr, "Failed to retrieve %llu random bytes, error: %s\n",
+				(unsigned long long) numBytes, buffer.getLastErrMsg());
+	}
+	stats.batches++;
+	if (numRequests > stats.maxBatchRequests) {
+		stats.maxBatchRequests = numRequests;
+	}
+
+	// Requests of a client are next to each other in the batch
+	const uint8_t *bytes = pBatchBytes;
+	uint32_t first = 0;
+	while (first < numRequests) {
+		uint32_t last = first;
+		uint64_t clientBytes = 0;
+		while (last < numRequests && batchClients[last] == batchClients[first]) {
+			clientBytes += batchLengths[last++];
+		}
+		if (batchClients[first]->fd >= 0) {
+			sendResponses(batchClients[first], batchLengths + first, bytes, last - first, isSuccess);
+		}
+		bytes += clientBytes;
+		first = last;
+	}
+	memset(pBatchBytes, 0, numBytes);
+	return status;
+}
+
+/**
+ * Compute how long the main loop may wait for events
+ *
+ * @param uint64_t nowNanos - CLOCK_MONOTONIC time in nanoseconds
+ * @param int batchStatus - result of the last batch
+ * @return int - timeout in milliseconds, -1 to wait for the next event
+ */
+static int computeTimeout(uint64_t nowNanos, int batchStatus) {
+	if (batchStatus == MCRSV_BATCH_BACKLOGGED) {
+		return 0;
+	}
+	if (batchStatus == MCRSV_BATCH_BUFFER_SHORT) {
+		// Rate limits only postpone requests further
+		return MCRSV_BUFFER_WAIT_MS;
+	}
+	if (rateLimitBytes == 0) {
+		return -1;
+	}
+	bool hasDeadline = false;
+	double minWaitNanos = 0;
+	for (uint32_t slot = 0; slot < maxClients; slot++) {
+		McrsvClient *client = &pClients[slot];
+		// Clients with queued responses are served again once their socket accepts the output
+		if (client->fd < 0 || !client->isThrottled || client->outputBytes > 0
+				|| client->inputBytes < MCRSV_HEADER_BYTES) {
+			continue;
+		}
+		double waitNanos = -client->tokens * 1000000000 / rateLimitBytes
+				- (double) (nowNanos - client->tokenNanos);
+		if (waitNanos < 0) {
+			waitNanos = 0;
+		}
+		if (!hasDeadline || waitNanos < minWaitNanos) {
+			minWaitNanos = waitNanos;
+			hasDeadline = true;
+		}
+	}
+	if (!hasDeadline) {
+		return -1;
+	}
+	return (int) (minWaitNanos / 1000000) + 1;
+}
+
+/**
+ * Print server, client and buffer counters to standard error
+ */
+static void printStats() {
+	fprintf(stderr, "Server stats: %u clients, %llu connections, %llu rejected, %llu protocol errors, "
+			"%llu requests, %llu failed, %llu bytes, %llu batches, %.1f requests per batch, "
+			"max %u requests per batch, %llu throttles, %llu partial writes\n",
+			numClients, (unsigned long long) stats.connections, (unsigned long long) stats.rejectedConnections,
+			(unsigned long long) stats.protocolErrors, (unsigned long long) stats.requests,
+			(unsigned long long) stats.failedRequests, (unsigned long long) stats.bytesServed,
+			(unsigned long long) stats.batches,
+			stats.batches > 0 ? (double) stats.requests / stats.batches : 0, stats.maxBatchRequests,
+			(unsigned long long) stats.throttles, (unsigned long long) stats.partialWrites);
+	uint64_t nowNanos = getMonotonicNanos();
+	for (uint32_t slot = 0; slot < maxClients; slot++) {
+		McrsvClient *client = &pClients[slot];
+		if (client->fd < 0) {
+			continue;
+		}
+		double connectedSecs = (double) (nowNanos - client->connectNanos) / 1000000000;
+		fprintf(stderr, "    client %s: %llu requests, %llu bytes, %.0f bytes/s, %llu throttles, %u bytes queued\n",
+				client->address, (unsigned long long) client->requests, (unsigned long long) client->bytesServed,
+				connectedSecs > 0 ? client->bytesServed / connectedSecs : 0,
+				(unsigned long long) client->throttles, client->outputBytes);
+	}
+	MicroRngBufferStats bufferStats;
+	buffer.getStats(&bufferStats);
+	fprintf(stderr, "Buffer stats: %u of %u bytes available, %llu hits, %llu misses, %.3f s waited, "
+			"%llu refills, %llu refill failures\n",
+			bufferStats.availableBytes, bufferSizeBytes, (unsigned long long) bufferStats.hits,
+			(unsigned long long) bufferStats.misses, (double) bufferStats.missWaitNanos / 1000000000,
+			(unsigned long long) bufferStats.refills, (unsigned long long) bufferStats.refillFailures);
+}
+
+/**
+ * Serve clients until termination is requested
+ *
+ * @return int - 0 when run successfully
+ */
+static int runServer() {
+	pClients = (McrsvClient*) calloc(maxClients, sizeof(McrsvClient));
+	pBatchBytes = (uint8_t*) malloc(MCRSV_MAX_BATCH_BYTES);
+	if (pClients == nullptr || pBatchBytes == nullptr) {
+		fprintf(stderr, "Cannot allocate memory for %u clients\n", maxClients);
+		return -1;
+	}
+	for (uint32_t slot = 0; slot < maxClients; slot++) {
+		pClients[slot].fd = -1;
+	}
+
+	if (connectDevice() != 0) {
+		return -1;
+	}
+
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	if (epollFd < 0) {
+		fprintf(stderr, "Cannot create epoll instance, error: %s\n", strerror(errno));
+		return -1;
+	}
+	if (strlen(tcpAddress) > 0 && listenTcp() != 0) {
+		return -1;
+	}
+	if (strlen(unixSocketPath) > 0 && listenUnix() != 0) {
+		return -1;
+	}
+
+	// Signals are only delivered while waiting for events, so none is missed between checks
+	sigset_t blockedSignals;
+	sigset_t waitSignals;
+	sigemptyset(&blockedSignals);
+	sigaddset(&blockedSignals, SIGTERM);
+	sigaddset(&blockedSignals, SIGINT);
+	sigaddset(&blockedSignals, SIGHUP);
+	sigaddset(&blockedSignals, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &blockedSignals, &waitSignals);
+	sigdelset(&waitSignals, SIGTERM);
+	sigdelset(&waitSignals, SIGINT);
+	sigdelset(&waitSignals, SIGHUP);
+	sigdelset(&waitSignals, SIGUSR1);
+
+	struct sigaction action = { };
+	action.sa_handler = handleTerminationSignal;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGTERM, &action, nullptr);
+	sigaction(SIGINT, &action, nullptr);
+	sigaction(SIGHUP, &action, nullptr);
+	struct sigaction statsAction = { };
+	statsAction.sa_handler = handleStatsSignal;
+	sigemptyset(&statsAction.sa_mask);
+	sigaction(SIGUSR1, &statsAction, nullptr);
+	struct sigaction ignoreAction = { };
+	ignoreAction.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &ignoreAction, nullptr);
+
+	int status = 0;
+	int timeoutMs = -1;
+	struct epoll_event events[64];
+	while (!isTerminationRequested) {
+		if (isStatsDumpRequested) {
+			isStatsDumpRequested = 0;
+			printStats();
+		}
+		int numEvents = epoll_pwait(epollFd, events, 64, timeoutMs, &waitSignals);
+		if (numEvents < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "Cannot wait for events, error: %s\n", strerror(errno));
+			status = -1;
+			break;
+		}
+		for (int i = 0; i < numEvents; i++) {
+			uint64_t tag = events[i].data.u64;
+			if (tag < MCRSV_CLIENT_TAG) {
+				acceptClients(listenerFds[tag]);
+				continue;
+			}
+			McrsvClient *client = &pClients[tag - MCRSV_CLIENT_TAG];
+			if (client->fd < 0) {
+				continue;
+			}
+			if (events[i].events & EPOLLERR) {
+				closeClient(client);
+				continue;
+			}
+			if ((events[i].events & EPOLLOUT) && !flushOutput(client)) {
+				continue;
+			}
+			if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+				readRequests(client);
+			}
+		}
+		uint64_t nowNanos = getMonotonicNanos();
+		timeoutMs = computeTimeout(nowNanos, serveBatch(nowNanos));
+	}
+
+	if (isStatsReportEnabled) {
+		printStats();
+	}
+	for (uint32_t slot = 0; slot < maxClients; slot++) {
+		closeClient(&pClients[slot]);
+	}
+	for (uint32_t i = 0; i < numListeners; i++) {
+		close(listenerFds[i]);
+	}
+	if (strlen(unixSocketPath) > 0) {
+		removeStaleSocket();
+	}
+	close(epollFd);
+	buffer.stop();
+	spi.disconnect();
+	free(pBatchBytes);
+	free(pClients);
+	return status;
+}
+
+/**
+ * Main entry
+ *
+ * @param int argc - number of parameters
+ * @param char ** argv - parameters
+ *
+ */
+int main(int argc, char **argv) {
+	if (processArguments(argc, argv) != 0) {
+		return -1;
+	}
+	return runServer() == 0 ? 0 : -1;
+}
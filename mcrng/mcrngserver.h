@@ -0,0 +1,261 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file mcrngserver.h
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief serves random bytes from MicroRNG device to network clients over TCP and Unix domain sockets, on Raspberry PI 3+ or other Linux-based single-board computers.
+ *
+ *    Protocol: a client sends requests, each one a 4 byte big-endian number of random bytes wanted,
+ *    between 1 and MCRSV_MAX_REQUEST_BYTES. Requests may be pipelined. The server answers the requests
+ *    in order, each response is a 4 byte big-endian length followed by that many random bytes.
+ *    A zero length response reports a failed device retrieval, the client may retry the request.
+ *    Any other request length closes the connection.
+ *
+ *    A single epoll loop serves all clients: the pending requests of all clients are coalesced into one read
+ *    of the MicroRngBuffer and each client's responses are written with one writev() call. Clients may be
+ *    rate limited to a number of bytes per second, server and client counters are printed on SIGUSR1.
+ */
+#ifndef MCRNGSERVER_H_
+#define MCRNGSERVER_H_
+
+#include "MicroRngSPI.h"
+#include "MicroRngBuffer.h"
+#include <unistd.h>
+
+#include <stdlib.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#define DEFAULT_SPI_DEV_PATH "/dev/spidev0.0"
+#define MCRSV_DEFAULT_UNIX_SOCKET "/run/mcrng-server.sock"
+#define MCRSV_DEFAULT_PERMISSIONS (0666)
+#define MCRSV_DEFAULT_MAX_CLIENTS (256)
+#define MCRSV_MAX_CLIENTS (65536)
+#define MCRSV_MAX_LISTENERS (2)
+#define MCRSV_LISTEN_BACKLOG (128)
+
+/**
+ * Max amount of random bytes a single request may ask for
+ */
+#define MCRSV_MAX_REQUEST_BYTES (1048576)
+
+/**
+ * Size of the request header and of the response header
+ */
+#define MCRSV_HEADER_BYTES (4)
+
+/**
+ * Amount of received request bytes buffered per client, pipelined requests beyond it wait in the socket
+ */
+#define MCRSV_INPUT_BUFFER_BYTES (1024)
+
+/**
+ * Max amount of requests and of random bytes coalesced into one read from the buffered device
+ */
+#define MCRSV_MAX_BATCH_REQUESTS (4096)
+#define MCRSV_MAX_BATCH_BYTES (4194304)
+
+/**
+ * Results of serving a batch: no requests left over, requests left over for the next batch,
+ * or requests waiting for the buffer to hold enough random bytes
+ */
+#define MCRSV_BATCH_DONE (0)
+#define MCRSV_BATCH_BACKLOGGED (1)
+#define MCRSV_BATCH_BUFFER_SHORT (2)
+
+/**
+ * How long the main loop waits for the buffer to refill before serving the waiting requests, in milliseconds
+ */
+#define MCRSV_BUFFER_WAIT_MS (1)
+
+/**
+ * Max amount of responses written with one writev() call, two iovec entries each
+ */
+#define MCRSV_MAX_WRITEV_RESPONSES (512)
+
+/**
+ * epoll tag of the client events, listener events are tagged with the listener index
+ */
+#define MCRSV_CLIENT_TAG (1ULL << 32)
+
+/**
+ * A client connection, its pending requests and responses and its counters
+ */
+struct McrsvClient {
+	int fd;
+	char address[128];
+	uint8_t input[MCRSV_INPUT_BUFFER_BYTES];
+	uint32_t inputBytes;
+	bool isInputClosed;		// the client shut down its sending side, answer the requests received so far
+	uint8_t *pOutput;		// response bytes not accepted by the socket yet
+	uint32_t outputBytes;
+	uint32_t outputOffset;
+	uint32_t outputCapacity;
+	uint32_t epollEvents;
+	double tokens;			// rate limit token bucket, in bytes, negative while throttled
+	uint64_t tokenNanos;
+	bool isThrottled;
+	uint64_t requests;
+	uint64_t bytesServed;
+	uint64_t throttles;
+	uint64_t connectNanos;
+};
+
+/**
+ * Counters of the server
+ */
+struct McrsvStats {
+	uint64_t connections;		// accepted connections
+	uint64_t rejectedConnections;	// connections closed because of the client limit
+	uint64_t protocolErrors;	// connections closed because of invalid requests
+	uint64_t requests;		// answered requests
+	uint64_t failedRequests;	// requests answered with a zero length response
+	uint64_t bytesServed;		// random bytes sent
+	uint64_t batches;		// reads from the buffered device
+	uint32_t maxBatchRequests;	// most requests coalesced into one read
+	uint64_t throttles;		// times a client waited for its rate limit
+	uint64_t partialWrites;		// responses queued because the socket didn't accept them
+};
+
+/**
+ * SPI device path (a command line argument)
+ */
+static char devicePath[256];
+
+/**
+ * Max SPI master clock frequency in Hz (a command line argument)
+ */
+static uint32_t maxSpiMasterClock = 250000;
+
+/**
+ * True when the SPI master clock frequency is set with a command line argument,
+ * otherwise the calibrated frequency is used
+ */
+static bool isClockFrequencySpecified = false;
+
+/**
+ * Lower the SPI master clock frequency on communication errors and probe it back up when stable (a command line argument)
+ */
+static bool isAdaptiveClock = false;
+
+/**
+ * TCP listening address as HOST:PORT (a command line argument), empty when not listening on TCP
+ */
+static char tcpAddress[256];
+
+/**
+ * Unix domain socket path (a command line argument), empty when not listening on a Unix domain socket
+ */
+static char unixSocketPath[108];
+
+/**
+ * Access permissions of the Unix domain socket (a command line argument)
+ */
+static mode_t socketPermissions = MCRSV_DEFAULT_PERMISSIONS;
+
+/**
+ * Size of the random byte buffer kept filled by the device (a command line argument)
+ */
+static uint32_t bufferSizeBytes = MCR_BUFFER_DEFAULT_CAPACITY_BYTES * 16;
+
+/**
+ * Refill watermarks of the random byte buffer in bytes, 0 for the buffer defaults (command line arguments)
+ */
+static uint32_t lowWatermarkBytes = 0;
+static uint32_t highWatermarkBytes = 0;
+
+/**
+ * Idle time in milliseconds before the noise sources are shut down while the buffer is full,
+ * 0 to keep them on (a command line argument)
+ */
+static uint32_t idleTimeoutMs = 0;
+
+/**
+ * Max amount of simultaneously connected clients (a command line argument)
+ */
+static uint32_t maxClients = MCRSV_DEFAULT_MAX_CLIENTS;
+
+/**
+ * Max amount of random bytes per second served to each client, 0 for unlimited (a command line argument)
+ */
+static uint64_t rateLimitBytes = 0;
+
+/**
+ * Print server counters at exit (a command line argument), counters are also printed when receiving SIGUSR1
+ */
+static bool isStatsReportEnabled = false;
+
+static volatile sig_atomic_t isTerminationRequested = 0;
+static volatile sig_atomic_t isStatsDumpRequested = 0;
+static MicroRngSPI spi;
+static MicroRngBuffer buffer(spi);
+static int epollFd = -1;
+static int listenerFds[MCRSV_MAX_LISTENERS] = { -1, -1 };
+static uint32_t numListeners = 0;
+static McrsvClient *pClients = nullptr;
+static uint32_t numClients = 0;
+static uint8_t *pBatchBytes = nullptr;
+static McrsvStats stats;
+
+/**
+ * Function Declarations
+ */
+static void displayUsage();
+static int processArguments(int argc, char **argv);
+static bool validateArgumentCount(int curIdx, int actualArgumentCount);
+static void handleTerminationSignal(int signum);
+static void handleStatsSignal(int signum);
+static uint64_t getMonotonicNanos();
+static int connectDevice();
+static int addListener(int fd);
+static int listenTcp();
+static int removeStaleSocket();
+static int listenUnix();
+static void acceptClients(int listenerFd);
+static void closeClient(McrsvClient *client);
+static void closeIfDone(McrsvClient *client);
+static void updateEvents(McrsvClient *client);
+static void readRequests(McrsvClient *client);
+static bool flushOutput(McrsvClient *client);
+static bool queueOutput(McrsvClient *client, const struct iovec *iov, int numIov, size_t skipBytes);
+static void refillTokens(McrsvClient *client, uint64_t nowNanos);
+static int serveBatch(uint64_t nowNanos);
+static void sendResponses(McrsvClient *client, const uint32_t *lengths, const uint8_t *bytes,
+		uint32_t numResponses, bool isSuccess);
+static int computeTimeout(uint64_t nowNanos, int batchStatus);
+static void printStats();
+static int runServer();
+
+#endif /* MCRNGSERVER_H_ */
@@ -0,0 +1,384 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file mcrngshm.cpp
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief keeps a shared-memory ring of random bytes from MicroRNG device filled for local consumer processes, on Raspberry PI 3+ or other Linux-based single-board computers.
+ *
+ */
+#include "mcrngshm.h"
+
+/**
+ * Display usage message
+ *
+ */
+static void displayUsage() {
+    printf("---------------------------------------------------------------------------\n");
+    printf("---   TectroLabs - mcrngshm - MicroRNG shared-memory server Version 1.0  ---\n");
+    printf("---     Use with RPI 3+ or other Linux-based single-board computers     ---\n");
+    printf("---------------------------------------------------------------------------\n");
+    printf("NAME\n");
+    printf("     mcrngshm  - True Random Number Generator MicroRNG shared-memory server \n");
+    printf("SYNOPSIS\n");
+    printf("     mcrngshm  [options] \n");
+    printf("\n");
+    printf("DESCRIPTION\n");
+    printf("     Mcrngshm keeps a POSIX shared-memory ring filled with random bytes from\n");
+    printf("     MicroRNG device. Local processes fetch bytes from the ring using the\n");
+    printf("     MicroRngShmClient class declared in MicroRngShm.h.\n");
+    printf("\n");
+    printf("OPTIONS\n");
+    printf("     Operation modifiers:\n");
+    printf("\n");
+    printf("     -dp PATH, --device-path PATH\n");
+    printf("           SPI device path, default value: /dev/spidev0.0\n");
+    printf("\n");
+    printf("     -cf NUMBER, --clock-frequency NUMBER\n");
+    printf("           SPI master clock frequency in KHz, max value 60000,\n");
+    printf("           skip this option for the max frequency calibrated for the device,\n");
+    printf("           detected on first use and kept in %s.\n", MCR_SPI_CALIBRATION_CACHE_DIR);
+    printf("           Use 'mcdiag' utility to re-calibrate the max frequency.\n");
+    printf("\n");
+    printf("     -ac, --adaptive-clock\n");
+    printf("           check the communication periodically with test bytes, drop the\n");
+    printf("           SPI clock frequency a step on errors and retry, then probe it\n");
+    printf("           back up to the max frequency once the communication is stable\n");
+    printf("\n");
+    printf("     -sn NAME, --shm-name NAME\n");
+    printf("           shared-memory segment NAME, default value: /microrng\n");
+    printf("\n");
+    printf("     -rs NUMBER, --ring-size NUMBER\n");
+    printf("           NUMBER of bytes in the shared ring, a power of two,\n");
+    printf("           default value: 1048576\n");
+    printf("\n");
+    printf("     -cs NUMBER, --chunk-size NUMBER\n");
+    printf("           NUMBER of bytes retrieved from the device per refill,\n");
+    printf("           default value: 4096\n");
+    printf("\n");
+    printf("     -pm MODE, --permissions MODE\n");
+    printf("           octal access MODE of the shared-memory segment,\n");
+    printf("           default value: 660\n");
+    printf("EXAMPLES:\n");
+    printf("     It may require 'sudo' permissions to run this utility.\n");
+    printf("     To serve random bytes to local processes using device path\n");
+    printf("           mcrngshm  -dp /dev/spidev0.0 -cf 20000 -sn /microrng\n");
+    printf("\n");
+}
+
+/**
+ * Validate command line argument count
+ *
+ * @param int curIdx
+ * @param int actualArgumentCount
+ * @return true if run successfully
+ */
+static bool validateArgumentCount(int curIdx, int actualArgumentCount) {
+	if (curIdx >= actualArgumentCount) {
+		fprintf(stderr, "\nMissing command line arguments\n\n");
+		displayUsage();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Parse arguments for extracting command line parameters
+ *
+ * @param int argc
+ * @param char** argv
+ * @return int - 0 when run successfully
+ */
+static int processArguments(int argc, char **argv) {
+	int idx = 1;
+	strcpy(devicePath, DEFAULT_SPI_DEV_PATH);
+	strcpy(shmName, MCR_SHM_DEFAULT_NAME);
+	while (idx < argc) {
+		if (strcmp("-dp", argv[idx]) == 0
+				|| strcmp("--device-path", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			strcpy(devicePath, argv[idx++]);
+		} else if (strcmp("-cf", argv[idx]) == 0
+				|| strcmp("--clock-frequency", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			maxSpiMasterClock = (uint32_t) atoi(argv[idx++]) * 1000;
+			isClockFrequencySpecified = true;
+		} else if (strcmp("-ac", argv[idx]) == 0
+				|| strcmp("--adaptive-clock", argv[idx]) == 0) {
+			isAdaptiveClock = true;
+			++idx;
+		} else if (strcmp("-sn", argv[idx]) == 0
+				|| strcmp("--shm-name", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			if (argv[idx][0] != '/' || strlen(argv[idx]) >= sizeof(shmName)) {
+				fprintf(stderr, "Shared-memory name must start with '/'\n");
+				return -1;
+			}
+			strcpy(shmName, argv[idx++]);
+		} else if (strcmp("-rs", argv[idx]) == 0
+				|| strcmp("--ring-size", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			int64_t value = atoll(argv[idx++]);
+			if (value < MCRS_MIN_RING_SIZE_BYTES || value > MCRS_MAX_RING_SIZE_BYTES
+					|| (value & (value - 1)) != 0) {
+				fprintf(stderr, "Ring size must be a power of two between %d and %d\n",
+						MCRS_MIN_RING_SIZE_BYTES, MCRS_MAX_RING_SIZE_BYTES);
+				return -1;
+			}
+			ringSizeBytes = (uint64_t) value;
+		} else if (strcmp("-cs", argv[idx]) == 0
+				|| strcmp("--chunk-size", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			int value = atoi(argv[idx++]);
+			if (value <= 0) {
+				fprintf(stderr, "Chunk size must be a positive number\n");
+				return -1;
+			}
+			chunkSizeBytes = (uint32_t) value;
+		} else if (strcmp("-pm", argv[idx]) == 0
+				|| strcmp("--permissions", argv[idx]) == 0) {
+			if (validateArgumentCount(++idx, argc) == false) {
+				return -1;
+			}
+			shmPermissions = (mode_t) strtol(argv[idx++], nullptr, 8) & 0777;
+		} else if (strcmp("-h", argv[idx]) == 0
+				|| strcmp("--help", argv[idx]) == 0) {
+			displayUsage();
+			return -1;
+		} else {
+			// Could not handle the argument, skip to the next one
+			++idx;
+		}
+	}
+	if (chunkSizeBytes > ringSizeBytes) {
+		chunkSizeBytes = (uint32_t) ringSizeBytes;
+	}
+	return 0;
+}
+
+/**
+ * Request the main loop to stop
+ *
+ * @param int signum - signal number
+ */
+static void handleTerminationSignal(int signum) {
+	(void) signum;
+	isTerminationRequested = 1;
+}
+
+/**
+ * Create and map the shared-memory segment holding the ring
+ *
+ * @return int - 0 when run successfully
+ */
+static int createSharedRing() {
+	// Clients still mapping a previous segment keep their copy until they re-open
+	shm_unlink(shmName);
+	int fd = shm_open(shmName, O_RDWR | O_CREAT | O_EXCL, shmPermissions);
+	if (fd < 0) {
+		fprintf(stderr, "Cannot create shared-memory segment %s, error: %s\n", shmName,
+				strerror(errno));
+		return -1;
+	}
+	// Not affected by umask
+	fchmod(fd, shmPermissions);
+
+	size_t dataOffset = (sizeof(MicroRngShmHeader) + MCR_SHM_CACHE_LINE - 1)
+			/ MCR_SHM_CACHE_LINE * MCR_SHM_CACHE_LINE;
+	shmSizeBytes = dataOffset + ringSizeBytes;
+	if (ftruncate(fd, (off_t) shmSizeBytes) != 0) {
+		fprintf(stderr, "Cannot size shared-memory segment %s, error: %s\n", shmName,
+				strerror(errno));
+		close(fd);
+		shm_unlink(shmName);
+		return -1;
+	}
+	void *addr = mmap(nullptr, shmSizeBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) {
+		fprintf(stderr, "Cannot map shared-memory segment %s, error: %s\n", shmName,
+				strerror(errno));
+		shm_unlink(shmName);
+		return -1;
+	}
+
+	pShmHeader = new (addr) MicroRngShmHeader();
+	pShmHeader->capacity = ringSizeBytes;
+	pShmHeader->dataOffset = dataOffset;
+	pShmHeader->writePos.store(0, std::memory_order_relaxed);
+	pShmHeader->readPos.store(0, std::memory_order_relaxed);
+	pShmHeader->serverActive.store(1, std::memory_order_relaxed);
+	pShmHeader->version = MCR_SHM_VERSION;
+	pRingData = (uint8_t*) addr + dataOffset;
+	// Clients validate the magic number last
+	std::atomic_thread_fence(std::memory_order_release);
+	pShmHeader->magic = MCR_SHM_MAGIC;
+	return 0;
+}
+
+/**
+ * Mark the ring inactive, unmap and remove the shared-memory segment
+ */
+static void removeSharedRing() {
+	if (pShmHeader != nullptr) {
+		pShmHeader->serverActive.store(0, std::memory_order_release);
+		munmap(pShmHeader, shmSizeBytes);
+		pShmHeader = nullptr;
+		pRingData = nullptr;
+		shm_unlink(shmName);
+	}
+}
+
+/**
+ * Retrieve random bytes from the device straight into the free space of the ring
+ *
+ * @param uint64_t writePos - ring position to fill from
+ * @param uint32_t numBytes - how many bytes to retrieve
+ * @return true if retrieved successfully
+ */
+static bool fillRing(uint64_t writePos, uint32_t numBytes) {
+	uint64_t offset = writePos & (ringSizeBytes - 1);
+	uint32_t firstPart = numBytes;
+	if (offset + numBytes > ringSizeBytes) {
+		firstPart = (uint32_t) (ringSizeBytes - offset);
+	}
+	if (!spi.retrieveRandomBytes(firstPart, pRingData + offset)) {
+		return false;
+	}
+	if (firstPart < numBytes && !spi.retrieveRandomBytes(numBytes - firstPart, pRingData)) {
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Zero the ring bytes claimed by consumers, so they can't be read from the ring any more
+ *
+ * @param uint64_t fromPos - ring position of the first claimed byte not wiped yet
+ * @param uint64_t toPos - current read position
+ */
+static void wipeRing(uint64_t fromPos, uint64_t toPos) {
+	uint64_t offset = fromPos & (ringSizeBytes - 1);
+	uint64_t numBytes = toPos - fromPos;
+	if (offset + numBytes > ringSizeBytes) {
+		memset(pRingData + offset, 0, ringSizeBytes - offset);
+		numBytes -= ringSizeBytes - offset;
+		offset = 0;
+	}
+	memset(pRingData + offset, 0, numBytes);
+}
+
+/**
+ * Keep the shared ring filled until termination is requested
+ *
+ * @return int - 0 when run successfully
+ */
+static int runServer() {
+	if (!spi.connect(devicePath)) {
+		fprintf(stderr, " Cannot open SPI device %s, error: %s ... \n",
+				devicePath, spi.getLastErrMsg());
+		return -1;
+	}
+
+	if (isClockFrequencySpecified) {
+		spi.setMaxClockFrequency(maxSpiMasterClock);
+	} else if (!spi.calibrateClockFrequency()) {
+		fprintf(stderr, " Cannot calibrate SPI clock frequency, error: %s ... \n",
+				spi.getLastErrMsg());
+		return -1;
+	}
+	spi.setAdaptiveClock(isAdaptiveClock, 0, 0);
+
+	if (!spi.validateDevice()) {
+		fprintf(stderr, " Cannot access device, error: %s ... \n",
+				spi.getLastErrMsg());
+		return -1;
+	}
+
+	if (createSharedRing() != 0) {
+		return -1;
+	}
+
+	struct sigaction action = { };
+	action.sa_handler = handleTerminationSignal;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGTERM, &action, nullptr);
+	sigaction(SIGINT, &action, nullptr);
+	sigaction(SIGHUP, &action, nullptr);
+
+	int status = 0;
+	uint64_t writePos = 0;
+	uint64_t wipedPos = 0;
+	while (!isTerminationRequested) {
+		// Consumers release ring space by advancing the read position
+		uint64_t readPos = pShmHeader->readPos.load(std::memory_order_acquire);
+		// A consumer that copied bytes claimed by another one fails its own claim, so wiping them is safe
+		wipeRing(wipedPos, readPos);
+		wipedPos = readPos;
+		uint64_t freeBytes = ringSizeBytes - (writePos - readPos);
+		if (freeBytes < chunkSizeBytes) {
+			usleep(MCRS_IDLE_SLEEP_USECS);
+			continue;
+		}
+		uint32_t numBytes = chunkSizeBytes;
+		if (!fillRing(writePos, numBytes)) {
+			fprintf(stderr, "Failed to receive %u bytes, error: %s. \n", numBytes,
+					spi.getLastErrMsg());
+			status = -1;
+			break;
+		}
+		writePos += numBytes;
+		pShmHeader->writePos.store(writePos, std::memory_order_release);
+	}
+
+	wipeRing(wipedPos, pShmHeader->readPos.load(std::memory_order_acquire));
+	removeSharedRing();
+	spi.disconnect();
+	return status;
+}
+
+/**
+ * Main entry
+ *
+ * @param int argc - number of parameters
+ * @param char ** argv - parameters
+ *
+ */
+int main(int argc, char **argv) {
+	if (processArguments(argc, argv) != 0) {
+		return -1;
+	}
+	return runServer() == 0 ? 0 : -1;
+}
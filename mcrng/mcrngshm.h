@@ -0,0 +1,113 @@
+/**
+ *   Copyright (C) 2014-2023 TectroLabs LLC, https://tectrolabs.com
+ *
+ *    Permission is hereby granted, free of charge, to any person obtaining
+ *    a copy of this software and associated documentation files (the "Software"),
+ *    to deal in the Software without restriction, including without limitation
+ *    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *    and/or sell copies of the Software, and to permit persons to whom the Software
+ *    is furnished to do so, subject to the following conditions:
+ *
+ *    The above copyright notice and this permission notice shall be included in
+ *    all copies or substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *    OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ *    @file mcrngshm.h
+ *    @author Andrian Belinski
+ *    @date 10/14/2026
+ *    @version 1.0
+ *
+ *    @brief keeps a shared-memory ring of random bytes from MicroRNG device filled for local consumer processes, on Raspberry PI 3+ or other Linux-based single-board computers.
+ *
+ */
+#ifndef MCRNGSHM_H_
+#define MCRNGSHM_H_
+
+#include "MicroRngSPI.h"
+#include "MicroRngShm.h"
+#include <unistd.h>
+
+#include <stdlib.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <new>
+
+#define DEFAULT_SPI_DEV_PATH "/dev/spidev0.0"
+#define MCRS_DEFAULT_RING_SIZE_BYTES (1048576)
+#define MCRS_MIN_RING_SIZE_BYTES (4096)
+#define MCRS_MAX_RING_SIZE_BYTES (1073741824)
+#define MCRS_DEFAULT_CHUNK_SIZE_BYTES (4096)
+#define MCRS_DEFAULT_PERMISSIONS (0660)
+#define MCRS_IDLE_SLEEP_USECS (500)
+
+/**
+ * SPI device path
+ */
+static char devicePath[256];
+
+/**
+ * Max SPI master clock frequency in Hz (a command line argument)
+ */
+static uint32_t maxSpiMasterClock = 250000;
+
+/**
+ * True when the SPI master clock frequency is set with a command line argument,
+ * otherwise the calibrated frequency is used
+ */
+static bool isClockFrequencySpecified = false;
+
+/**
+ * Lower the SPI master clock frequency on communication errors and probe it back up when stable (a command line argument)
+ */
+static bool isAdaptiveClock = false;
+
+/**
+ * Name of the shared-memory segment (a command line argument)
+ */
+static char shmName[256];
+
+/**
+ * Size of the shared ring in bytes, a power of two (a command line argument)
+ */
+static uint64_t ringSizeBytes = MCRS_DEFAULT_RING_SIZE_BYTES;
+
+/**
+ * Max amount of random bytes retrieved from the device per refill (a command line argument)
+ */
+static uint32_t chunkSizeBytes = MCRS_DEFAULT_CHUNK_SIZE_BYTES;
+
+/**
+ * Access permissions of the shared-memory segment (a command line argument)
+ */
+static mode_t shmPermissions = MCRS_DEFAULT_PERMISSIONS;
+
+static volatile sig_atomic_t isTerminationRequested = 0;
+static MicroRngShmHeader *pShmHeader = nullptr;
+static uint8_t *pRingData = nullptr;
+static size_t shmSizeBytes = 0;
+static MicroRngSPI spi;
+
+/**
+ * Function Declarations
+ */
+static void displayUsage();
+static int processArguments(int argc, char **argv);
+static bool validateArgumentCount(int curIdx, int actualArgumentCount);
+static void handleTerminationSignal(int signum);
+static int createSharedRing();
+static void removeSharedRing();
+static bool fillRing(uint64_t writePos, uint32_t numBytes);
+static void wipeRing(uint64_t fromPos, uint64_t toPos);
+static int runServer();
+
+#endif /* MCRNGSHM_H_ */
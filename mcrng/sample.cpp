@@ -30,12 +30,16 @@
  *
  */
 #include "MicroRngSPI.h"
+#include "MicroRngBuffer.h"
+#include "MicroRngDistribution.h"
 
 #define BYTE_BUFF_SIZE (10)
 #define DEC_BUFF_SIZE (10)
+#define DIE_ROLL_COUNT (10)
 
 static unsigned char randombyte[BYTE_BUFF_SIZE]; // Allocate memory for random bytes
 static unsigned int randomint[DEC_BUFF_SIZE]; // Allocate memory for random integers
+static uint32_t dieRolls[DIE_ROLL_COUNT]; // Allocate memory for die rolls
 
 //
 // Main entry
@@ -106,6 +110,24 @@ int main(int argc, char **argv) {
 		printf("random number -> %lf\n", d);
 	}
 
+	// Unbiased values without wasting random bits, drawn from a buffer kept filled by a background thread
+	MicroRngBuffer buffer(spi);
+	MicroRngDistribution distribution(buffer);
+	if (!buffer.start(MCR_BUFFER_DEFAULT_CAPACITY_BYTES)) {
+		printf("%s\n", buffer.getLastErrMsg());
+		return -1;
+	}
+	if (!distribution.fillUniform(dieRolls, DIE_ROLL_COUNT, 6)) {
+		printf("%s\n", distribution.getLastErrMsg());
+		return -1;
+	}
+
+	printf("\n*** Rolling a die %d times ***\n", DIE_ROLL_COUNT);
+	for (i = 0; i < DIE_ROLL_COUNT; i++) {
+		printf("die roll -> %u\n", dieRolls[i] + 1);
+	}
+	buffer.stop();
+
 	printf("\n");
 	return 0;
 